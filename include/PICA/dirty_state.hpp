@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+
+#include "PICA/regs.hpp"
+#include "helpers.hpp"
+
+namespace PICA {
+	// Groups of GPU state that internal register writes can invalidate. The GPU ORs in the groups affected by every register whose value changes,
+	// and renderers use them to avoid re-deriving state (shader configs, uniforms, host pipeline state) that hasn't changed since the last draw
+	namespace DirtyState {
+		enum : u32 {
+			Viewport = 1 << 0,
+			Clip = 1 << 1,
+			Depth = 1 << 2,
+			Stencil = 1 << 3,
+			Blend = 1 << 4,  // Blending, logic ops and alpha test
+			Textures = 1 << 5,
+			TexEnv = 1 << 6,
+			Fog = 1 << 7,
+			Lighting = 1 << 8,
+			Framebuffer = 1 << 9,
+			Attributes = 1 << 10,  // Vertex attribute & index buffer layout
+			Misc = 1 << 11,        // Any other rasterizer register
+
+			All = (1 << 12) - 1,
+			// Everything that's not part of the geometry pipeline
+			Rasterizer = All & ~Attributes,
+
+			// Groups read by PICA::FragmentConfig and by the fragment uniforms respectively
+			FragmentConfig = Blend | Depth | Textures | TexEnv | Fog | Lighting,
+			FragmentUniforms = Blend | Depth | Clip | TexEnv | Fog | Lighting,
+		};
+
+		static constexpr std::array<u32, 0x300> makeRegisterMap() {
+			std::array<u32, 0x300> map{};
+			auto mark = [&map](u32 start, u32 end, u32 groups) {
+				for (u32 i = start; i <= end; i++) {
+					map[i] |= groups;
+				}
+			};
+
+			using namespace InternalRegs;
+			mark(ViewportWidth, ViewportInvh, Viewport);
+			mark(ViewportXY, ViewportXY, Viewport);
+			mark(ClipEnable, ClipData3, Clip);
+			mark(DepthScale, DepthOffset, Depth);
+			mark(DepthmapEnable, DepthmapEnable, Depth);
+
+			mark(TexUnitCfg, 0xBF, Textures);
+			mark(TexEnv0Source, TexEnv3Scale, TexEnv);
+			mark(TexEnv4Source, 0xFF, TexEnv);
+			// The TEV update buffer register also holds the fog mode
+			mark(TexEnvUpdateBuffer, TexEnvUpdateBuffer, TexEnv | Fog);
+			mark(FogColor, FogLUTData7, Fog);
+
+			mark(ColourOperation, AlphaTestConfig, Blend);
+			mark(StencilTest, StencilOp, Stencil);
+			mark(DepthAndColorMask, DepthAndColorMask, Depth);
+			mark(DepthBufferWrite, DepthBufferWrite, Depth | Stencil);
+			mark(DepthBufferFormat, FramebufferSize, Framebuffer);
+
+			// The lighting enable bit lives in the middle of the texture unit registers
+			map[LightingEnable] = Lighting;
+			mark(Light0Specular0, LightLUTScale, Lighting);
+			mark(LightLUTScale + 1, LightPermutation, Lighting);
+
+			mark(VertexAttribLoc, IndexBufferConfig, Attributes);
+			mark(FixedAttribIndex, FixedAttribData2, Attributes);
+			mark(VertexShaderAttrNum, VertexShaderAttrNum, Attributes);
+			mark(VertexShaderInputBufferCfg, VertexShaderInputBufferCfg, Attributes);
+			mark(VertexShaderInputCfgLow, VertexShaderInputCfgHigh, Attributes);
+
+			for (u32 i = 0; i < VertexAttribLoc; i++) {
+				if (map[i] == 0) {
+					map[i] = Misc;
+				}
+			}
+
+			return map;
+		}
+
+		// Maps every internal register to the state groups that need to be rebuilt when its value changes
+		static constexpr std::array<u32, 0x300> registerMap = makeRegisterMap();
+	}  // namespace DirtyState
+}  // namespace PICA
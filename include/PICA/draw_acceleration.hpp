@@ -10,11 +10,12 @@ namespace PICA {
 		static constexpr u32 maxLoaderCount = 12;
 
 		struct AttributeInfo {
-			u32 offset;
+			u32 offset;  // Offset of the attribute from the start of its loader's data
 			u32 stride;
 
 			u8 type;
 			u8 componentCount;
+			u8 loaderIndex;  // Index of the loader that provides this attribute
 
 			std::array<float, 4> fixedValue;  // For fixed attributes
 		};
@@ -23,9 +24,12 @@ namespace PICA {
 			// Data to upload for this loader
 			u8* data;
 			usize size;
+			// Physical address of the data, used for caching uploads
+			u32 address;
 		};
 
 		u8* indexBuffer;
+		u32 indexBufferAddress;
 
 		// Minimum and maximum index in the index buffer for a draw call
 		u16 minimumIndex, maximumIndex;
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+
+#include "PICA/shader.hpp"
+#include "helpers.hpp"
+
+// Decoded form of a PICA shader that the shader JIT runs its optimization passes on before emitting code.
+// The passes find the instructions reachable from the entrypoint, the boundaries of straight-line blocks (where the emitter has to write back
+// registers it keeps in host registers), instructions whose results are never used, and simplify source swizzles and negations
+class ShaderIR {
+  public:
+	// If the swizzle field is this value then the swizzle pattern is .xyzw
+	static constexpr u32 noSwizzle = 0x1B;
+
+	struct Source {
+		u32 reg = 0;             // Register in the PICA source encoding: Inputs, then temporaries, then float uniforms
+		u32 index = 0;           // Which address register is used for relative addressing (0 = none)
+		u32 swizzle = noSwizzle;  // PICA swizzle pattern, with the selector for x in the top 2 bits
+		bool negate = false;
+	};
+
+	struct Instruction {
+		u32 opcode = 0;
+		u32 dest = 0;       // Destination register in the PICA destination encoding, if the instruction has one
+		u32 writeMask = 0;  // Destination write mask in PICA order (x = bit 3, w = bit 0)
+		u32 sourceCount = 0;
+		std::array<Source, 3> sources;
+
+		bool reachable = false;   // Can this instruction be executed when starting from the entrypoint?
+		bool blockStart = false;  // Can this instruction be reached from somewhere other than the instruction right before it?
+		bool dead = false;        // Is the result of this instruction never read?
+	};
+
+	std::array<Instruction, PICAShader::maxInstructionCount> instructions;
+	u32 reachableCount = 0;
+	u32 deadCount = 0;
+
+	// liveOutputs: Mask of the output registers the GPU reads after the shader has run. Writes to the rest are dead
+	void build(const PICAShader& shader, u32 entrypoint, u16 liveOutputs);
+
+	static bool isControlFlow(u32 opcode);
+	// Returns whether the instruction writes its result to a register in the destination field. This excludes CMP, MOVA and control flow
+	static bool writesRegister(u32 opcode);
+
+  private:
+	void decode(const PICAShader& shader);
+	void findReachable(const PICAShader& shader, u32 entrypoint);
+	void eliminateDeadCode(u16 liveOutputs);
+	void foldSources();
+
+	// Lanes of the swizzled source value that the instruction actually consumes, as a mask with x = bit 0
+	static u32 getConsumedLanes(const Instruction& instruction, u32 sourceIndex);
+};
@@ -1,10 +1,10 @@
 #pragma once
 #include "PICA/shader.hpp"
+#include "shared_caches.hpp"
 
 #if defined(PANDA3DS_DYNAPICA_SUPPORTED) && (defined(PANDA3DS_X64_HOST) || defined(PANDA3DS_ARM64_HOST))
 #define PANDA3DS_SHADER_JIT_SUPPORTED
 #include <memory>
-#include <unordered_map>
 
 #ifdef PANDA3DS_X64_HOST
 #include "shader_rec_emitter_x64.hpp"
@@ -16,29 +16,44 @@
 class ShaderJIT {
 #ifdef PANDA3DS_SHADER_JIT_SUPPORTED
 	using Hash = PICAShader::Hash;
-	using ShaderCache = std::unordered_map<Hash, std::unique_ptr<ShaderEmitter>>;
 	ShaderEmitter::PrologueCallback prologueCallback;
 	ShaderEmitter::InstructionCallback entrypointCallback;
 
-	ShaderCache cache;
+	// The shader used by the previous draw. Most draws reuse it, in which case we don't need to look anything up
+	std::shared_ptr<CompiledShader> activeShader = nullptr;
+	Hash activeHash = 0;
+	u32 activeEntrypoint = 0;
+
+#ifdef PANDA3DS_X64_HOST
+	// Scratch emitter that shaders are compiled in before being copied to the shared code arena
+	std::unique_ptr<ShaderEmitter> emitter = nullptr;
+#endif
+	// Used when no shared cache has been set
+	ConcurrentCache<u64, CompiledShader> privateCache{32_MB};
+
+	std::shared_ptr<CompiledShader> compile(PICAShader& shaderUnit, u16 liveOutputs);
 #endif
+	// Compiled shaders shared with other emulator instances. Emitted code doesn't depend on the instance, only on the shader & accurateMul
+	ConcurrentCache<u64, CompiledShader>* sharedCache = nullptr;
 	bool accurateMul = false;
 
   public:
 	void setAccurateMul(bool value) { accurateMul = value; }
+	void setSharedCache(ConcurrentCache<u64, CompiledShader>* cache) { sharedCache = cache; }
 
 #ifdef PANDA3DS_SHADER_JIT_SUPPORTED
 	// Call this before starting to process a batch of vertices
 	// This will read the PICA config (uploaded shader and shader operand descriptors) and search if we've already compiled this shader
 	// If yes, it sets it as the active shader. if not, then it compiles it, adds it to the cache, and sets it as active,
 	// The caller must make sure the entrypoint has been properly set beforehand
-	void prepare(PICAShader& shaderUnit);
+	// liveOutputs is the mask of output registers that are actually read after the shader has run. Writes to the others may be skipped
+	void prepare(PICAShader& shaderUnit, u16 liveOutputs = 0xFFFF);
 	void reset();
 	void run(PICAShader& shaderUnit) { prologueCallback(shaderUnit, entrypointCallback); }
 
 	static constexpr bool isAvailable() { return true; }
 #else
-	void prepare(PICAShader& shaderUnit) {
+	void prepare(PICAShader& shaderUnit, u16 liveOutputs = 0xFFFF) {
 		Helpers::panic("Shader JIT: Tried to run ShaderJIT::Prepare on platform that does not support shader jit");
 	}
 
@@ -3,6 +3,7 @@
 // Only do anything if we're on an x64 target with JIT support enabled
 #if defined(PANDA3DS_DYNAPICA_SUPPORTED) && defined(PANDA3DS_ARM64_HOST)
 #include <array>
+#include <memory>
 #include <oaknut/code_block.hpp>
 #include <oaknut/oaknut.hpp>
 
@@ -132,6 +133,20 @@ class ShaderEmitter : private oaknut::CodeBlock, public oaknut::CodeGenerator {
 
 	PrologueCallback getPrologueCallback() { return prologueCb; }
 	void compile(const PICAShader& shaderUnit);
+
+	static constexpr size_t getCodeBufferSize() { return allocSize; }
+};
+
+// A compiled shader. Each one owns the emitter its code lives in
+class CompiledShader {
+	std::unique_ptr<ShaderEmitter> emitter;
+
+  public:
+	explicit CompiledShader(std::unique_ptr<ShaderEmitter> emitter) : emitter(std::move(emitter)) {}
+
+	usize getSize() const { return ShaderEmitter::getCodeBufferSize(); }
+	ShaderEmitter::PrologueCallback getPrologueCallback() const { return emitter->getPrologueCallback(); }
+	ShaderEmitter::InstructionCallback getInstructionCallback(u32 pc) const { return emitter->getInstructionCallback(pc); }
 };
 
 #endif  // arm64 recompiler check
@@ -2,8 +2,13 @@
 
 // Only do anything if we're on an x64 target with JIT support enabled
 #if defined(PANDA3DS_DYNAPICA_SUPPORTED) && defined(PANDA3DS_X64_HOST)
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+#include "PICA/dynapica/shader_ir.hpp"
 #include "PICA/shader.hpp"
 #include "helpers.hpp"
 #include "logger.hpp"
@@ -11,6 +16,28 @@
 #include "xbyak/xbyak.h"
 #include "xbyak/xbyak_util.h"
 
+class CompiledShader;
+
+// Executable memory shared by every compiled shader in the process. Shaders are emitted into a scratch buffer and then copied here,
+// so each one only takes up as much memory as its code actually needs instead of a worst-case sized buffer
+class ShaderCodeArena {
+	static constexpr usize capacity = 64_MB;
+	// The emitter aligns constants and functions to at most 64 bytes, so blocks need to keep that alignment when code is copied into them
+	static constexpr usize blockAlignment = 64;
+
+	std::mutex mutex;
+	Xbyak::CodeGenerator memory{capacity};
+	std::map<usize, usize> freeBlocks;  // Offset -> size of every free range, for first-fit allocation and coalescing
+
+  public:
+	ShaderCodeArena() { freeBlocks[0] = capacity; }
+	static ShaderCodeArena& get();
+
+	// Returns nullptr if the arena is full
+	u8* allocate(usize size);
+	void free(u8* pointer, usize size);
+};
+
 class ShaderEmitter : public Xbyak::CodeGenerator {
 	static constexpr size_t executableMemorySize = PICAShader::maxInstructionCount * 96;  // How much executable memory to alloc for each shader
 	// Allocate some extra space as padding for security purposes in the extremely unlikely occasion we manage to overflow the above size
@@ -35,6 +62,34 @@ class ShaderEmitter : public Xbyak::CodeGenerator {
 	// Vector value of (0xFF, 0xFF, 0xFF, 0) for setting the w component to 0 in DP3
 	Xbyak::Label dp3Vector;
 
+	// Analysis of the shader being compiled. Unreachable and dead instructions are skipped, and sources use its folded swizzles/negations
+	ShaderIR ir;
+	const ShaderIR::Instruction* currentInstruction = nullptr;
+
+	// PICA registers kept in host registers (xmm6-xmm15) within a straight-line block, so that chains of ALU instructions don't go through memory.
+	// IDs use the PICA source encoding, with outputs placed after the float uniforms. Cached registers are written back at block boundaries
+	struct CachedRegister {
+		u32 id = invalidRegister;
+		u32 lastUse = 0;
+		bool dirty = false;
+	};
+
+	static constexpr u32 invalidRegister = 0xFFFFFFFF;
+	static constexpr u32 outputRegisterBase = 0x80;
+	static constexpr int firstCacheRegister = 6;
+	std::array<CachedRegister, 10> cachedRegisters;
+	u32 cacheUseCounter = 0;
+	// Stack space used to preserve xmm6-xmm15 on the MS ABI, where they're callee-saved
+	static constexpr int msABISaveAreaSize = 10 * 16 + 8;
+
+	// Returns the index of the host register holding the PICA register "id", allocating one (and loading the value if needed) if it's not cached
+	int getCachedRegister(const PICAShader& shader, u32 id, bool loadValue);
+	// Write back dirty registers to the PICA state, but keep them cached
+	void writeBackRegisters(const PICAShader& shader);
+	// Write back dirty registers and drop everything from the cache. Must be called at the end of every block
+	void flushRegisters(const PICAShader& shader);
+	uintptr_t getRegisterOffset(const PICAShader& shader, u32 id);
+
 	u32 recompilerPC = 0;  // PC the recompiler is currently recompiling @
 	u32 loopLevel = 0;     // The current loop nesting level (0 = not in a loop)
 
@@ -71,12 +126,12 @@ class ShaderEmitter : public Xbyak::CodeGenerator {
 	void scanCode(const PICAShader& shaderUnit);
 
 	// Load register with number "srcReg" indexed by index "idx" into the xmm register "reg"
+	// The swizzle and negation come from the IR of the current instruction rather than the operand descriptor, as they may have been folded
 	template <int sourceIndex>
 	void loadRegister(Xbyak::Xmm dest, const PICAShader& shader, u32 src, u32 idx, u32 operandDescriptor);
 	void storeRegister(Xbyak::Xmm source, const PICAShader& shader, u32 dest, u32 operandDescriptor);
 
 	const vec4f& getSourceRef(const PICAShader& shader, u32 src);
-	const vec4f& getDestRef(const PICAShader& shader, u32 dest);
 
 	// Check the value of the cmp register for instructions like ifc and callc
 	// Result is returned in the zero flag. If the comparison is true then zero == 1, else zero == 0
@@ -131,8 +186,8 @@ class ShaderEmitter : public Xbyak::CodeGenerator {
 
 	PrologueCallback prologueCb = nullptr;
 
-	// Initialize our emitter with "allocSize" bytes of RWX memory
-	ShaderEmitter(bool useSafeMUL) : Xbyak::CodeGenerator(allocSize), useSafeMUL(useSafeMUL) {
+	// Initialize our emitter with "allocSize" bytes of RWX memory. This is only used as a scratch buffer, which is reused for every shader
+	ShaderEmitter() : Xbyak::CodeGenerator(allocSize) {
 		cpuCaps = Xbyak::util::Cpu();
 
 		haveSSE4_1 = cpuCaps.has(Xbyak::util::Cpu::tSSE41);
@@ -144,16 +199,38 @@ class ShaderEmitter : public Xbyak::CodeGenerator {
 		}
 	}
 
-	void compile(const PICAShader& shaderUnit);
+	// Compile the code reachable from the shader's entrypoint. Writes to outputs not in liveOutputs may be skipped
+	std::shared_ptr<CompiledShader> compile(const PICAShader& shaderUnit, u16 liveOutputs, bool useSafeMUL);
+};
 
-	// PC must be a valid entrypoint here. It doesn't have that much overhead in this case, so we use std::array<>::at() to assert it does
-	InstructionCallback getInstructionCallback(u32 pc) {
-		// Cast away the constness because casting to a function pointer is hard otherwise. Legal as long as we don't write to *ptr
-		uint8_t* ptr = const_cast<uint8_t*>(instructionLabels.at(pc).getAddress());
-		return reinterpret_cast<InstructionCallback>(ptr);
-	}
+// A compiled shader, which owns the executable memory its code lives in
+class CompiledShader {
+	u8* code = nullptr;
+	usize size = 0;
+	std::unique_ptr<Xbyak::CodeGenerator> standaloneMemory = nullptr;  // Only used if the shared arena was full
 
-	PrologueCallback getPrologueCallback() { return prologueCb; }
+	ShaderEmitter::PrologueCallback prologue = nullptr;
+	ShaderEmitter::InstructionCallback entrypoint = nullptr;
+	u32 entrypointPC = 0;
+
+  public:
+	// Copy "size" bytes of position-independent code into executable memory
+	CompiledShader(const u8* source, usize size, usize prologueOffset, usize entrypointOffset, u32 entrypointPC);
+	~CompiledShader();
+	CompiledShader(const CompiledShader&) = delete;
+	CompiledShader& operator=(const CompiledShader&) = delete;
+
+	usize getSize() const { return size; }
+	ShaderEmitter::PrologueCallback getPrologueCallback() const { return prologue; }
+
+	// Only the code reachable from the entrypoint the shader was compiled for is emitted, so that's the only valid PC here
+	ShaderEmitter::InstructionCallback getInstructionCallback(u32 pc) const {
+		if (pc != entrypointPC) {
+			Helpers::panic("[Shader JIT] Shader compiled for entrypoint %X was entered at %X", entrypointPC, pc);
+		}
+
+		return entrypoint;
+	}
 };
 
 #endif  // x64 recompiler check
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include <array>
+#include <span>
+#include <vector>
 
+#include "PICA/dirty_state.hpp"
 #include "PICA/draw_acceleration.hpp"
 #include "PICA/dynapica/shader_rec.hpp"
 #include "PICA/float_types.hpp"
@@ -13,6 +16,7 @@
 #include "logger.hpp"
 #include "memory.hpp"
 #include "renderer.hpp"
+#include "shared_caches.hpp"
 
 enum class ShaderExecMode {
 	Interpreter,  // Interpret shaders on the CPU
@@ -30,6 +34,7 @@ class GPU {
 
 	Memory& mem;
 	EmulatorConfig& config;
+	SharedCaches& sharedCaches;
 	ShaderUnit shaderUnit;
 	ShaderJIT shaderJIT;  // Doesn't do anything if JIT is disabled or not supported
 
@@ -43,6 +48,8 @@ class GPU {
 
 	std::array<vec4f, 16> immediateModeAttributes;  // Vertex attributes uploaded via immediate mode submission
 	std::array<PICA::Vertex, 3> immediateModeVertices;
+	// Vertices processed by drawArrays and passed to the renderer. Heap-allocated since it's big (Renderer::vertexBufferSize entries)
+	std::vector<PICA::Vertex> vertices;
 
 	// Pointers for the output registers as arranged after GPUREG_VSH_OUTMAP_MASK is applied
 	std::array<Floats::f24*, 16> vsOutputRegisters;
@@ -88,7 +95,14 @@ class GPU {
 	std::unique_ptr<Renderer> renderer;
 	PICA::Vertex getImmediateModeVertex();
 
+	// Set for frames that render-skip doesn't draw. Draws still do their surface bookkeeping but aren't issued, everything else
+	// (register writes, transfers, DMAs) still runs
+	bool skipDraws = false;
+
 	void getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed);
+	// Handles a burst of unmasked command list writes to registers [firstId, lastId] in one go, if they all go to one of the data ports
+	// (shader code, operand descriptors, float uniforms, fog/lighting LUTs). Returns false if the writes need to go through writeInternalReg
+	bool writeDataPortBurst(u32 firstId, u32 lastId, std::span<const u32> words);
 
   public:
 	// 256 entries per LUT with each LUT as its own row forming a 2D image 256 * LUT_COUNT
@@ -104,9 +118,25 @@ class GPU {
 	bool fogLUTDirty = false;
 	std::array<uint32_t, 128> fogLUT;
 
-	GPU(Memory& mem, EmulatorConfig& config);
+	// Bitmask of PICA::DirtyState groups whose registers changed since the renderer last consumed them
+	u32 dirtyState = PICA::DirtyState::All;
+
+	GPU(Memory& mem, EmulatorConfig& config, SharedCaches& sharedCaches);
 	void display() { renderer->display(); }
+	void setDrawSkipping(bool skip) {
+		// Issue draws the renderer batched up before we start dropping them
+		if (skip && !skipDraws) {
+			renderer->flushDraws();
+		}
+
+		skipDraws = skip;
+	}
 	void screenshot(const std::string& name) { renderer->screenshot(name); }
+	bool captureFrame(FrameCapture& capture) { return renderer->captureFrame(capture); }
+	void setFrameStreaming(bool enable) { renderer->setFrameStreaming(enable); }
+	// Ask to be notified through Renderer::notifyVRAMAccess whenever the CPU accesses this range of VRAM
+	void watchVRAM(u32 paddr, u32 size, Memory::VRAMWatch mode) { mem.watchVRAM(paddr, size, mode); }
+	void commitVRAMWatches() { renderer->commitVRAMWatches(); }
 	void deinitGraphicsContext() { renderer->deinitGraphicsContext(); }
 
 	void initGraphicsContext(void* context) { renderer->initGraphicsContext(context); }
@@ -180,6 +210,7 @@ class GPU {
 	}
 
 	Renderer* getRenderer() { return renderer.get(); }
+	SharedCaches& getSharedCaches() { return sharedCaches; }
 
   private:
 	// GPU external registers
@@ -210,4 +241,27 @@ class GPU {
 			}
 		}
 	}
+
+	// Mask of the vertex shader output registers that end up in vertices, ie the first ShaderOutputCount registers mapped by setVsOutputMask.
+	// The shader JIT can skip computing the rest
+	u16 getLiveVsOutputs() const {
+		const u32 outputMask = regs[PICA::InternalRegs::VertexShaderOutputMask] & 0xffff;
+		const u32 outputCount = regs[PICA::InternalRegs::ShaderOutputCount] & 7;
+		u32 liveOutputs = 0;
+		u32 count = 0;
+
+		for (int i = 0; i < 16 && count < outputCount; i++) {
+			if (outputMask & (1u << i)) {
+				liveOutputs |= 1u << i;
+				count++;
+			}
+		}
+
+		// Same fallback as setVsOutputMask for outputs that don't have an enabled register
+		for (; count < outputCount; count++) {
+			liveOutputs |= 1u << count;
+		}
+
+		return u16(liveOutputs);
+	}
 };
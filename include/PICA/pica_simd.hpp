@@ -273,3 +273,74 @@ namespace PICA::IndexBuffer {
 		}
 	}
 }  // namespace PICA::IndexBuffer
+
+// Optimized functions for converting packed PICA floats to host floats
+namespace PICA::F24 {
+	// Converts a single raw f24 value to the bit pattern of the equivalent f32. Matches Floats::f24::fromRaw
+	inline u32 toF32Bits(u32 hex) {
+		const u32 sign = (hex >> 23) << 31;
+		if ((hex & 0x7fffff) == 0) {
+			return sign;
+		}
+
+		const u32 exponent = (hex >> 16) & 0x7f;
+		const u32 mantissa = hex & 0xffff;
+		return sign | (mantissa << 7) | ((exponent == 0x7f ? 255 : exponent + 64) << 23);
+	}
+
+#ifdef PICA_SIMD_ARM64
+	inline uint32x4_t toF32BitsNEON(uint32x4_t hex) {
+		const uint32x4_t sign = vshlq_n_u32(vshrq_n_u32(hex, 23), 31);
+		const uint32x4_t exponent = vandq_u32(vshrq_n_u32(hex, 16), vdupq_n_u32(0x7f));
+		const uint32x4_t mantissa = vshlq_n_u32(vandq_u32(hex, vdupq_n_u32(0xffff)), 7);
+
+		// Exponent 0x7f (inf/NaN) maps to 0xff, everything else gets rebiased
+		const uint32x4_t isMaxExponent = vceqq_u32(exponent, vdupq_n_u32(0x7f));
+		const uint32x4_t newExponent = vbslq_u32(isMaxExponent, vdupq_n_u32(255), vaddq_u32(exponent, vdupq_n_u32(64)));
+		const uint32x4_t result = vorrq_u32(sign, vorrq_u32(mantissa, vshlq_n_u32(newExponent, 23)));
+
+		// Zeroes (ignoring the sign) keep only their sign
+		const uint32x4_t isZero = vceqq_u32(vandq_u32(hex, vdupq_n_u32(0x7fffff)), vdupq_n_u32(0));
+		return vbslq_u32(isZero, sign, result);
+	}
+#endif
+
+#ifdef PICA_SIMD_X64
+	// Only uses SSE2, so this is always available on x64
+	inline __m128i toF32BitsSSE(__m128i hex) {
+		const __m128i sign = _mm_slli_epi32(_mm_srli_epi32(hex, 23), 31);
+		const __m128i exponent = _mm_and_si128(_mm_srli_epi32(hex, 16), _mm_set1_epi32(0x7f));
+		const __m128i mantissa = _mm_slli_epi32(_mm_and_si128(hex, _mm_set1_epi32(0xffff)), 7);
+
+		// Exponent 0x7f (inf/NaN) maps to 0xff, everything else gets rebiased
+		const __m128i isMaxExponent = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x7f));
+		const __m128i rebiased = _mm_add_epi32(exponent, _mm_set1_epi32(64));
+		const __m128i newExponent = _mm_or_si128(_mm_and_si128(isMaxExponent, _mm_set1_epi32(255)), _mm_andnot_si128(isMaxExponent, rebiased));
+		const __m128i result = _mm_or_si128(sign, _mm_or_si128(mantissa, _mm_slli_epi32(newExponent, 23)));
+
+		// Zeroes (ignoring the sign) keep only their sign
+		const __m128i isZero = _mm_cmpeq_epi32(_mm_and_si128(hex, _mm_set1_epi32(0x7fffff)), _mm_setzero_si128());
+		return _mm_or_si128(_mm_and_si128(isZero, sign), _mm_andnot_si128(isZero, result));
+	}
+#endif
+
+	// Converts an array of raw f24 values to f32 bit patterns in place
+	inline void toF32Bits(u32* data, usize count) {
+		usize i = 0;
+
+#if defined(PICA_SIMD_ARM64)
+		for (; i + 4 <= count; i += 4) {
+			vst1q_u32(&data[i], toF32BitsNEON(vld1q_u32(&data[i])));
+		}
+#elif defined(PICA_SIMD_X64)
+		for (; i + 4 <= count; i += 4) {
+			__m128i* ptr = reinterpret_cast<__m128i*>(&data[i]);
+			_mm_storeu_si128(ptr, toF32BitsSSE(_mm_loadu_si128(ptr)));
+		}
+#endif
+
+		for (; i < count; i++) {
+			data[i] = toF32Bits(data[i]);
+		}
+	}
+}  // namespace PICA::F24
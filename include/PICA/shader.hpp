@@ -4,6 +4,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <span>
 
 #include "PICA/float_types.hpp"
 #include "PICA/pica_hash.hpp"
@@ -143,6 +144,7 @@ class PICAShader {
 	// Add these as friend classes for the JIT so it has access to all important state
 	friend class ShaderJIT;
 	friend class ShaderEmitter;
+	friend class ShaderIR;
 	friend class PICA::ShaderGen::ShaderDecompiler;
 
 	vec4f getSource(u32 source);
@@ -259,6 +261,32 @@ class PICAShader {
 		opdescHashDirty = true;  // Signal the JIT if necessary that the program hash has potentially changed
 	}
 
+	// Bulk versions of uploadWord/uploadDescriptor/uploadFloatUniform, for when the command processor sees a burst of writes to the same data port
+	void uploadWords(std::span<const u32> words) {
+		if (bufferIndex + words.size() > 4095) {
+			Helpers::panic("o no, shader upload overflew");
+		}
+
+		std::memcpy(&loadedShader[bufferIndex], words.data(), words.size_bytes());
+		bufferIndex += int(words.size());
+		codeHashDirty = true;
+	}
+
+	void uploadDescriptors(std::span<const u32> words) {
+		// The descriptor index wraps around, so copy in chunks that end at the end of the descriptor array
+		while (!words.empty()) {
+			const usize count = std::min<usize>(words.size(), operandDescriptors.size() - opDescriptorIndex);
+			std::memcpy(&operandDescriptors[opDescriptorIndex], words.data(), count * sizeof(u32));
+
+			opDescriptorIndex = (opDescriptorIndex + int(count)) & 0x7f;
+			words = words.subspan(count);
+		}
+
+		opdescHashDirty = true;
+	}
+
+	void uploadFloatUniforms(std::span<const u32> words);
+
 	void setFloatUniformIndex(u32 word) {
 		floatUniformIndex = word & 0xff;
 		floatUniformWordCount = 0;
@@ -85,11 +85,37 @@ namespace PICA::ShaderGen {
 		Function::ExitMode analyzeFunction(const PICAShader& shader, u32 start, u32 end, Function::Labels& labels);
 	};
 
+	// Code generation strategy used for a decompiled shader
+	enum class DecompilerStrategy {
+		Failed,      // The shader couldn't be decompiled, eg due to an unimplemented instruction, and has to run on the CPU
+		Structured,  // Control flow was turned into GLSL functions, ifs and loops
+		Dispatcher,  // Control flow couldn't be structured, so the shader is emulated by a switch on the PC inside a loop
+	};
+
+	// How many shaders were decompiled with each strategy
+	struct DecompilerStats {
+		u64 structured = 0;
+		u64 dispatcher = 0;
+		u64 failed = 0;
+	};
+
 	class ShaderDecompiler {
 		using AddressRange = ControlFlow::AddressRange;
 		using Function = ControlFlow::Function;
 
+		// Addresses the dispatcher can reach, and those where it has to check the control flow stacks after executing an instruction
+		struct DispatcherInfo {
+			std::set<u32> reachable;
+			std::set<u32> loopEnds;
+			std::set<u32> ifEnds;
+			std::set<u32> callEnds;
+		};
+
+		// Upper bound on how many times the dispatcher loop can run, so that a shader stuck in an infinite loop doesn't hang the host GPU
+		static constexpr u32 dispatcherMaxSteps = 0x10000;
+
 		ControlFlow controlFlow{};
+		DecompilerStrategy strategy = DecompilerStrategy::Failed;
 
 		PICAShader& shader;
 		EmulatorConfig& config;
@@ -108,6 +134,13 @@ namespace PICA::ShaderGen {
 		const Function* findFunction(const AddressRange& range);
 
 		void writeAttributes();
+		void writeHeader();
+		void writeStructuredShader();
+		void writeDispatcherShader();
+
+		DispatcherInfo analyzeDispatcher() const;
+		// Compile the instruction at "pc" into a case of the dispatcher switch
+		void compileDispatcherInstruction(u32 pc, const DispatcherInfo& info);
 
 		std::string getSource(u32 source, u32 index) const;
 		std::string getDest(u32 dest) const;
@@ -125,7 +158,11 @@ namespace PICA::ShaderGen {
 			: shader(shader), entrypoint(entrypoint), config(config), api(api), language(language), decompiledShader("") {}
 
 		std::string decompile();
+		DecompilerStrategy getStrategy() const { return strategy; }
 	};
 
-	std::string decompileShader(PICAShader& shader, EmulatorConfig& config, u32 entrypoint, API api, Language language);
+	// Decompile a shader, optionally counting which strategy was used for it in "stats"
+	std::string decompileShader(
+		PICAShader& shader, EmulatorConfig& config, u32 entrypoint, API api, Language language, DecompilerStats* stats = nullptr
+	);
 }  // namespace PICA::ShaderGen
\ No newline at end of file
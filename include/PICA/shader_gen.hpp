@@ -32,6 +32,8 @@ namespace PICA::ShaderGen {
 		FragmentGenerator(API api, Language language) : api(api), language(language) {}
 		std::string generate(const PICA::FragmentConfig& config, void* driverInfo = nullptr);
 		std::string getDefaultVertexShader();
+		// The vertex shader the ubershader FS is linked with when PICA shaders run on the CPU
+		std::string getUbershaderVertexShader();
 		// For when PICA shader is acceleration is enabled. Turn the PICA shader source into a proper vertex shader
 		std::string getVertexShaderAccelerated(const std::string& picaSource, const PICA::VertConfig& vertConfig, bool usingUbershader);
 
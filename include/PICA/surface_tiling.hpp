@@ -0,0 +1,14 @@
+#pragma once
+#include "PICA/regs.hpp"
+#include "helpers.hpp"
+
+// Conversion between the tiled layout PICA colour buffers have in guest memory and the linear RGBA8 images host GPUs work with.
+// Colour buffers are split into 8x8 tiles, stored left to right, top to bottom, with the pixels of each tile in Z-order.
+// On the host side, images are tightly packed RGBA8 rows ordered bottom to top, like glReadPixels returns them and glTexSubImage2D expects them.
+// Only whole tiles are converted, so the width and height should be multiples of 8.
+namespace PICA::SurfaceTiling {
+	// Convert a host RGBA8 image to a PICA colour buffer of the given format
+	void encode(ColorFmt format, const u8* source, u8* dest, u32 width, u32 height);
+	// Convert a PICA colour buffer of the given format to a host RGBA8 image
+	void decode(ColorFmt format, const u8* source, u8* dest, u32 width, u32 height);
+}  // namespace PICA::SurfaceTiling
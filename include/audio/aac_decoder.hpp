@@ -1,5 +1,8 @@
 #pragma once
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
 
 #include "audio/aac.hpp"
 #include "helpers.hpp"
@@ -22,4 +25,36 @@ namespace Audio::AAC {
 		void decode(AAC::Message& response, const AAC::Message& request, PaddrCallback paddrCallback, bool enableAudio = true);
 		~Decoder();
 	};
+
+	// Runs a decoder on a worker thread, so that decoding AAC packets doesn't stall the emulator thread.
+	// Only one request can be in flight at a time. The worker is started on the first request
+	class AsyncDecoder {
+		using PaddrCallback = std::function<u8*(u32)>;
+
+		Decoder decoder;
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// Protected by the mutex
+		Message request;
+		Message response;
+		PaddrCallback paddrCallback;
+		bool enableAudio = true;
+		bool hasRequest = false;  // Is there a request the worker hasn't picked up yet?
+		bool busy = false;        // Has a request been submitted whose response hasn't been collected with wait()?
+		bool done = false;        // Has the worker finished the current request?
+		bool stop = false;
+
+		void workerLoop();
+
+	  public:
+		~AsyncDecoder();
+
+		// Start decoding a request in the background. Any previous request must have been collected with wait() first
+		void submit(const Message& request, PaddrCallback paddrCallback, bool enableAudio);
+		// Block until the current request has been decoded, and return its response
+		Message wait();
+		bool isBusy() const { return busy; }
+	};
 }  // namespace Audio::AAC
\ No newline at end of file
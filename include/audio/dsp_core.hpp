@@ -54,6 +54,8 @@ namespace Audio {
 		virtual void loadComponent(std::vector<u8>& data, u32 programMask, u32 dataMask) = 0;
 		virtual void unloadComponent() = 0;
 		virtual void setSemaphoreMask(u16 value) = 0;
+		// Report a finished AAC decode request to the guest. Only used by the HLE core, which decodes AAC in the background
+		virtual void finishAACRequest() {}
 
 		static Audio::DSPCore::Type typeFromString(std::string inString);
 		static const char* typeToString(Audio::DSPCore::Type type);
@@ -149,7 +149,7 @@ namespace Audio {
 		Audio::HLE::DspMemory& dspRam;
 
 		Audio::DSPMixer mixer;
-		std::unique_ptr<Audio::AAC::Decoder> aacDecoder;
+		std::unique_ptr<Audio::AAC::AsyncDecoder> aacDecoder;
 
 		void resetAudioPipe();
 		bool loaded = false;  // Have we loaded a component?
@@ -191,7 +191,10 @@ namespace Audio {
 			}
 		}
 
-		void handleAACRequest(const AAC::Message& request);
+		// Returns true if the response is already in the binary pipe, or false if the request is being decoded in the background.
+		// In the latter case, finishAACRequest writes the response later
+		bool handleAACRequest(const AAC::Message& request);
+		void writeAACResponse(const AAC::Message& response);
 		void updateSourceConfig(Source& source, HLE::SourceConfiguration::Configuration& config, s16_le* adpcmCoefficients);
 		void updateMixerConfig(HLE::SharedMemory& sharedMem);
 		void generateFrame(StereoFrame<s16>& frame);
@@ -226,5 +229,6 @@ namespace Audio {
 		void unloadComponent() override;
 		void setSemaphore(u16 value) override {}
 		void setSemaphoreMask(u16 value) override {}
+		void finishAACRequest() override;
 	};
 }  // namespace Audio
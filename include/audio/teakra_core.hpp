@@ -1,5 +1,11 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
 
 #include "audio/dsp_core.hpp"
 #include "memory.hpp"
@@ -18,6 +24,74 @@ namespace Audio {
 		uint audioFrameIndex = 0;  // Index in our audio frame
 		std::array<s16, 160 * 2> audioFrame;
 
+		// Events the DSP raises for the DSP service. When the DSP runs on its own thread, they're queued and delivered on the emulator thread
+		struct Event {
+			enum class Type : u8 { Interrupt0, Interrupt1, Pipe };
+			Type type;
+			u8 pipe;
+		};
+
+		// Requests from the emulator thread that are handed to the DSP thread instead of waiting for it. The data of pipe writes follows
+		// in the commandData ring
+		struct Command {
+			enum class Type : u8 { SetSemaphore, MaskSemaphore, WritePipe };
+			Type type;
+			u16 value;  // Semaphore value or pipe channel
+			u32 size;   // Size of the pipe data
+		};
+
+		// State of the DSP thread, if the DSP runs on its own thread. The emulator thread grants the DSP cycles as the ARM11 timeline
+		// advances, and the DSP thread executes them in the background. The emulator thread only waits for it when it needs to read DSP
+		// state (pipe reads, reply registers, component loading) or when the DSP falls more than maxLag cycles behind
+		bool threaded = false;
+		u64 maxLag = 0;
+		std::thread dspThread;
+		std::mutex teakraMutex;  // Held by whichever thread is accessing Teakra
+		std::mutex threadMutex;  // Protects the fields below
+		std::condition_variable wakeDSP;
+		std::condition_variable dspProgress;
+		std::condition_variable eventsDrained;
+		u64 targetCycles = 0;
+		u64 executedCycles = 0;
+		bool busy = false;        // Whether the DSP thread is working on a batch of commands and cycles it took
+		bool eventsFull = false;  // Whether the DSP thread is waiting for the emulator thread to make room in the event queue
+		bool stopThread = false;
+		Common::RingBuffer<Event, 256> events;  // Lock-free, written by the DSP thread and read by the emulator thread
+
+		// Lock-free like the events, but written by the emulator thread and read by the DSP thread. Pipe writes are at most 0xFFFF bytes,
+		// so any single one fits in the data ring. The emulator thread only takes threadMutex to wake the DSP thread if it's sleeping
+		Common::RingBuffer<Command, 256> commands;
+		Common::RingBuffer<u8, 128 * 1024> commandData;
+		std::atomic<bool> dspSleeping = false;
+		std::vector<u8> pipeScratch;  // Only used by the DSP thread
+
+		void threadLoop();
+		// Wait for the DSP thread to catch up with the ARM11 and go idle. The DSP thread stays idle while the returned lock is held.
+		// Returns an empty lock if the DSP doesn't run on a thread
+		std::unique_lock<std::mutex> syncThread();
+		// Wait on dspProgress until done returns true. Delivers the queued events whenever the queue fills up in the meantime, as the DSP
+		// thread can't make progress until there's room for its events again
+		template <typename Func>
+		void waitForThread(std::unique_lock<std::mutex>& lock, Func done) {
+			while (true) {
+				dspProgress.wait(lock, [&]() { return eventsFull || done(); });
+				if (!eventsFull) {
+					return;
+				}
+
+				lock.unlock();
+				deliverEvents();
+				lock.lock();
+			}
+		}
+		void stopDSPThread();
+
+		void signalEvent(Event event);
+		void deliverEvents();
+		void queueCommand(Command command, std::span<const u8> data = {});
+		void executeCommands();
+		void writePipe(u32 channel, std::span<const u8> data);
+
 		// Get a pointer to a data memory address
 		u8* getDataPointer(u32 address) { return getDspMemory() + Memory::DSP_DATA_MEMORY_OFFSET + address; }
 		Teakra::UserConfig getTeakraConfig();
@@ -79,15 +153,12 @@ namespace Audio {
 
 	  public:
 		TeakraDSP(Memory& mem, Scheduler& scheduler, DSPService& dspService, EmulatorConfig& config);
-		~TeakraDSP() override {}
+		~TeakraDSP() override;
 
 		void reset() override;
 
-		// Run 1 slice of DSP instructions and schedule the next audio frame
-		void runAudioFrame(u64 eventTimestamp) override {
-			runSlice();
-			scheduler.addEvent(Scheduler::EventType::RunDSP, scheduler.currentTimestamp + Audio::lleSlice * 2);
-		}
+		// Run 1 slice of DSP instructions, or hand it to the DSP thread, and schedule the next audio frame
+		void runAudioFrame(u64 eventTimestamp) override;
 
 		void setAudioEnabled(bool enable) override;
 		u8* getDspMemory() override { return teakra.GetDspMemory(); }
@@ -95,10 +166,10 @@ namespace Audio {
 		DSPCore::Type getType() override { return DSPCore::Type::Teakra; }
 		u16 readProgramWord(u32 address) override { return teakra.ProgramRead(address); }
 
-		u16 recvData(u32 regId) override { return teakra.RecvData(regId); }
-		bool recvDataIsReady(u32 regId) override { return teakra.RecvDataIsReady(regId); }
-		void setSemaphore(u16 value) override { teakra.SetSemaphore(value); }
-		void setSemaphoreMask(u16 value) override { teakra.MaskSemaphore(value); }
+		u16 recvData(u32 regId) override;
+		bool recvDataIsReady(u32 regId) override;
+		void setSemaphore(u16 value) override;
+		void setSemaphoreMask(u16 value) override;
 
 		void writeProcessPipe(u32 channel, u32 size, u32 buffer) override;
 		std::vector<u8> readPipe(u32 channel, u32 peer, u32 size, u32 buffer) override;
@@ -71,6 +71,10 @@ struct EmulatorConfig {
 	bool accelerateShaders = accelerateShadersDefault;
 	bool fastmemEnabled = enableFastmemDefault;
 	bool hashTextures = hashTexturesDefault;
+	// Keep vertex and index data used by hw-accelerated shaders resident on the GPU when it doesn't change between draws
+	bool geometryCacheEnabled = true;
+	// Merge consecutive draws that share the same rasterizer state into a single host draw call
+	bool drawBatchingEnabled = true;
 
 	ScreenLayout::Layout screenLayout = ScreenLayout::Layout::Default;
 	float topScreenSize = 0.5;
@@ -89,10 +93,21 @@ struct EmulatorConfig {
 	bool sdWriteProtected = false;
 	bool circlePadProEnabled = true;
 	bool usePortableBuild = false;
+	// Keep decrypted and decompressed code of booted titles on disk, to make later boots of the same title faster
+	bool bootCacheEnabled = true;
+
+	// Speed multiplier used by turbo mode, where 0 means unlimited. Turbo mode also skips host rendering for turboSkippedFrames out of every
+	// turboSkipPeriod frames, while still emulating all GPU work
+	float turboSpeed = 0.0f;
+	int turboSkippedFrames = 3;
+	int turboSkipPeriod = 4;
 
 	bool audioEnabled = audioEnabledDefault;
 	bool vsyncEnabled = true;
 	bool aacEnabled = true;  // Enable AAC audio?
+	// Run the LLE DSP on its own thread. The DSP may then fall behind the ARM11 by up to lleDSPMaxLag DSP cycles before the emulator waits for it
+	bool lleDSPThreadEnabled = false;
+	u32 lleDSPMaxLag = u32(Audio::lleSlice * 8);
 
 	bool enableRenderdoc = false;
 	bool printAppVersion = true;
@@ -128,6 +143,8 @@ struct EmulatorConfig {
 	AudioDeviceConfig audioDeviceConfig;
 	FrontendSettings frontendSettings;
 
+	// Creates a config with the default settings that isn't backed by a file, for hosts that configure the emulator themselves
+	EmulatorConfig() = default;
 	EmulatorConfig(const std::filesystem::path& path);
 	void load();
 	void save();
@@ -73,6 +73,11 @@ class MyEnvironment final : public Dynarmic::A32::UserCallbacks {
 
     #undef makeExclusiveWriteHandler
 
+    // Lets dynarmic replace loads from constant addresses in read-only code with the loaded value
+    bool IsReadOnlyMemory(u32 vaddr) override {
+        return mem.isReadOnlyCode(vaddr);
+    }
+
     void InterpreterFallback(u32 pc, size_t num_instructions) override {
         // This is never called in practice.
         std::terminate();
@@ -18,7 +18,11 @@
 #include "io_file.hpp"
 #include "lua_manager.hpp"
 #include "memory.hpp"
+#include "memory_scanner.hpp"
+#include "movie.hpp"
 #include "scheduler.hpp"
+#include "shared_caches.hpp"
+#include "speed_control.hpp"
 
 #ifdef PANDA3DS_ENABLE_HTTP_SERVER
 #include "http_server.hpp"
@@ -35,6 +39,8 @@ enum class ROMType {
 class Emulator {
 	// Config should be initialized before anything else
 	EmulatorConfig config;
+	// Caches shared with other emulator instances in the same process, if any. Needs to be initialized before the GPU
+	std::shared_ptr<SharedCaches> sharedCaches;
 
 	Memory memory;
 	// We want memory to be constructed before the rest of the emulator, so it's at the top of the struct
@@ -47,6 +53,8 @@ class Emulator {
 	Crypto::AESEngine aesEngine;
 	AudioDevice audioDevice;
 	Cheats cheats;
+	MemoryScanner memoryScanner;
+	SpeedControl speedControl;
 
   public:
 	static constexpr u32 width = 400;
@@ -69,10 +77,21 @@ class Emulator {
 	// This is currently only used for ELFs, NCSDs use the IOFile API instead
 	std::ifstream loadedELF;
 	NCSD loadedNCSD;
+	// Preprocessed code and metadata of previously booted titles
+	BootCache bootCache;
 
 	std::optional<std::filesystem::path> romPath = std::nullopt;
 	LuaManager lua;
 
+	Movie movie;
+	// Battery settings from the config, put back after playing back a movie that overrode them
+	bool savedChargerPlugged = true;
+	int savedBatteryPercentage = 0;
+
+	bool turboEnabled = false;
+	// Whether the last call to runFrame rendered anything. If not, frontends shouldn't present the frame
+	bool frameRendered = true;
+
   public:
 	// Decides whether to reload or not reload the ROM when resetting. We use enum class over a plain bool for clarity.
 	// If NoReload is selected, the emulator will not reload its selected ROM. This is useful for things like booting up the emulator, or resetting to
@@ -82,7 +101,11 @@ class Emulator {
 	// Used in CPU::runFrame
 	bool frameDone = false;
 
+	// Loads the config from the default config path
 	Emulator();
+	// Creates an emulator with an injected config. Nothing in the core is process-global, so any number of instances can run on separate
+	// threads. Instances created with the same SharedCaches share compiled shaders, decoded textures and decrypted RomFS data
+	explicit Emulator(const EmulatorConfig& config, std::shared_ptr<SharedCaches> sharedCaches = nullptr);
 	~Emulator();
 
 	void step();
@@ -96,6 +119,24 @@ class Emulator {
 	void togglePause();
 	void setAudioEnabled(bool enable);
 
+	// Run at a multiple of the 3DS' speed, or as fast as possible with SpeedControl::unlimited. Audio is muted at any speed other than 1x
+	void setSpeed(float multiplier);
+	void setRenderSkip(u32 skipped, u32 period) { speedControl.setRenderSkip(skipped, period); }
+	// Turbo mode switches to the turbo speed and render-skip settings from the config, and back to 1x without render-skip
+	void setTurbo(bool enable);
+	void toggleTurbo() { setTurbo(!turboEnabled); }
+	bool isTurboEnabled() const { return turboEnabled; }
+	bool isFrameRendered() const { return frameRendered; }
+	// Frontends should turn vsync off when running at a speed other than 1x, as we pace emulation ourselves then
+	bool shouldUseVsync() const { return config.vsyncEnabled && speedControl.isRealTime(); }
+
+	// Movies restart the current ROM, then record or replay every input from boot. Returns false if no ROM is loaded or the movie can't be
+	// read. Stopping a recording writes it out, and returns false if that failed
+	bool startMovieRecording(const std::filesystem::path& path);
+	bool startMoviePlayback(const std::filesystem::path& path);
+	bool stopMovie();
+	const Movie& getMovie() const { return movie; }
+
 	bool loadAmiibo(const std::filesystem::path& path);
 	bool loadROM(const std::filesystem::path& path);
 	bool loadNCSD(const std::filesystem::path& path, ROMType type);
@@ -123,6 +164,9 @@ class Emulator {
 
 	EmulatorConfig& getConfig() { return config; }
 	Cheats& getCheats() { return cheats; }
+	MemoryScanner& getMemoryScanner() { return memoryScanner; }
+	const SpeedControl& getSpeedControl() const { return speedControl; }
+	std::shared_ptr<SharedCaches> getSharedCaches() { return sharedCaches; }
 	ServiceManager& getServiceManager() { return kernel.getServiceManager(); }
 	LuaManager& getLua() { return lua; }
 	AudioDeviceInterface& getAudioDevice() { return audioDevice; }
@@ -140,4 +184,6 @@ class Emulator {
 
   private:
 	void loadRenderdoc();
+	// Pin the inputs that don't go through HID to the ones of the movie, and hook HID up to it
+	void applyMovieEnvironment(const Movie::Environment& environment);
 };
@@ -12,8 +12,10 @@
 #include <thread>
 
 #include "helpers.hpp"
+#include "renderer.hpp"
 
-enum class HttpActionType { None, Screenshot, Key, TogglePause, Reset, LoadRom, Step };
+enum class HttpActionType { None, Screenshot, Key, TogglePause, Reset, LoadRom, Step, SetSpeed, Movie };
+enum class HttpMovieCommand { Record, Play, Stop };
 
 class Emulator;
 namespace httplib {
@@ -41,12 +43,16 @@ class HttpAction {
 
 	HttpActionType getType() const { return type; }
 
-	static std::unique_ptr<HttpAction> createScreenshotAction(DeferredResponseWrapper& response);
+	static std::unique_ptr<HttpAction> createScreenshotAction(DeferredResponseWrapper& response, FrameCapture& frame);
 	static std::unique_ptr<HttpAction> createKeyAction(u32 key, bool state);
 	static std::unique_ptr<HttpAction> createLoadRomAction(DeferredResponseWrapper& response, const std::filesystem::path& path, bool paused);
 	static std::unique_ptr<HttpAction> createTogglePauseAction();
 	static std::unique_ptr<HttpAction> createResetAction();
 	static std::unique_ptr<HttpAction> createStepAction(DeferredResponseWrapper& response, int frames);
+	static std::unique_ptr<HttpAction> createSetSpeedAction(float speed, u32 skippedFrames, u32 skipPeriod);
+	static std::unique_ptr<HttpAction> createMovieAction(
+		DeferredResponseWrapper& response, HttpMovieCommand command, const std::filesystem::path& path
+	);
 };
 
 struct HttpServer {
@@ -69,6 +75,21 @@ struct HttpServer {
 	bool paused = false;
 	int framesToRun = 0;
 
+	// State for the /stream endpoint. The emulator thread publishes the last displayed frame here once per frame,
+	// and the server threads handling /stream requests pick it up, encode it and send it to their client
+	std::mutex streamMutex;
+	std::condition_variable streamCv;
+	FrameCapture streamFrame;
+	u64 streamFrameCount = 0;
+	bool stopping = false;
+	std::atomic<int> streamClients = 0;
+
+	// Only accessed from the emulator thread
+	FrameCapture streamScratchFrame;
+	bool frameStreaming = false;
+
+	void publishStreamFrame();
+
 	void startHttpServer();
 	void pushAction(std::unique_ptr<HttpAction> action);
 	std::string status();
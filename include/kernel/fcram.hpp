@@ -1,6 +1,9 @@
 #pragma once
 #include <list>
+#include <map>
 #include <memory>
+#include <set>
+#include <utility>
 
 #include "helpers.hpp"
 
@@ -21,28 +24,39 @@ struct FcramBlock {
 
 using FcramBlockList = std::list<FcramBlock>;
 
+// Fragmentation statistics for an FCRAM region, for debugging and for tracking how allocation-heavy games use memory
+struct FcramStats {
+	u32 totalPages = 0;
+	u32 freePages = 0;
+	u32 freeBlockCount = 0;    // Number of separate free blocks. 1 means the free memory is entirely contiguous
+	u32 largestFreeBlock = 0;  // Size of the largest free block in pages. Linear allocations bigger than this fail
+};
+
 class KFcram {
 	struct Region {
-		struct Block {
-			s32 pages;
-			s32 pageOffset;
-			bool used;
-
-			Block(s32 pages, u32 pageOffset) : pages(pages), pageOffset(pageOffset), used(false) {}
-		};
+		// Free blocks, indexed by their page offset in the region. Freed blocks get merged with their free neighbours,
+		// so two blocks in here are never adjacent
+		std::map<s32, s32> freeBlocks;
+		// The same blocks indexed by (size, page offset), so that linear allocations can find the smallest block that fits in O(log n)
+		std::set<std::pair<s32, s32>> freeBlocksBySize;
 
-		std::list<Block> blocks;
 		u32 start;
 		s32 pages;
 		s32 freePages;
 
+		void addFreeBlock(s32 pageOffset, s32 pages);
+		void removeFreeBlock(std::map<s32, s32>::iterator it);
+
 	  public:
-		Region() : start(0), pages(0) {}
+		Region() : start(0), pages(0), freePages(0) {}
 		void reset(u32 start, size_t size);
 		void alloc(std::list<FcramBlock>& out, s32 pages, bool linear);
+		void free(u32 paddr, s32 pages);
+		bool contains(u32 paddr) const { return paddr >= start && paddr < start + (u32(pages) << 12); }
 
 		u32 getUsedCount();
 		u32 getFreeCount();
+		FcramStats getStats() const;
 	};
 
 	Memory& mem;
@@ -51,13 +65,19 @@ class KFcram {
 	uint8_t* fcram;
 	std::unique_ptr<u32> refs;
 
+	Region& getRegion(FcramRegion region);
+	// Return freed pages to the region they belong to
+	void free(u32 paddr, s32 pages);
+
   public:
 	KFcram(Memory& memory);
 	void reset(size_t ramSize, size_t appSize, size_t sysSize, size_t baseSize);
 	void alloc(FcramBlockList& out, s32 pages, FcramRegion region, bool linear);
 
 	void incRef(FcramBlockList& list);
+	// Decrement the reference count of each page in the list, freeing the pages that are no longer referenced
 	void decRef(FcramBlockList& list);
 
 	u32 getUsedCount(FcramRegion region);
+	FcramStats getStats(FcramRegion region);
 };
\ No newline at end of file
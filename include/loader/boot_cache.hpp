@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+
+#include "helpers.hpp"
+
+struct NCCH;
+
+// On-disk cache of the parts of an NCCH that are expensive to produce on every boot: the decrypted exheader info, the decrypted and
+// decompressed .code file and the SMDH. Entries are keyed by title ID and a hash of the NCCH header, which itself contains the SHA-256 hashes
+// of the exheader and ExeFS, so a modified ROM never hits a stale entry. As an extra safety net, entries also store the size and modification
+// time of the ROM file they were created from, and are ignored if those don't match.
+class BootCache {
+	static constexpr u32 magic = 0x48434250;  // "PBCH"
+	// Bump this whenever the layout of cache files changes
+	static constexpr u32 version = 1;
+
+	std::filesystem::path directory;
+	u64 romSize = 0;
+	s64 romTimestamp = 0;
+	bool romValid = false;
+
+	std::filesystem::path getEntryPath(u64 programID, u64 headerHash) const;
+
+  public:
+	void setDirectory(const std::filesystem::path& path) { directory = path; }
+
+	// Must be called before loading the NCCH partitions of the ROM at path. If the ROM can't be stat'd, the cache is bypassed for it
+	void setROM(const std::filesystem::path& path);
+
+	// Fill in the exheader info, code and SMDH of ncch from the cache. Returns false if there's no valid entry, in which case ncch is untouched
+	bool load(NCCH& ncch, u64 headerHash);
+	// Write the exheader info, code and SMDH of a freshly parsed NCCH to the cache
+	void store(const NCCH& ncch, u64 headerHash);
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "crypto/aes_engine.hpp"
+#include "helpers.hpp"
+#include "io_file.hpp"
+
+// Seekable compressed container for CCI/CXI images.
+// The image is split into fixed-size blocks which are Deflate-compressed independently, so any byte can be read by decompressing a single
+// block. Images are decrypted before compression (with the NCCH NoCrypto flag set), since encrypted data doesn't compress, and so that reads
+// don't have to decrypt anything.
+// Layout: Header, then an index of blockCount BlockEntry structures, then the compressed blocks.
+class CompressedROM {
+  public:
+	static constexpr u32 magic = 0x4D4F525A;  // "ZROM"
+	static constexpr u32 version = 1;
+	static constexpr u32 defaultBlockSize = 64_KB;
+	// Largest block size we create or accept. Every cache slot holds a whole block, so this also bounds the memory a container can make us use
+	static constexpr u32 maxBlockSize = 4_MB;
+
+	struct Header {
+		u32 magic;
+		u32 version;
+		u32 blockSize;
+		u32 blockCount;
+		u64 imageSize;  // Size of the uncompressed image in bytes
+	};
+
+	struct BlockEntry {
+		static constexpr u32 StoredRaw = 1;  // Set if the block didn't compress and is stored as-is
+
+		u64 offset;      // Offset of the block data in the container
+		u32 storedSize;  // Size of the block data in the container
+		u32 flags;
+		u64 checksum;  // XXH3 hash of the uncompressed block, to catch corrupted containers
+	};
+
+  private:
+	// Small LRU cache of decompressed blocks. RomFS reads tend to be sequential or to hit the same few files, so a few blocks are enough
+	static constexpr usize cacheSize = 8;
+	static constexpr u32 invalidBlock = 0xFFFFFFFF;
+
+	struct CachedBlock {
+		u32 index = invalidBlock;
+		u64 lastUse = 0;
+		std::vector<u8> data;
+	};
+
+	IOFile file;
+	Header header;
+	std::vector<BlockEntry> blocks;
+
+	std::array<CachedBlock, cacheSize> cache;
+	u64 useCounter = 0;
+	std::vector<u8> compressedBuffer;
+
+	// Returns the decompressed contents of a block, or nullptr if it couldn't be read or is corrupted
+	const std::vector<u8>* getBlock(u32 index);
+
+  public:
+	CompressedROM() = default;
+	CompressedROM(const CompressedROM&) = delete;
+	CompressedROM& operator=(const CompressedROM&) = delete;
+	~CompressedROM();
+
+	// Check whether the open file at the current position starts with the container magic. Rewinds the file afterwards
+	static bool isCompressedROM(IOFile& file);
+
+	bool open(const std::filesystem::path& path);
+	u64 size() const { return header.imageSize; }
+
+	// Read size bytes starting at offset in the uncompressed image. Returns {success, bytes read}
+	std::pair<bool, std::size_t> read(u64 offset, u8* dst, std::size_t size);
+
+	// Convert a plain CCI (or CXI if isCXI is true) to a compressed container, decrypting it on the way. Returns true on success
+	static bool convert(
+		Crypto::AESEngine& aesEngine, const std::filesystem::path& input, const std::filesystem::path& output, bool isCXI,
+		u32 blockSize = defaultBlockSize
+	);
+
+	// Fills dst with size bytes of the image starting at offset. Returns false on failure
+	using ImageReader = std::function<bool(u64 offset, u8* dst, usize size)>;
+	// Write a container for an image of imageSize bytes, whose contents are fetched one block at a time through readImage
+	static bool write(const std::filesystem::path& output, u64 imageSize, u32 blockSize, const ImageReader& readImage);
+};
@@ -5,8 +5,10 @@
 
 #include "crypto/aes_engine.hpp"
 #include "helpers.hpp"
-#include "io_file.hpp"
+#include "loader/boot_cache.hpp"
+#include "loader/rom_file.hpp"
 #include "services/region_codes.hpp"
+#include "shared_caches.hpp"
 
 struct NCCH {
 	struct EncryptionInfo {
@@ -49,6 +51,7 @@ struct NCCH {
 	u8 secondaryKeySlot = 0;
 
 	static constexpr u64 mediaUnit = 0x200;
+	static constexpr u64 headerSize = 0x200;
 	u64 size = 0;  // Size of NCCH converted to bytes
 	u64 saveDataSize = 0;
 	u32 stackSize = 0;
@@ -69,9 +72,16 @@ struct NCCH {
 	std::optional<Regions> region = std::nullopt;
 	std::vector<u8> smdh;
 
+	// If set, decrypted data read through readFromFile is cached here so that other emulator instances running the same title can reuse it
+	ConcurrentCache<DecryptedBlockKey, std::vector<u8>, DecryptedBlockKey::Hasher>* decryptedBlockCache = nullptr;
+
 	// Returns true on success, false on failure
 	// Partition index/offset/size must have been set before this
-	bool loadFromHeader(Crypto::AESEngine &aesEngine, IOFile &file, const FSInfo &info);
+	// If a boot cache is provided, the exheader info, code and SMDH are fetched from it when possible, and stored to it otherwise
+	bool loadFromHeader(Crypto::AESEngine &aesEngine, ROMFile &file, const FSInfo &info, BootCache *bootCache = nullptr);
+
+	// Only read the header and SMDH, to get the title ID, region, name and icon of a title without loading its code. Returns false on failure
+	bool loadMetadata(Crypto::AESEngine &aesEngine, ROMFile &file, const FSInfo &info);
 
 	bool hasExtendedHeader() { return exheaderSize != 0; }
 	bool hasExeFS() { return exeFS.size != 0; }
@@ -85,5 +95,16 @@ struct NCCH {
 	std::pair<bool, Crypto::AESKey> getPrimaryKey(Crypto::AESEngine &aesEngine, const Crypto::AESKey &keyY);
 	std::pair<bool, Crypto::AESKey> getSecondaryKey(Crypto::AESEngine &aesEngine, const Crypto::AESKey &keyY);
 
-	std::pair<bool, std::size_t> readFromFile(IOFile &file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size);
+	std::pair<bool, std::size_t> readFromFile(ROMFile &file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size);
+
+  private:
+	// Read and parse the NCCH header and derive the keys of the partition. gotCryptoKeys is set to whether the keys could be derived
+	bool readHeader(Crypto::AESEngine &aesEngine, ROMFile &file, const FSInfo &info, u8 *header, bool &gotCryptoKeys);
+	// Decrypt, decompress and parse the exheader and ExeFS. Returns false on failure
+	bool loadExheaderAndExeFS(Crypto::AESEngine &aesEngine, ROMFile &file, const FSInfo &info, bool gotCryptoKeys);
+
+	// Read and decrypt data directly from the file, bypassing the decrypted block cache
+	std::pair<bool, std::size_t> readAndDecrypt(ROMFile &file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size);
+	// Read encrypted data in whole blocks through the decrypted block cache
+	std::pair<bool, std::size_t> readCachedBlocks(ROMFile &file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size);
 };
\ No newline at end of file
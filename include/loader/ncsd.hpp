@@ -1,7 +1,7 @@
 #pragma once
 #include <array>
 #include "helpers.hpp"
-#include "io_file.hpp"
+#include "loader/rom_file.hpp"
 #include "loader/ncch.hpp"
 
 struct NCSD {
@@ -13,7 +13,7 @@ struct NCSD {
         NCCH ncch;
     };
 
-    IOFile file;
+    ROMFile file;
     u64 size = 0; // Image size according to the header converted to bytes
     std::array<Partition, 8> partitions; // NCCH partitions
 
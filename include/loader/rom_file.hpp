@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "helpers.hpp"
+#include "io_file.hpp"
+
+class CompressedROM;
+
+// Random-access reader for CCI/CXI images, which are either plain files or compressed containers (see compressed_rom.hpp).
+// Compressed containers are detected by their magic, so they can have any extension.
+// Like IOFile, copies of a ROMFile share the same underlying file, so every read should be preceded by a seek.
+class ROMFile {
+	IOFile file;
+	std::shared_ptr<CompressedROM> compressed = nullptr;
+	u64 position = 0;  // Only used for compressed images, plain images use the position of the IOFile
+
+  public:
+	bool open(const std::filesystem::path& path);
+	bool isOpen();
+	void close();
+	bool isCompressed() const { return compressed != nullptr; }
+
+	std::pair<bool, std::size_t> read(void* data, std::size_t length, std::size_t dataSize);
+	std::pair<bool, std::size_t> readBytes(void* data, std::size_t count);
+	bool seek(u64 offset);
+
+	// Size of the image. For compressed containers, this is the size of the uncompressed image
+	std::optional<u64> size();
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/aes_engine.hpp"
+#include "helpers.hpp"
+#include "services/region_codes.hpp"
+
+// Metadata of a title in the user's ROM library, as shown in game lists
+struct TitleInfo {
+	std::filesystem::path path;
+	u64 fileSize = 0;
+	s64 timestamp = 0;  // Modification time of the file, used together with the size to detect changed files
+
+	bool valid = false;  // False if the file couldn't be parsed. Such files are still indexed so rescans don't retry them every time
+	bool encrypted = false;
+	u64 programID = 0;
+	std::optional<Regions> region = std::nullopt;
+	std::vector<u8> smdh;  // Raw SMDH containing the title names and icons. Empty if the title has none, or if it's encrypted and we lack keys
+};
+
+// Persistent index of the titles found in a set of library directories.
+// Scanning only reads the NCSD/NCCH headers and SMDH of each ROM, in parallel, and files whose size and modification time haven't changed
+// since the last scan are not read again at all. Frontends can scan on startup and query the results, then save the index for next time.
+class TitleIndex {
+	static constexpr u32 magic = 0x58444954;  // "TIDX"
+	// Bump this whenever the layout of the index file or the contents of TitleInfo change
+	static constexpr u32 version = 1;
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, TitleInfo> titles;  // Keyed by the UTF-8 path of the ROM
+
+	static std::string getKey(const std::filesystem::path& path);
+	static bool isROMExtension(const std::filesystem::path& extension);
+	static TitleInfo readTitleInfo(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, u64 fileSize, s64 timestamp);
+
+  public:
+	// Load a previously saved index. Returns false if the file doesn't exist or is invalid, in which case the index is left empty
+	bool load(const std::filesystem::path& indexPath);
+	bool save(const std::filesystem::path& indexPath) const;
+
+	// Recursively scan directories for ROMs. New and modified files are parsed on threadCount threads (0 = one per hardware thread),
+	// and entries for files that no longer exist in the directories are dropped. Returns the number of files that had to be parsed
+	usize scan(const std::vector<std::filesystem::path>& directories, const Crypto::AESEngine& aesEngine, unsigned threadCount = 0);
+
+	// Returns all indexed titles that could be parsed, sorted by path
+	std::vector<TitleInfo> getTitles() const;
+	std::optional<TitleInfo> find(const std::filesystem::path& path) const;
+};
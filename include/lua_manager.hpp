@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 
 #include "helpers.hpp"
 
@@ -22,18 +23,27 @@ extern "C" {
 }
 
 class LuaManager {
+	Emulator& emulator;
 	lua_State* L = nullptr;
 	bool initialized = false;
 	bool haveScript = false;
 
+	// Write watches added by scripts. Memory only reports writes per page, so the byte ranges scripts asked for are filtered here
+	struct WriteWatch {
+		u32 id;
+		u32 start;
+		u32 end;  // Exclusive
+		int callbackRef;
+	};
+
+	std::vector<WriteWatch> writeWatches;
+	u32 nextWriteWatchID = 1;
+
 	void signalEventInternal(LuaEvent e);
+	void signalWrite(u32 vaddr, u32 size, u32 value);
 
   public:
-	// For Lua we must have some global pointers to our emulator objects to use them in script code via thunks. See the thunks in lua.cpp as an
-	// example
-	static Emulator* g_emulator;
-
-	LuaManager(Emulator& emulator) { g_emulator = &emulator; }
+	LuaManager(Emulator& emulator) : emulator(emulator) {}
 
 	void close();
 	void initialize();
@@ -50,6 +60,11 @@ class LuaManager {
 
 	bool signalInterceptedService(const std::string& service, u32 function, u32 messagePointer, int callbackRef);
 	void removeInterceptedService(const std::string& service, u32 function, int callbackRef);
+
+	// Call a Lua function whenever the guest writes to [vaddr, vaddr + size). Returns an ID for removing the watch
+	u32 addWriteWatch(u32 vaddr, u32 size, int callbackRef);
+	bool removeWriteWatch(u32 id);
+	void clearWriteWatches();
 };
 
 #else  // Lua not enabled, Lua manager does nothing
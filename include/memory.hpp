@@ -1,9 +1,13 @@
 #pragma once
 #include <array>
+#include <bitset>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <list>
+#include <map>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "config.hpp"
@@ -86,7 +90,7 @@ namespace KernelMemoryTypes {
 		u32 perms;
 		u32 state;
 
-		u32 end() { return baseAddr + (pages << 12); }
+		u32 end() const { return baseAddr + (pages << 12); }
 		MemoryInfo() : baseAddr(0), pages(0), perms(0), state(0) {}
 		MemoryInfo(u32 baseAddr, u32 pages, u32 perms, u32 state) : baseAddr(baseAddr), pages(pages), perms(perms), state(state) {}
 	};
@@ -114,22 +118,20 @@ class Memory {
 
 	u8* fcram;
 	u8* dspRam;  // Provided to us by Audio
-	u8* vram;    // Provided to the memory class by the GPU class
+	u8* vram;    // Handed to the GPU, which owns its contents
 
 	const u64* cpuTicks = nullptr;  // Pointer to the CPU tick counter, provided to us by the CPU class
+	// If set, the RTC is pinned to this time at tick 0 and advances with emulated time instead of following the host clock
+	std::optional<u64> fixedClockStart = std::nullopt;
 	using SharedMemoryBlock = KernelMemoryTypes::SharedMemoryBlock;
 
 	// TODO: remove this reference when Peach's excellent page table code is moved to a better home
 	KFcram& fcramManager;
 
-	// Our dynarmic core uses page tables for reads and writes with 4096 byte pages
-	std::vector<uintptr_t> readTable, writeTable;
-
-	// vaddr->paddr translation table
-	std::vector<u32> paddrTable;
-
-	// This tracks our OS' memory allocations
-	std::list<KernelMemoryTypes::MemoryInfo> memoryInfo;
+	// This tracks our OS' memory allocations. Blocks are keyed by their base address, cover the whole process address space without gaps,
+	// and neighbouring blocks with the same state and permissions are always merged
+	using VMAMap = std::map<u32, KernelMemoryTypes::MemoryInfo>;
+	VMAMap memoryInfo;
 
 	std::array<SharedMemoryBlock, 5> sharedMemBlocks = {
 		SharedMemoryBlock(
@@ -147,6 +149,50 @@ class Memory {
 	static constexpr u32 pageMask = pageSize - 1;
 	static constexpr u32 totalPageCount = 1 << (32 - pageShift);
 
+  private:
+	// Guest page tables, with 4096 byte pages. Rather than flat tables covering the whole 4GB address space, they're a 2-level radix tree:
+	// A directory with one slot per 4MB of address space, pointing to lazily allocated leaves that hold an entry for each page in that range.
+	// Only a handful of leaves are ever populated, which keeps the tables small and means reset only has to touch the leaves in use.
+	struct PageEntry {
+		uintptr_t read;   // Host pointer for reads, 0 if the page is not readable
+		uintptr_t write;  // Host pointer for writes, 0 if the page is not writable
+		u32 paddr;        // vaddr->paddr translation
+	};
+
+	static constexpr u32 pageLeafShift = 10;
+	static constexpr u32 pageLeafSize = 1 << pageLeafShift;  // Number of pages covered by each leaf
+	static constexpr u32 pageLeafMask = pageLeafSize - 1;
+	static constexpr u32 pageDirectorySize = totalPageCount >> pageLeafShift;
+
+	using PageTableLeaf = std::array<PageEntry, pageLeafSize>;
+	std::array<std::unique_ptr<PageTableLeaf>, pageDirectorySize> pageDirectory;
+
+	// Entry returned for pages whose leaf was never allocated
+	static const PageEntry unmappedPage;
+
+	const PageEntry& lookupPage(u32 page) const {
+		const auto& leaf = pageDirectory[page >> pageLeafShift];
+		return (leaf != nullptr) ? (*leaf)[page & pageLeafMask] : unmappedPage;
+	}
+
+	// Returns nullptr if the page's leaf was never allocated, in which case the page is unmapped
+	PageEntry* findPage(u32 page) {
+		const auto& leaf = pageDirectory[page >> pageLeafShift];
+		return (leaf != nullptr) ? &(*leaf)[page & pageLeafMask] : nullptr;
+	}
+
+	PageEntry& getOrCreatePage(u32 page) {
+		auto& leaf = pageDirectory[page >> pageLeafShift];
+		if (leaf == nullptr) {
+			leaf = std::make_unique<PageTableLeaf>();
+			leaf->fill(PageEntry{0, 0, 0});
+		}
+
+		return (*leaf)[page & pageLeafMask];
+	}
+
+  public:
+
 	static constexpr u32 FCRAM_SIZE = u32(128_MB);
 	static constexpr u32 FCRAM_APPLICATION_SIZE = u32(64_MB + 16_MB);
 	static constexpr u32 FCRAM_SYSTEM_SIZE = u32(44_MB - 16_MB);
@@ -159,6 +205,9 @@ class Memory {
 	static constexpr u32 DSP_CODE_MEMORY_OFFSET = u32(0_KB);
 	static constexpr u32 DSP_DATA_MEMORY_OFFSET = u32(256_KB);
 
+	static constexpr u32 VRAM_SIZE = u32(6_MB);
+	static constexpr u32 VRAM_PAGE_COUNT = VRAM_SIZE / pageSize;
+
   private:
 	// We also use MMU-accelerated fastmem for fast memory emulation
 	// This means that we've got a 4GB memory arena which is organized the same way as the emulated 3DS' memory map
@@ -168,13 +217,81 @@ class Memory {
 	bool useFastmem = false;
 	static constexpr size_t FASTMEM_FCRAM_OFFSET = 0;                                    // Offset of FCRAM in the fastmem arena
 	static constexpr size_t FASTMEM_DSP_RAM_OFFSET = FASTMEM_FCRAM_OFFSET + FCRAM_SIZE;  // Offset of DSP RAM
+	static constexpr size_t FASTMEM_VRAM_OFFSET = FASTMEM_DSP_RAM_OFFSET + DSP_RAM_SIZE;  // Offset of VRAM
 
-	static constexpr size_t FASTMEM_BACKING_SIZE = FCRAM_SIZE + DSP_RAM_SIZE;
+	static constexpr size_t FASTMEM_BACKING_SIZE = FCRAM_SIZE + DSP_RAM_SIZE + VRAM_SIZE;
 	// Total size of the virtual address space we will occupy (4GB)
 	static constexpr size_t FASTMEM_VIRTUAL_SIZE = 4_GB;
 
 	Common::HostMemory* arena;
 
+  public:
+	// Flat table of host pointers for every guest page, in the format dynarmic expects. Used so that the CPU JIT can do address translation
+	// inline when fastmem isn't available. Only pages that are both readable and writable are present: dynarmic uses the same table for
+	// loads and stores, so a read-only page in it would take guest writes without any check. Accesses to any other page (eg read-only code
+	// and data) fall back to the slow memory handlers, which check the guest page tables for permissions. Loads from constant addresses in
+	// read-only code are folded at compile time instead (see isReadOnlyCode), which leaves register-relative loads from .rodata on the
+	// slow path.
+	using CPUPageTable = std::array<u8*, totalPageCount>;
+
+	// How CPU accesses to a VRAM page should be reported through the VRAM access callback
+	enum class VRAMWatch : u8 {
+		None,            // The page is fully accessible through the fast paths
+		Writes,          // Writes are reported, reads go through the fast paths
+		ReadsAndWrites,  // All accesses are reported
+	};
+
+	// Called with a physical address & size before the CPU accesses a watched VRAM page
+	using VRAMAccessCallback = std::function<void(u32 paddr, u32 size, bool write)>;
+	// Called with the virtual address, size & value of a write after it lands on a page with a write watch
+	using WriteWatchCallback = std::function<void(u32 vaddr, u32 size, u32 value)>;
+	// Called when the state or permissions of read-only code change, with the range that changed
+	using CodeChangeCallback = std::function<void(u32 vaddr, u32 size)>;
+
+  private:
+	std::unique_ptr<CPUPageTable> cpuPageTable;
+
+	// VRAM pages that the renderer wants to be notified about when the CPU accesses them. Watched pages lose their host pointer in the guest page
+	// tables and the CPU page table for the watched kind of access, and are protected accordingly in the fastmem view. Accesses to them end up
+	// in the slow path, where we invoke the callback.
+	std::bitset<VRAM_PAGE_COUNT> watchedVRAMWrites;
+	std::bitset<VRAM_PAGE_COUNT> watchedVRAMReads;
+	VRAMAccessCallback vramAccessCallback;
+
+	bool isWatchedVRAMPage(u32 paddr, const std::bitset<VRAM_PAGE_COUNT>& watched) const {
+		const u32 offset = paddr - PhysicalAddrs::VRAM;
+		return offset < VRAM_SIZE && watched[offset >> pageShift];
+	}
+
+	void protectFastmemVRAM(u32 vaddr, u32 paddr, s32 pages);
+
+	// Slow paths for CPU accesses to VRAM pages that are being watched. Return false if the access doesn't target VRAM
+	template <typename T>
+	bool readWatchedVRAM(u32 vaddr, T& value);
+	template <typename T>
+	bool writeWatchedVRAM(u32 vaddr, T value);
+
+	// Virtual pages with write watches on them, eg for scripts that want to know when a value changes. Like watched VRAM pages, they lose their
+	// write pointer in the guest page tables and the CPU page table, and are write-protected in the fastmem view. The write pointer they'd
+	// otherwise have is kept here, so that the slow path can still perform the write before reporting it.
+	// Watches stay armed across remaps and resets: Mapping a watched page hides its new write pointer again.
+	struct WatchedPage {
+		u32 watchCount = 0;   // Number of watches covering this page
+		uintptr_t write = 0;  // Host pointer for writes to this page, or 0 if the page isn't writable
+	};
+
+	std::unordered_map<u32, WatchedPage> watchedPages;
+	WriteWatchCallback writeWatchCallback;
+	CodeChangeCallback codeChangeCallback;
+
+	// Move the write pointer of a watched page from the page tables into its watch. Called whenever the page tables are updated for the page
+	void hideWatchedPage(u32 page, WatchedPage& watch);
+	// Write-protect the watched pages in a range of the fastmem view
+	void protectWatchedPages(u32 vaddr, s32 pages);
+	// Slow path for writes to pages with write watches. Returns false if the page isn't watched
+	template <typename T>
+	bool writeWatchedPage(u32 vaddr, T value);
+
 	void addFastmemView(u32 guestVaddr, size_t arenaOffset, size_t size, bool w, bool x = false) {
 		if (useFastmem) {
 			Common::MemoryPermission perms = Common::MemoryPermission::Read;
@@ -192,8 +309,6 @@ class Memory {
 		}
 	}
 
-	u64 timeSince3DSEpoch();
-
 	// https://www.3dbrew.org/wiki/Configuration_Memory#ENVINFO
 	// Report a retail unit without JTAG
 	static constexpr u32 envInfo = 1;
@@ -216,6 +331,8 @@ class Memory {
 
 	static constexpr std::array<u8, 6> MACAddress = {0x40, 0xF4, 0x07, 0xFF, 0xFF, 0xEE};
 
+	// Returns the block containing vaddr, or memoryInfo.end() if it's outside of the process address space
+	VMAMap::iterator findVMA(u32 vaddr);
 	void changeMemoryState(u32 vaddr, s32 pages, const Operation& op);
 	void queryPhysicalBlocks(std::list<FcramBlock>& outList, u32 vaddr, s32 pages);
 	void mapPhysicalMemory(u32 vaddr, u32 paddr, s32 pages, bool r, bool w, bool x);
@@ -230,8 +347,9 @@ class Memory {
 	void* getWritePointer(u32 address);
 	std::optional<u32> loadELF(std::ifstream& file);
 	std::optional<u32> load3DSX(const std::filesystem::path& path);
-	std::optional<NCSD> loadNCSD(Crypto::AESEngine& aesEngine, const std::filesystem::path& path);
-	std::optional<NCSD> loadCXI(Crypto::AESEngine& aesEngine, const std::filesystem::path& path);
+	// If bootCache is not null, it's used to skip decrypting and decompressing the code of titles that have been booted before
+	std::optional<NCSD> loadNCSD(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, BootCache* bootCache = nullptr);
+	std::optional<NCSD> loadCXI(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, BootCache* bootCache = nullptr);
 
 	bool mapCXI(NCSD& ncsd, NCCH& cxi);
 	bool map3DSX(HB3DSX& hb3dsx, const HB3DSX::Header& header);
@@ -294,7 +412,11 @@ class Memory {
 		bool unmapPages = true
 	);
 	void changePermissions(u32 vaddr, s32 pages, bool r, bool w, bool x);
+	// Unmap heap or linear heap memory and release its physical pages. Returns false if the region can't be freed
+	bool freeMemory(u32 vaddr, s32 pages);
 	Result::HorizonResult queryMemory(KernelMemoryTypes::MemoryInfo& out, u32 vaddr);
+	// Returns the readable blocks of the process address space in address order, for tools that walk guest memory like the memory scanner
+	std::vector<KernelMemoryTypes::MemoryInfo> getReadableRegions() const;
 	Result::HorizonResult testMemoryState(u32 vaddr, s32 pages, KernelMemoryTypes::MemoryState desiredState);
 
 	void copyToVaddr(u32 dstVaddr, const u8* srcHost, s32 size);
@@ -309,7 +431,7 @@ class Memory {
 	std::optional<NCCH> loadedCXI = std::nullopt;
 	std::optional<HB3DSX> loaded3DSX = std::nullopt;
 	// File handle for reading the loaded ncch
-	IOFile CXIFile;
+	ROMFile CXIFile;
 
 	std::optional<u64> getProgramID();
 
@@ -317,14 +439,36 @@ class Memory {
 	u8* getDSPDataMem() { return &dspRam[DSP_DATA_MEMORY_OFFSET]; }
 	u8* getDSPCodeMem() { return &dspRam[DSP_CODE_MEMORY_OFFSET]; }
 
-	void setVRAM(u8* pointer) { vram = pointer; }
+	u8* getVRAM() { return vram; }
 	void setDSPMem(u8* pointer) { dspRam = pointer; }
 	void setCPUTicks(const u64& ticks) { cpuTicks = &ticks; }
 
+	// Get the current RTC time, in ms since Jan 1 1900
+	u64 timeSince3DSEpoch();
+	// Make the RTC deterministic, by starting it at startTime (in ms since Jan 1 1900) and advancing it with the CPU tick counter.
+	// nullopt goes back to the host clock
+	void setFixedClock(std::optional<u64> startTime) { fixedClockStart = startTime; }
+
 	bool allocateMainThreadStack(u32 size);
 	Regions getConsoleRegion();
 	void copySharedFont(u8* ptr, u32 vaddr);
 
 	bool isFastmemEnabled() { return useFastmem; }
 	u8* getFastmemArenaBase() { return arena->VirtualBasePointer(); }
+	// Returns nullptr when fastmem is enabled, as the JIT doesn't need a page table then
+	CPUPageTable* getCPUPageTable() { return cpuPageTable.get(); }
+	// Whether vaddr is in the read-only code or rodata of a loaded executable. The CPU JIT folds loads from constant addresses in these pages
+	// (eg literal pools) when it compiles a block, so any change to their state or permissions is reported through the code change callback
+	bool isReadOnlyCode(u32 vaddr);
+	void setCodeChangeCallback(CodeChangeCallback callback) { codeChangeCallback = std::move(callback); }
+
+	void setVRAMAccessCallback(VRAMAccessCallback callback) { vramAccessCallback = std::move(callback); }
+	// Change how CPU accesses to a range of VRAM are watched. Watched pages lose their fast paths, so only watch memory the renderer caches
+	void watchVRAM(u32 paddr, u32 size, VRAMWatch mode);
+
+	void setWriteWatchCallback(WriteWatchCallback callback) { writeWatchCallback = std::move(callback); }
+	// Report writes to the pages covering a range of virtual memory through the write watch callback. Watches are counted per page, so
+	// overlapping ranges can be watched and unwatched independently. Watched pages lose their fast paths until every watch on them is removed
+	void addWriteWatch(u32 vaddr, u32 size);
+	void removeWriteWatch(u32 vaddr, u32 size);
 };
@@ -18,6 +18,7 @@ class MemoryMappedFile {
   public:
 	bool exists() const { return opened; }
 	u8* data() const { return pointer; }
+	usize size() const { return opened ? map.size() : 0; }
 
 	std::error_code flush();
 	MemoryMappedFile();
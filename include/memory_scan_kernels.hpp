@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+
+#include "helpers.hpp"
+
+// Compare kernels used by the memory scanner. Memory is processed in blocks of 64 naturally aligned values, with one bit per value in a
+// u64 candidate mask. Each kernel ANDs the candidate mask of a block with whether each value passes its test, and skips blocks that have
+// no candidates left, so later scans only touch the blocks that still contain results
+namespace MemoryScanKernels {
+	enum class ValueType : u8 { U8 = 0, U16, U32, Float, Count };
+
+	enum class Op : u8 {
+		InRange = 0,       // lo <= value <= hi. Callers must pass lo <= hi
+		NotInRange,        // !(lo <= value <= hi)
+		EqualPrevious,     // value == previous. Floats are compared by bit pattern
+		NotEqualPrevious,  // value != previous. Floats are compared by bit pattern
+		GreaterPrevious,   // value > previous
+		LessPrevious,      // value < previous
+		Count,
+	};
+
+	static constexpr usize blockValues = 64;
+	static constexpr usize valueTypeCount = usize(ValueType::Count);
+	static constexpr usize opCount = usize(Op::Count);
+
+	// current/previous: The values to test and their values on the last scan. previous is unused, and may be null, for range ops
+	// lo/hi: Bounds for range ops, as raw bits (Float bounds are the bits of a float)
+	using Kernel = void (*)(const u8* current, const u8* previous, u32 lo, u32 hi, u64* bits, usize blockCount);
+	using KernelTable = std::array<std::array<Kernel, opCount>, valueTypeCount>;
+
+	static constexpr usize valueSize(ValueType type) { return type == ValueType::U8 ? 1 : (type == ValueType::U16 ? 2 : 4); }
+
+	const KernelTable& portableKernels();
+#ifdef PANDA3DS_X64_HOST
+	// Built with AVX2 enabled, so only call these if the host supports it
+	const KernelTable& avx2Kernels();
+#elif defined(PANDA3DS_ARM64_HOST)
+	const KernelTable& neonKernels();
+#endif
+
+	// Returns the fastest kernels the host supports
+	const KernelTable& getKernels();
+}  // namespace MemoryScanKernels
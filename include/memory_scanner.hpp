@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+
+#include "helpers.hpp"
+#include "memory_scan_kernels.hpp"
+
+class Memory;
+
+// Searches guest memory for values, for finding cheat codes. A search starts with a scan of all readable memory of the running process,
+// and every following scan filters the candidates left by the previous one, eg by whether they changed since the last scan.
+// Scans are split across threads and run SIMD compare kernels over whole pages, so they're meant to be run while the emulator is paused
+// or between frames, on the emulator thread.
+class MemoryScanner {
+  public:
+	using ValueType = MemoryScanKernels::ValueType;
+
+	enum class Comparison : u8 {
+		Unknown,  // Keep every value. On a first scan this just takes a snapshot of memory, on later scans it only refreshes the values
+		Equal,
+		NotEqual,
+		Greater,
+		GreaterOrEqual,
+		Less,
+		LessOrEqual,
+		Between,  // value <= x <= value2
+		// Compare against the value on the previous scan. These are only valid for scans after the first
+		Changed,
+		Unchanged,
+		Increased,
+		Decreased,
+	};
+
+	// Values are passed around as raw bits, so floats are the bit pattern of the float. Integers are unsigned
+	struct Result {
+		u32 address;
+		u32 value;     // Current value
+		u32 previous;  // Value on the last scan
+	};
+
+  private:
+	// Candidates are tracked per guest page. Pages with many candidates keep a bitmap of them and a snapshot of the whole page, which the
+	// compare kernels run on directly. Pages with few candidates keep a sorted list of their offsets and values instead, which takes far
+	// less memory, and pages without any candidates are dropped.
+	struct Page {
+		u32 vaddr;
+		u32 count = 0;  // Number of candidates in the page
+
+		// Dense pages
+		std::vector<u64> bits;
+		std::vector<u8> snapshot;
+		// Sparse pages
+		std::vector<u16> offsets;
+		std::vector<u8> values;
+
+		bool isDense() const { return !bits.empty(); }
+	};
+
+	// A comparison translated to a kernel op and its bounds
+	struct Filter {
+		MemoryScanKernels::Op op;
+		u32 lo, hi;
+		bool matchesNothing = false;  // For comparisons no value can pass, like x < 0
+	};
+
+	Memory& mem;
+	std::vector<Page> pages;
+	ValueType type = ValueType::U32;
+	usize resultCount = 0;
+	bool active = false;
+	unsigned threadCount = 0;
+
+	Filter makeFilter(Comparison comparison, u32 value, u32 value2) const;
+	usize valueSize() const { return MemoryScanKernels::valueSize(type); }
+	usize blocksPerPage() const;
+
+	// Update a page's candidates and values after filtering. current points to the current contents of the page
+	void storePage(Page& page, const u8* current, const u64* bits, usize blockCount);
+	void scanPage(Page& page, const MemoryScanKernels::KernelTable& kernels, const Filter* filter, bool firstScan);
+	// Run the scan on every page, then drop the pages that were left without candidates
+	void scanPages(const Filter* filter, bool firstScan);
+
+  public:
+	MemoryScanner(Memory& mem) : mem(mem) {}
+
+	// Start a new search over all readable memory. Returns false if the comparison needs a previous scan
+	bool firstScan(ValueType type, Comparison comparison, u32 value = 0, u32 value2 = 0);
+	// Filter the candidates of the current search. Returns false if there is no search in progress
+	bool nextScan(Comparison comparison, u32 value = 0, u32 value2 = 0);
+	void reset();
+
+	// Returns up to maxResults results, skipping the first "start" ones, in address order
+	std::vector<Result> getResults(usize start, usize maxResults) const;
+	usize getResultCount() const { return resultCount; }
+	bool isActive() const { return active; }
+	ValueType getType() const { return type; }
+
+	// Number of threads to scan on. 0 uses one thread per hardware thread
+	void setThreadCount(unsigned count) { threadCount = count; }
+};
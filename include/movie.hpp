@@ -0,0 +1,93 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "helpers.hpp"
+#include "services/hid.hpp"
+
+// Records the inputs of a run from boot, so that it can be replayed bit-exactly later, eg to compare the performance of 2 builds on the
+// exact same guest work. Besides the input state of every HID sample, movies store the other inputs the guest could tell apart between
+// runs, like the RTC and the battery state, and these are pinned for the whole run while recording and playing back.
+// Every hashInterval frames, a hash of FCRAM is stored as well. Playback compares against these, to tell whether the replay still does
+// the same thing the recording did.
+// Things outside the movie that change guest behaviour (save data, cheats, Lua scripts writing memory, the LLE DSP thread, a different ROM
+// or config) will still make a replay desync.
+class Movie {
+  public:
+	enum class State { Idle, Recording, Playing };
+
+	// Nondeterministic inputs that don't go through HID. They're captured when recording starts and applied by the emulator
+	struct Environment {
+		u64 programID;
+		u64 startTime;  // RTC at boot, in ms since Jan 1 1900
+		u32 sslSeed;
+		u8 chargerPlugged;
+		u8 batteryPercentage;
+		u8 padding[2];
+	};
+
+	static constexpr u32 defaultHashInterval = 60;
+
+  private:
+	static constexpr u32 magic = 0x564F4D50;  // "PMOV"
+	// Bump this whenever the layout of movie files changes
+	static constexpr u32 version = 1;
+
+	// Inputs only get stored when they change, so an entry stays active until the tick of the next one
+	struct InputEntry {
+		u64 tick;
+		HID::InputState state;
+	};
+
+	struct HashEntry {
+		u64 frame;
+		u64 hash;
+	};
+
+	State state = State::Idle;
+	std::filesystem::path path;
+	Environment environment = {};
+	u32 hashInterval = defaultHashInterval;
+
+	std::vector<InputEntry> inputs;
+	std::vector<HashEntry> hashes;
+	usize nextInput = 0;
+	usize nextHash = 0;
+	HID::InputState currentInput = {};
+
+	u64 frameCount = 0;   // Frames since the movie started
+	u64 totalFrames = 0;  // Length of the movie being played back
+	std::optional<u64> desyncFrame = std::nullopt;
+
+	bool save();
+	bool load(const std::filesystem::path& moviePath);
+	void clear();
+
+  public:
+	// Start recording a movie, to be written to path when it's stopped. The emulator should have just been reset
+	bool startRecording(const std::filesystem::path& moviePath, const Environment& env, u32 interval = defaultHashInterval);
+	// Load a movie and start playing it back. The emulator should have just been reset
+	bool startPlayback(const std::filesystem::path& moviePath);
+	// Stop the current movie, writing it out if it was being recorded. Returns false if a recording couldn't be written
+	bool stop();
+
+	// Called with every HID sample. Records the state, or replaces it with the recorded one
+	void onInputSample(u64 tick, HID::InputState& input);
+	// Called at the end of every emulated frame, to hash FCRAM when needed
+	void onFrame(std::span<const u8> fcram);
+
+	State getState() const { return state; }
+	bool isActive() const { return state != State::Idle; }
+	bool isRecording() const { return state == State::Recording; }
+	bool isPlaying() const { return state == State::Playing; }
+	// Whether playback went past the last recorded frame
+	bool isPlaybackDone() const { return state == State::Playing && frameCount >= totalFrames; }
+
+	const Environment& getEnvironment() const { return environment; }
+	u64 getFrameCount() const { return frameCount; }
+	u64 getTotalFrames() const { return totalFrames; }
+	// The first frame at which the FCRAM hash didn't match the recording, if any
+	std::optional<u64> getDesyncFrame() const { return desyncFrame; }
+};
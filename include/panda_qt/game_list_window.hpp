@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QImage>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QWidget>
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "emulator.hpp"
+#include "loader/title_index.hpp"
+
+class MainWindow;
+
+// Lists the titles in the ROM folder, using the title index so that only new or modified files get parsed when the list is refreshed.
+// Scans run on a worker thread, and the list is updated on the GUI thread once they're done
+class GameListWindow final : public QWidget {
+	Q_OBJECT
+
+	Emulator* emu;
+	MainWindow* mainWindow;
+
+	std::filesystem::path appDataPath;
+	std::filesystem::path romDirectory;
+	TitleIndex index;
+	std::thread scanThread;
+	std::atomic<bool> scanning = false;
+
+	QTreeWidget* gameTree;
+	QLabel* statusLabel;
+	QPushButton* folderButton;
+	QPushButton* refreshButton;
+
+	std::filesystem::path getIndexPath() const { return appDataPath / "cache" / "title_index.bin"; }
+	void chooseFolder();
+	void startScan();
+	void finishScan(usize parsedCount);
+	void populate();
+	void loadTitle(QTreeWidgetItem* item);
+
+	// Returns the English short title of an SMDH, or an empty string if there's none
+	static QString getTitleName(const std::vector<u8>& smdh);
+	// Decodes the large icon of an SMDH. Returns a null image if there's none
+	static QImage getIcon(const std::vector<u8>& smdh);
+	static QString getRegionName(std::optional<Regions> region);
+
+  public:
+	GameListWindow(Emulator* emu, MainWindow* mainWindow, QWidget* parent = nullptr);
+	~GameListWindow();
+
+	void showEvent(QShowEvent* event) override;
+};
@@ -19,6 +19,8 @@
 #include "panda_qt/config_window.hpp"
 #include "panda_qt/cpu_debugger.hpp"
 #include "panda_qt/dsp_debugger.hpp"
+#include "panda_qt/game_list_window.hpp"
+#include "panda_qt/memory_search_window.hpp"
 #include "panda_qt/patch_window.hpp"
 #include "panda_qt/screen/screen.hpp"
 #include "panda_qt/shader_editor.hpp"
@@ -43,17 +45,14 @@ class MainWindow : public QMainWindow {
 		Pause,
 		Resume,
 		TogglePause,
-		PressKey,
-		ReleaseKey,
 		SetCirclePadX,
 		SetCirclePadY,
 		LoadLuaScript,
 		EditCheat,
-		PressTouchscreen,
-		ReleaseTouchscreen,
 		ReloadUbershader,
 		SetScreenSize,
 		UpdateConfig,
+		RunOnEmuThread,
 	};
 
 	// Tagged union representing our message queue messages
@@ -65,10 +64,6 @@ class MainWindow : public QMainWindow {
 				std::filesystem::path* p;
 			} path;
 
-			struct {
-				u32 key;
-			} key;
-
 			struct {
 				s16 value;
 			} circlepad;
@@ -81,15 +76,14 @@ class MainWindow : public QMainWindow {
 				CheatMessage* c;
 			} cheat;
 
-			struct {
-				u16 x;
-				u16 y;
-			} touchscreen;
-
 			struct {
 				u32 width;
 				u32 height;
 			} screenSize;
+
+			struct {
+				std::function<void()>* f;
+			} function;
 		};
 	};
 
@@ -98,11 +92,14 @@ class MainWindow : public QMainWindow {
 	std::thread emuThread;
 
 	std::atomic<bool> appRunning = true;  // Is the application itself running?
+	// Whether vsync is currently on, which depends on the emulation speed as well as the config. Only accessed from the emulator thread
+	bool vsyncActive = false;
 	// Used for synchronizing messages between the emulator and UI
 	std::mutex messageQueueMutex;
 	std::vector<EmulatorMessage> messageQueue;
 
 	QMenuBar* menuBar = nullptr;
+	QAction* turboAction = nullptr;
 	InputMappings keyboardMappings;
 	ScreenWidget* screen;
 	AboutWindow* aboutWindow;
@@ -114,6 +111,8 @@ class MainWindow : public QMainWindow {
 	CPUDebugger* cpuDebugger;
 	DSPDebugger* dspDebugger;
 	ThreadDebugger* threadDebugger;
+	MemorySearchWindow* memorySearch;
+	GameListWindow* gameList;
 
 	// We use SDL's game controller API since it's the sanest API that supports as many controllers as possible
 	SDL_GameController* gameController = nullptr;
@@ -123,6 +122,8 @@ class MainWindow : public QMainWindow {
 	void emuThreadMainLoop();
 	void selectLuaFile();
 	void selectROM();
+	void recordMovie();
+	void playMovie();
 	void dumpDspFirmware();
 	void dumpRomFS();
 	void showAboutMenu();
@@ -165,6 +166,8 @@ class MainWindow : public QMainWindow {
 	void loadLuaScript(const std::string& code);
 	void reloadShader(const std::string& shader);
 	void editCheat(u32 handle, const std::vector<uint8_t>& cheat, const std::function<void(u32)>& callback);
+	// Run a callback on the emulator thread, between frames. Used by tools that need to access emulator state, like the memory search
+	void runOnEmuThread(const std::function<void()>& callback);
 
 	void handleScreenResize(u32 width, u32 height);
 	void handleTouchscreenPress(QMouseEvent* event);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QComboBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QWidget>
+#include <optional>
+#include <vector>
+
+#include "emulator.hpp"
+#include "memory_scanner.hpp"
+
+class MainWindow;
+
+// Window for searching guest memory for values with the memory scanner, to find addresses for new cheat codes.
+// Scans run on the emulator thread, and their results are sent back to the GUI thread for display
+class MemorySearchWindow final : public QWidget {
+	Q_OBJECT
+
+	// Maximum number of results shown in the table. Scans can have millions of results, which the table can't handle
+	static constexpr usize maxShownResults = 1000;
+
+	Emulator* emu;
+	MainWindow* mainWindow;
+
+	QComboBox* typeSelect;
+	QComboBox* comparisonSelect;
+	QLineEdit* valueEdit;
+	QLineEdit* value2Edit;
+	QPushButton* firstScanButton;
+	QPushButton* nextScanButton;
+	QPushButton* resetButton;
+	QPushButton* copyCheatButton;
+	QLabel* resultCountLabel;
+	QTableWidget* resultTable;
+
+	// Type of the values of the search shown in the table
+	MemoryScanner::ValueType shownType = MemoryScanner::ValueType::U32;
+	std::vector<MemoryScanner::Result> shownResults;
+
+	void startScan(bool firstScan);
+	void resetScan();
+	void copyCheatCode();
+	void showResults(MemoryScanner::ValueType type, usize resultCount, std::vector<MemoryScanner::Result> results);
+	void setButtonsEnabled(bool enabled, bool searchActive);
+
+	std::optional<u32> parseValue(const QString& text, MemoryScanner::ValueType type) const;
+	static QString formatValue(u32 value, MemoryScanner::ValueType type);
+
+  public:
+	MemorySearchWindow(Emulator* emu, MainWindow* mainWindow, QWidget* parent = nullptr);
+	~MemorySearchWindow() = default;
+};
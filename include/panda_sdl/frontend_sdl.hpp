@@ -42,6 +42,8 @@ class FrontendSDL {
 	// And so the user can still use the keyboard to control the analog
 	bool keyboardAnalogX = false;
 	bool keyboardAnalogY = false;
+	// Whether vsync is currently on, which depends on the emulation speed as well as the config
+	bool vsyncActive = false;
 
   private:
 	void setupControllerSensors(SDL_GameController* controller);
@@ -3,6 +3,7 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <vector>
 
 #include "PICA/draw_acceleration.hpp"
 #include "PICA/pica_vertex.hpp"
@@ -23,6 +24,13 @@ struct EmulatorConfig;
 class GPU;
 class ShaderUnit;
 
+// The composited output of both 3DS screens, as returned by Renderer::captureFrame
+struct FrameCapture {
+	u32 width = 0;
+	u32 height = 0;
+	std::vector<u8> pixels;  // RGBA8, rows ordered from top to bottom
+};
+
 class Renderer {
   protected:
 	GPU& gpu;
@@ -50,6 +58,10 @@ class Renderer {
 	bool hashTextures = false;
 	bool outputSizeChanged = true;
 
+	// Set by renderers that queue up draws instead of issuing them immediately. While it's set, the GPU must call flushDraws before changing
+	// any state that the queued draws depend on
+	bool drawsPending = false;
+
 	EmulatorConfig* emulatorConfig = nullptr;
 
 	void doSoftwareTextureCopy(u32 inputAddr, u32 outputAddr, u32 copySize, u32 inputWidth, u32 inputGap, u32 outputWidth, u32 outputGap);
@@ -69,8 +81,22 @@ class Renderer {
 	virtual void displayTransfer(u32 inputAddr, u32 outputAddr, u32 inputSize, u32 outputSize, u32 flags) = 0;  // Perform display transfer
 	virtual void textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32 inputSize, u32 outputSize, u32 flags) = 0;
 	virtual void drawVertices(PICA::PrimType primType, std::span<const PICA::Vertex> vertices) = 0;  // Draw the given vertices
+	// Issue any draws the renderer has deferred. Only relevant for renderers that batch draws
+	virtual void flushDraws() {}
+	// Called after prepareForDraw instead of drawVertices for draws that render-skip drops. Renderers with a surface cache still look up and
+	// mark the surfaces the draw renders to here, so that transfers and CPU accesses in skipped frames see the same surfaces as in drawn ones
+	virtual void skipDraw() {}
 
 	virtual void screenshot(const std::string& name) = 0;
+	// Copy the last displayed frame into memory. Returns false if the renderer doesn't support frame capture
+	virtual bool captureFrame(FrameCapture& capture) { return false; }
+	// Hint that captureFrame is going to be called every frame (eg for streaming), so the renderer can read back frames asynchronously.
+	// While this is on, captureFrame may return the frame before the last displayed one, so that it doesn't have to wait for the GPU
+	virtual void setFrameStreaming(bool enable) {}
+	// Called before the CPU accesses a range of VRAM that the renderer asked to watch via GPU::watchVRAM, as well as before DMAs into VRAM
+	virtual void notifyVRAMAccess(u32 paddr, u32 size, bool write) {}
+	// Called when the CPU is about to run again after the GPU processed commands. Renderers that defer their VRAM watch updates must apply them here
+	virtual void commitVRAMWatches() {}
 	// Some frontends and platforms may require that we delete our GL or misc context and obtain a new one for things like exclusive fullscreen
 	// This function does things like write back or cache necessary state before we delete our context
 	virtual void deinitGraphicsContext() = 0;
@@ -118,6 +144,8 @@ class Renderer {
 		outputWindowHeight = height;
 	}
 
+	bool hasPendingDraws() const { return drawsPending; }
+
 	void setConfig(EmulatorConfig* config) { emulatorConfig = config; }
 	void setHashTextures(bool setting) { hashTextures = setting; }
 	void reloadScreenLayout() { outputSizeChanged = true; }
@@ -0,0 +1,101 @@
+#pragma once
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#include "PICA/pica_hash.hpp"
+#include "helpers.hpp"
+#include "opengl.hpp"
+
+// GPU-resident cache for the vertex & index data consumed by hardware-accelerated vertex shaders.
+// Games commonly redraw the same static meshes every frame, and re-uploading them through the stream buffers on every draw is one of the most
+// expensive parts of the hw shader path. Instead, we keep a GL buffer per (physical address, size, kind) tuple and validate it against a hash of the
+// guest data. On a hit, the renderer binds the cached buffer directly and skips the upload.
+// Data that keeps changing under the same key (eg CPU-animated vertices) is flagged as volatile and is then left to the stream buffers, so
+// that we don't end up re-creating buffers every frame.
+class GeometryCache {
+  public:
+	enum class BufferKind : u8 {
+		Vertex = 0,
+		Index8 = 1,
+		Index16 = 2,
+	};
+
+	struct Stats {
+		u64 hits = 0;
+		u64 misses = 0;
+		u64 invalidations = 0;  // Number of times a cached buffer was re-uploaded because the guest data changed
+		u64 evictions = 0;
+		u64 bytesUploaded = 0;
+		usize residentBytes = 0;
+	};
+
+	// Total amount of VRAM we allow the cache to occupy before evicting the least recently used buffers
+	static constexpr usize defaultBudget = 64_MB;
+	// Buffers smaller than this are cheaper to stream than to look up, hash and bind separately
+	static constexpr u32 minCachedSize = 1_KB;
+	// Keep the number of tracked buffers bounded, as every entry holds a GL buffer object
+	static constexpr usize maxEntries = 4096;
+	// If the data behind a key changes this many times in a row without being reused in between, we stop caching it
+	static constexpr u32 volatileThreshold = 3;
+
+  private:
+	struct Key {
+		u32 address;
+		u32 size;
+		BufferKind kind;
+
+		bool operator==(const Key& other) const { return address == other.address && size == other.size && kind == other.kind; }
+	};
+
+	struct KeyHash {
+		usize operator()(const Key& key) const {
+			const u64 combined = (u64(key.address) << 32) ^ (u64(key.size) << 2) ^ u64(key.kind);
+			return std::hash<u64>()(combined);
+		}
+	};
+
+	struct Entry {
+		GLuint buffer = 0;
+		PICAHash::HashType hash = 0;
+		u32 consecutiveChanges = 0;
+		bool isVolatile = false;
+		// Draw this entry was last looked up in. Entries of the current draw can't be evicted, as their buffers may already be bound
+		u64 lastDraw = 0;
+
+		// Position of this entry in the LRU list
+		std::list<Key>::iterator lruPosition;
+	};
+
+	std::unordered_map<Key, Entry, KeyHash> entries;
+	// Keys ordered from most recently used (front) to least recently used (back)
+	std::list<Key> lru;
+
+	usize budget = defaultBudget;
+	u64 drawGeneration = 0;
+	Stats stats;
+
+	void evict(Key key);
+	// Evict entries until size more bytes fit in the budget. Returns false if that isn't possible without evicting entries of the current draw
+	bool makeRoom(usize size);
+	void upload(Entry& entry, const u8* data, u32 size);
+
+  public:
+	// Call before looking up the buffers of a new draw. Buffers looked up since the previous call are then no longer pinned
+	void beginDraw() { drawGeneration++; }
+
+	// Returns the GL buffer holding a copy of the guest data, uploading it if it's not resident or out of date.
+	// The buffer stays valid until the next beginDraw call, even if other lookups for the same draw need room in the cache.
+	// Returns 0 if the data should not be cached, in which case the caller should stream it instead.
+	GLuint lookup(BufferKind kind, u32 address, const u8* data, u32 size);
+
+	void reset();
+	void setBudget(usize newBudget);
+
+	const Stats& getStats() const { return stats; }
+	void resetStats() {
+		const usize residentBytes = stats.residentBytes;
+		stats = Stats();
+		stats.residentBytes = residentBytes;
+	}
+};
@@ -9,13 +9,17 @@
 #include <unordered_map>
 #include <utility>
 
+#include "PICA/dirty_state.hpp"
 #include "PICA/float_types.hpp"
 #include "PICA/pica_frag_config.hpp"
+#include "PICA/pica_frag_uniforms.hpp"
 #include "PICA/pica_hash.hpp"
 #include "PICA/pica_vert_config.hpp"
 #include "PICA/pica_vertex.hpp"
 #include "PICA/regs.hpp"
+#include "PICA/shader_decompiler.hpp"
 #include "PICA/shader_gen.hpp"
+#include "geometry_cache.hpp"
 #include "gl/stream_buffer.h"
 #include "gl_driver.hpp"
 #include "gl_state.hpp"
@@ -40,8 +44,9 @@ class RendererGL final : public Renderer {
 	OpenGL::VertexArray hwShaderVAO;
 	OpenGL::VertexBuffer vbo;
 
-	// Data that will be uploaded to the ubershader
-	struct {
+	// Uniform locations of an ubershader program. The ubershader FS can be linked with either the default ubershader VS or with a
+	// recompiled PICA vertex shader, and every such program has its own locations
+	struct UbershaderUniforms {
 		// TEV configuration uniform locations
 		GLint textureEnvSourceLoc = -1;
 		GLint textureEnvOperandLoc = -1;
@@ -56,7 +61,14 @@ class RendererGL final : public Renderer {
 		GLint depthOffsetLoc = -1;
 		GLint depthScaleLoc = -1;
 		GLint depthmapEnableLoc = -1;
-	} ubershaderData;
+	};
+
+	// Data that will be uploaded to the ubershader
+	UbershaderUniforms ubershaderData;
+	// The ubershader fragment shader, shared by triangleProgram and the ubershader programs using accelerated vertex shaders
+	OpenGL::Shader ubershaderFragShader;
+	// The ubershader program we last uploaded uniforms to. Uniforms are per-program, so switching programs means re-uploading all of them
+	GLuint lastUbershaderProgram = 0;
 
 	float oldDepthScale = -1.0;
 	float oldDepthOffset = 0.0;
@@ -70,6 +82,8 @@ class RendererGL final : public Renderer {
 	GLuint minimumIndex = 0;
 	GLuint maximumIndex = 0;
 	void* hwIndexBufferOffset = nullptr;
+	// Buffer to source indices from for indexed renders. Either the index stream buffer or a buffer from the geometry cache
+	GLuint hwIndexBufferHandle = 0;
 
 	// When doing hw shaders, we cache which attributes are enabled in our VAO to avoid having to enable/disable all attributes on each draw
 	u32 previousAttributeMask = 0;
@@ -78,7 +92,8 @@ class RendererGL final : public Renderer {
 	OpenGL::Shader* generatedVertexShader = nullptr;
 
 	SurfaceCache<DepthBuffer, 16, true> depthBufferCache;
-	SurfaceCache<ColourBuffer, 16, true> colourBufferCache;
+	static constexpr usize colourBufferCacheSize = 16;
+	SurfaceCache<ColourBuffer, colourBufferCacheSize, true> colourBufferCache;
 	SurfaceCache<Texture, 256, true> textureCache;
 
 	// Dummy VAO/VBO for blitting the final output
@@ -101,17 +116,80 @@ class RendererGL final : public Renderer {
 	std::unique_ptr<StreamBuffer> hwVertexBuffer;
 	std::unique_ptr<StreamBuffer> hwIndexBuffer;
 
+	// Cache of vertex/index data that is reused across draws when using hw shaders, to avoid re-uploading static geometry
+	GeometryCache geometryCache;
+	// Counts of PICA vertex shaders by the strategy the GLSL decompiler used for them
+	PICA::ShaderGen::DecompilerStats shaderDecompilerStats;
+
+	// PICA::DirtyState groups that changed since each piece of derived state below was last rebuilt. Filled from GPU::dirtyState by collectDirtyState
+	struct {
+		u32 fragmentShader = PICA::DirtyState::All;
+		u32 fragmentUniforms = PICA::DirtyState::All;
+		u32 blending = PICA::DirtyState::All;
+		u32 stencil = PICA::DirtyState::All;
+		u32 ubershader = PICA::DirtyState::All;
+	} pendingDirtyState;
+
+	// Specialized fragment shader matching the last FragmentConfig we built. Points into shaderCache
+	OpenGL::Shader* currentFragmentShader = nullptr;
+
+	// Last fragment uniforms we built, and where they were uploaded in the fragment UBO
+	PICA::FragmentUniforms fragmentUniforms;
+	u32 fragmentUniformsOffset = 0;
+
+	// Host blending & stencil state translated from the PICA registers
+	struct {
+		bool blendingEnabled = false;
+		GLenum logicOp = GL_COPY;
+		GLenum rgbEquation = GL_FUNC_ADD;
+		GLenum alphaEquation = GL_FUNC_ADD;
+		GLenum rgbSourceFunc = GL_ONE;
+		GLenum rgbDestFunc = GL_ZERO;
+		GLenum alphaSourceFunc = GL_ONE;
+		GLenum alphaDestFunc = GL_ZERO;
+	} blendState;
+
+	struct {
+		GLenum func = GL_ALWAYS;
+		GLint reference = 0;
+		GLuint referenceMask = 0;
+		GLuint writeMask = 0;
+		GLenum stencilFailOp = GL_KEEP;
+		GLenum depthFailOp = GL_KEEP;
+		GLenum passOp = GL_KEEP;
+	} stencilState;
+
+	// Consecutive CPU-shaded draws with the same rasterizer state are merged into one batch, which gets issued as a single draw call when
+	// the state changes or when someone needs the results of the draws. Batches of more than 1 draw are always stored as triangle lists
+	struct DrawBatch {
+		std::vector<PICA::Vertex> vertices;
+		PICA::PrimType primType = PICA::PrimType::TriangleList;
+	} drawBatch;
+
+	// Our VBO holds vertexBufferSize * 2 vertices, so batches can't grow past that
+	static constexpr usize maxBatchedVertices = usize(vertexBufferSize) * 2;
+
 	// Current offset for our hw shader uniform UBO
 	u32 hwShaderUniformUBOOffset = 0;
 
 	// Cache of fixed attribute values so that we don't do any duplicate updates
 	std::array<std::array<float, 4>, 16> fixedAttrValues;
 
+	// UBO binding points for the PICA shader uniforms when using hw shaders, and the shadergen fragment uniforms
+	static constexpr uint vsUBOBlockBinding = 1;
+	static constexpr uint fsUBOBlockBinding = 2;
+
 	// Cached recompiled fragment shader
 	struct CachedProgram {
 		OpenGL::Program program;
 	};
 
+	// Ubershader linked with an accelerated vertex shader
+	struct CachedUbershaderProgram {
+		OpenGL::Program program;
+		UbershaderUniforms uniforms;
+	};
+
 	struct ShaderCache {
 		std::unordered_map<PICA::VertConfig, std::optional<OpenGL::Shader>> vertexShaderCache;
 		std::unordered_map<PICA::FragmentConfig, OpenGL::Shader> fragmentShaderCache;
@@ -119,6 +197,16 @@ class RendererGL final : public Renderer {
 		// Program cache indexed by GLuints for the vertex and fragment shader to use
 		// Top 32 bits are the vertex shader GLuint, bottom 32 bits are the fs GLuint
 		std::unordered_map<u64, CachedProgram> programCache;
+		// Ubershader programs indexed by the GLuint of their vertex shader, as they all share the ubershader FS
+		std::unordered_map<GLuint, CachedUbershaderProgram> ubershaderProgramCache;
+
+		void clearUbershaderPrograms() {
+			for (auto& it : ubershaderProgramCache) {
+				it.second.program.free();
+			}
+
+			ubershaderProgramCache.clear();
+		}
 
 		void clear() {
 			for (auto& it : programCache) {
@@ -126,6 +214,8 @@ class RendererGL final : public Renderer {
 				cachedProgram.program.free();
 			}
 
+			clearUbershaderPrograms();
+
 			for (auto& it : vertexShaderCache) {
 				if (it.second.has_value()) {
 					it.second->free();
@@ -146,6 +236,7 @@ class RendererGL final : public Renderer {
 	OpenGL::Framebuffer getColourFBO();
 	OpenGL::Texture getTexture(Texture& tex);
 	OpenGL::Program& getSpecializedShader();
+	CachedUbershaderProgram& getAcceleratedUbershader();
 
 	PICA::ShaderGen::FragmentGenerator fragShaderGen;
 	OpenGL::Driver driverInfo;
@@ -171,22 +262,69 @@ class RendererGL final : public Renderer {
 		bool canDoSingleBlit = true;
 	} blitInfo;
 
+	// Ring of pixel pack buffers for reading back the composited screen asynchronously. When frame streaming is on, display() queues a readback
+	// of each frame into the next buffer, and captureFrame returns the frame before that. Its copy was queued a whole frame earlier, so mapping
+	// it doesn't stall on the frame the GPU is still working on
+	struct FrameReadback {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	static constexpr usize frameReadbackCount = 3;
+	std::array<FrameReadback, frameReadbackCount> frameReadbacks;
+	usize nextReadback = 0;          // Index of the buffer the next readback goes to
+	usize consecutiveReadbacks = 0;  // How many of the most recently displayed frames are in the ring, up to frameReadbackCount
+	bool frameStreaming = false;
+
+	void queueFrameReadback();
+	void releaseFrameReadbacks();
+
+	// Coherency between colour buffers and guest memory. Rendering marks colour buffers as newer than memory, and CPU accesses to them
+	// (which we watch for through the memory subsystem) make us write them back or reload them. Only buffers that are actually touched get transferred
+	std::vector<u8> surfaceStagingBuffer;
+
+	// Load a colour buffer from memory if memory was written to since it was last loaded
+	void loadSurface(ColourBuffer& surface);
+	// Mark a colour buffer as rendered to, so that it gets written back to memory when the CPU accesses it
+	void markSurfaceRendered(ColourBuffer& surface);
+	// Look up, load and bind the colour buffer the current draw renders to, and mark it as rendered
+	ColourBuffer* bindDrawColourBuffer();
+	// Write a colour buffer back to memory if it was rendered to since it was last written back
+	void flushSurface(ColourBuffer& surface);
+	void queueSurfaceReadback(ColourBuffer& surface);
+	// Update which VRAM pages in a range are watched for CPU accesses, based on the state of the colour buffers overlapping them
+	void updateVRAMWatch(Interval<u32> range);
+
+	// Buffers that get rendered to only need their pages watched by the time the CPU runs again, so the watch updates of a whole batch of GPU
+	// commands are merged into one and applied by commitVRAMWatches. This saves a lot of mprotect calls with fastmem
+	std::optional<Interval<u32>> pendingVRAMWatch = std::nullopt;
+	void queueVRAMWatchUpdate(Interval<u32> range);
+
 	MAKE_LOG_FUNCTION(log, rendererLogger)
 	void setupBlending();
 	void setupStencilTest(bool stencilEnable);
 	void bindDepthBuffer();
-	void setupUbershaderTexEnv();
+	void setupUbershaderTexEnv(const UbershaderUniforms& uniforms);
 	void bindTexturesToSlots();
 	void updateLightingLUT();
 	void updateFogLUT();
 	void initGraphicsContextInternal();
+	// Fetch the state groups that the GPU invalidated since the last call and mark our derived state as out of date
+	void collectDirtyState();
+	// Force all derived state to be rebuilt, eg when the GL objects or GL state it refers to are gone
+	void invalidateDerivedState();
 
 	void accelerateVertexUpload(ShaderUnit& shaderUnit, PICA::DrawAcceleration* accel);
+	// Set up the rasterizer state for the current registers and issue a draw with the given vertices
+	void issueDraw(PICA::PrimType primType, std::span<const PICA::Vertex> vertices);
 	void compileDisplayShader();
 
   public:
 	RendererGL(GPU& gpu, const std::array<u32, regNum>& internalRegs, const std::array<u32, extRegNum>& externalRegs)
-		: Renderer(gpu, internalRegs, externalRegs), fragShaderGen(PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL) {}
+		: Renderer(gpu, internalRegs, externalRegs), fragShaderGen(PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL) {
+		// Evicted buffers may hold rendered data that never made it to memory
+		colourBufferCache.setEvictionCallback([this](ColourBuffer& surface) { flushSurface(surface); });
+	}
 	~RendererGL() override;
 
 	void reset() override;
@@ -196,6 +334,8 @@ class RendererGL final : public Renderer {
 	void displayTransfer(u32 inputAddr, u32 outputAddr, u32 inputSize, u32 outputSize, u32 flags) override;  // Perform display transfer
 	void textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32 inputSize, u32 outputSize, u32 flags) override;
 	void drawVertices(PICA::PrimType primType, std::span<const PICA::Vertex> vertices) override;  // Draw the given vertices
+	void flushDraws() override;
+	void skipDraw() override;
 	void deinitGraphicsContext() override;
 
 	virtual bool supportsShaderReload() override { return true; }
@@ -204,13 +344,23 @@ class RendererGL final : public Renderer {
 	virtual bool prepareForDraw(ShaderUnit& shaderUnit, PICA::DrawAcceleration* accel) override;
 	virtual void setupGLES() override;
 
-	std::optional<ColourBuffer> getColourBuffer(u32 addr, PICA::ColorFmt format, u32 width, u32 height, bool createIfnotFound = true);
+	ColourBuffer* getColourBuffer(u32 addr, PICA::ColorFmt format, u32 width, u32 height, bool createIfnotFound = true);
+	const GeometryCache::Stats& getGeometryCacheStats() const { return geometryCache.getStats(); }
+	const PICA::ShaderGen::DecompilerStats& getShaderDecompilerStats() const { return shaderDecompilerStats; }
 
 	// Note: The caller is responsible for deleting the currently bound FBO before calling this
 	void setFBO(uint handle) { screenFramebuffer.m_handle = handle; }
-	void resetStateManager() { gl.reset(); }
-	void initUbershader(OpenGL::Program& program);
+	void resetStateManager() {
+		gl.reset();
+		// The frontend may have clobbered GL state that our state manager doesn't track, such as the stencil func or the blend colour
+		invalidateDerivedState();
+	}
+	void initUbershader(OpenGL::Program& program, UbershaderUniforms& uniforms);
 
 	// Take a screenshot of the screen and store it in a file
 	void screenshot(const std::string& name) override;
+	bool captureFrame(FrameCapture& capture) override;
+	void setFrameStreaming(bool enable) override { frameStreaming = enable; }
+	void notifyVRAMAccess(u32 paddr, u32 size, bool write) override;
+	void commitVRAMWatches() override;
 };
\ No newline at end of file
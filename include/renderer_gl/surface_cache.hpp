@@ -27,6 +27,9 @@ class SurfaceCache {
 	size_t evictionIndex = 0;
 	std::array<SurfaceType, capacity> buffer;
 
+	// Called with surfaces right before they're evicted to make room for another one, eg to write their contents back to memory
+	std::function<void(SurfaceType&)> evictionCallback = nullptr;
+
 	// Map from address to a surface in the above buffer.
 	// Several cached surfaces may have the same starting address, so we use a multimap.
 	std::multimap<u32, SurfaceType*> surfaceMap;
@@ -45,7 +48,17 @@ class SurfaceCache {
 		}
 	}
 
+	void evict(SurfaceType& surface) {
+		if (evictionCallback) {
+			evictionCallback(surface);
+		}
+
+		unindexSurface(surface);
+	}
+
   public:
+	void setEvictionCallback(const std::function<void(SurfaceType&)>& callback) { evictionCallback = callback; }
+
 	void reset() {
 		size = 0;
 		evictionIndex = 0;
@@ -91,7 +104,7 @@ class SurfaceCache {
 				}
 
 				auto& e = buffer[evictionIndex];
-				unindexSurface(e);
+				evict(e);
 				evictionIndex = (evictionIndex + 1) % capacity;
 
 				e.valid = false;
@@ -110,7 +123,7 @@ class SurfaceCache {
 		// See if any existing surface fully overlaps
 		for (auto& e : buffer) {
 			if (e.valid && e.range.lower() >= surface.range.lower() && e.range.upper() <= surface.range.upper()) {
-				unindexSurface(e);
+				evict(e);
 				e.free();
 				e = surface;
 				e.allocate();
@@ -133,6 +146,16 @@ class SurfaceCache {
 		Helpers::panic("Couldn't add surface to cache\n");
 	}
 
+	// Calls func for every valid surface that overlaps the given range of memory
+	template <typename Func>
+	void forEachInRange(Interval<u32> range, Func&& func) {
+		for (auto& e : buffer) {
+			if (e.valid && boost::icl::intersects(e.range, range)) {
+				func(e);
+			}
+		}
+	}
+
 	SurfaceType& operator[](size_t i) { return buffer[i]; }
 	const SurfaceType& operator[](size_t i) const { return buffer[i]; }
 };
\ No newline at end of file
@@ -20,6 +20,18 @@ struct ColourBuffer {
 	OpenGL::Texture texture;
 	OpenGL::Framebuffer fbo;
 
+	// Coherency between the texture and the copy of the buffer in guest memory. At most one of these is set at a time.
+	// New buffers start out with needsUpload set, so that their contents get loaded from memory the first time they're used
+	bool gpuDirty = false;    // The texture was rendered to after the buffer was last written back to memory
+	bool needsUpload = true;  // Memory was written to after the texture was last loaded from it
+	// Set once the CPU has touched the buffer after the GPU rendered to it. Such buffers get read back ahead of time at the end of each frame
+	bool prefetchReadback = false;
+
+	// Pixel pack buffer the texture gets read back into, and the fence for the last readback. The fence is only kept as long as no rendering
+	// happened after the readback was queued, ie while the readback is up to date
+	GLuint readbackBuffer = 0;
+	GLsync readbackFence = nullptr;
+
 	ColourBuffer() : valid(false) {}
 
 	ColourBuffer(u32 loc, PICA::ColorFmt format, u32 x, u32 y, bool valid = true) : location(loc), format(format), size({x, y}), valid(valid) {
@@ -51,18 +63,10 @@ struct ColourBuffer {
 			Helpers::warn("ColourBuffer: Incomplete framebuffer");
 		}
 
-		// TODO: This should not clear the framebuffer contents. It should load them from VRAM.
-		GLint oldViewport[4];
-		GLfloat oldClearColour[4];
-
-		glGetIntegerv(GL_VIEWPORT, oldViewport);
-		glGetFloatv(GL_COLOR_CLEAR_VALUE, oldClearColour);
-
-		OpenGL::setViewport(size.x(), size.y());
-		OpenGL::setClearColor(0.0, 0.0, 0.0, 1.0);
-		OpenGL::clearColor();
-		OpenGL::setViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
-		OpenGL::setClearColor(oldClearColour[0], oldClearColour[1], oldClearColour[2], oldClearColour[3]);
+		// The texture contents are loaded from memory by the renderer the first time the buffer is used
+		gpuDirty = false;
+		needsUpload = true;
+		prefetchReadback = false;
 	}
 
 	void free() {
@@ -72,6 +76,16 @@ struct ColourBuffer {
 			texture.free();
 			fbo.free();
 		}
+
+		if (readbackFence != nullptr) {
+			glDeleteSync(readbackFence);
+			readbackFence = nullptr;
+		}
+
+		if (readbackBuffer != 0) {
+			glDeleteBuffers(1, &readbackBuffer);
+			readbackBuffer = 0;
+		}
 	}
 
 	Math::Rect<u32> getSubRect(u32 inputAddress, u32 width, u32 height) {
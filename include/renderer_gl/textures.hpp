@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "PICA/pica_hash.hpp"
 #include "PICA/regs.hpp"
@@ -45,7 +47,9 @@ struct Texture {
 
 	void allocate();
 	void setNewConfig(u32 newConfig);
-	void decodeTexture(std::span<const u8> data);
+	// Decode the texture to RGBA8, with rows ordered the way upload() expects them
+	std::vector<u32> decodeTexture(std::span<const u8> data);
+	void upload(std::span<const u32> decoded);
 	void free();
 	u64 sizeInBytes();
 
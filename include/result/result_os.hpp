@@ -9,6 +9,7 @@ namespace Result::OS {
 	DEFINE_HORIZON_RESULT(MisalignedAddress, 1009, InvalidArgument, Usage);
 	DEFINE_HORIZON_RESULT(MisalignedSize, 1010, InvalidArgument, Usage);
 	DEFINE_HORIZON_RESULT(NotImplemented, 1012, InvalidArgument, Usage);
+	DEFINE_HORIZON_RESULT(InvalidAddressState, 1013, InvalidState, Usage);
 	DEFINE_HORIZON_RESULT(InvalidHandle, 1015, WrongArgument, Permanent);
 	DEFINE_HORIZON_RESULT(OutOfRange, 1021, InvalidArgument, Usage);
 	DEFINE_HORIZON_RESULT(Timeout, 1022, StatusChanged, Info);
@@ -14,6 +14,8 @@ struct Scheduler {
 		SignalY2R = 4,       // Signal that a Y2R conversion has finished
 		UpdateIR = 5,        // Update an IR device (For now, just the CirclePad Pro/N3DS controls)
 		Panic = 6,           // Dummy event that is always pending and should never be triggered (Timestamp = UINT64_MAX)
+		UpdateHID = 7,       // Sample the host's input state and write it to HID shared memory
+		SignalAAC = 8,       // Report that an AAC decode request sent to the DSP has finished
 		TotalNumberOfEvents  // How many event types do we have in total?
 	};
 	static constexpr usize totalNumberOfEvents = static_cast<usize>(EventType::TotalNumberOfEvents);
@@ -1,5 +1,7 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <functional>
 #include <optional>
 #include <string>
 
@@ -8,6 +10,7 @@
 #include "logger.hpp"
 #include "memory.hpp"
 #include "result/result.hpp"
+#include "scheduler.hpp"
 
 namespace HID::Keys {
 	enum : u32 {
@@ -44,6 +47,27 @@ namespace HID::Keys {
 	u32 nameToKey(std::string name);
 }  // namespace HID::Keys
 
+namespace HID {
+	// Snapshot of the frontend's input state, as latched by one HID sample. This is all the input the guest ever sees, which makes it
+	// what movies record and replay. Fixed layout, as movies store it as-is
+	struct InputState {
+		u32 buttons;      // Pad state, including the CirclePad Pro buttons but not the circlepad direction bits
+		u32 touchScreen;  // Packed by HIDService::packTouchScreen
+		s16 circlePadX, circlePadY;
+		s16 cStickX, cStickY;
+		// Gyroscope and accelerometer state. They're only sampled every other HID update and are 0 in the samples in between
+		s16 roll, pitch, yaw;
+		s16 accelX, accelY, accelZ;
+		u16 padding[2];
+
+		bool operator==(const InputState& other) const = default;
+	};
+	static_assert(sizeof(InputState) == 32);
+
+	// Called with every latched input state before the HID service uses it. The hook may replace the state
+	using InputHook = std::function<void(u64 tick, InputState& state)>;
+}  // namespace HID
+
 // Circular dependency because we need HID to spawn events
 class Kernel;
 
@@ -60,21 +84,34 @@ class HIDService {
 	uint nextAccelerometerIndex;
 	uint nextGyroIndex;
 
-	u32 newButtons;  // The button state currently being edited
-	u32 oldButtons;  // The previous pad state
-
-	s16 circlePadX, circlePadY;      // Circlepad state
-	s16 touchScreenX, touchScreenY;  // Touchscreen state
-	s16 roll, pitch, yaw;            // Gyroscope state
-	s16 accelX, accelY, accelZ;      // Accelerometer state
+	// Input state written by the frontend. Frontends may update it from their own thread at any time, so everything is atomic and the HID
+	// sampling event latches a copy of it right before writing it to shared memory. This way inputs are picked up as late as possible
+	std::atomic<u32> newButtons;                 // The button state currently being edited, not including the circlepad direction bits
+	std::atomic<s16> circlePadX, circlePadY;     // Circlepad state
+	std::atomic<u32> touchScreenState;           // Touchscreen state, packed by packTouchScreen so that x, y and the press can't tear
+	std::atomic<s16> roll, pitch, yaw;           // Gyroscope state. Relative, so it gets reset every time it's sampled
+	std::atomic<s16> accelX, accelY, accelZ;     // Accelerometer state
 
 	// New 3DS/CirclePad Pro C-stick state
-	s16 cStickX, cStickY;
+	std::atomic<s16> cStickX, cStickY;
+
+	u32 oldButtons;                      // The previous pad state, as sampled by the last HID update
+	s16 latchedCStickX, latchedCStickY;  // C-stick state as sampled by the last HID update, read by the IR service
+	HID::InputHook inputHook = nullptr;
+
+	// Period of the HID sampling event. The HID module updates the pad and touchscreen roughly every 4.3ms (234Hz)
+	// The accelerometer and gyroscope are updated every other sample, which is close enough to their ~104Hz rate
+	static constexpr u64 padUpdateTicks = Scheduler::arm11Clock / 234;
+	uint sampleCount;
+
+	static constexpr u32 touchScreenPressedBit = 1u << 31;
+	static constexpr u32 packTouchScreen(u16 x, u16 y, bool pressed) {
+		return u32(x & 0x7fff) | (u32(y & 0x7fff) << 15) | (pressed ? touchScreenPressedBit : 0);
+	}
 
 	bool accelerometerEnabled;
 	bool eventsInitialized;
 	bool gyroEnabled;
-	bool touchScreenPressed;
 
 	std::array<std::optional<Handle>, 5> events;
 
@@ -113,43 +150,25 @@ class HIDService {
 	void reset();
 	void handleSyncRequest(u32 messagePointer);
 
-	void pressKey(u32 mask) { newButtons |= mask; }
-	void releaseKey(u32 mask) { newButtons &= ~mask; }
+	// The input setters below may be called from any thread
+	void pressKey(u32 mask) { newButtons.fetch_or(mask, std::memory_order_relaxed); }
+	void releaseKey(u32 mask) { newButtons.fetch_and(~mask, std::memory_order_relaxed); }
 	void setKey(u32 mask, bool pressed) { pressed ? pressKey(mask) : releaseKey(mask); }
 
 	u32 getOldButtons() const { return oldButtons; }
 	s16 getCirclepadX() const { return circlePadX; }
 	s16 getCirclepadY() const { return circlePadY; }
 
-	void setCirclepadX(s16 x) {
-		circlePadX = x;
-
-		// Turn bits 28 and 29 off in the new button state, which indicate whether the circlepad is steering left or right
-		// Then, set them according to the new value of x
-		newButtons &= ~(HID::Keys::CirclePadLeft | HID::Keys::CirclePadRight);
-		if (x >= 41)  // Pressing right
-			newButtons |= HID::Keys::CirclePadRight;
-		else if (x <= -41)  // Pressing left
-			newButtons |= HID::Keys::CirclePadLeft;
-	}
-
-	void setCirclepadY(s16 y) {
-		circlePadY = y;
-
-		// Turn bits 30 and 31 off in the new button state, which indicate whether the circlepad is steering up or down
-		// Then, set them according to the new value of y
-		newButtons &= ~(HID::Keys::CirclePadUp | HID::Keys::CirclePadDown);
-		if (y >= 41)  // Pressing up
-			newButtons |= HID::Keys::CirclePadUp;
-		else if (y <= -41)  // Pressing down
-			newButtons |= HID::Keys::CirclePadDown;
-	}
+	// The circlepad direction bits (28-31) of the pad state get computed from the circlepad position when inputs are sampled
+	void setCirclepadX(s16 x) { circlePadX = x; }
+	void setCirclepadY(s16 y) { circlePadY = y; }
 
 	void setCStickX(s16 x) { cStickX = x; }
 	void setCStickY(s16 y) { cStickY = y; }
 
-	s16 getCStickX() { return cStickX; }
-	s16 getCStickY() { return cStickY; }
+	// These return the state of the last HID sample, so that the CirclePad Pro sees the same inputs as the rest of the guest
+	s16 getCStickX() { return latchedCStickX; }
+	s16 getCStickY() { return latchedCStickY; }
 
 	void setRoll(s16 value) { roll = value; }
 	void setPitch(s16 value) { pitch = value; }
@@ -161,7 +180,10 @@ class HIDService {
 		accelZ = z;
 	}
 
-	void updateInputs(u64 currentTimestamp);
+	// Called by the scheduler's HID sampling event. Latches the current input state, writes it to shared memory, signals the HID events and
+	// schedules the next sample
+	void updateInputs(u64 currentTick);
+	void setInputHook(const HID::InputHook& hook) { inputHook = hook; }
 
 	void setSharedMem(u8* ptr) {
 		sharedMem = ptr;
@@ -170,12 +192,8 @@ class HIDService {
 		}
 	}
 
-	void setTouchScreenPress(u16 x, u16 y) {
-		touchScreenX = x;
-		touchScreenY = y;
-		touchScreenPressed = true;
-	}
-
-	void releaseTouchScreen() { touchScreenPressed = false; }
-	bool isTouchScreenPressed() { return touchScreenPressed; }
+	void setTouchScreenPress(u16 x, u16 y) { touchScreenState = packTouchScreen(x, y, true); }
+	// Keep the last touched position, only clear the press
+	void releaseTouchScreen() { touchScreenState.fetch_and(~touchScreenPressedBit, std::memory_order_relaxed); }
+	bool isTouchScreenPressed() { return (touchScreenState & touchScreenPressedBit) != 0; }
 };
@@ -135,6 +135,7 @@ class ServiceManager {
 	DSPService& getDSP() { return dsp; }
 	Y2RService& getY2R() { return y2r; }
 	IRUserService& getIRUser() { return ir_user; }
+	SSLService& getSSL() { return ssl; }
 
 	void addServiceIntercept(const std::string& service, u32 function, int callbackRef) {
 		auto success = interceptedServices.try_emplace(InterceptedService(service, function), callbackRef);
@@ -1,4 +1,5 @@
 #pragma once
+#include <optional>
 #include <random>
 
 #include "helpers.hpp"
@@ -15,6 +16,7 @@ class SSLService {
 
 	std::mt19937 rng;  // Use a Mersenne Twister for RNG since this service is supposed to have better rng than just rand()
 	bool initialized;
+	std::optional<u32> fixedSeed = std::nullopt;  // Seed to use instead of a random one, to make runs reproducible
 
 	// Service commands
 	void initialize(u32 messagePointer);
@@ -24,4 +26,5 @@ class SSLService {
 	SSLService(Memory& mem) : mem(mem) {}
 	void reset();
 	void handleSyncRequest(u32 messagePointer);
+	void setFixedSeed(std::optional<u32> seed) { fixedSeed = seed; }
 };
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PICA/pica_hash.hpp"
+#include "crypto/aes_engine.hpp"
+#include "helpers.hpp"
+
+// Forward-declare this since only the shader JIT needs the full definition, and it only exists on platforms the JIT supports
+class CompiledShader;
+
+// A thread-safe cache that can be shared between multiple emulator instances running in the same process.
+// Entries must never be modified after they've been inserted, since other instances may be using them at the same time.
+// Eviction only drops the cache's reference to an entry, so anyone still holding the shared_ptr can keep using it.
+// Entries are evicted in CLOCK (second chance) order, an approximation of LRU: lookups only set a flag on the entry, so they can keep
+// using the shared lock, and inserts sweep a ring of entries, evicting the first one that wasn't looked up since the hand last passed it.
+// Each step of the sweep either evicts an entry or clears a flag set by an earlier lookup, so inserts are O(1) amortized
+template <typename Key, typename Value, typename Hasher = std::hash<Key>>
+class ConcurrentCache {
+	struct Entry {
+		std::shared_ptr<Value> value;
+		usize cost;
+		// Set when the entry is looked up, cleared when the clock hand passes over it. Atomic so that lookups only need the shared lock
+		mutable std::atomic<bool> referenced = false;
+
+		Entry(std::shared_ptr<Value> value, usize cost) : value(std::move(value)), cost(cost) {}
+	};
+
+	using Map = std::unordered_map<Key, Entry, Hasher>;
+
+	mutable std::shared_mutex mutex;
+	Map entries;
+	// The clock ring, in insertion order. Pointers to unordered_map elements stay valid until the element is erased, even when the map
+	// rehashes. The hand wraps around to the front when it reaches the end
+	using Ring = std::list<typename Map::value_type*>;
+	Ring ring;
+	typename Ring::iterator hand = ring.end();
+
+	usize capacity;  // Max total cost of the entries in the cache. The unit depends on the cache, usually bytes
+	usize totalCost = 0;
+
+	void advanceHand() {
+		if (++hand == ring.end()) {
+			hand = ring.begin();
+		}
+	}
+
+  public:
+	explicit ConcurrentCache(usize capacity) : capacity(capacity) {}
+
+	std::shared_ptr<Value> find(const Key& key) const {
+		std::shared_lock lock(mutex);
+		auto it = entries.find(key);
+		if (it == entries.end()) {
+			return nullptr;
+		}
+
+		// Avoid writing the flag when it's already set, so that hot entries don't keep bouncing their cache line between threads
+		if (!it->second.referenced.load(std::memory_order_relaxed)) {
+			it->second.referenced.store(true, std::memory_order_relaxed);
+		}
+
+		return it->second.value;
+	}
+
+	// Add an entry to the cache. If another instance inserted the same key in the meantime, we keep the existing entry instead
+	// Returns whichever entry ended up in the cache, so that all instances end up sharing a single copy
+	std::shared_ptr<Value> insert(const Key& key, std::shared_ptr<Value> value, usize cost) {
+		std::unique_lock lock(mutex);
+		if (auto it = entries.find(key); it != entries.end()) {
+			return it->second.value;
+		}
+
+		// Sweep the ring until the new entry fits, giving entries that were looked up since the hand last passed them a second chance
+		while (!ring.empty() && totalCost + cost > capacity) {
+			if (hand == ring.end()) {
+				hand = ring.begin();
+			}
+
+			Entry& entry = (*hand)->second;
+			if (entry.referenced.exchange(false, std::memory_order_relaxed)) {
+				advanceHand();
+			} else {
+				totalCost -= entry.cost;
+				entries.erase(entries.find((*hand)->first));
+				hand = ring.erase(hand);
+			}
+		}
+
+		// New entries go right behind the hand, so that they're the last ones it gets to
+		totalCost += cost;
+		auto it = entries.try_emplace(key, value, cost).first;
+		ring.insert(hand, &*it);
+		return value;
+	}
+
+	void clear() {
+		std::unique_lock lock(mutex);
+		entries.clear();
+		ring.clear();
+		hand = ring.end();
+		totalCost = 0;
+	}
+};
+
+// Identifies a block of decrypted NCCH data. The key and initial counter are unique to a partition of a title, so instances running the same
+// title can share decrypted blocks without having to know anything about which file they came from
+struct DecryptedBlockKey {
+	Crypto::AESKey normalKey;
+	Crypto::AESKey initialCounter;
+	u64 offset;
+
+	bool operator==(const DecryptedBlockKey& other) const {
+		return normalKey == other.normalKey && initialCounter == other.initialCounter && offset == other.offset;
+	}
+
+	struct Hasher {
+		usize operator()(const DecryptedBlockKey& key) const { return usize(PICAHash::computeHash((const char*)&key, sizeof(key))); }
+	};
+};
+
+// Caches for data that is expensive to produce and only depends on the title being run, not on the state of the emulator.
+// Every Emulator owns one by default. Hosts that run several instances of the same title can create one and pass it to all of them instead
+struct SharedCaches {
+	static constexpr usize decryptedBlockSize = 64_KB;
+
+	// Vertex shaders compiled by the shader JIT, keyed by the shader & operand descriptor hash. JIT code only accesses shader state through the
+	// PICAShader passed to it, so it can run for any instance. The cost of an entry is the size of its executable memory
+	ConcurrentCache<u64, CompiledShader> shaders{32_MB};
+	// Textures decoded to RGBA8, keyed by a hash of their data, format and size
+	ConcurrentCache<u64, std::vector<u32>> textures{256_MB};
+	// RomFS/ExeFS data of encrypted titles, in blocks of decryptedBlockSize bytes
+	ConcurrentCache<DecryptedBlockKey, std::vector<u8>, DecryptedBlockKey::Hasher> decryptedBlocks{64_MB};
+};
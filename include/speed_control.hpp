@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+
+#include "helpers.hpp"
+
+// Decides how fast the emulator runs compared to a real 3DS, and which frames get drawn on the host.
+// At 1x speed, emulation is paced by vsync and the audio device like always. At any other speed the frontends turn vsync off, audio is muted,
+// and endFrame sleeps to hit the target frame rate instead. Unlimited speed doesn't sleep at all.
+// Render-skip drops the host draw and present work for some frames. The GPU still emulates everything the guest can observe during those
+// frames, only the host-side rendering is skipped.
+class SpeedControl {
+	using Clock = std::chrono::steady_clock;
+
+	float speed = 1.0f;
+	u32 skippedFrames = 0;  // Frames out of every skipPeriod frames that aren't rendered
+	u32 skipPeriod = 1;
+	u32 frameIndex = 0;  // Index of the current frame in the skip period
+	bool renderingFrame = true;
+
+	bool pacing = false;
+	Clock::time_point nextFrameTime;
+
+  public:
+	static constexpr float unlimited = 0.0f;
+	static constexpr double framesPerSecond = 60.0;
+
+	// Set the target speed as a multiple of the 3DS' speed, or unlimited
+	void setSpeed(float multiplier);
+	// Skip host rendering for the first "skipped" frames of every "period" frames. (0, 1) renders every frame
+	void setRenderSkip(u32 skipped, u32 period);
+
+	float getSpeed() const { return speed; }
+	bool isUnlimited() const { return speed == unlimited; }
+	// Whether emulation is paced by the frontend and audio, as opposed to by us
+	bool isRealTime() const { return speed == 1.0f; }
+	u32 getSkippedFrames() const { return skippedFrames; }
+	u32 getSkipPeriod() const { return skipPeriod; }
+
+	// Called before emulating a frame. Returns whether the frame should be rendered on the host
+	bool beginFrame();
+	// Called after emulating a frame. Waits until it's time for the next frame when running at a speed other than 1x
+	void endFrame();
+	bool isRenderingFrame() const { return renderingFrame; }
+};
@@ -49,6 +49,7 @@ void EmulatorConfig::load() {
 			printAppVersion = toml::find_or<toml::boolean>(general, "PrintAppVersion", true);
 			circlePadProEnabled = toml::find_or<toml::boolean>(general, "EnableCirclePadPro", true);
 			fastmemEnabled = toml::find_or<toml::boolean>(general, "EnableFastmem", enableFastmemDefault);
+			bootCacheEnabled = toml::find_or<toml::boolean>(general, "EnableBootCache", true);
 			systemLanguage = languageCodeFromString(toml::find_or<std::string>(general, "SystemLanguage", "en"));
 		}
 	}
@@ -93,6 +94,8 @@ void EmulatorConfig::load() {
 			forceShadergenForLights = toml::find_or<toml::boolean>(gpu, "ForceShadergenForLighting", true);
 			lightShadergenThreshold = toml::find_or<toml::integer>(gpu, "ShadergenLightThreshold", 1);
 			hashTextures = toml::find_or<toml::boolean>(gpu, "HashTextures", hashTexturesDefault);
+			geometryCacheEnabled = toml::find_or<toml::boolean>(gpu, "EnableGeometryCache", true);
+			drawBatchingEnabled = toml::find_or<toml::boolean>(gpu, "EnableDrawBatching", true);
 			enableRenderdoc = toml::find_or<toml::boolean>(gpu, "EnableRenderdoc", false);
 
 			auto screenLayoutName = toml::find_or<std::string>(gpu, "ScreenLayout", "Default");
@@ -112,6 +115,8 @@ void EmulatorConfig::load() {
 			audioEnabled = toml::find_or<toml::boolean>(audio, "EnableAudio", audioEnabledDefault);
 			aacEnabled = toml::find_or<toml::boolean>(audio, "EnableAACAudio", true);
 			printDSPFirmware = toml::find_or<toml::boolean>(audio, "PrintDSPFirmware", false);
+			lleDSPThreadEnabled = toml::find_or<toml::boolean>(audio, "LLEDSPThread", false);
+			lleDSPMaxLag = u32(toml::find_or<toml::integer>(audio, "LLEDSPMaxLag", toml::integer(Audio::lleSlice * 8)));
 
 			audioDeviceConfig.muteAudio = toml::find_or<toml::boolean>(audio, "MuteAudio", false);
 			// Our volume ranges from 0.0 (muted) to 2.0 (boosted, using a logarithmic scale). 1.0 is the "default" volume, ie we don't adjust the PCM
@@ -121,6 +126,17 @@ void EmulatorConfig::load() {
 		}
 	}
 
+	if (data.contains("Turbo")) {
+		auto turboResult = toml::expect<toml::value>(data.at("Turbo"));
+		if (turboResult.is_ok()) {
+			auto turbo = turboResult.unwrap();
+
+			turboSpeed = float(std::max(toml::find_or<toml::floating>(turbo, "Speed", 0.0), 0.0));
+			turboSkipPeriod = std::max<int>(toml::find_or<toml::integer>(turbo, "RenderSkipPeriod", 4), 1);
+			turboSkippedFrames = std::clamp<int>(toml::find_or<toml::integer>(turbo, "RenderSkipFrames", 3), 0, turboSkipPeriod - 1);
+		}
+	}
+
 	if (data.contains("Battery")) {
 		auto batteryResult = toml::expect<toml::value>(data.at("Battery"));
 		if (batteryResult.is_ok()) {
@@ -182,6 +198,7 @@ void EmulatorConfig::save() {
 	data["General"]["SystemLanguage"] = languageCodeToString(systemLanguage);
 	data["General"]["EnableCirclePadPro"] = circlePadProEnabled;
 	data["General"]["EnableFastmem"] = fastmemEnabled;
+	data["General"]["EnableBootCache"] = bootCacheEnabled;
 
 	data["Window"]["AppVersionOnWindow"] = windowSettings.showAppVersion;
 	data["Window"]["RememberWindowPosition"] = windowSettings.rememberPosition;
@@ -200,6 +217,8 @@ void EmulatorConfig::save() {
 	data["GPU"]["AccelerateShaders"] = accelerateShaders;
 	data["GPU"]["EnableRenderdoc"] = enableRenderdoc;
 	data["GPU"]["HashTextures"] = hashTextures;
+	data["GPU"]["EnableGeometryCache"] = geometryCacheEnabled;
+	data["GPU"]["EnableDrawBatching"] = drawBatchingEnabled;
 	data["GPU"]["ScreenLayout"] = std::string(ScreenLayout::layoutToString(screenLayout));
 	data["GPU"]["TopScreenSize"] = double(topScreenSize);
 
@@ -210,6 +229,12 @@ void EmulatorConfig::save() {
 	data["Audio"]["AudioVolume"] = double(audioDeviceConfig.volumeRaw);
 	data["Audio"]["VolumeCurve"] = std::string(AudioDeviceConfig::volumeCurveToString(audioDeviceConfig.volumeCurve));
 	data["Audio"]["PrintDSPFirmware"] = printDSPFirmware;
+	data["Audio"]["LLEDSPThread"] = lleDSPThreadEnabled;
+	data["Audio"]["LLEDSPMaxLag"] = lleDSPMaxLag;
+
+	data["Turbo"]["Speed"] = double(turboSpeed);
+	data["Turbo"]["RenderSkipFrames"] = turboSkippedFrames;
+	data["Turbo"]["RenderSkipPeriod"] = turboSkipPeriod;
 
 	data["Battery"]["ChargerPlugged"] = chargerPlugged;
 	data["Battery"]["BatteryPercentage"] = batteryPercentage;
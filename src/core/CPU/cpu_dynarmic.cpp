@@ -20,9 +20,21 @@ CPU::CPU(Memory& mem, Kernel& kernel, Emulator& emu) : mem(mem), emu(emu), sched
 		config.fastmem_pointer = u64(mem.getFastmemArenaBase());
 	} else {
 		config.fastmem_pointer = std::nullopt;
+
+		// Without fastmem, let the JIT translate addresses itself using our page table, rather than calling the memory callbacks for every access.
+		// Pages missing from the table (unmapped or read-only) still go through the callbacks, as the table is used for writes as well
+		config.page_table = mem.getCPUPageTable();
+		config.absolute_offset_page_table = false;
+		// Accesses that straddle 2 pages can't use the table directly, as the pages are not necessarily contiguous in host memory
+		config.detect_misaligned_access_via_page_table = 16 | 32 | 64;
+		config.only_detect_misalignment_via_page_table_on_page_boundary = true;
 	}
 
 	jit = std::make_unique<Dynarmic::A32::Jit>(config);
+
+	// Loads folded from read-only code can live in any block, not only in blocks whose code is in the changed range, and InvalidateCacheRange
+	// only looks at the latter. Code stops being read-only very rarely (eg a game reprotecting it through svcControlMemory), so clear it all
+	mem.setCodeChangeCallback([this](u32 vaddr, u32 size) { clearCache(); });
 }
 
 void CPU::reset() {
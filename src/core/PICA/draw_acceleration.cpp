@@ -34,8 +34,10 @@ void GPU::getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed) {
 		}
 
 		accel.indexBuffer = indexBuffer;
+		accel.indexBufferAddress = indexBufferPointer;
 	} else {
 		accel.indexBuffer = nullptr;
+		accel.indexBufferAddress = 0;
 		accel.minimumIndex = regs[PICA::InternalRegs::VertexOffsetReg];
 		accel.maximumIndex = accel.minimumIndex + vertexCount - 1;
 	}
@@ -44,7 +46,6 @@ void GPU::getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed) {
 	const u64 inputAttrCfg = getVertexShaderInputConfig();
 
 	u32 attrCount = 0;
-	u32 loaderOffset = 0;
 	accel.vertexDataSize = 0;
 	accel.totalLoaderCount = 0;
 
@@ -56,7 +57,8 @@ void GPU::getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed) {
 			continue;
 		}
 
-		auto& loader = accel.loaders[accel.totalLoaderCount++];
+		const u32 loaderIndex = accel.totalLoaderCount++;
+		auto& loader = accel.loaders[loaderIndex];
 
 		// The size of the loader in bytes is equal to the bytes supplied for 1 vertex, multiplied by the number of vertices we'll be uploading
 		// Which is equal to maximumIndex - minimumIndex + 1
@@ -69,6 +71,7 @@ void GPU::getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed) {
 		// Get a pointer to the data where this loader's data is stored
 		const u32 loaderAddress = vertexBase + loaderData.offset + (accel.minimumIndex * loaderData.size);
 		loader.data = getPointerPhys<u8>(loaderAddress);
+		loader.address = loaderAddress;
 
 		u64 attrCfg = loaderData.getConfigFull();  // Get config1 | (config2 << 32)
 		u32 attributeOffset = 0;
@@ -101,13 +104,12 @@ void GPU::getAcceleratedDrawInfo(PICA::DrawAcceleration& accel, bool indexed) {
 
 			auto& attr = accel.attributeInfo[inputReg];
 			attr.componentCount = size;
-			attr.offset = attributeOffset + loaderOffset;
+			attr.offset = attributeOffset;
 			attr.stride = loaderData.size;
 			attr.type = attribType;
+			attr.loaderIndex = u8(loaderIndex);
 			attributeOffset += size << sizeShiftPerComponent[attribType];
 		}
-
-		loaderOffset += loader.size;
 	}
 
 	u32 fixedAttributes = fixedAttribMask;
@@ -0,0 +1,330 @@
+#include "PICA/dynapica/shader_ir.hpp"
+
+#include <vector>
+
+using namespace Helpers;
+
+namespace {
+	// Convert a PICA write mask (x = bit 3) to a lane mask (x = bit 0) and vice versa
+	constexpr u32 reverseLanes(u32 mask) {
+		return ((mask >> 3) & 0b1) | ((mask >> 1) & 0b10) | ((mask << 1) & 0b100) | ((mask << 3) & 0b1000);
+	}
+
+	// Which lane of the source register ends up in lane "lane" of the swizzled value
+	constexpr u32 getSwizzleSelector(u32 swizzle, u32 lane) { return (swizzle >> (2 * (3 - lane))) & 3; }
+
+	// Registers tracked by the liveness pass, in the PICA destination encoding: 16 outputs followed by 16 temporaries
+	constexpr u32 trackedRegisterCount = 0x20;
+}  // namespace
+
+bool ShaderIR::isControlFlow(u32 opcode) {
+	switch (opcode) {
+		case ShaderOpcodes::BREAK:
+		case ShaderOpcodes::BREAKC:
+		case ShaderOpcodes::END:
+		case ShaderOpcodes::CALL:
+		case ShaderOpcodes::CALLC:
+		case ShaderOpcodes::CALLU:
+		case ShaderOpcodes::IFU:
+		case ShaderOpcodes::IFC:
+		case ShaderOpcodes::LOOP:
+		case ShaderOpcodes::EMIT:
+		case ShaderOpcodes::SETEMIT:
+		case ShaderOpcodes::JMPC:
+		case ShaderOpcodes::JMPU: return true;
+
+		default: return false;
+	}
+}
+
+bool ShaderIR::writesRegister(u32 opcode) {
+	if (opcode >= 0x30) {  // MAD/MADI
+		return true;
+	}
+
+	switch (opcode) {
+		case ShaderOpcodes::ADD:
+		case ShaderOpcodes::DP3:
+		case ShaderOpcodes::DP4:
+		case ShaderOpcodes::DPH:
+		case ShaderOpcodes::DPHI:
+		case ShaderOpcodes::EX2:
+		case ShaderOpcodes::LG2:
+		case ShaderOpcodes::MUL:
+		case ShaderOpcodes::SGE:
+		case ShaderOpcodes::SGEI:
+		case ShaderOpcodes::SLT:
+		case ShaderOpcodes::SLTI:
+		case ShaderOpcodes::FLR:
+		case ShaderOpcodes::MAX:
+		case ShaderOpcodes::MIN:
+		case ShaderOpcodes::RCP:
+		case ShaderOpcodes::RSQ:
+		case ShaderOpcodes::MOV: return true;
+
+		default: return false;
+	}
+}
+
+void ShaderIR::build(const PICAShader& shader, u32 entrypoint, u16 liveOutputs) {
+	decode(shader);
+	findReachable(shader, entrypoint);
+	eliminateDeadCode(liveOutputs);
+	foldSources();
+}
+
+void ShaderIR::decode(const PICAShader& shader) {
+	for (u32 pc = 0; pc < PICAShader::maxInstructionCount; pc++) {
+		const u32 instruction = shader.loadedShader[pc];
+		Instruction& ir = instructions[pc];
+		ir = Instruction();
+		ir.opcode = instruction >> 26;
+
+		// MAD and MADI have their own encoding, with a 5-bit operand descriptor index
+		if (ir.opcode >= 0x30) {
+			const bool isMADI = getBit<29>(instruction) == 0;
+			const u32 operandDescriptor = shader.operandDescriptors[instruction & 0x1f];
+			const u32 idx = getBits<22, 2>(instruction);
+
+			ir.dest = getBits<24, 5>(instruction);
+			ir.writeMask = operandDescriptor & 0xf;
+			ir.sourceCount = 3;
+			ir.sources[0].reg = getBits<17, 5>(instruction);
+			ir.sources[1].reg = isMADI ? getBits<12, 5>(instruction) : getBits<10, 7>(instruction);
+			ir.sources[1].index = isMADI ? 0 : idx;
+			ir.sources[2].reg = isMADI ? getBits<5, 7>(instruction) : getBits<5, 5>(instruction);
+			ir.sources[2].index = isMADI ? idx : 0;
+
+			ir.sources[0].negate = getBit<4>(operandDescriptor) != 0;
+			ir.sources[0].swizzle = getBits<5, 8>(operandDescriptor);
+			ir.sources[1].negate = getBit<13>(operandDescriptor) != 0;
+			ir.sources[1].swizzle = getBits<14, 8>(operandDescriptor);
+			ir.sources[2].negate = getBit<22>(operandDescriptor) != 0;
+			ir.sources[2].swizzle = getBits<23, 8>(operandDescriptor);
+			continue;
+		}
+
+		const bool isCMP = ir.opcode == ShaderOpcodes::CMP1 || ir.opcode == ShaderOpcodes::CMP2;
+		const bool isInverted = ir.opcode == ShaderOpcodes::DPHI || ir.opcode == ShaderOpcodes::SGEI || ir.opcode == ShaderOpcodes::SLTI;
+		const bool isUnary = ir.opcode == ShaderOpcodes::MOV || ir.opcode == ShaderOpcodes::MOVA || ir.opcode == ShaderOpcodes::FLR ||
+							 ir.opcode == ShaderOpcodes::RCP || ir.opcode == ShaderOpcodes::RSQ || ir.opcode == ShaderOpcodes::EX2 ||
+							 ir.opcode == ShaderOpcodes::LG2 || ir.opcode == ShaderOpcodes::LITP;
+
+		if (!writesRegister(ir.opcode) && !isCMP && ir.opcode != ShaderOpcodes::MOVA && ir.opcode != ShaderOpcodes::LITP) {
+			continue;
+		}
+
+		const u32 operandDescriptor = shader.operandDescriptors[instruction & 0x7f];
+		const u32 idx = getBits<19, 2>(instruction);
+
+		ir.dest = isCMP ? 0 : getBits<21, 5>(instruction);
+		ir.writeMask = isCMP ? 0 : (operandDescriptor & 0xf);
+		ir.sourceCount = isUnary ? 1 : 2;
+		ir.sources[0].reg = isInverted ? getBits<14, 5>(instruction) : getBits<12, 7>(instruction);
+		ir.sources[0].index = isInverted ? 0 : idx;
+		ir.sources[1].reg = isInverted ? getBits<7, 7>(instruction) : getBits<7, 5>(instruction);
+		ir.sources[1].index = isInverted ? idx : 0;
+
+		ir.sources[0].negate = getBit<4>(operandDescriptor) != 0;
+		ir.sources[0].swizzle = getBits<5, 8>(operandDescriptor);
+		ir.sources[1].negate = getBit<13>(operandDescriptor) != 0;
+		ir.sources[1].swizzle = getBits<14, 8>(operandDescriptor);
+	}
+}
+
+void ShaderIR::findReachable(const PICAShader& shader, u32 entrypoint) {
+	std::vector<u32> worklist = {entrypoint};
+	reachableCount = 0;
+
+	auto markBlockStart = [this](u32 pc) {
+		if (pc < PICAShader::maxInstructionCount) {
+			instructions[pc].blockStart = true;
+		}
+	};
+
+	markBlockStart(entrypoint);
+	while (!worklist.empty()) {
+		const u32 pc = worklist.back();
+		worklist.pop_back();
+
+		if (pc >= PICAShader::maxInstructionCount || instructions[pc].reachable) {
+			continue;
+		}
+
+		instructions[pc].reachable = true;
+		reachableCount++;
+
+		const u32 instruction = shader.loadedShader[pc];
+		const u32 opcode = instruction >> 26;
+		const u32 num = instruction & 0xff;
+		const u32 dest = getBits<10, 12>(instruction);
+
+		// Control flow instructions end the current block, and their targets start new ones
+		if (isControlFlow(opcode)) {
+			markBlockStart(pc + 1);
+		}
+
+		switch (opcode) {
+			case ShaderOpcodes::END: break;
+
+			case ShaderOpcodes::JMPC:
+			case ShaderOpcodes::JMPU:
+				markBlockStart(dest);
+				worklist.push_back(dest);
+				worklist.push_back(pc + 1);
+				break;
+
+			case ShaderOpcodes::IFC:
+			case ShaderOpcodes::IFU:
+				markBlockStart(dest);
+				markBlockStart(dest + num);
+				worklist.push_back(pc + 1);
+				worklist.push_back(dest);
+				worklist.push_back(dest + num);
+				break;
+
+			// The instruction after the called function is a return PC, which can be reached by returning from the function
+			case ShaderOpcodes::CALL:
+			case ShaderOpcodes::CALLC:
+			case ShaderOpcodes::CALLU:
+				markBlockStart(dest);
+				markBlockStart(dest + num);
+				worklist.push_back(dest);
+				worklist.push_back(dest + num);
+				worklist.push_back(pc + 1);
+				break;
+
+			case ShaderOpcodes::LOOP:
+				markBlockStart(dest + 1);
+				worklist.push_back(pc + 1);
+				worklist.push_back(dest + 1);
+				break;
+
+			default: worklist.push_back(pc + 1); break;
+		}
+	}
+}
+
+u32 ShaderIR::getConsumedLanes(const Instruction& instruction, u32 sourceIndex) {
+	const u32 written = reverseLanes(instruction.writeMask);
+	const u32 opcode = instruction.opcode;
+
+	if (opcode >= 0x30) {
+		return written;
+	}
+
+	switch (opcode) {
+		// DP3 still reads the w lane when using safe multiplication, which multiplies it by 0 instead of skipping it
+		case ShaderOpcodes::DP3:
+		case ShaderOpcodes::DP4: return written != 0 ? 0b1111 : 0;
+
+		// The w lane of the first source is replaced with 1.0
+		case ShaderOpcodes::DPH:
+		case ShaderOpcodes::DPHI: return written == 0 ? 0 : (sourceIndex == 0 ? 0b0111 : 0b1111);
+
+		// These only operate on the x lane and broadcast the result
+		case ShaderOpcodes::RCP:
+		case ShaderOpcodes::RSQ:
+		case ShaderOpcodes::EX2:
+		case ShaderOpcodes::LG2: return written != 0 ? 0b0001 : 0;
+
+		case ShaderOpcodes::CMP1:
+		case ShaderOpcodes::CMP2: return 0b0011;
+		// MOVA writes the x and y lanes of the address register, using the same bits of the write mask
+		case ShaderOpcodes::MOVA: return written & 0b0011;
+		case ShaderOpcodes::LITP: return 0b1011;
+
+		default: return written;
+	}
+}
+
+void ShaderIR::eliminateDeadCode(u16 liveOutputs) {
+	// Lane masks (x = bit 0) of the tracked registers whose current value may still be read
+	std::array<u32, trackedRegisterCount> live;
+	auto resetLiveness = [&]() {
+		for (u32 i = 0; i < 0x10; i++) {
+			live[i] = (liveOutputs & (1u << i)) ? 0xF : 0;
+		}
+
+		// We only analyze within blocks, so all temporaries are live at the end of one
+		for (u32 i = 0x10; i < trackedRegisterCount; i++) {
+			live[i] = 0xF;
+		}
+	};
+
+	deadCount = 0;
+	resetLiveness();
+
+	// Walk the code backwards. Execution can only leave a block at a control flow instruction, and only enter at its start
+	for (s32 pc = PICAShader::maxInstructionCount - 1; pc >= 0; pc--) {
+		Instruction& ir = instructions[pc];
+		const bool blockEnd = (u32(pc) == PICAShader::maxInstructionCount - 1) || instructions[pc + 1].blockStart || isControlFlow(ir.opcode);
+
+		if (blockEnd) {
+			resetLiveness();
+		}
+
+		if (!ir.reachable) {
+			continue;
+		}
+
+		if (writesRegister(ir.opcode)) {
+			const u32 written = reverseLanes(ir.writeMask);
+			if (ir.dest >= trackedRegisterCount || (live[ir.dest] & written) == 0) {
+				ir.dead = true;
+				deadCount++;
+				continue;
+			}
+
+			live[ir.dest] &= ~written;
+		}
+
+		for (u32 i = 0; i < ir.sourceCount; i++) {
+			const Source& source = ir.sources[i];
+
+			// Relative addressing can read any register, so everything it could reach is live
+			if (source.index != 0) {
+				for (u32 reg = 0x10; reg < trackedRegisterCount; reg++) {
+					live[reg] = 0xF;
+				}
+			} else if (source.reg >= 0x10 && source.reg < 0x20) {
+				const u32 consumed = getConsumedLanes(ir, i);
+				for (u32 lane = 0; lane < 4; lane++) {
+					if (consumed & (1u << lane)) {
+						live[source.reg] |= 1u << getSwizzleSelector(source.swizzle, lane);
+					}
+				}
+			}
+		}
+	}
+}
+
+void ShaderIR::foldSources() {
+	for (Instruction& ir : instructions) {
+		if (!ir.reachable || ir.dead) {
+			continue;
+		}
+
+		// Lanes that are never consumed can take any value, so pick the identity selector for them.
+		// If that leaves an .xyzw swizzle then the emitter can skip the shuffle altogether
+		for (u32 i = 0; i < ir.sourceCount; i++) {
+			Source& source = ir.sources[i];
+			const u32 consumed = getConsumedLanes(ir, i);
+
+			for (u32 lane = 0; lane < 4; lane++) {
+				if ((consumed & (1u << lane)) == 0) {
+					const u32 shift = 2 * (3 - lane);
+					source.swizzle = (source.swizzle & ~(3u << shift)) | (lane << shift);
+				}
+			}
+		}
+
+		// Negating both factors of a product doesn't change it. This doesn't hold for DPH, where the w lane of src1 is not negated
+		const bool isProduct =
+			ir.opcode == ShaderOpcodes::MUL || ir.opcode == ShaderOpcodes::DP3 || ir.opcode == ShaderOpcodes::DP4 || ir.opcode >= 0x30;
+		if (isProduct && ir.sources[0].negate && ir.sources[1].negate) {
+			ir.sources[0].negate = false;
+			ir.sources[1].negate = false;
+		}
+	}
+}
@@ -3,30 +3,57 @@
 
 #ifdef PANDA3DS_SHADER_JIT_SUPPORTED
 void ShaderJIT::reset() {
-	cache.clear();
+	activeShader = nullptr;
+	privateCache.clear();
 }
 
-void ShaderJIT::prepare(PICAShader& shaderUnit) {
+std::shared_ptr<CompiledShader> ShaderJIT::compile(PICAShader& shaderUnit, u16 liveOutputs) {
+#ifdef PANDA3DS_X64_HOST
+	if (!emitter) {
+		emitter = std::make_unique<ShaderEmitter>();
+	}
+
+	return emitter->compile(shaderUnit, liveOutputs, accurateMul);
+#else
+	auto shaderEmitter = std::make_unique<ShaderEmitter>(accurateMul);
+	shaderEmitter->compile(shaderUnit);
+	return std::make_shared<CompiledShader>(std::move(shaderEmitter));
+#endif
+}
+
+void ShaderJIT::prepare(PICAShader& shaderUnit, u16 liveOutputs) {
 	shaderUnit.pc = shaderUnit.entrypoint;
 	// We combine the code and operand descriptor hashes into a single hash
 	// This is so that if only one of them changes, we still properly recompile the shader
 	// The combine does rotl(x, 1) ^ y for the merging instead of x ^ y because xor is commutative, hence creating possible collisions
 	// re: https://github.com/wheremyfoodat/Panda3DS/pull/15#discussion_r1229925372
 	Hash hash = std::rotl(shaderUnit.getCodeHash(), 1) ^ shaderUnit.getOpdescHash();
-	auto it = cache.find(hash);
-
-	if (it == cache.end()) { // Block has not been compiled yet
-		auto emitter = std::make_unique<ShaderEmitter>(accurateMul);
-		emitter->compile(shaderUnit);
-		// Get pointer to callbacks
-		entrypointCallback = emitter->getInstructionCallback(shaderUnit.entrypoint);
-		prologueCallback = emitter->getPrologueCallback();
-
-		cache.emplace_hint(it, hash, std::move(emitter));
-	} else { // Block has been compiled and found, use it
-		auto emitter = it->second.get();
-		entrypointCallback = emitter->getInstructionCallback(shaderUnit.entrypoint);
-		prologueCallback = emitter->getPrologueCallback();
+	// The shared cache may hold shaders compiled by instances with a different multiplication accuracy setting
+	hash = std::rotl(hash, 1) ^ Hash(accurateMul);
+#ifdef PANDA3DS_X64_HOST
+	// The x64 emitter only compiles the code reachable from the entrypoint, and skips computing outputs that are never read
+	hash = std::rotl(hash, 1) ^ (Hash(shaderUnit.entrypoint) | (Hash(liveOutputs) << 16));
+#endif
+
+	if (activeShader && hash == activeHash && shaderUnit.entrypoint == activeEntrypoint) {
+		return;
 	}
+
+	auto& cache = sharedCache ? *sharedCache : privateCache;
+	std::shared_ptr<CompiledShader> shader = cache.find(hash);
+
+	// Shader has not been compiled by any instance yet
+	if (!shader) {
+		shader = compile(shaderUnit, liveOutputs);
+		shader = cache.insert(hash, shader, shader->getSize());
+	}
+
+	// Get pointer to callbacks
+	entrypointCallback = shader->getInstructionCallback(shaderUnit.entrypoint);
+	prologueCallback = shader->getPrologueCallback();
+
+	activeShader = std::move(shader);
+	activeHash = hash;
+	activeEntrypoint = shaderUnit.entrypoint;
 }
 #endif // PANDA3DS_SHADER_JIT_SUPPORTED
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <bit>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <immintrin.h>
 #include <smmintrin.h>
 
@@ -38,7 +40,89 @@ static constexpr Reg64 statePointer = rdi;
 #error Unknown ABI for x86-64 shader JIT
 #endif
 
-void ShaderEmitter::compile(const PICAShader& shaderUnit) {
+ShaderCodeArena& ShaderCodeArena::get() {
+	static ShaderCodeArena arena;
+	return arena;
+}
+
+u8* ShaderCodeArena::allocate(usize size) {
+	size = (size + blockAlignment - 1) & ~(blockAlignment - 1);
+	std::scoped_lock lock(mutex);
+
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); it++) {
+		auto [offset, blockSize] = *it;
+		if (blockSize < size) {
+			continue;
+		}
+
+		freeBlocks.erase(it);
+		if (blockSize > size) {
+			freeBlocks[offset + size] = blockSize - size;
+		}
+
+		return const_cast<u8*>(memory.getCode()) + offset;
+	}
+
+	return nullptr;
+}
+
+void ShaderCodeArena::free(u8* pointer, usize size) {
+	size = (size + blockAlignment - 1) & ~(blockAlignment - 1);
+	usize offset = usize(pointer - memory.getCode());
+	std::scoped_lock lock(mutex);
+
+	// Merge the block with the free blocks right after and right before it, if any
+	if (auto next = freeBlocks.find(offset + size); next != freeBlocks.end()) {
+		size += next->second;
+		freeBlocks.erase(next);
+	}
+
+	if (auto next = freeBlocks.lower_bound(offset); next != freeBlocks.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			size += previous->second;
+			freeBlocks.erase(previous);
+		}
+	}
+
+	freeBlocks[offset] = size;
+}
+
+CompiledShader::CompiledShader(const u8* source, usize size, usize prologueOffset, usize entrypointOffset, u32 entrypointPC)
+	: size(size), entrypointPC(entrypointPC) {
+	code = ShaderCodeArena::get().allocate(size);
+
+	if (code == nullptr) {
+		Helpers::warn("[Shader JIT] Shared code arena is full, allocating separate memory for shader");
+		// Xbyak allocates page-aligned memory, so alignment of the code is preserved when copying it there as well
+		standaloneMemory = std::make_unique<Xbyak::CodeGenerator>(size);
+		code = const_cast<u8*>(standaloneMemory->getCode());
+	}
+
+	// The shader code only uses relative addressing internally, so it can be moved freely
+	std::memcpy(code, source, size);
+	prologue = reinterpret_cast<ShaderEmitter::PrologueCallback>(code + prologueOffset);
+	entrypoint = reinterpret_cast<ShaderEmitter::InstructionCallback>(code + entrypointOffset);
+}
+
+CompiledShader::~CompiledShader() {
+	if (!standaloneMemory) {
+		ShaderCodeArena::get().free(code, size);
+	}
+}
+
+std::shared_ptr<CompiledShader> ShaderEmitter::compile(const PICAShader& shaderUnit, u16 liveOutputs, bool useSafeMUL) {
+	// The emitter is reused between shaders, so start from an empty buffer and clean state
+	reset();
+	this->useSafeMUL = useSafeMUL;
+	codeHasExp2 = false;
+	codeHasLog2 = false;
+	cachedRegisters.fill(CachedRegister());
+	cacheUseCounter = 0;
+
+	ir.build(shaderUnit, shaderUnit.entrypoint, liveOutputs);
+
 	// Constants
 	align(16);
 	L(negateVector);
@@ -64,6 +148,14 @@ void ShaderEmitter::compile(const PICAShader& shaderUnit) {
 	// state pointer is volatile, no need to preserve it
 	mov(statePointer, arg1.cvt64());
 
+#if defined(PANDA3DS_MS_ABI)
+	// xmm6-xmm15 are callee-saved on Windows, and we use them to cache PICA registers. The extra 8 bytes make the save area 16-byte aligned
+	sub(rsp, msABISaveAreaSize);
+	for (int i = 0; i < int(cachedRegisters.size()); i++) {
+		movaps(xword[rsp + i * 16], Xmm(firstCacheRegister + i));
+	}
+#endif
+
 	// Push a return guard on the stack. This happens due to the way we handle the PICA callstack, by pushing the return PC to stack
 	// By pushing ffff'ffff, we make it impossible for a return check to erroneously pass
 	push(qword, 0xffffffff);
@@ -81,16 +173,27 @@ void ShaderEmitter::compile(const PICAShader& shaderUnit) {
 
 	align(16);
 	// Compile every instruction in the shader
-	// This sounds horrible but the PICA instruction memory is tiny, and most of the time it's padded wtih nops that compile to nothing
+	// Instructions that can't be reached from the entrypoint or whose results are unused compile to nothing
 	recompilerPC = 0;
 	loopLevel = 0;
 	compileUntil(shaderUnit, PICAShader::maxInstructionCount);
+
+	const u8* code = getCode();
+	const usize prologueOffset = usize(reinterpret_cast<const u8*>(prologueCb) - code);
+	const usize entrypointOffset = usize(instructionLabels[shaderUnit.entrypoint].getAddress() - code);
+
+	return std::make_shared<CompiledShader>(code, getSize(), prologueOffset, entrypointOffset, shaderUnit.entrypoint);
 }
 
 void ShaderEmitter::scanCode(const PICAShader& shaderUnit) {
 	returnPCs.clear();
 
 	for (u32 i = 0; i < PICAShader::maxInstructionCount; i++) {
+		const ShaderIR::Instruction& instr = ir.instructions[i];
+		if (!instr.reachable || instr.dead) {
+			continue;
+		}
+
 		const u32 instruction = shaderUnit.loadedShader[i];
 		const u32 opcode = instruction >> 26;
 
@@ -115,12 +218,27 @@ void ShaderEmitter::compileUntil(const PICAShader& shaderUnit, u32 end) {
 	while (recompilerPC < end) {
 		compileInstruction(shaderUnit);
 	}
+
+	// The end of an if/else or loop body is also the end of a block
+	flushRegisters(shaderUnit);
 }
 
 void ShaderEmitter::compileInstruction(const PICAShader& shaderUnit) {
+	currentInstruction = &ir.instructions[recompilerPC];
+
+	// Cached registers must be in memory whenever we enter or leave a block
+	if (currentInstruction->blockStart || ShaderIR::isControlFlow(currentInstruction->opcode)) {
+		flushRegisters(shaderUnit);
+	}
+
 	// Write current location to label for this instruction
 	L(instructionLabels[recompilerPC]);
 
+	if (!currentInstruction->reachable) {
+		recompilerPC++;
+		return;
+	}
+
 	// See if PC is a possible return PC and emit the proper code if so
 	if (std::binary_search(returnPCs.begin(), returnPCs.end(), recompilerPC)) {
 		constexpr uintptr_t stackOffsetForPC = 8;
@@ -134,6 +252,11 @@ void ShaderEmitter::compileInstruction(const PICAShader& shaderUnit) {
 		L(end);
 	}
 
+	if (currentInstruction->dead) {
+		recompilerPC++;
+		return;
+	}
+
 	// Fetch instruction and inc PC
 	const u32 instruction = shaderUnit.loadedShader[recompilerPC++];
 	const u32 opcode = instruction >> 26;
@@ -218,33 +341,65 @@ const ShaderEmitter::vec4f& ShaderEmitter::getSourceRef(const PICAShader& shader
 	}
 }
 
-const ShaderEmitter::vec4f& ShaderEmitter::getDestRef(const PICAShader& shader, u32 dest) {
-	if (dest < 0x10) {
-		return shader.outputs[dest];
-	} else if (dest < 0x20) {
-		return shader.tempRegisters[dest - 0x10];
-	}
-	Helpers::panic("[Shader JIT] Unimplemented dest: %X", dest);
+uintptr_t ShaderEmitter::getRegisterOffset(const PICAShader& shader, u32 id) {
+	const vec4f& ref = (id >= outputRegisterBase) ? shader.outputs[id - outputRegisterBase] : getSourceRef(shader, id);
+	return uintptr_t(&ref) - uintptr_t(&shader);
 }
 
-// See shader.hpp header for docs on how the swizzle and negate works
-template <int sourceIndex>
-void ShaderEmitter::loadRegister(Xmm dest, const PICAShader& shader, u32 src, u32 index, u32 operandDescriptor) {
-	u32 compSwizzle; // Component swizzle pattern for the register
-	bool negate;     // If true, negate all lanes of the register
+int ShaderEmitter::getCachedRegister(const PICAShader& shader, u32 id, bool loadValue) {
+	int slot = -1;
+	for (int i = 0; i < int(cachedRegisters.size()); i++) {
+		if (cachedRegisters[i].id == id) {
+			cachedRegisters[i].lastUse = ++cacheUseCounter;
+			return i;
+		}
 
-	if constexpr (sourceIndex == 1) { // SRC1
-		negate = (getBit<4>(operandDescriptor)) != 0;
-		compSwizzle = getBits<5, 8>(operandDescriptor);
+		// Prefer empty slots, otherwise evict the least recently used register
+		if (slot == -1 ||
+			(cachedRegisters[slot].id != invalidRegister &&
+			 (cachedRegisters[i].id == invalidRegister || cachedRegisters[i].lastUse < cachedRegisters[slot].lastUse))) {
+			slot = i;
+		}
 	}
-	else if constexpr (sourceIndex == 2) { // SRC2
-		negate = (getBit<13>(operandDescriptor)) != 0;
-		compSwizzle = getBits<14, 8>(operandDescriptor);
+
+	CachedRegister& reg = cachedRegisters[slot];
+	const Xmm hostReg = Xmm(firstCacheRegister + slot);
+	if (reg.id != invalidRegister && reg.dirty) {
+		movaps(xword[statePointer + getRegisterOffset(shader, reg.id)], hostReg);
 	}
-	else if constexpr (sourceIndex == 3) { // SRC3
-		negate = (getBit<22>(operandDescriptor)) != 0;
-		compSwizzle = getBits<23, 8>(operandDescriptor);
+
+	if (loadValue) {
+		movaps(hostReg, xword[statePointer + getRegisterOffset(shader, id)]);
+	}
+
+	reg.id = id;
+	reg.dirty = false;
+	reg.lastUse = ++cacheUseCounter;
+	return slot;
+}
+
+void ShaderEmitter::writeBackRegisters(const PICAShader& shader) {
+	for (int i = 0; i < int(cachedRegisters.size()); i++) {
+		CachedRegister& reg = cachedRegisters[i];
+
+		if (reg.id != invalidRegister && reg.dirty) {
+			movaps(xword[statePointer + getRegisterOffset(shader, reg.id)], Xmm(firstCacheRegister + i));
+			reg.dirty = false;
+		}
 	}
+}
+
+void ShaderEmitter::flushRegisters(const PICAShader& shader) {
+	writeBackRegisters(shader);
+	cachedRegisters.fill(CachedRegister());
+}
+
+// See shader.hpp header for docs on how the swizzle and negate works
+template <int sourceIndex>
+void ShaderEmitter::loadRegister(Xmm dest, const PICAShader& shader, u32 src, u32 index, u32 operandDescriptor) {
+	const ShaderIR::Source& source = currentInstruction->sources[sourceIndex - 1];
+	const u32 compSwizzle = source.swizzle;  // Component swizzle pattern for the register
+	const bool negate = source.negate;       // If true, negate all lanes of the register
 
 	// TODO: Do indexes get applied if src < 0x20?
 
@@ -253,13 +408,12 @@ void ShaderEmitter::loadRegister(Xmm dest, const PICAShader& shader, u32 src, u3
 
 	switch (index) {
 		case 0: [[likely]] { // Keep src as is, no need to offset it
-			const vec4f& srcRef = getSourceRef(shader, src);
-			const uintptr_t offset = uintptr_t(&srcRef) - uintptr_t(&shader); // Calculate offset of register from start of the state struct
-
+			// Registers that are written in this block are likely to be read again soon, so go through the register cache
+			const Xmm cached = Xmm(firstCacheRegister + getCachedRegister(shader, src, true));
 			if (compSwizzle == noSwizzle) // Avoid emitting swizzle if not necessary
-				movaps(dest, xword[statePointer + offset]);
+				movaps(dest, cached);
 			else // Swizzle is not trivial so we need to emit a shuffle instruction
-				pshufd(dest, xword[statePointer + offset], convertedSwizzle);
+				pshufd(dest, cached, convertedSwizzle);
 
 			// Negate the register if necessary
 			if (negate) {
@@ -290,6 +444,9 @@ void ShaderEmitter::loadRegister(Xmm dest, const PICAShader& shader, u32 src, u3
 			Helpers::panic("[ShaderJIT]: Unimplemented source index type %d", index);
 	}
 
+	// We can't know which register is read, so make sure the memory copies of cached registers are up to date
+	writeBackRegisters(shader);
+
 	// Swizzle and load register into dest, from [state pointer + rcx + offset] and apply the relevant swizzle
 	auto swizzleAndLoadReg = [this, &dest, &compSwizzle, &convertedSwizzle](size_t offset) {
 		if (compSwizzle == noSwizzle)  // Avoid emitting swizzle if not necessary
@@ -345,50 +502,44 @@ void ShaderEmitter::loadRegister(Xmm dest, const PICAShader& shader, u32 src, u3
 }
 
 void ShaderEmitter::storeRegister(Xmm source, const PICAShader& shader, u32 dest, u32 operandDescriptor) {
-	const vec4f& destRef = getDestRef(shader, dest);
-	const uintptr_t offset = uintptr_t(&destRef) - uintptr_t(&shader); // Calculate offset of register from start of the state struct
-
 	// Mask of which lanes to write
-	u32 writeMask = operandDescriptor & 0xf;
+	const u32 writeMask = operandDescriptor & 0xf;
+	if (writeMask == 0) {
+		return;
+	}
+
+	if (dest >= 0x20) {
+		Helpers::panic("[Shader JIT] Unimplemented dest: %X", dest);
+	}
+
+	// Temporaries have the same number in the source and destination encodings, outputs go after the float uniforms
+	const u32 id = (dest < 0x10) ? (outputRegisterBase + dest) : dest;
+
+	// Writes happen on the cached copy of the register, which gets written back at the end of the block
+	// If all lanes are overwritten, we don't even need to load the old value
+	const int slot = getCachedRegister(shader, id, writeMask != 0xf);
+	const Xmm destReg = Xmm(firstCacheRegister + slot);
+	cachedRegisters[slot].dirty = true;
+
 	if (writeMask == 0xf) { // No lanes are masked, just movaps
-		movaps(xword[statePointer + offset], source);
-	} else if (std::popcount(writeMask) == 1) { // Only 1 register needs to be written back. This can be done with a simple shift right + movss
-		int bit = std::countr_zero(writeMask); // Get which PICA register needs to be written to (0 = w, 1 = z, etc)
-		size_t index = 3 - bit;
-		const uintptr_t laneOffset = offset + index * sizeof(float);
-
-		if (index == 0) { // Bottom lane, no need to shift
-			movss(dword[statePointer + laneOffset], source);
-		} else { // Shift right by 32 * index, then write bottom lane
-			if (haveAVX) {
-				vpsrldq(scratch1, source, index * sizeof(float));
-			} else {
-				movaps(scratch1, source);
-				psrldq(scratch1, index * sizeof(float));
-			}
-			movss(dword[statePointer + laneOffset], scratch1);
-		}
+		movaps(destReg, source);
 	} else if (haveSSE4_1) {
 		// Bit reverse the write mask because that is what blendps expects
 		u32 adjustedMask = ((writeMask >> 3) & 0b1) | ((writeMask >> 1) & 0b10) | ((writeMask << 1) & 0b100) | ((writeMask << 3) & 0b1000);
-
-		// Blend current value of dest with source. We have to invert the bits of the mask, as we do blendps source, dest instead of dest, source
-		// Note: This destroys source
-		blendps(source, xword[statePointer + offset], adjustedMask ^ 0xF);
-		movaps(xword[statePointer + offset], source);     // Write back
+		blendps(destReg, source, adjustedMask);
 	} else {
 		// Blend algo referenced from Citra
 		const u8 selector = (((writeMask & 0b1000) ? 1 : 0) << 0) |
 			(((writeMask & 0b0100) ? 3 : 2) << 2) |
 			(((writeMask & 0b0010) ? 0 : 1) << 4) |
 			(((writeMask & 0b0001) ? 2 : 3) << 6);
-		
-		movaps(scratch3, xword[statePointer + offset]);
+
+		movaps(scratch3, destReg);
 		movaps(scratch2, source);
 		unpckhps(scratch2, scratch3); // Unpack X/Y components of source and destination
 		unpcklps(scratch3, source);   // Unpack Z/W components of source and destination
 		shufps(scratch3, scratch2, selector); // "merge-shuffle" dest and source using selecto
-		movaps(xword[statePointer + offset], scratch3); // Write back
+		movaps(destReg, scratch3);
 	}
 }
 
@@ -443,6 +594,13 @@ void ShaderEmitter::recEND(const PICAShader& shader, u32 instruction) {
 	// Undo anything the prologue did and return
 	// Deallocate the 8 bytes taken up for the return guard + the 8 bytes of rsp padding we inserted in the prologue
 	add(rsp, 16);
+
+#if defined(PANDA3DS_MS_ABI)
+	for (int i = 0; i < int(cachedRegisters.size()); i++) {
+		movaps(Xmm(firstCacheRegister + i), xword[rsp + i * 16]);
+	}
+	add(rsp, msABISaveAreaSize);
+#endif
 	ret();
 }
 
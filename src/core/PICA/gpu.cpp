@@ -29,9 +29,10 @@ using namespace Floats;
 
 // Note: For when we have multiple backends, the GL state manager can stay here and have the constructor for the Vulkan-or-whatever renderer ignore it
 // Thus, our GLStateManager being here does not negatively impact renderer-agnosticness
-GPU::GPU(Memory& mem, EmulatorConfig& config) : mem(mem), config(config) {
-	vram = new u8[vramSize];
-	mem.setVRAM(vram);  // Give the bus a pointer to our VRAM
+GPU::GPU(Memory& mem, EmulatorConfig& config, SharedCaches& sharedCaches)
+	: mem(mem), config(config), sharedCaches(sharedCaches), vertices(Renderer::vertexBufferSize) {
+	vram = mem.getVRAM();  // VRAM lives in the memory arena, so that the CPU can access it through the page tables & fastmem
+	shaderJIT.setSharedCache(&sharedCaches.shaders);
 
 	switch (config.rendererType) {
 		case RendererType::Null: {
@@ -71,6 +72,8 @@ GPU::GPU(Memory& mem, EmulatorConfig& config) : mem(mem), config(config) {
 	if (renderer != nullptr) {
 		renderer->setConfig(&config);
 	}
+
+	mem.setVRAMAccessCallback([this](u32 paddr, u32 size, bool write) { renderer->notifyVRAMAccess(paddr, size, write); });
 }
 
 void GPU::reset() {
@@ -85,6 +88,7 @@ void GPU::reset() {
 
 	fogLUT.fill(0);
 	fogLUTDirty = true;
+	dirtyState = PICA::DirtyState::All;
 
 	totalAttribCount = 0;
 	fixedAttribMask = 0;
@@ -129,20 +133,24 @@ void GPU::reset() {
 	renderer->reset();
 }
 
-static std::array<PICA::Vertex, Renderer::vertexBufferSize> vertices;
-
 // Call the correct version of drawArrays based on whether this is an indexed draw (first template parameter)
 // And whether we are going to use the shader JIT (second template parameter)
 void GPU::drawArrays(bool indexed) {
 	PICA::DrawAcceleration accel;
 
-	if (config.accelerateShaders) {
+	if (config.accelerateShaders && !skipDraws) {
 		// If we are potentially going to use hw shaders, gather necessary to do vertex fetch, index buffering, etc on the GPU
 		// This includes parsing which vertices to upload, getting pointers to the index buffer data & vertex data, and so on
 		getAcceleratedDrawInfo(accel, indexed);
 	}
 
-	const bool hwShaders = renderer->prepareForDraw(shaderUnit, &accel);
+	// Frames skipped by render-skip still prepare their draws and let the renderer track the surfaces they render to. Only vertex processing and
+	// the draw itself are left out, so games that read rendered images back see stale contents for those frames, but the right surfaces
+	const bool hwShaders = renderer->prepareForDraw(shaderUnit, skipDraws ? nullptr : &accel);
+	if (skipDraws) [[unlikely]] {
+		renderer->skipDraw();
+		return;
+	}
 
 	if (hwShaders) {
 		// Hardware shaders have their own accelerated code path for draws, so they skip everything here
@@ -174,7 +182,7 @@ void GPU::drawArrays(bool indexed) {
 template <bool indexed, ShaderExecMode mode>
 void GPU::drawArrays() {
 	if constexpr (mode == ShaderExecMode::JIT) {
-		shaderJIT.prepare(shaderUnit.vs);
+		shaderJIT.prepare(shaderUnit.vs, getLiveVsOutputs());
 	} else if constexpr (mode == ShaderExecMode::Hardware) {
 		// Hardware shaders have their own accelerated code path for draws, so they're not meant to take this path
 		Helpers::panic("GPU::DrawArrays: Hardware shaders shouldn't take this path!");
@@ -418,6 +426,9 @@ PICA::Vertex GPU::getImmediateModeVertex() {
 
 void GPU::fireDMA(u32 dest, u32 source, u32 size) {
 	log("[GPU] DMA of %08X bytes from %08X to %08X\n", size, source, dest);
+	// The DMA may overwrite textures used by draws that the renderer has batched up
+	renderer->flushDraws();
+
 	constexpr u32 vramStart = VirtualAddrs::VramStart;
 	constexpr u32 vramSize = VirtualAddrs::VramSize;
 
@@ -438,6 +449,9 @@ void GPU::fireDMA(u32 dest, u32 source, u32 size) {
 	}
 
 	if (cpuToVRAM) [[likely]] {
+		// Colour buffers the renderer holds for the destination are about to go stale
+		renderer->notifyVRAMAccess(dest - vramStart + PhysicalAddrs::VRAM, size, true);
+
 		// Valid, optimized FCRAM->VRAM DMA. TODO: Is VRAM->VRAM DMA allowed?
 		u8* fcram = mem.getFCRAM();
 		std::memcpy(&vram[dest - vramStart], &fcram[source - fcramStart], size);
@@ -86,7 +86,20 @@ void GPU::writeInternalReg(u32 index, u32 value, u32 mask) {
 
 	u32 currentValue = regs[index];
 	u32 newValue = (currentValue & ~mask) | (value & mask);  // Only overwrite the bits specified by "mask"
+
+	// The renderer may have queued up draws that depend on the current rasterizer state, so flush them before it changes.
+	// Registers past the geometry pipeline start only affect vertex processing, which has already happened for queued draws.
+	if (renderer->hasPendingDraws() && index < VertexAttribLoc) {
+		const bool writesLUT = (index >= FogLUTData0 && index <= FogLUTData7) || (index >= LightingLUTData0 && index <= LightingLUTData7);
+		if (newValue != currentValue || writesLUT) {
+			renderer->flushDraws();
+		}
+	}
+
 	regs[index] = newValue;
+	if (newValue != currentValue) {
+		dirtyState |= PICA::DirtyState::registerMap[index];
+	}
 
 	// TODO: Figure out if things like the shader index use the unmasked value or the masked one
 	// We currently use the unmasked value like Citra does
@@ -250,7 +263,11 @@ void GPU::writeInternalReg(u32 index, u32 value, u32 mask) {
 						// Handle rendering depending on the primitive type
 						if (immediateModeVertIndex == 3) {
 							renderer->prepareForDraw(shaderUnit, nullptr);
-							renderer->drawVertices(PICA::PrimType::TriangleList, immediateModeVertices);
+							if (!skipDraws) [[likely]] {
+								renderer->drawVertices(PICA::PrimType::TriangleList, immediateModeVertices);
+							} else {
+								renderer->skipDraw();
+							}
 
 							switch (primType) {
 								// Triangle or geometry primitive. Draw a triangle and discard all vertices
@@ -378,6 +395,75 @@ void GPU::writeInternalReg(u32 index, u32 value, u32 mask) {
 	}
 }
 
+bool GPU::writeDataPortBurst(u32 firstId, u32 lastId, std::span<const u32> words) {
+	using namespace PICA::InternalRegs;
+
+	auto inPort = [firstId, lastId](u32 portStart) { return firstId >= portStart && lastId <= portStart + 7; };
+	const bool writesFogLUT = inPort(FogLUTData0);
+	const bool writesLightingLUT = inPort(LightingLUTData0);
+
+	if (writesFogLUT || writesLightingLUT) {
+		// Batched draws use the current LUT contents
+		renderer->flushDraws();
+	}
+
+	if (inPort(VertexShaderData0)) {
+		shaderUnit.vs.uploadWords(words);
+	} else if (inPort(VertexShaderOpDescriptorData0)) {
+		shaderUnit.vs.uploadDescriptors(words);
+	} else if (inPort(VertexFloatUniformData0)) {
+		shaderUnit.vs.uploadFloatUniforms(words);
+	} else if (writesFogLUT) {
+		u32 index = regs[FogLUTIndex] & 0x7F;
+		for (u32 value : words) {
+			fogLUT[index] = value;
+			index = (index + 1) & 0x7F;
+		}
+
+		regs[FogLUTIndex] = index;
+		fogLUTDirty = true;
+	} else if (writesLightingLUT) {
+		const u32 indexReg = regs[LightingLUTIndex];
+		const u32 lutID = getBits<8, 5>(indexReg);
+		u32 lutIndex = getBits<0, 8>(indexReg);
+
+		if (lutID < PICA::Lights::LUT_Count) {
+			u32* lut = &lightingLUT[lutID * 256];
+			for (u32 value : words) {
+				lut[lutIndex] = value;
+				lutIndex = (lutIndex + 1) & 0xff;
+			}
+
+			lightingLUTDirty = true;
+		} else {
+			lutIndex = (lutIndex + u32(words.size())) & 0xff;
+		}
+
+		// Only the bottom 8 bits of the index register get incremented
+		regs[LightingLUTIndex] = (indexReg & ~0xff) | lutIndex;
+	} else {
+		return false;
+	}
+
+	// Update the port registers themselves, as if every word had been written through writeInternalReg
+	auto setPortReg = [this](u32 index, u32 value) {
+		if (regs[index] != value) {
+			regs[index] = value;
+			dirtyState |= PICA::DirtyState::registerMap[index];
+		}
+	};
+
+	if (firstId == lastId) {
+		setPortReg(firstId, words.back());
+	} else {
+		for (u32 i = 0; i < words.size(); i++) {
+			setPortReg(firstId + i, words[i]);
+		}
+	}
+
+	return true;
+}
+
 void GPU::startCommandList(u32 addr, u32 size) {
 	cmdBuffStart = static_cast<u32*>(mem.getReadPointer(addr));
 	if (!cmdBuffStart) Helpers::panic("Couldn't get buffer for command list");
@@ -421,10 +507,26 @@ void GPU::startCommandList(u32 addr, u32 size) {
 		u32 idIncrement = (consecutiveWritingMode) ? 1 : 0;
 
 		writeInternalReg(id, param1, mask);
+
+		// Games upload shaders, uniforms and LUTs as long runs of writes to the same data port. Hand those to the bulk upload handlers
+		// instead of going through writeInternalReg word by word
+		if (paramCount != 0 && mask == 0xffffffff) {
+			const u32 firstId = id + idIncrement;
+			const u32 lastId = id + idIncrement * paramCount;
+
+			if (writeDataPortBurst(firstId, lastId, std::span<const u32>(cmdBuffCurr, paramCount))) {
+				cmdBuffCurr += paramCount;
+				continue;
+			}
+		}
+
 		for (u32 i = 0; i < paramCount; i++) {
 			id += idIncrement;
 			u32 param = *cmdBuffCurr++;
 			writeInternalReg(id, param, mask);
 		}
 	}
+
+	// The CPU may modify memory the queued draws depend on (eg textures) before the next command list, so don't keep draws batched past it
+	renderer->flushDraws();
 }
@@ -258,18 +258,7 @@ void ShaderDecompiler::writeAttributes() {
 )";
 }
 
-std::string ShaderDecompiler::decompile() {
-	controlFlow.analyze(shader, entrypoint);
-
-	if (controlFlow.analysisFailed) {
-		return "";
-	}
-
-	compilationError = false;
-	decompiledShader.clear();
-	// Reserve some memory for the shader string to avoid memory allocations
-	decompiledShader.reserve(256 * 1024);
-
+void ShaderDecompiler::writeHeader() {
 	switch (api) {
 		case API::GL: decompiledShader += "#version 410 core\n"; break;
 		case API::GLES: decompiledShader += "#version 300 es\nprecision mediump float;\nprecision mediump int;\n"; break;
@@ -287,7 +276,40 @@ std::string ShaderDecompiler::decompile() {
 			}
 		)";
 	}
+}
+
+std::string ShaderDecompiler::decompile() {
+	controlFlow.analyze(shader, entrypoint);
 
+	compilationError = false;
+	decompiledShader.clear();
+	// Reserve some memory for the shader string to avoid memory allocations
+	decompiledShader.reserve(256 * 1024);
+
+	writeHeader();
+
+	// If the control flow can't be turned into structured GLSL, fall back to emulating the PICA's control flow with a dispatcher loop.
+	// This is slower on the GPU than the structured code, but still a lot faster than running the shader on the CPU
+	if (controlFlow.analysisFailed) {
+		strategy = DecompilerStrategy::Dispatcher;
+		writeDispatcherShader();
+	} else {
+		strategy = DecompilerStrategy::Structured;
+		writeStructuredShader();
+	}
+
+	// We allow some leeway for "compilation errors" in addition to control flow errors, in cases where eg an unimplemented instruction
+	// or an instruction that we can't emulate in GLSL is found in the instruction stream. These return an empty string
+	// and the renderer core will decide to use CPU shaders instead
+	if (compilationError) [[unlikely]] {
+		strategy = DecompilerStrategy::Failed;
+		return "";
+	}
+
+	return decompiledShader;
+}
+
+void ShaderDecompiler::writeStructuredShader() {
 	// Forward declare every generated function first so that we can easily call anything from anywhere.
 	for (auto& func : controlFlow.functions) {
 		decompiledShader += func.getForwardDecl();
@@ -344,15 +366,216 @@ std::string ShaderDecompiler::decompile() {
 			decompiledShader += "}\n";
 		}
 	}
+}
 
-	// We allow some leeway for "compilation errors" in addition to control flow errors, in cases where eg an unimplemented instruction
-	// or an instruction that we can't emulate in GLSL is found in the instruction stream. Just like control flow errors, these return an empty string
-	// and the renderer core will decide to use CPU shaders instead
-	if (compilationError) [[unlikely]] {
-		return "";
+ShaderDecompiler::DispatcherInfo ShaderDecompiler::analyzeDispatcher() const {
+	DispatcherInfo info;
+	std::vector<u32> worklist = {entrypoint};
+
+	// Find every instruction reachable from the entrypoint, without making any assumptions about the structure of the control flow
+	while (!worklist.empty()) {
+		const u32 pc = worklist.back();
+		worklist.pop_back();
+
+		if (pc >= PICAShader::maxInstructionCount || !info.reachable.insert(pc).second) {
+			continue;
+		}
+
+		const u32 instruction = shader.loadedShader[pc];
+		const u32 opcode = instruction >> 26;
+		const u32 num = instruction & 0xff;
+		const u32 dest = getBits<10, 12>(instruction);
+
+		switch (opcode) {
+			case ShaderOpcodes::END: break;
+
+			case ShaderOpcodes::JMPC:
+			case ShaderOpcodes::JMPU:
+				worklist.push_back(dest);
+				worklist.push_back(pc + 1);
+				break;
+
+			case ShaderOpcodes::IFC:
+			case ShaderOpcodes::IFU:
+				info.ifEnds.insert(dest);
+				worklist.push_back(pc + 1);
+				worklist.push_back(dest);
+				worklist.push_back(dest + num);
+				break;
+
+			case ShaderOpcodes::CALL:
+			case ShaderOpcodes::CALLC:
+			case ShaderOpcodes::CALLU:
+				info.callEnds.insert(dest + num);
+				worklist.push_back(dest);
+				worklist.push_back(pc + 1);
+				break;
+
+			case ShaderOpcodes::LOOP:
+				info.loopEnds.insert(dest + 1);
+				worklist.push_back(pc + 1);
+				worklist.push_back(dest + 1);
+				break;
+
+			default: worklist.push_back(pc + 1); break;
+		}
 	}
 
-	return decompiledShader;
+	return info;
+}
+
+void ShaderDecompiler::writeDispatcherShader() {
+	const DispatcherInfo info = analyzeDispatcher();
+
+	// The control flow stacks are kept in local arrays and mirror the ones of our shader interpreter, with the same depths
+	decompiledShader += "void pica_shader_main() {\n";
+	decompiledShader += fmt::format("uint pc = {}u;\n", entrypoint);
+
+	if (!info.loopEnds.empty()) {
+		decompiledShader += "uint loop_start[4]; uint loop_end[4]; uint loop_iterations[4]; int loop_increment[4]; int loop_index = 0;\n";
+	}
+
+	if (!info.ifEnds.empty()) {
+		decompiledShader += "uint if_end[8]; uint if_new_pc[8]; int if_index = 0;\n";
+	}
+
+	if (!info.callEnds.empty()) {
+		decompiledShader += "uint call_end[4]; uint call_return[4]; int call_index = 0;\n";
+	}
+
+	decompiledShader += fmt::format("for (uint steps = 0u; steps < {}u; steps++) {{\nswitch (pc) {{\n", dispatcherMaxSteps);
+
+	for (u32 pc : info.reachable) {
+		decompiledShader += fmt::format("case {}u: {{\n", pc);
+		compileDispatcherInstruction(pc, info);
+		decompiledShader += "}\n";
+	}
+
+	decompiledShader += "default: return;\n}\n";
+
+	// After leaving the switch, handle the end of loops, if blocks and calls, in the same order of priority as the PICA: LOOP > IF > CALL
+	if (!info.loopEnds.empty()) {
+		decompiledShader += R"(
+	if (loop_index > 0 && pc == loop_end[loop_index - 1]) {
+		addr_reg.z += loop_increment[loop_index - 1];
+		loop_iterations[loop_index - 1] -= 1u;
+
+		if (loop_iterations[loop_index - 1] == 0u) {
+			loop_index -= 1;
+		} else {
+			pc = loop_start[loop_index - 1];
+		}
+	}
+)";
+	}
+
+	if (!info.ifEnds.empty()) {
+		decompiledShader += R"(
+	if (if_index > 0 && pc == if_end[if_index - 1]) {
+		pc = if_new_pc[if_index - 1];
+		if_index -= 1;
+	}
+)";
+	}
+
+	if (!info.callEnds.empty()) {
+		decompiledShader += R"(
+	if (call_index > 0 && pc == call_end[call_index - 1]) {
+		pc = call_return[call_index - 1];
+		call_index -= 1;
+	}
+)";
+	}
+
+	decompiledShader += "}\n}\n";
+}
+
+void ShaderDecompiler::compileDispatcherInstruction(u32 pc, const DispatcherInfo& info) {
+	const u32 instruction = shader.loadedShader[pc];
+	const u32 opcode = instruction >> 26;
+	const u32 num = instruction & 0xff;
+	const u32 dest = getBits<10, 12>(instruction);
+
+	// Condition of conditional control flow instructions, based on either the condition register or a bool uniform
+	auto getConditionString = [&]() -> std::string {
+		if (opcode == ShaderOpcodes::IFC || opcode == ShaderOpcodes::CALLC || opcode == ShaderOpcodes::JMPC) {
+			const u32 condOp = getBits<22, 2>(instruction);
+			const uint refY = getBit<24>(instruction);
+			const uint refX = getBit<25>(instruction);
+			return getCondition(condOp, refX, refY);
+		}
+
+		const u32 mask = 1u << getBits<22, 4>(instruction);  // Bit of the bool uniform to check
+		if (opcode == ShaderOpcodes::JMPU) {
+			const u32 test = (instruction & 1) ^ 1;  // If the LSB is 0 we jump if bit = 1, otherwise 0
+			return fmt::format("(uniform_bool & {}u) {} 0u", mask, (test != 0) ? "!=" : "==");
+		}
+
+		return fmt::format("(uniform_bool & {}u) != 0u", mask);
+	};
+
+	switch (opcode) {
+		case ShaderOpcodes::END: decompiledShader += "return;\n"; return;
+
+		case ShaderOpcodes::JMPC:
+		case ShaderOpcodes::JMPU:
+			decompiledShader += fmt::format("pc = ({}) ? {}u : {}u;\nbreak;\n", getConditionString(), dest, pc + 1);
+			return;
+
+		case ShaderOpcodes::IFC:
+		case ShaderOpcodes::IFU:
+			decompiledShader += fmt::format(
+				"if ({}) {{\n"
+				"if (if_index < 8) {{ if_end[if_index] = {}u; if_new_pc[if_index] = {}u; if_index += 1; }}\n"
+				"pc = {}u;\n"
+				"}} else {{ pc = {}u; }}\nbreak;\n",
+				getConditionString(), dest, dest + num, pc + 1, dest
+			);
+			return;
+
+		case ShaderOpcodes::CALL:
+		case ShaderOpcodes::CALLC:
+		case ShaderOpcodes::CALLU: {
+			const std::string push = fmt::format(
+				"if (call_index < 4) {{ call_end[call_index] = {}u; call_return[call_index] = {}u; call_index += 1; }}\npc = {}u;\n", dest + num,
+				pc + 1, dest
+			);
+
+			if (opcode == ShaderOpcodes::CALL) {
+				decompiledShader += push + "break;\n";
+			} else {
+				decompiledShader += fmt::format("if ({}) {{\n{}}} else {{ pc = {}u; }}\nbreak;\n", getConditionString(), push, pc + 1);
+			}
+			return;
+		}
+
+		case ShaderOpcodes::LOOP: {
+			const u32 uniformIndex = getBits<22, 2>(instruction);
+
+			decompiledShader += fmt::format("addr_reg.z = int((uniform_i[{}] >> 8u) & 0xFFu);\n", uniformIndex);
+			decompiledShader += fmt::format(
+				"if (loop_index < 4) {{ loop_start[loop_index] = {}u; loop_end[loop_index] = {}u; loop_iterations[loop_index] = (uniform_i[{}] & "
+				"0xFFu) + 1u; loop_increment[loop_index] = int((uniform_i[{}] >> 16u) & 0xFFu); loop_index += 1; }}\n",
+				pc + 1, dest + 1, uniformIndex, uniformIndex
+			);
+			decompiledShader += fmt::format("pc = {}u;\nbreak;\n", pc + 1);
+			return;
+		}
+
+		default: break;
+	}
+
+	// Everything else is not a control flow instruction, so we can use the same code generation as the structured decompiler
+	u32 nextPC = pc;
+	bool finished = false;
+	compileInstruction(nextPC, finished);
+
+	// If the next instruction is not where a loop, if or call can end, we don't need to check the control flow stacks.
+	// In that case fall through directly to its case, which comes right after this one, so that straight-line code runs without dispatching
+	const bool isBlockEnd = info.loopEnds.contains(nextPC) || info.ifEnds.contains(nextPC) || info.callEnds.contains(nextPC);
+	if (isBlockEnd || !info.reachable.contains(nextPC)) {
+		decompiledShader += fmt::format("pc = {}u;\nbreak;\n", nextPC);
+	}
 }
 
 std::string ShaderDecompiler::getSource(u32 source, [[maybe_unused]] u32 index) const {
@@ -794,10 +1017,21 @@ void ShaderDecompiler::callFunction(const Function& function) {
 	}
 }
 
-std::string ShaderGen::decompileShader(PICAShader& shader, EmulatorConfig& config, u32 entrypoint, API api, Language language) {
+std::string ShaderGen::decompileShader(
+	PICAShader& shader, EmulatorConfig& config, u32 entrypoint, API api, Language language, DecompilerStats* stats
+) {
 	ShaderDecompiler decompiler(shader, config, entrypoint, api, language);
+	std::string source = decompiler.decompile();
+
+	if (stats != nullptr) {
+		switch (decompiler.getStrategy()) {
+			case DecompilerStrategy::Structured: stats->structured++; break;
+			case DecompilerStrategy::Dispatcher: stats->dispatcher++; break;
+			case DecompilerStrategy::Failed: stats->failed++; break;
+		}
+	}
 
-	return decompiler.decompile();
+	return source;
 }
 
 const char* ShaderDecompiler::getCondition(u32 cond, u32 refX, u32 refY) {
@@ -1,5 +1,6 @@
 #include "PICA/shader_unit.hpp"
 
+#include "PICA/pica_simd.hpp"
 #include "cityhash.hpp"
 
 void ShaderUnit::reset() {
@@ -35,4 +36,52 @@ void PICAShader::reset() {
 	codeHashDirty = true;
 	opdescHashDirty = true;
 	uniformsDirty = true;
-}
\ No newline at end of file
+}
+
+void PICAShader::uploadFloatUniforms(std::span<const u32> words) {
+	// Finish off any uniform that was partially uploaded before this burst through the slow path
+	while (!words.empty() && floatUniformWordCount != 0) {
+		uploadFloatUniform(words[0]);
+		words = words.subspan(1);
+	}
+
+	const usize wordsPerUniform = f32UniformTransfer ? 4 : 3;
+	const usize uniformCount = words.size() / wordsPerUniform;
+	// Uploads to non-existent uniforms (index >= 96) are dropped
+	const usize writtenCount = (floatUniformIndex < 96) ? std::min<usize>(uniformCount, 96 - floatUniformIndex) : 0;
+
+	if (writtenCount != 0) {
+		static_assert(sizeof(vec4f) == 4 * sizeof(u32), "Float uniform bulk upload assumes f24s are stored as 32-bit floats");
+		std::array<u32, 96 * 4> converted;
+		const u32* src = words.data();
+
+		// Uniform components are uploaded in reverse order (w, z, y, x)
+		if (f32UniformTransfer) {
+			for (usize i = 0; i < writtenCount; i++, src += 4) {
+				converted[i * 4 + 0] = src[3];
+				converted[i * 4 + 1] = src[2];
+				converted[i * 4 + 2] = src[1];
+				converted[i * 4 + 3] = src[0];
+			}
+		} else {
+			// f24 uniforms are packed into 3 words. Unpack them first, then convert them all to f32 in one go
+			for (usize i = 0; i < writtenCount; i++, src += 3) {
+				converted[i * 4 + 0] = src[2] & 0xffffff;
+				converted[i * 4 + 1] = ((src[1] & 0xffff) << 8) | (src[2] >> 24);
+				converted[i * 4 + 2] = ((src[0] & 0xff) << 16) | (src[1] >> 16);
+				converted[i * 4 + 3] = src[0] >> 8;
+			}
+
+			PICA::F24::toF32Bits(converted.data(), writtenCount * 4);
+		}
+
+		std::memcpy(&floatUniforms[floatUniformIndex], converted.data(), writtenCount * sizeof(vec4f));
+		floatUniformIndex += u32(writtenCount);
+		uniformsDirty = true;
+	}
+
+	// Buffer any leftover words of an incomplete uniform
+	for (usize i = uniformCount * wordsPerUniform; i < words.size(); i++) {
+		uploadFloatUniform(words[i]);
+	}
+}
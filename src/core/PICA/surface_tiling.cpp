@@ -0,0 +1,207 @@
+#include "PICA/surface_tiling.hpp"
+
+#include <array>
+#include <cstring>
+
+#include "PICA/pica_simd.hpp"
+#include "colour.hpp"
+
+using namespace PICA;
+
+namespace {
+	// In-tile offsets of a pixel depending on its x and y coordinates in the tile. The Z-order offset of a pixel is xOffsets[x] + yOffsets[y]
+	constexpr std::array<u32, 8> xOffsets = {0, 1, 4, 5, 16, 17, 20, 21};
+	constexpr std::array<u32, 8> yOffsets = {0, 2, 8, 10, 32, 34, 40, 42};
+
+	// Calls func(hostIndex, tiledIndex) for every row of 8 pixels inside a tile. hostIndex is the index of the leftmost pixel of the row in the host
+	// image, and tiledIndex is its index in the PICA colour buffer. The other pixels of the row are at tiledIndex + xOffsets[x]
+	template <typename Func>
+	void forEachTileRow(u32 width, u32 height, Func&& func) {
+		const u32 tilesPerRow = width / 8;
+		const u32 tiledHeight = height & ~7;
+
+		for (u32 y = 0; y < tiledHeight; y++) {
+			// The PICA colour buffer is stored top to bottom, while the host image is stored bottom to top
+			const u32 hostRowIndex = (height - 1 - y) * width;
+			const u32 tileRowIndex = (y / 8) * tilesPerRow * 64 + yOffsets[y & 7];
+
+			for (u32 tile = 0; tile < tilesPerRow; tile++) {
+				func(hostRowIndex + tile * 8, tileRowIndex + tile * 64);
+			}
+		}
+	}
+
+	void encodePixel(ColorFmt format, const u8* rgba, u8* out) {
+		const u8 r = rgba[0];
+		const u8 g = rgba[1];
+		const u8 b = rgba[2];
+		const u8 a = rgba[3];
+
+		switch (format) {
+			case ColorFmt::RGBA8:
+				out[0] = a;
+				out[1] = b;
+				out[2] = g;
+				out[3] = r;
+				break;
+
+			case ColorFmt::RGB8:
+				out[0] = b;
+				out[1] = g;
+				out[2] = r;
+				break;
+
+			case ColorFmt::RGBA5551: {
+				const u16 pixel = u16((r >> 3) << 11) | u16((g >> 3) << 6) | u16((b >> 3) << 1) | u16(a >> 7);
+				std::memcpy(out, &pixel, sizeof(pixel));
+				break;
+			}
+
+			case ColorFmt::RGB565: {
+				const u16 pixel = u16((r >> 3) << 11) | u16((g >> 2) << 5) | u16(b >> 3);
+				std::memcpy(out, &pixel, sizeof(pixel));
+				break;
+			}
+
+			case ColorFmt::RGBA4: {
+				const u16 pixel = u16((r >> 4) << 12) | u16((g >> 4) << 8) | u16((b >> 4) << 4) | u16(a >> 4);
+				std::memcpy(out, &pixel, sizeof(pixel));
+				break;
+			}
+		}
+	}
+
+	void decodePixel(ColorFmt format, const u8* in, u8* rgba) {
+		u16 pixel;
+
+		switch (format) {
+			case ColorFmt::RGBA8:
+				rgba[0] = in[3];
+				rgba[1] = in[2];
+				rgba[2] = in[1];
+				rgba[3] = in[0];
+				break;
+
+			case ColorFmt::RGB8:
+				rgba[0] = in[2];
+				rgba[1] = in[1];
+				rgba[2] = in[0];
+				rgba[3] = 0xff;
+				break;
+
+			case ColorFmt::RGBA5551:
+				std::memcpy(&pixel, in, sizeof(pixel));
+				rgba[0] = Colour::convert5To8Bit(Helpers::getBits<11, 5, u8>(pixel));
+				rgba[1] = Colour::convert5To8Bit(Helpers::getBits<6, 5, u8>(pixel));
+				rgba[2] = Colour::convert5To8Bit(Helpers::getBits<1, 5, u8>(pixel));
+				rgba[3] = Helpers::getBit<0>(pixel) ? 0xff : 0;
+				break;
+
+			case ColorFmt::RGB565:
+				std::memcpy(&pixel, in, sizeof(pixel));
+				rgba[0] = Colour::convert5To8Bit(Helpers::getBits<11, 5, u8>(pixel));
+				rgba[1] = Colour::convert6To8Bit(Helpers::getBits<5, 6, u8>(pixel));
+				rgba[2] = Colour::convert5To8Bit(Helpers::getBits<0, 5, u8>(pixel));
+				rgba[3] = 0xff;
+				break;
+
+			case ColorFmt::RGBA4:
+				std::memcpy(&pixel, in, sizeof(pixel));
+				rgba[0] = Colour::convert4To8Bit(Helpers::getBits<12, 4, u8>(pixel));
+				rgba[1] = Colour::convert4To8Bit(Helpers::getBits<8, 4, u8>(pixel));
+				rgba[2] = Colour::convert4To8Bit(Helpers::getBits<4, 4, u8>(pixel));
+				rgba[3] = Colour::convert4To8Bit(Helpers::getBits<0, 4, u8>(pixel));
+				break;
+		}
+	}
+
+	// RGBA8 is by far the most common colour buffer format, and converting it is just a byte swap of every pixel.
+	// Within a row of a tile, pixels come in adjacent pairs at in-tile offsets 0, 4, 16 and 20, so we can move 2 pixels per 64-bit load/store.
+#if defined(PICA_SIMD_X64)
+	// Byte swap every 32-bit lane. Only uses SSE2, so this is always available on x64
+	inline __m128i swapRGBA8(__m128i pixels) {
+		pixels = _mm_shufflelo_epi16(_mm_shufflehi_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+		return _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8));
+	}
+
+	inline void encodeRowRGBA8(const u8* source, u8* dest) {
+		const __m128i low = swapRGBA8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+		const __m128i high = swapRGBA8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16)));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), low);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + 4 * 4), _mm_unpackhi_epi64(low, low));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + 16 * 4), high);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + 20 * 4), _mm_unpackhi_epi64(high, high));
+	}
+
+	inline void decodeRowRGBA8(const u8* source, u8* dest) {
+		const __m128i low = _mm_unpacklo_epi64(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 4 * 4))
+		);
+		const __m128i high = _mm_unpacklo_epi64(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 16 * 4)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 20 * 4))
+		);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), swapRGBA8(low));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 16), swapRGBA8(high));
+	}
+#elif defined(PICA_SIMD_ARM64)
+	inline void encodeRowRGBA8(const u8* source, u8* dest) {
+		const uint8x16_t low = vrev32q_u8(vld1q_u8(source));
+		const uint8x16_t high = vrev32q_u8(vld1q_u8(source + 16));
+
+		vst1_u8(dest, vget_low_u8(low));
+		vst1_u8(dest + 4 * 4, vget_high_u8(low));
+		vst1_u8(dest + 16 * 4, vget_low_u8(high));
+		vst1_u8(dest + 20 * 4, vget_high_u8(high));
+	}
+
+	inline void decodeRowRGBA8(const u8* source, u8* dest) {
+		const uint8x16_t low = vcombine_u8(vld1_u8(source), vld1_u8(source + 4 * 4));
+		const uint8x16_t high = vcombine_u8(vld1_u8(source + 16 * 4), vld1_u8(source + 20 * 4));
+
+		vst1q_u8(dest, vrev32q_u8(low));
+		vst1q_u8(dest + 16, vrev32q_u8(high));
+	}
+#else
+	inline void encodeRowRGBA8(const u8* source, u8* dest) {
+		for (u32 x = 0; x < 8; x++) {
+			encodePixel(ColorFmt::RGBA8, source + x * 4, dest + xOffsets[x] * 4);
+		}
+	}
+
+	inline void decodeRowRGBA8(const u8* source, u8* dest) {
+		for (u32 x = 0; x < 8; x++) {
+			decodePixel(ColorFmt::RGBA8, source + xOffsets[x] * 4, dest + x * 4);
+		}
+	}
+#endif
+}  // namespace
+
+void SurfaceTiling::encode(ColorFmt format, const u8* source, u8* dest, u32 width, u32 height) {
+	if (format == ColorFmt::RGBA8) {
+		forEachTileRow(width, height, [&](u32 hostIndex, u32 tiledIndex) { encodeRowRGBA8(source + hostIndex * 4, dest + tiledIndex * 4); });
+		return;
+	}
+
+	const u32 bytesPerPixel = sizePerPixel(format);
+	forEachTileRow(width, height, [&](u32 hostIndex, u32 tiledIndex) {
+		for (u32 x = 0; x < 8; x++) {
+			encodePixel(format, source + (hostIndex + x) * 4, dest + (tiledIndex + xOffsets[x]) * bytesPerPixel);
+		}
+	});
+}
+
+void SurfaceTiling::decode(ColorFmt format, const u8* source, u8* dest, u32 width, u32 height) {
+	if (format == ColorFmt::RGBA8) {
+		forEachTileRow(width, height, [&](u32 hostIndex, u32 tiledIndex) { decodeRowRGBA8(source + tiledIndex * 4, dest + hostIndex * 4); });
+		return;
+	}
+
+	const u32 bytesPerPixel = sizePerPixel(format);
+	forEachTileRow(width, height, [&](u32 hostIndex, u32 tiledIndex) {
+		for (u32 x = 0; x < 8; x++) {
+			decodePixel(format, source + (tiledIndex + xOffsets[x]) * bytesPerPixel, dest + (hostIndex + x) * 4);
+		}
+	});
+}
@@ -142,3 +142,70 @@ AAC::Decoder::~Decoder() {
 		decoderHandle = nullptr;
 	}
 }
+
+AAC::AsyncDecoder::~AsyncDecoder() {
+	if (worker.joinable()) {
+		{
+			std::scoped_lock lock(mutex);
+			stop = true;
+		}
+
+		condition.notify_all();
+		worker.join();
+	}
+}
+
+void AAC::AsyncDecoder::submit(const AAC::Message& newRequest, AAC::AsyncDecoder::PaddrCallback callback, bool audioEnabled) {
+	if (busy) [[unlikely]] {
+		Helpers::panic("Submitted AAC request while another one is in flight");
+	}
+
+	if (!worker.joinable()) {
+		worker = std::thread(&AAC::AsyncDecoder::workerLoop, this);
+	}
+
+	{
+		std::scoped_lock lock(mutex);
+		request = newRequest;
+		paddrCallback = std::move(callback);
+		enableAudio = audioEnabled;
+		hasRequest = true;
+		busy = true;
+		done = false;
+	}
+
+	condition.notify_all();
+}
+
+AAC::Message AAC::AsyncDecoder::wait() {
+	std::unique_lock lock(mutex);
+	condition.wait(lock, [this]() { return done; });
+
+	busy = false;
+	done = false;
+	return response;
+}
+
+void AAC::AsyncDecoder::workerLoop() {
+	std::unique_lock lock(mutex);
+
+	while (true) {
+		condition.wait(lock, [this]() { return stop || hasRequest; });
+		if (stop) {
+			return;
+		}
+
+		hasRequest = false;
+		const AAC::Message currentRequest = request;
+		lock.unlock();
+
+		// Nothing else touches the decoder or the request's callback while a request is in flight
+		AAC::Message currentResponse;
+		decoder.decode(currentResponse, currentRequest, paddrCallback, enableAudio);
+
+		lock.lock();
+		response = currentResponse;
+		done = true;
+		condition.notify_all();
+	}
+}
@@ -29,7 +29,7 @@ namespace Audio {
 			sources[i].index = i;
 		}
 
-		aacDecoder.reset(new Audio::AAC::Decoder());
+		aacDecoder.reset(new Audio::AAC::AsyncDecoder());
 	}
 
 	void HLE_DSP::resetAudioPipe() {
@@ -72,6 +72,12 @@ namespace Audio {
 		dspState = DSPState::Off;
 		loaded = false;
 
+		// Let any in-flight AAC decode finish, as it writes to guest memory, and drop its response
+		if (aacDecoder->isBusy()) {
+			aacDecoder->wait();
+		}
+		scheduler.removeEvent(Scheduler::EventType::SignalAAC);
+
 		for (auto& e : pipeData) {
 			e.clear();
 		}
@@ -202,7 +208,10 @@ namespace Audio {
 					}
 
 					std::memcpy(&request, raw.data(), sizeof(request));
-					handleAACRequest(request);
+					if (!handleAACRequest(request)) {
+						// The pipe event is signalled once decoding is done
+						break;
+					}
 				} else {
 					Helpers::warn("Invalid size for AAC request");
 				}
@@ -222,6 +231,11 @@ namespace Audio {
 			return {};
 		}
 
+		// If the guest reads the response to an AAC request before we've reported it as done, finish decoding now
+		if (pipe == DSPPipeType::Binary && aacDecoder->isBusy()) {
+			finishAACRequest();
+		}
+
 		if (pipe != DSPPipeType::Audio) {
 			log("Reading from non-audio pipe! This might be broken, might need to check what pipe is being read from and implement writing to it\n");
 		}
@@ -753,13 +767,24 @@ namespace Audio {
 		return decodedSamples;
 	}
 
-	void HLE_DSP::handleAACRequest(const AAC::Message& request) {
+	bool HLE_DSP::handleAACRequest(const AAC::Message& request) {
+		// Requests are handled in order, so complete the one in flight first
+		if (aacDecoder->isBusy()) {
+			finishAACRequest();
+		}
+
 		AAC::Message response;
 
 		switch (request.command) {
-			case AAC::Command::EncodeDecode:
-				aacDecoder->decode(response, request, [this](u32 paddr) { return getPointerPhys<u8>(paddr); }, settings.aacEnabled);
-				break;
+			case AAC::Command::EncodeDecode: {
+				// Decode on a worker thread and report the result a bit later, like the DSP would, instead of making the emulator
+				// thread wait. The delay is roughly the time the DSP firmware takes to decode a packet
+				static constexpr u64 decodeDelayTicks = Scheduler::arm11Clock / 2000;  // 0.5ms
+
+				aacDecoder->submit(request, [this](u32 paddr) { return getPointerPhys<u8>(paddr); }, settings.aacEnabled);
+				scheduler.addEvent(Scheduler::EventType::SignalAAC, scheduler.currentTimestamp + decodeDelayTicks);
+				return false;
+			}
 
 			case AAC::Command::Init:
 			case AAC::Command::Shutdown:
@@ -772,6 +797,22 @@ namespace Audio {
 			default: Helpers::warn("Unknown AAC command type"); break;
 		}
 
+		writeAACResponse(response);
+		return true;
+	}
+
+	void HLE_DSP::finishAACRequest() {
+		if (!aacDecoder->isBusy()) {
+			return;
+		}
+
+		// If the worker is done, this doesn't block
+		writeAACResponse(aacDecoder->wait());
+		scheduler.removeEvent(Scheduler::EventType::SignalAAC);
+		dspService.triggerPipeEvent(DSPPipeType::Binary);
+	}
+
+	void HLE_DSP::writeAACResponse(const AAC::Message& response) {
 		// Copy response data to the binary pipe
 		auto& pipe = pipeData[DSPPipeType::Binary];
 		pipe.resize(sizeof(response));
@@ -28,19 +28,23 @@ TeakraDSP::TeakraDSP(Memory& mem, Scheduler& scheduler, DSPService& dspService,
 
 	teakra.SetAHBMCallback(ahbm);
 	teakra.SetAudioCallback([](std::array<s16, 2> sample) { /* Do nothing */ });
+	// Run DSP code from Teakra's cache of pre-decoded blocks, which is cycle-for-cycle identical to its interpreter but faster.
+	// On x64 the blocks are also recompiled to native code. Other hosts keep running them through the interpreter's handlers
+	teakra.SetBlockCacheEnabled(true);
+	teakra.SetRecompilerEnabled(true);
 
 	// Set up event handlers. These handlers forward a hardware interrupt to the DSP service, which is responsible
 	// For triggering the appropriate DSP kernel events
 	// Note: It's important not to fire any events if "loaded" is false, ie if we haven't fully loaded a DSP component yet
 	teakra.SetRecvDataHandler(0, [&]() {
 		if (loaded) {
-			dspService.triggerInterrupt0();
+			signalEvent({Event::Type::Interrupt0, 0});
 		}
 	});
 
 	teakra.SetRecvDataHandler(1, [&]() {
 		if (loaded) {
-			dspService.triggerInterrupt1();
+			signalEvent({Event::Type::Interrupt1, 0});
 		}
 	});
 
@@ -73,13 +77,224 @@ TeakraDSP::TeakraDSP(Memory& mem, Scheduler& scheduler, DSPService& dspService,
 			if (pipe == 0) {
 				Helpers::warn("Pipe event for debug pipe: Should be ignored and the data should be flushed");
 			} else {
-				dspService.triggerPipeEvent(pipe);
+				signalEvent({Event::Type::Pipe, u8(pipe)});
 			}
 		}
 	};
 
 	teakra.SetRecvDataHandler(2, [processPipeEvent]() { processPipeEvent(true); });
 	teakra.SetSemaphoreHandler([processPipeEvent]() { processPipeEvent(false); });
+
+	if (config.lleDSPThreadEnabled) {
+		threaded = true;
+		maxLag = std::max<u64>(config.lleDSPMaxLag, Audio::lleSlice);
+		dspThread = std::thread(&TeakraDSP::threadLoop, this);
+	}
+}
+
+TeakraDSP::~TeakraDSP() { stopDSPThread(); }
+
+void TeakraDSP::stopDSPThread() {
+	if (!threaded) {
+		return;
+	}
+
+	{
+		std::scoped_lock lock(threadMutex);
+		stopThread = true;
+	}
+
+	wakeDSP.notify_one();
+	eventsDrained.notify_one();
+	dspThread.join();
+	threaded = false;
+}
+
+void TeakraDSP::threadLoop() {
+	std::unique_lock lock(threadMutex);
+
+	while (true) {
+		// queueCommand only notifies us while this is set. It's set under the lock before the predicate is checked, so a command queued
+		// after the check always sees it and its notification can't get lost
+		dspSleeping = true;
+		wakeDSP.wait(lock, [this]() { return stopThread || commands.size() != 0 || executedCycles < targetCycles; });
+		dspSleeping = false;
+
+		if (stopThread) {
+			return;
+		}
+
+		const bool runCycles = executedCycles < targetCycles;
+		// Keep syncThread waiting until this batch has been applied to Teakra, so that nothing on the emulator thread can overtake it
+		busy = true;
+		lock.unlock();
+
+		{
+			std::scoped_lock teakraLock(teakraMutex);
+			executeCommands();
+
+			if (runCycles) {
+				runSlice();
+			}
+		}
+
+		lock.lock();
+		busy = false;
+		if (runCycles) {
+			executedCycles += Audio::lleSlice;
+		}
+		dspProgress.notify_all();
+	}
+}
+
+std::unique_lock<std::mutex> TeakraDSP::syncThread() {
+	if (!threaded) {
+		return {};
+	}
+
+	{
+		std::unique_lock lock(threadMutex);
+		waitForThread(lock, [this]() { return !busy && commands.size() == 0 && executedCycles >= targetCycles; });
+	}
+
+	// The DSP thread only gets new work from the emulator thread, so it stays idle until the caller is done with Teakra
+	return std::unique_lock(teakraMutex);
+}
+
+void TeakraDSP::runAudioFrame(u64 eventTimestamp) {
+	if (!threaded) {
+		runSlice();
+	} else {
+		std::unique_lock lock(threadMutex);
+		targetCycles += Audio::lleSlice;
+		wakeDSP.notify_one();
+
+		// Hard sync if the DSP has fallen too far behind the ARM11
+		waitForThread(lock, [this]() { return targetCycles - executedCycles <= maxLag; });
+		lock.unlock();
+
+		deliverEvents();
+	}
+
+	scheduler.addEvent(Scheduler::EventType::RunDSP, scheduler.currentTimestamp + Audio::lleSlice * 2);
+}
+
+void TeakraDSP::signalEvent(Event event) {
+	if (!threaded) {
+		events.push(&event, 1);
+		deliverEvents();
+		return;
+	}
+
+	// Events can't be dropped, as the guest may hang waiting for a lost pipe event. If the queue is full, the DSP thread waits for the
+	// emulator thread to deliver the events queued so far
+	while (events.push(&event, 1) == 0) {
+		if (std::this_thread::get_id() != dspThread.get_id()) {
+			deliverEvents();
+			continue;
+		}
+
+		std::unique_lock lock(threadMutex);
+		eventsFull = true;
+		dspProgress.notify_all();
+		eventsDrained.wait(lock, [this]() { return stopThread || !eventsFull; });
+
+		if (stopThread) {
+			return;
+		}
+	}
+}
+
+void TeakraDSP::deliverEvents() {
+	Event event;
+	while (events.pop(&event, 1) != 0) {
+		switch (event.type) {
+			case Event::Type::Interrupt0: dspService.triggerInterrupt0(); break;
+			case Event::Type::Interrupt1: dspService.triggerInterrupt1(); break;
+			case Event::Type::Pipe: dspService.triggerPipeEvent(event.pipe); break;
+		}
+	}
+
+	if (threaded) {
+		std::scoped_lock lock(threadMutex);
+		if (eventsFull) {
+			eventsFull = false;
+			eventsDrained.notify_one();
+		}
+	}
+}
+
+void TeakraDSP::queueCommand(Command command, std::span<const u8> data) {
+	command.size = u32(data.size());
+
+	// If the rings are full, wait for the DSP thread to work through them. It drains them every time it wakes up, so this only happens if
+	// the guest queues up a lot of requests at once
+	if (commands.size() == commands.Capacity() || commandData.Capacity() - commandData.size() < data.size()) [[unlikely]] {
+		std::unique_lock lock(threadMutex);
+		wakeDSP.notify_one();
+		waitForThread(lock, [&]() {
+			return commands.size() < commands.Capacity() && commandData.Capacity() - commandData.size() >= data.size();
+		});
+	}
+
+	// Push the data first, so that it's there by the time the DSP thread sees the command
+	commandData.push(data);
+	commands.push(&command, 1);
+
+	if (dspSleeping) {
+		std::scoped_lock lock(threadMutex);
+		wakeDSP.notify_one();
+	}
+}
+
+void TeakraDSP::executeCommands() {
+	Command command;
+	while (commands.pop(&command, 1) != 0) {
+		switch (command.type) {
+			case Command::Type::SetSemaphore: teakra.SetSemaphore(command.value); break;
+			case Command::Type::MaskSemaphore: teakra.MaskSemaphore(command.value); break;
+
+			case Command::Type::WritePipe:
+				pipeScratch.resize(command.size);
+				commandData.pop(pipeScratch.data(), pipeScratch.size());
+				writePipe(command.value, pipeScratch);
+				break;
+		}
+	}
+}
+
+u16 TeakraDSP::recvData(u32 regId) {
+	u16 value;
+	{
+		auto lock = syncThread();
+		value = teakra.RecvData(regId);
+	}
+
+	deliverEvents();
+	return value;
+}
+
+bool TeakraDSP::recvDataIsReady(u32 regId) {
+	auto lock = syncThread();
+	return teakra.RecvDataIsReady(regId);
+}
+
+void TeakraDSP::setSemaphore(u16 value) {
+	if (!threaded) {
+		teakra.SetSemaphore(value);
+		return;
+	}
+
+	queueCommand({Command::Type::SetSemaphore, value});
+}
+
+void TeakraDSP::setSemaphoreMask(u16 value) {
+	if (!threaded) {
+		teakra.MaskSemaphore(value);
+		return;
+	}
+
+	queueCommand({Command::Type::MaskSemaphore, value});
 }
 
 Teakra::UserConfig TeakraDSP::getTeakraConfig() {
@@ -90,16 +305,27 @@ Teakra::UserConfig TeakraDSP::getTeakraConfig() {
 }
 
 void TeakraDSP::reset() {
+	auto lock = syncThread();
 	teakra.Reset();
 	running = false;
 	loaded = false;
 	signalledData = signalledSemaphore = false;
 
 	audioFrameIndex = 0;
+
+	// Drop events from before the reset
+	Event event;
+	while (events.pop(&event, 1) != 0) {
+	}
+
+	std::scoped_lock threadLock(threadMutex);
+	targetCycles = executedCycles = 0;
+	eventsFull = false;
 }
 
 void TeakraDSP::setAudioEnabled(bool enable) {
 	if (audioEnabled != enable) {
+		auto lock = syncThread();
 		audioEnabled = enable;
 
 		// Set the appropriate audio callback for Teakra
@@ -130,9 +356,6 @@ void TeakraDSP::setAudioEnabled(bool enable) {
 void TeakraDSP::writeProcessPipe(u32 channel, u32 size, u32 buffer) {
 	size &= 0xffff;
 
-	PipeStatus status = getPipeStatus(channel, PipeDirection::CPUtoDSP);
-	bool needUpdate = false;  // Do we need to update the pipe status and catch up Teakra?
-
 	std::vector<u8> data;
 	data.reserve(size);
 
@@ -141,7 +364,21 @@ void TeakraDSP::writeProcessPipe(u32 channel, u32 size, u32 buffer) {
 		const u8 byte = mem.read8(buffer + i);
 		data.push_back(byte);
 	}
-	u8* dataPointer = data.data();
+
+	// The pipe lives in DSP memory, so let the DSP thread write it in between slices instead of waiting for it here
+	if (threaded) {
+		queueCommand({Command::Type::WritePipe, u16(channel)}, data);
+	} else {
+		writePipe(channel, data);
+	}
+}
+
+void TeakraDSP::writePipe(u32 channel, std::span<const u8> data) {
+	PipeStatus status = getPipeStatus(channel, PipeDirection::CPUtoDSP);
+	bool needUpdate = false;  // Do we need to update the pipe status and catch up Teakra?
+
+	u32 size = u32(data.size());
+	const u8* dataPointer = data.data();
 
 	while (size != 0) {
 		if (status.isFull()) {
@@ -186,6 +423,7 @@ void TeakraDSP::writeProcessPipe(u32 channel, u32 size, u32 buffer) {
 
 std::vector<u8> TeakraDSP::readPipe(u32 channel, u32 peer, u32 size, u32 buffer) {
 	size &= 0xffff;
+	auto lock = syncThread();
 
 	PipeStatus status = getPipeStatus(channel, PipeDirection::DSPtoCPU);
 
@@ -241,6 +479,7 @@ void TeakraDSP::loadComponent(std::vector<u8>& data, u32 programMask, u32 dataMa
 		return;
 	}
 
+	auto lock = syncThread();
 	teakra.Reset();
 	running = true;
 
@@ -269,6 +508,9 @@ void TeakraDSP::loadComponent(std::vector<u8>& data, u32 programMask, u32 dataMa
 		std::memcpy(dst, src, segment.size);
 	}
 
+	// We wrote the code straight into DSP memory, so Teakra doesn't know it has changed
+	teakra.InvalidateCodeCache();
+
 	bool syncWithDsp = dsp1.flags & 0x1;
 	bool loadSpecialSegment = (dsp1.flags >> 1) & 0x1;
 
@@ -304,6 +546,8 @@ void TeakraDSP::unloadComponent() {
 		Helpers::warn("Audio: unloadComponent called without a running program");
 		return;
 	}
+
+	auto lock = syncThread();
 	loaded = false;
 	// Stop scheduling DSP events
 	scheduler.removeEvent(Scheduler::EventType::RunDSP);
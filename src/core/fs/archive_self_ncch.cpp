@@ -74,7 +74,7 @@ std::optional<u32> SelfNCCHArchive::readFile(FileSession* file, u64 offset, u32
 	std::unique_ptr<u8[]> data(new u8[size]);
 
 	if (auto cxi = mem.getCXI(); cxi != nullptr) {
-		IOFile& ioFile = mem.CXIFile;
+		ROMFile& ioFile = mem.CXIFile;
 
 		NCCH::FSInfo fsInfo;
 
@@ -1,5 +1,8 @@
 #include "fcram.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #include "memory.hpp"
 
 void KFcram::Region::reset(u32 start, size_t size) {
@@ -7,41 +10,101 @@ void KFcram::Region::reset(u32 start, size_t size) {
 	pages = size >> 12;
 	freePages = pages;
 
-	Block initialBlock(pages, 0);
-	blocks.clear();
-	blocks.push_back(initialBlock);
+	freeBlocks.clear();
+	freeBlocksBySize.clear();
+	addFreeBlock(0, pages);
+}
+
+void KFcram::Region::addFreeBlock(s32 pageOffset, s32 blockPages) {
+	// Merge the block with the free blocks right before and after it, if any
+	auto next = freeBlocks.lower_bound(pageOffset);
+	if (next != freeBlocks.end() && next->first == pageOffset + blockPages) {
+		blockPages += next->second;
+		removeFreeBlock(next++);
+	}
+
+	if (next != freeBlocks.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == pageOffset) {
+			pageOffset = prev->first;
+			blockPages += prev->second;
+			removeFreeBlock(prev);
+		}
+	}
+
+	freeBlocks.emplace(pageOffset, blockPages);
+	freeBlocksBySize.emplace(blockPages, pageOffset);
+}
+
+void KFcram::Region::removeFreeBlock(std::map<s32, s32>::iterator it) {
+	freeBlocksBySize.erase({it->second, it->first});
+	freeBlocks.erase(it);
 }
 
 void KFcram::Region::alloc(std::list<FcramBlock>& out, s32 allocPages, bool linear) {
-	for (auto it = blocks.begin(); it != blocks.end(); it++) {
-		if (it->used) continue;
+	if (allocPages > freePages) {
+		// Official kernel panics here
+		Helpers::panic("Failed to allocate FCRAM, not enough guest memory");
+	}
 
-		// On linear allocations, only a single contiguous block may be used
-		if (it->pages < allocPages && linear) continue;
+	// Take the first "count" pages of a free block and add them to the output list
+	auto takePages = [&](std::map<s32, s32>::iterator it, s32 count) {
+		const s32 pageOffset = it->first;
+		const s32 blockPages = it->second;
 
-		// If the current block is bigger than the allocation, split it
-		if (it->pages > allocPages) {
-			Block newBlock(it->pages - allocPages, it->pageOffset + allocPages);
-			it->pages = allocPages;
-			blocks.insert(it, newBlock);
+		removeFreeBlock(it);
+		if (blockPages > count) {
+			addFreeBlock(pageOffset + count, blockPages - count);
 		}
 
-		// Mark the block as allocated and add it to the output list
-		it->used = true;
-		allocPages -= it->pages;
-		freePages -= it->pages;
+		freePages -= count;
+		out.push_back(FcramBlock(start + (pageOffset << 12), count));
+	};
 
-		u32 paddr = start + (it->pageOffset << 12);
-		FcramBlock outBlock(paddr, it->pages);
-		out.push_back(outBlock);
+	if (linear) {
+		// On linear allocations, only a single contiguous block may be used. Pick the smallest one that fits, to keep big blocks around
+		auto fit = freeBlocksBySize.lower_bound({allocPages, std::numeric_limits<s32>::min()});
+		if (fit == freeBlocksBySize.end()) {
+			Helpers::panic("Failed to allocate linear FCRAM, guest memory is too fragmented");
+		}
 
-		if (allocPages < 1) {
-			return;
+		takePages(freeBlocks.find(fit->second), allocPages);
+	} else {
+		// Otherwise, fill the allocation with free blocks from the start of the region
+		while (allocPages > 0) {
+			auto it = freeBlocks.begin();
+			const s32 count = std::min(allocPages, it->second);
+
+			takePages(it, count);
+			allocPages -= count;
 		}
 	}
+}
+
+void KFcram::Region::free(u32 paddr, s32 freedPages) {
+	const s32 pageOffset = s32((paddr - start) >> 12);
+
+	// Make sure we're not freeing memory that's already free
+	auto next = freeBlocks.lower_bound(pageOffset);
+	const bool overlapsNext = next != freeBlocks.end() && next->first < pageOffset + freedPages;
+	const bool overlapsPrev = next != freeBlocks.begin() && std::prev(next)->first + std::prev(next)->second > pageOffset;
+
+	if (overlapsNext || overlapsPrev) {
+		Helpers::panic("Tried to free FCRAM that was already free (paddr: %08X, pages: %d)", paddr, freedPages);
+	}
 
-	// Official kernel panics here
-	Helpers::panic("Failed to allocate FCRAM, not enough guest memory");
+	addFreeBlock(pageOffset, freedPages);
+	freePages += freedPages;
+}
+
+FcramStats KFcram::Region::getStats() const {
+	FcramStats stats;
+	stats.totalPages = u32(pages);
+	stats.freePages = u32(freePages);
+	stats.freeBlockCount = u32(freeBlocks.size());
+	stats.largestFreeBlock = freeBlocksBySize.empty() ? 0 : u32(freeBlocksBySize.rbegin()->first);
+
+	return stats;
 }
 
 u32 KFcram::Region::getUsedCount() { return pages - freePages; }
@@ -59,17 +122,31 @@ void KFcram::reset(size_t ramSize, size_t appSize, size_t sysSize, size_t baseSi
 	baseRegion.reset(appSize + sysSize, baseSize);
 }
 
-void KFcram::alloc(FcramBlockList& out, s32 pages, FcramRegion region, bool linear) {
+KFcram::Region& KFcram::getRegion(FcramRegion region) {
 	switch (region) {
-		case FcramRegion::App: appRegion.alloc(out, pages, linear); break;
-		case FcramRegion::Sys: sysRegion.alloc(out, pages, linear); break;
-		case FcramRegion::Base: baseRegion.alloc(out, pages, linear); break;
-		default: Helpers::panic("Invalid FCRAM region chosen for allocation!"); break;
+		case FcramRegion::App: return appRegion;
+		case FcramRegion::Sys: return sysRegion;
+		case FcramRegion::Base: return baseRegion;
+		default: Helpers::panic("Invalid FCRAM region %X", static_cast<u32>(region));
 	}
+}
 
+void KFcram::alloc(FcramBlockList& out, s32 pages, FcramRegion region, bool linear) {
+	getRegion(region).alloc(out, pages, linear);
 	incRef(out);
 }
 
+void KFcram::free(u32 paddr, s32 pages) {
+	for (Region* region : {&appRegion, &sysRegion, &baseRegion}) {
+		if (region->contains(paddr)) {
+			region->free(paddr, pages);
+			return;
+		}
+	}
+
+	Helpers::panic("Tried to free FCRAM outside of any region (paddr: %08X)", paddr);
+}
+
 void KFcram::incRef(FcramBlockList& list) {
 	for (auto it = list.begin(); it != list.end(); it++) {
 		for (int i = 0; i < it->pages; i++) {
@@ -81,22 +158,29 @@ void KFcram::incRef(FcramBlockList& list) {
 
 void KFcram::decRef(FcramBlockList& list) {
 	for (auto it = list.begin(); it != list.end(); it++) {
-		for (int i = 0; i < it->pages; i++) {
-			u32 index = (it->paddr >> 12) + i;
-			refs.get()[index]--;
+		// Free runs of unreferenced pages at once, so that the region doesn't need to merge them page by page
+		s32 runStart = -1;
+
+		for (int i = 0; i <= it->pages; i++) {
+			bool unreferenced = false;
+			if (i < it->pages) {
+				u32 index = (it->paddr >> 12) + i;
+				if (refs.get()[index] == 0) {
+					Helpers::panic("Tried to decrement the reference count of unreferenced FCRAM (paddr: %08X)", index << 12);
+				}
+
+				unreferenced = (--refs.get()[index] == 0);
+			}
 
-			if (!refs.get()[index]) {
-				Helpers::panic("TODO: Freeing FCRAM");
+			if (unreferenced && runStart == -1) {
+				runStart = i;
+			} else if (!unreferenced && runStart != -1) {
+				free(it->paddr + (u32(runStart) << 12), i - runStart);
+				runStart = -1;
 			}
 		}
 	}
 }
 
-u32 KFcram::getUsedCount(FcramRegion region) {
-	switch (region) {
-		case FcramRegion::App: return appRegion.getUsedCount();
-		case FcramRegion::Sys: return sysRegion.getUsedCount();
-		case FcramRegion::Base: return baseRegion.getUsedCount();
-		default: Helpers::panic("Invalid FCRAM region in getUsedCount!");
-	}
-}
\ No newline at end of file
+u32 KFcram::getUsedCount(FcramRegion region) { return getRegion(region).getUsedCount(); }
+FcramStats KFcram::getStats(FcramRegion region) { return getRegion(region).getStats(); }
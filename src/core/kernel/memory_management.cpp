@@ -93,6 +93,16 @@ void Kernel::controlMemory() {
 			break;
 		}
 
+		case Operation::Free:
+			if (!mem.freeMemory(addr0, pages)) {
+				Helpers::warn("ControlMemory: Failed to free memory (addr: %08X, pages: %X)", addr0, pages);
+				regs[0] = Result::OS::InvalidAddressState;
+				return;
+			}
+
+			regs[1] = addr0;
+			break;
+
 		case Operation::Map:
 			// Official kernel only allows Private regions to be mapped to Free regions. An Alias or Aliased region cannot be mapped again
 			if (!mem.mapVirtualMemory(
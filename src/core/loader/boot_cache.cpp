@@ -0,0 +1,178 @@
+#include "loader/boot_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <system_error>
+
+#include "io_file.hpp"
+#include "loader/ncch.hpp"
+#include "memory_mapped_file.hpp"
+
+namespace {
+	// Fixed-size header at the start of every cache entry, followed by the .code file and then the SMDH
+	struct EntryHeader {
+		u32 magic;
+		u32 version;
+		u64 programID;
+		u64 headerHash;
+		u64 romSize;
+		s64 romTimestamp;
+
+		u64 saveDataSize;
+		u32 stackSize;
+		u32 bssSize;
+		NCCH::CodeSetInfo text, rodata, data;
+
+		u32 codeSize;
+		u32 smdhSize;
+		u32 region;  // noRegion if the SMDH didn't specify one
+		u8 encrypted;
+		u8 compressCode;
+		u8 padding[2];
+	};
+
+	constexpr u32 noRegion = 0xFFFFFFFF;
+}  // namespace
+
+std::filesystem::path BootCache::getEntryPath(u64 programID, u64 headerHash) const {
+	char name[64];
+	std::snprintf(name, sizeof(name), "%016llX-%016llX.bin", (unsigned long long)programID, (unsigned long long)headerHash);
+	return directory / name;
+}
+
+void BootCache::setROM(const std::filesystem::path& path) {
+	std::error_code ec;
+	romValid = false;
+
+	const auto size = std::filesystem::file_size(path, ec);
+	if (ec) return;
+	const auto timestamp = std::filesystem::last_write_time(path, ec);
+	if (ec) return;
+
+	romSize = u64(size);
+	romTimestamp = s64(timestamp.time_since_epoch().count());
+	romValid = !directory.empty();
+}
+
+bool BootCache::load(NCCH& ncch, u64 headerHash) {
+	if (!romValid) {
+		return false;
+	}
+
+	const std::filesystem::path path = getEntryPath(ncch.programID, headerHash);
+	std::error_code ec;
+	if (!std::filesystem::exists(path, ec)) {
+		return false;
+	}
+
+	MemoryMappedFile file;
+	if (!file.open(path)) {
+		return false;
+	}
+
+	EntryHeader header;
+	const usize fileSize = file.size();
+	if (fileSize < sizeof(header)) {
+		file.close();
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+	const bool valid = header.magic == magic && header.version == version && header.programID == ncch.programID &&
+					   header.headerHash == headerHash && header.romSize == romSize && header.romTimestamp == romTimestamp;
+
+	// The sizes come from the file, so make sure they describe exactly what's left of it before copying anything out
+	if (!valid || u64(header.codeSize) + header.smdhSize != fileSize - sizeof(header)) {
+		if (valid) {
+			Helpers::warn("Boot cache entry for title %016llX is corrupt, ignoring it", (unsigned long long)ncch.programID);
+		}
+
+		file.close();
+		return false;
+	}
+
+	const u8* code = file.data() + sizeof(header);
+	const u8* smdh = code + header.codeSize;
+	ncch.codeFile.assign(code, code + header.codeSize);
+	ncch.smdh.assign(smdh, smdh + header.smdhSize);
+	file.close();
+
+	ncch.saveDataSize = header.saveDataSize;
+	ncch.stackSize = header.stackSize;
+	ncch.bssSize = header.bssSize;
+	ncch.text = header.text;
+	ncch.rodata = header.rodata;
+	ncch.data = header.data;
+	ncch.encrypted = header.encrypted != 0;
+	ncch.compressCode = header.compressCode != 0;
+
+	if (header.region != noRegion) {
+		ncch.region = static_cast<Regions>(header.region);
+	}
+
+	return true;
+}
+
+void BootCache::store(const NCCH& ncch, u64 headerHash) {
+	if (!romValid) {
+		return;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if (ec) {
+		Helpers::warn("Failed to create boot cache directory: %s", ec.message().c_str());
+		return;
+	}
+
+	EntryHeader header{};
+	header.magic = magic;
+	header.version = version;
+	header.programID = ncch.programID;
+	header.headerHash = headerHash;
+	header.romSize = romSize;
+	header.romTimestamp = romTimestamp;
+	header.saveDataSize = ncch.saveDataSize;
+	header.stackSize = ncch.stackSize;
+	header.bssSize = ncch.bssSize;
+	header.text = ncch.text;
+	header.rodata = ncch.rodata;
+	header.data = ncch.data;
+	header.codeSize = u32(ncch.codeFile.size());
+	header.smdhSize = u32(ncch.smdh.size());
+	header.region = ncch.region.has_value() ? static_cast<u32>(*ncch.region) : noRegion;
+	header.encrypted = ncch.encrypted ? 1 : 0;
+	header.compressCode = ncch.compressCode ? 1 : 0;
+
+	// Write to a uniquely named temporary file first and then rename it, so that other instances booting the same title never see a partially
+	// written entry
+	const std::filesystem::path path = getEntryPath(ncch.programID, headerHash);
+	std::filesystem::path tmpPath = path;
+	tmpPath += "." + std::to_string(std::random_device{}()) + ".tmp";
+
+	IOFile file;
+	if (!file.open(tmpPath, "wb")) {
+		return;
+	}
+
+	auto writeAll = [&file](const void* data, std::size_t size) {
+		auto [success, bytes] = file.writeBytes(data, size);
+		return success && bytes == size;
+	};
+
+	bool success = writeAll(&header, sizeof(header)) && writeAll(ncch.codeFile.data(), ncch.codeFile.size()) &&
+				   writeAll(ncch.smdh.data(), ncch.smdh.size());
+	file.close();
+
+	if (success) {
+		std::filesystem::rename(tmpPath, path, ec);
+		success = !ec;
+	}
+
+	if (!success) {
+		std::filesystem::remove(tmpPath, ec);
+		Helpers::warn("Failed to write boot cache entry for title %016llX", (unsigned long long)ncch.programID);
+	}
+}
@@ -0,0 +1,417 @@
+#include "loader/compressed_rom.hpp"
+
+#include <cryptopp/filters.h>
+#include <cryptopp/zdeflate.h>
+#include <cryptopp/zinflate.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "loader/ncch.hpp"
+#include "loader/ncsd.hpp"
+#include "loader/rom_file.hpp"
+#include "xxhash/xxhash.h"
+
+CompressedROM::~CompressedROM() { file.close(); }
+
+bool CompressedROM::isCompressedROM(IOFile& file) {
+	u32 fileMagic = 0;
+	file.seek(0);
+	auto [success, bytes] = file.readBytes(&fileMagic, sizeof(fileMagic));
+	file.seek(0);
+
+	return success && bytes == sizeof(fileMagic) && fileMagic == magic;
+}
+
+bool CompressedROM::open(const std::filesystem::path& path) {
+	if (!file.open(path, "rb")) {
+		return false;
+	}
+
+	auto [success, bytes] = file.readBytes(&header, sizeof(header));
+	if (!success || bytes != sizeof(header) || header.magic != magic) {
+		printf("Invalid compressed ROM header\n");
+		return false;
+	}
+
+	if (header.version != version) {
+		printf("Unsupported compressed ROM version %u\n", header.version);
+		return false;
+	}
+
+	if (header.blockSize == 0 || header.blockSize > maxBlockSize) {
+		printf("Compressed ROM has an invalid block size\n");
+		return false;
+	}
+
+	const u64 fileSize = file.size().value_or(0);
+	const u64 expectedBlocks = (header.imageSize + header.blockSize - 1) / header.blockSize;
+	// The block index has to fit in the file, which also keeps a bad header from making us allocate a huge index
+	const u64 maxBlocks = fileSize / sizeof(BlockEntry);
+	if (header.blockCount != expectedBlocks || header.blockCount > maxBlocks) {
+		printf("Compressed ROM has an invalid block layout\n");
+		return false;
+	}
+
+	blocks.resize(header.blockCount);
+	std::tie(success, bytes) = file.read(blocks.data(), blocks.size(), sizeof(BlockEntry));
+	if (!success || bytes != blocks.size()) {
+		printf("Failed to read compressed ROM block index\n");
+		return false;
+	}
+
+	// Check the index up front instead of trusting it when reading blocks. Blocks that don't compress are stored as-is, so no block takes up
+	// more space than its uncompressed size, and all of them are after the index
+	const u64 dataStart = sizeof(Header) + u64(blocks.size()) * sizeof(BlockEntry);
+	for (u32 i = 0; i < header.blockCount; i++) {
+		const BlockEntry& entry = blocks[i];
+		const u64 blockBytes = std::min<u64>(header.blockSize, header.imageSize - u64(i) * header.blockSize);
+
+		if (entry.storedSize > blockBytes || entry.offset < dataStart || entry.offset > fileSize || entry.storedSize > fileSize - entry.offset) {
+			printf("Compressed ROM block %u is out of bounds\n", i);
+			return false;
+		}
+
+		if ((entry.flags & BlockEntry::StoredRaw) && entry.storedSize != blockBytes) {
+			printf("Raw compressed ROM block %u has the wrong size\n", i);
+			return false;
+		}
+	}
+
+	for (auto& block : cache) {
+		block.index = invalidBlock;
+		block.data.resize(header.blockSize);
+	}
+
+	return true;
+}
+
+const std::vector<u8>* CompressedROM::getBlock(u32 index) {
+	useCounter++;
+
+	// Look for the block in the cache, and pick the least recently used slot to evict in case it's not there
+	CachedBlock* victim = &cache[0];
+	for (auto& block : cache) {
+		if (block.index == index) {
+			block.lastUse = useCounter;
+			return &block.data;
+		}
+
+		if (block.lastUse < victim->lastUse) {
+			victim = &block;
+		}
+	}
+
+	const BlockEntry& entry = blocks[index];
+	const u64 blockStart = u64(index) * header.blockSize;
+	const usize blockBytes = usize(std::min<u64>(header.blockSize, header.imageSize - blockStart));
+
+	// Invalidate the slot first, so that it isn't left holding the wrong data if decompression fails
+	victim->index = invalidBlock;
+	victim->lastUse = 0;
+	compressedBuffer.resize(entry.storedSize);
+
+	file.seek(entry.offset);
+	auto [success, bytes] = file.readBytes(compressedBuffer.data(), compressedBuffer.size());
+	if (!success || bytes != compressedBuffer.size()) {
+		Helpers::warn("CompressedROM: Failed to read block %u", index);
+		return nullptr;
+	}
+
+	if (entry.flags & BlockEntry::StoredRaw) {
+		std::memcpy(victim->data.data(), compressedBuffer.data(), blockBytes);
+	} else {
+		try {
+			CryptoPP::ArraySink* sink = new CryptoPP::ArraySink(victim->data.data(), blockBytes);
+			CryptoPP::Inflator inflator(sink);
+			inflator.Put(compressedBuffer.data(), compressedBuffer.size());
+			inflator.MessageEnd();
+
+			if (sink->TotalPutLength() != blockBytes) {
+				Helpers::warn("CompressedROM: Block %u decompressed to the wrong size", index);
+				return nullptr;
+			}
+		} catch (const CryptoPP::Exception& e) {
+			Helpers::warn("CompressedROM: Failed to decompress block %u: %s", index, e.what());
+			return nullptr;
+		}
+	}
+
+	if (XXH3_64bits(victim->data.data(), blockBytes) != entry.checksum) {
+		Helpers::warn("CompressedROM: Checksum mismatch in block %u, the file is corrupted", index);
+		return nullptr;
+	}
+
+	victim->index = index;
+	victim->lastUse = useCounter;
+	return &victim->data;
+}
+
+std::pair<bool, std::size_t> CompressedROM::read(u64 offset, u8* dst, std::size_t size) {
+	if (offset >= header.imageSize) {
+		return {true, 0};
+	}
+
+	const std::size_t readMaxSize = std::size_t(std::min<u64>(size, header.imageSize - offset));
+	std::size_t bytesRead = 0;
+
+	while (bytesRead < readMaxSize) {
+		const u64 position = offset + bytesRead;
+		const u32 index = u32(position / header.blockSize);
+		const std::size_t blockOffset = std::size_t(position % header.blockSize);
+
+		const std::vector<u8>* block = getBlock(index);
+		if (block == nullptr) {
+			return {false, bytesRead};
+		}
+
+		const std::size_t copySize = std::min(std::size_t(header.blockSize) - blockOffset, readMaxSize - bytesRead);
+		std::memcpy(dst + bytesRead, block->data() + blockOffset, copySize);
+		bytesRead += copySize;
+	}
+
+	return {true, bytesRead};
+}
+
+namespace {
+	// A range of the image that has to be decrypted when converting. Bytes [start, start + size) of the image are bytes
+	// [infoOffset, infoOffset + size) of the NCCH section described by info
+	struct DecryptedRange {
+		u64 start;
+		u64 size;
+		u64 infoOffset;
+		NCCH::FSInfo info;
+		usize partition;
+	};
+
+	// Find the parts of an NCCH partition that are encrypted
+	bool collectEncryptedRanges(
+		Crypto::AESEngine& aesEngine, ROMFile& file, NCCH& ncch, const NCCH::FSInfo& partitionInfo, usize partition,
+		std::vector<DecryptedRange>& ranges
+	) {
+		if (!ncch.loadFromHeader(aesEngine, file, partitionInfo)) {
+			return false;
+		}
+
+		if (!ncch.encrypted) {
+			return true;
+		}
+
+		// The exheader is followed by the access descriptor, which is encrypted along with it
+		constexpr u64 exheaderAndAccessDescSize = 0x800;
+		if (ncch.hasExtendedHeader()) {
+			ranges.push_back({ncch.exheaderInfo.offset, exheaderAndAccessDescSize, 0, ncch.exheaderInfo, partition});
+			ranges.back().info.size = exheaderAndAccessDescSize;
+		}
+
+		if (ncch.hasExeFS()) {
+			ranges.push_back({ncch.exeFS.offset, ncch.exeFS.size, 0, ncch.exeFS, partition});
+
+			// The ExeFS uses the primary key, except for .code which uses the secondary key. Since ranges are applied in order,
+			// the .code range overrides the ExeFS one
+			constexpr u64 exeFSHeaderSize = 0x200;
+			u8 exeFSHeader[exeFSHeaderSize];
+			auto [success, bytes] = ncch.readFromFile(file, ncch.exeFS, exeFSHeader, 0, exeFSHeaderSize);
+			if (!success || bytes != exeFSHeaderSize) {
+				return false;
+			}
+
+			for (int i = 0; i < 10; i++) {
+				const u8* fileInfo = &exeFSHeader[i * 16];
+				const u32 fileOffset = *(u32*)&fileInfo[0x8];
+				const u32 fileSize = *(u32*)&fileInfo[0xC];
+
+				if (std::memcmp(fileInfo, ".code\0\0\0", 8) == 0 && ncch.secondaryKey.has_value()) {
+					NCCH::FSInfo codeInfo = ncch.exeFS;
+					codeInfo.encryptionInfo->normalKey = *ncch.secondaryKey;
+					ranges.push_back(
+						{ncch.exeFS.offset + exeFSHeaderSize + fileOffset, fileSize, exeFSHeaderSize + fileOffset, codeInfo, partition}
+					);
+				}
+			}
+		}
+
+		if (ncch.hasRomFS()) {
+			ranges.push_back({ncch.romFS.offset, ncch.romFS.size, 0, ncch.romFS, partition});
+		}
+
+		return true;
+	}
+}  // namespace
+
+bool CompressedROM::convert(
+	Crypto::AESEngine& aesEngine, const std::filesystem::path& input, const std::filesystem::path& output, bool isCXI, u32 blockSize
+) {
+	ROMFile inputFile;
+	if (!inputFile.open(input)) {
+		printf("Failed to open %s\n", input.string().c_str());
+		return false;
+	}
+
+	if (inputFile.isCompressed()) {
+		printf("%s is already compressed\n", input.string().c_str());
+		return false;
+	}
+
+	const std::optional<u64> imageSize = inputFile.size();
+	if (!imageSize.has_value() || blockSize == 0 || blockSize > maxBlockSize) {
+		return false;
+	}
+
+	// Find the NCCH partitions of the image. A CXI is a single partition, while a CCI has a partition table in its header
+	std::vector<NCCH::FSInfo> partitions;
+	if (isCXI) {
+		partitions.push_back(NCCH::FSInfo{.offset = 0, .size = *imageSize, .hashRegionSize = 0, .encryptionInfo = std::nullopt});
+	} else {
+		u32 partitionData[8 * 2];
+		inputFile.seek(0x120);
+		auto [success, count] = inputFile.read(partitionData, std::size(partitionData), sizeof(u32));
+		if (!success || count != std::size(partitionData)) {
+			printf("Failed to read NCSD partition table\n");
+			return false;
+		}
+
+		for (int i = 0; i < 8; i++) {
+			const u64 offset = u64(partitionData[i * 2]) * NCSD::mediaUnit;
+			const u64 length = u64(partitionData[i * 2 + 1]) * NCSD::mediaUnit;
+
+			if (length != 0) {
+				partitions.push_back(NCCH::FSInfo{.offset = offset, .size = length, .hashRegionSize = 0, .encryptionInfo = std::nullopt});
+			}
+		}
+	}
+
+	// Every partition of the output is decrypted, so they all get the NoCrypto flag set in their header to load as plain NCCHs
+	std::vector<DecryptedRange> ranges;
+	std::vector<u64> flagPatches;
+	std::vector<NCCH> ncchs(partitions.size());
+
+	for (usize i = 0; i < partitions.size(); i++) {
+		ncchs[i].partitionIndex = i;
+		ncchs[i].fileOffset = partitions[i].offset;
+
+		if (!collectEncryptedRanges(aesEngine, inputFile, ncchs[i], partitions[i], i, ranges)) {
+			printf("Failed to parse NCCH partition %zu\n", i);
+			return false;
+		}
+
+		flagPatches.push_back(partitions[i].offset + 0x188 + 7);
+	}
+
+	auto readImage = [&](u64 blockStart, u8* block, usize blockBytes) {
+		const u32 blockIndex = u32(blockStart / blockSize);
+		const u64 blockEnd = blockStart + blockBytes;
+
+		inputFile.seek(blockStart);
+		auto [readSuccess, bytes] = inputFile.readBytes(block, blockBytes);
+		if (!readSuccess || bytes != blockBytes) {
+			printf("Failed to read block %u of the input image\n", blockIndex);
+			return false;
+		}
+
+		for (auto& range : ranges) {
+			const u64 start = std::max(range.start, blockStart);
+			const u64 end = std::min(range.start + range.size, blockEnd);
+
+			if (start < end) {
+				const u64 infoOffset = range.infoOffset + (start - range.start);
+				auto [decryptSuccess, decrypted] =
+					ncchs[range.partition].readFromFile(inputFile, range.info, &block[start - blockStart], infoOffset, end - start);
+
+				if (!decryptSuccess || decrypted != end - start) {
+					printf("Failed to decrypt block %u of the input image\n", blockIndex);
+					return false;
+				}
+			}
+		}
+
+		for (u64 patch : flagPatches) {
+			if (patch >= blockStart && patch < blockEnd) {
+				block[patch - blockStart] |= 0x4;  // NoCrypto
+			}
+		}
+
+		return true;
+	};
+
+	return write(output, *imageSize, blockSize, readImage);
+}
+
+bool CompressedROM::write(const std::filesystem::path& output, u64 imageSize, u32 blockSize, const ImageReader& readImage) {
+	if (blockSize == 0 || blockSize > maxBlockSize) {
+		return false;
+	}
+
+	IOFile outputFile;
+	if (!outputFile.open(output, "wb")) {
+		printf("Failed to open %s for writing\n", output.string().c_str());
+		return false;
+	}
+
+	Header outHeader{};
+	outHeader.magic = magic;
+	outHeader.version = version;
+	outHeader.blockSize = blockSize;
+	outHeader.imageSize = imageSize;
+	outHeader.blockCount = u32((imageSize + blockSize - 1) / blockSize);
+
+	// Reserve space for the header and index, which we fill in at the end once the block offsets are known
+	std::vector<BlockEntry> index(outHeader.blockCount);
+	u64 outOffset = sizeof(Header) + index.size() * sizeof(BlockEntry);
+	outputFile.seek(outOffset);
+
+	std::vector<u8> block(blockSize);
+	std::vector<u8> compressed;
+	bool success = true;
+
+	for (u32 i = 0; i < outHeader.blockCount && success; i++) {
+		const u64 blockStart = u64(i) * blockSize;
+		const usize blockBytes = usize(std::min<u64>(blockSize, imageSize - blockStart));
+
+		if (!readImage(blockStart, block.data(), blockBytes)) {
+			success = false;
+			break;
+		}
+
+		compressed.clear();
+		CryptoPP::Deflator deflator(new CryptoPP::VectorSink(compressed), CryptoPP::Deflator::MAX_DEFLATE_LEVEL);
+		deflator.Put(block.data(), blockBytes);
+		deflator.MessageEnd();
+
+		BlockEntry& entry = index[i];
+		entry.offset = outOffset;
+		entry.checksum = XXH3_64bits(block.data(), blockBytes);
+
+		// Store blocks that don't compress as-is, so that reading them is just a copy
+		const u8* data = compressed.data();
+		if (compressed.size() >= blockBytes) {
+			entry.flags = BlockEntry::StoredRaw;
+			entry.storedSize = u32(blockBytes);
+			data = block.data();
+		} else {
+			entry.flags = 0;
+			entry.storedSize = u32(compressed.size());
+		}
+
+		auto [writeSuccess, written] = outputFile.writeBytes(data, entry.storedSize);
+		success = writeSuccess && written == entry.storedSize;
+		outOffset += entry.storedSize;
+	}
+
+	if (success) {
+		outputFile.seek(0);
+		auto [headerSuccess, headerBytes] = outputFile.writeBytes(&outHeader, sizeof(outHeader));
+		auto [indexSuccess, indexCount] = outputFile.write(index.data(), index.size(), sizeof(BlockEntry));
+		success = headerSuccess && headerBytes == sizeof(outHeader) && indexSuccess && indexCount == index.size();
+	}
+
+	outputFile.close();
+	if (!success) {
+		printf("Failed to write %s\n", output.string().c_str());
+		std::error_code ec;
+		std::filesystem::remove(output, ec);
+	}
+
+	return success;
+}
@@ -8,14 +8,11 @@
 #include <iostream>
 #include <vector>
 
+#include "PICA/pica_hash.hpp"
 #include "loader/lz77.hpp"
 #include "memory.hpp"
 
-bool NCCH::loadFromHeader(Crypto::AESEngine &aesEngine, IOFile& file, const FSInfo &info) {
-    // 0x200 bytes for the NCCH header
-    constexpr u64 headerSize = 0x200;
-    u8 header[headerSize];
-
+bool NCCH::readHeader(Crypto::AESEngine &aesEngine, ROMFile& file, const FSInfo &info, u8* header, bool& gotCryptoKeys) {
     auto [success, bytes] = readFromFile(file, info, header, 0, headerSize);
     if (!success || bytes != headerSize) {
         printf("Failed to read NCCH header\n");
@@ -64,7 +61,7 @@ bool NCCH::loadFromHeader(Crypto::AESEngine &aesEngine, IOFile& file, const FSIn
 	romFS.encryptionInfo = std::nullopt;
 
 	// Shows whether we got the primary and secondary keys correctly
-	bool gotCryptoKeys = true;
+	gotCryptoKeys = true;
 	if (encrypted) {
 		Crypto::AESKey primaryKeyY;
 		Crypto::AESKey secondaryKeyY;
@@ -123,6 +120,110 @@ bool NCCH::loadFromHeader(Crypto::AESEngine &aesEngine, IOFile& file, const FSIn
 		}
 	}
 
+	return true;
+}
+
+bool NCCH::loadFromHeader(Crypto::AESEngine &aesEngine, ROMFile& file, const FSInfo &info, BootCache* bootCache) {
+	u8 header[headerSize];
+	bool gotCryptoKeys;
+	if (!readHeader(aesEngine, file, info, header, gotCryptoKeys)) {
+		return false;
+	}
+
+	// Fetching the exheader and ExeFS from the boot cache skips decrypting them and decompressing the code. For encrypted titles we still need
+	// the keys, since RomFS is decrypted on the fly. The header contains hashes of the exheader and ExeFS, so hashing it identifies their contents
+	const u64 headerHash = PICAHash::computeHash((const char*)header, headerSize);
+	const bool useBootCache = bootCache != nullptr && (!encrypted || gotCryptoKeys);
+
+	if (useBootCache && bootCache->load(*this, headerHash)) {
+		// The cache entry remembers whether the title only pretended to be encrypted
+		if (!encrypted) {
+			exheaderInfo.encryptionInfo = std::nullopt;
+			romFS.encryptionInfo = std::nullopt;
+			exeFS.encryptionInfo = std::nullopt;
+		}
+
+		printf("Loaded exheader and ExeFS from the boot cache\n");
+	} else {
+		if (!loadExheaderAndExeFS(aesEngine, file, info, gotCryptoKeys)) {
+			return false;
+		}
+
+		if (useBootCache) {
+			bootCache->store(*this, headerHash);
+		}
+	}
+
+	// If no region has been detected for CXI, set the region to USA by default
+	if (!region.has_value() && partitionIndex == 0) {
+		printf("No region detected for CXI, defaulting to USA\n");
+		region = Regions::USA;
+	}
+
+	if (hasRomFS()) {
+		printf("RomFS offset: %08llX, size: %08llX\n", romFS.offset, romFS.size);
+	}
+
+	initialized = true;
+	return true;
+}
+
+bool NCCH::loadMetadata(Crypto::AESEngine& aesEngine, ROMFile& file, const FSInfo& info) {
+	u8 header[headerSize];
+	bool gotCryptoKeys;
+	if (!readHeader(aesEngine, file, info, header, gotCryptoKeys)) {
+		return false;
+	}
+
+	// Same check for titles pretending to be encrypted as in loadExheaderAndExeFS, but only reading the bytes we need
+	if (encrypted && hasExtendedHeader()) {
+		u64 jumpID = 0;
+		auto [success, bytes] = readFromFile(file, info, (u8*)&jumpID, 0x200 + 0x1C0 + 0x8, sizeof(jumpID));
+
+		if (success && bytes == sizeof(jumpID) && u32(programID) == u32(jumpID)) {
+			encrypted = false;
+			exheaderInfo.encryptionInfo = std::nullopt;
+			romFS.encryptionInfo = std::nullopt;
+			exeFS.encryptionInfo = std::nullopt;
+		}
+	}
+
+	// Without keys we can't decrypt the SMDH, but the title ID is still useful
+	if (!hasExeFS() || (encrypted && !gotCryptoKeys)) {
+		return true;
+	}
+
+	constexpr size_t exeFSHeaderSize = 0x200;
+	u8 exeFSHeader[exeFSHeaderSize];
+
+	auto [success, bytes] = readFromFile(file, exeFS, exeFSHeader, 0, exeFSHeaderSize);
+	if (!success || bytes != exeFSHeaderSize) {
+		return false;
+	}
+
+	for (int i = 0; i < 10; i++) {
+		const u8* fileInfo = &exeFSHeader[i * 16];
+		const u32 fileOffset = *(u32*)&fileInfo[0x8];
+		const u32 fileSize = *(u32*)&fileInfo[0xC];
+
+		if (std::memcmp(fileInfo, "icon\0\0\0\0", 8) == 0) {
+			smdh.resize(fileSize);
+			std::tie(success, bytes) = readFromFile(file, exeFS, smdh.data(), fileOffset + exeFSHeaderSize, fileSize);
+
+			if (!success || bytes != fileSize) {
+				smdh.clear();
+				return false;
+			}
+
+			parseSMDH(smdh);
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool NCCH::loadExheaderAndExeFS(Crypto::AESEngine& aesEngine, ROMFile& file, const FSInfo& info, bool gotCryptoKeys) {
 	if (exheaderSize != 0) {
 		std::unique_ptr<u8[]> exheader(new u8[exheaderSize]);
 
@@ -259,17 +360,6 @@ bool NCCH::loadFromHeader(Crypto::AESEngine &aesEngine, IOFile& file, const FSIn
 		}
 	}
 
-	// If no region has been detected for CXI, set the region to USA by default
-	if (!region.has_value() && partitionIndex == 0) {
-		printf("No region detected for CXI, defaulting to USA\n");
-		region = Regions::USA;
-	}
-
-	if (hasRomFS()) {
-		printf("RomFS offset: %08llX, size: %08llX\n", romFS.offset, romFS.size);
-	}
-
-	initialized = true;
 	return true;
 }
 
@@ -385,11 +475,58 @@ std::pair<bool, Crypto::AESKey> NCCH::getSecondaryKey(Crypto::AESEngine &aesEngi
 	return {true, result};
 }
 
-std::pair<bool, std::size_t> NCCH::readFromFile(IOFile& file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size) {
+std::pair<bool, std::size_t> NCCH::readFromFile(ROMFile& file, const FSInfo &info, u8 *dst, std::size_t offset, std::size_t size) {
 	if (size == 0) {
 		return { true, 0 };
 	}
 
+	if (info.encryptionInfo.has_value() && decryptedBlockCache != nullptr) {
+		return readCachedBlocks(file, info, dst, offset, size);
+	} else {
+		return readAndDecrypt(file, info, dst, offset, size);
+	}
+}
+
+std::pair<bool, std::size_t> NCCH::readCachedBlocks(ROMFile& file, const FSInfo& info, u8* dst, std::size_t offset, std::size_t size) {
+	constexpr std::size_t blockSize = SharedCaches::decryptedBlockSize;
+	const auto& encryptionInfo = info.encryptionInfo.value();
+
+	if (offset >= info.size) {
+		return { true, 0 };
+	}
+
+	const std::size_t readMaxSize = std::min(size, static_cast<std::size_t>(info.size) - offset);
+	std::size_t bytesRead = 0;
+
+	while (bytesRead < readMaxSize) {
+		const std::size_t position = offset + bytesRead;
+		const std::size_t blockStart = position & ~(blockSize - 1);
+		const DecryptedBlockKey key = {encryptionInfo.normalKey, encryptionInfo.initialCounter, blockStart};
+
+		auto block = decryptedBlockCache->find(key);
+		if (!block) {
+			const std::size_t blockBytes = std::min(blockSize, static_cast<std::size_t>(info.size) - blockStart);
+			auto newBlock = std::make_shared<std::vector<u8>>(blockBytes);
+
+			auto [success, bytes] = readAndDecrypt(file, info, newBlock->data(), blockStart, blockBytes);
+			if (!success || bytes != blockBytes) {
+				return { false, bytesRead };
+			}
+
+			block = decryptedBlockCache->insert(key, std::move(newBlock), blockBytes);
+		}
+
+		const std::size_t blockOffset = position - blockStart;
+		const std::size_t copySize = std::min(block->size() - blockOffset, readMaxSize - bytesRead);
+		std::memcpy(dst + bytesRead, block->data() + blockOffset, copySize);
+		bytesRead += copySize;
+	}
+
+	return { true, bytesRead };
+}
+
+std::pair<bool, std::size_t> NCCH::readAndDecrypt(ROMFile& file, const FSInfo& info, u8* dst, std::size_t offset, std::size_t size) {
+
 	std::size_t readMaxSize = std::min(size, static_cast<std::size_t>(info.size) - offset);
 
 	file.seek(info.offset + offset);
@@ -75,15 +75,19 @@ bool Memory::mapCXI(NCSD& ncsd, NCCH& cxi) {
 
 	ncsd.entrypoint = cxi.text.address;
 
-	// Back the IOFile for accessing the ROM, as well as the ROM's CXI partition, in the memory class.
+	// Back the ROMFile for accessing the ROM, as well as the ROM's CXI partition, in the memory class.
 	CXIFile = ncsd.file;
 	loadedCXI = cxi;
 	return true;
 }
 
-std::optional<NCSD> Memory::loadNCSD(Crypto::AESEngine& aesEngine, const std::filesystem::path& path) {
+std::optional<NCSD> Memory::loadNCSD(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, BootCache* bootCache) {
+	if (bootCache != nullptr) {
+		bootCache->setROM(path);
+	}
+
 	NCSD ncsd;
-	if (!ncsd.file.open(path, "rb")) {
+	if (!ncsd.file.open(path)) {
 		return std::nullopt;
 	}
 
@@ -135,7 +139,7 @@ std::optional<NCSD> Memory::loadNCSD(Crypto::AESEngine& aesEngine, const std::fi
 			ncchFsInfo.offset = partition.offset;
 			ncchFsInfo.size = partition.length;
 
-			if (!ncch.loadFromHeader(aesEngine, ncsd.file, ncchFsInfo)) {
+			if (!ncch.loadFromHeader(aesEngine, ncsd.file, ncchFsInfo, bootCache)) {
 				printf("Invalid NCCH partition\n");
 				return std::nullopt;
 			}
@@ -158,9 +162,13 @@ std::optional<NCSD> Memory::loadNCSD(Crypto::AESEngine& aesEngine, const std::fi
 
 // We are lazy so we take CXI files, easily "convert" them to NCSD internally, then use our existing NCSD infrastructure
 // This is easy because NCSD is just CXI + some more NCCH partitions, which we can make empty when converting to NCSD
-std::optional<NCSD> Memory::loadCXI(Crypto::AESEngine& aesEngine, const std::filesystem::path& path) {
+std::optional<NCSD> Memory::loadCXI(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, BootCache* bootCache) {
+	if (bootCache != nullptr) {
+		bootCache->setROM(path);
+	}
+
 	NCSD ncsd;
-	if (!ncsd.file.open(path, "rb")) {
+	if (!ncsd.file.open(path)) {
 		return std::nullopt;
 	}
 
@@ -188,7 +196,7 @@ std::optional<NCSD> Memory::loadCXI(Crypto::AESEngine& aesEngine, const std::fil
 	cxiPartition.length = size.value();
 	NCCH::FSInfo cxiInfo{.offset = cxiPartition.offset, .size = cxiPartition.length, .hashRegionSize = 0, .encryptionInfo = std::nullopt};
 
-	if (!cxi.loadFromHeader(aesEngine, ncsd.file, cxiInfo)) {
+	if (!cxi.loadFromHeader(aesEngine, ncsd.file, cxiInfo, bootCache)) {
 		printf("Invalid CXI partition\n");
 		return std::nullopt;
 	}
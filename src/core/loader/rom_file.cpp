@@ -0,0 +1,66 @@
+#include "loader/rom_file.hpp"
+
+#include "loader/compressed_rom.hpp"
+
+bool ROMFile::open(const std::filesystem::path& path) {
+	compressed = nullptr;
+	position = 0;
+
+	if (!file.open(path, "rb")) {
+		return false;
+	}
+
+	if (CompressedROM::isCompressedROM(file)) {
+		file.close();
+
+		auto rom = std::make_shared<CompressedROM>();
+		if (!rom->open(path)) {
+			return false;
+		}
+
+		compressed = std::move(rom);
+	}
+
+	return true;
+}
+
+bool ROMFile::isOpen() { return compressed != nullptr || file.isOpen(); }
+
+void ROMFile::close() {
+	// Other copies may still be using the compressed image, so just drop our reference to it
+	if (compressed) {
+		compressed = nullptr;
+	} else {
+		file.close();
+	}
+}
+
+std::pair<bool, std::size_t> ROMFile::read(void* data, std::size_t length, std::size_t dataSize) {
+	if (!compressed) {
+		return file.read(data, length, dataSize);
+	}
+
+	// Like fread, return the number of whole elements read
+	auto [success, bytes] = compressed->read(position, static_cast<u8*>(data), length * dataSize);
+	position += bytes;
+	return {success, dataSize == 0 ? 0 : bytes / dataSize};
+}
+
+std::pair<bool, std::size_t> ROMFile::readBytes(void* data, std::size_t count) { return read(data, count, sizeof(u8)); }
+
+bool ROMFile::seek(u64 offset) {
+	if (!compressed) {
+		return file.seek(s64(offset));
+	}
+
+	position = offset;
+	return true;
+}
+
+std::optional<u64> ROMFile::size() {
+	if (!compressed) {
+		return file.size();
+	}
+
+	return compressed->size();
+}
@@ -0,0 +1,332 @@
+#include "loader/title_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include "io_file.hpp"
+#include "loader/ncch.hpp"
+#include "loader/ncsd.hpp"
+#include "loader/rom_file.hpp"
+
+bool TitleIndex::isROMExtension(const std::filesystem::path& extension) {
+	static constexpr const char* extensions[] = {".3ds", ".cci", ".cxi", ".app", ".ncch", ".zcci", ".zcxi"};
+	// Dumps often come with uppercase extensions, eg from FAT32 SD cards
+	std::string ext = extension.string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	return std::any_of(std::begin(extensions), std::end(extensions), [&](const char* e) { return ext == e; });
+}
+
+std::string TitleIndex::getKey(const std::filesystem::path& path) {
+	const std::u8string utf8 = path.u8string();
+	return std::string(utf8.begin(), utf8.end());
+}
+
+TitleInfo TitleIndex::readTitleInfo(Crypto::AESEngine& aesEngine, const std::filesystem::path& path, u64 fileSize, s64 timestamp) {
+	TitleInfo info;
+	info.path = path;
+	info.fileSize = fileSize;
+	info.timestamp = timestamp;
+
+	ROMFile file;
+	if (!file.open(path)) {
+		return info;
+	}
+
+	// CCIs start with an NCSD header, which points to the CXI in partition 0. CXIs start with the NCCH header directly
+	u8 magic[4];
+	file.seek(0x100);
+	auto [success, bytes] = file.readBytes(magic, sizeof(magic));
+	const std::optional<u64> imageSize = file.size();
+
+	if (!success || bytes != sizeof(magic) || !imageSize.has_value()) {
+		file.close();
+		return info;
+	}
+
+	NCCH::FSInfo partition{.offset = 0, .size = *imageSize, .hashRegionSize = 0, .encryptionInfo = std::nullopt};
+	if (std::memcmp(magic, "NCSD", 4) == 0) {
+		u32 partitionData[2];
+		file.seek(0x120);
+		std::tie(success, bytes) = file.read(partitionData, 2, sizeof(u32));
+
+		if (!success || bytes != 2) {
+			file.close();
+			return info;
+		}
+
+		partition.offset = u64(partitionData[0]) * NCSD::mediaUnit;
+		partition.size = u64(partitionData[1]) * NCSD::mediaUnit;
+	} else if (std::memcmp(magic, "NCCH", 4) != 0) {
+		file.close();
+		return info;
+	}
+
+	NCCH ncch;
+	ncch.fileOffset = partition.offset;
+	if (ncch.loadMetadata(aesEngine, file, partition)) {
+		info.valid = true;
+		info.encrypted = ncch.encrypted;
+		info.programID = ncch.programID;
+		info.region = ncch.region;
+		info.smdh = std::move(ncch.smdh);
+	}
+
+	file.close();
+	return info;
+}
+
+usize TitleIndex::scan(const std::vector<std::filesystem::path>& directories, const Crypto::AESEngine& aesEngine, unsigned threadCount) {
+	struct Candidate {
+		std::filesystem::path path;
+		u64 size;
+		s64 timestamp;
+	};
+
+	// Walk the directories first, which is cheap compared to parsing, and figure out which files are new or changed
+	std::vector<Candidate> candidates;
+	std::unordered_map<std::string, TitleInfo> newTitles;
+
+	{
+		std::scoped_lock lock(mutex);
+
+		for (const auto& directory : directories) {
+			std::error_code ec;
+			auto it = std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec);
+
+			for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+				const auto& entry = *it;
+				std::error_code entryError;
+
+				if (!entry.is_regular_file(entryError) || entryError || !isROMExtension(entry.path().extension())) {
+					continue;
+				}
+
+				const u64 size = u64(entry.file_size(entryError));
+				const s64 timestamp = s64(entry.last_write_time(entryError).time_since_epoch().count());
+				if (entryError) {
+					continue;
+				}
+
+				const std::string key = getKey(entry.path());
+				if (auto existing = titles.find(key); existing != titles.end() && existing->second.fileSize == size &&
+													   existing->second.timestamp == timestamp) {
+					newTitles[key] = existing->second;
+				} else {
+					candidates.push_back({entry.path(), size, timestamp});
+				}
+			}
+		}
+	}
+
+	// Parse the new files in parallel. Every worker gets its own copy of the AES engine, since deriving keys modifies key slots.
+	// Load the seed DB up front so that workers don't all hit the file
+	Crypto::AESEngine baseEngine = aesEngine;
+	baseEngine.loadSeeds();
+
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min<unsigned>(threadCount, unsigned(std::max<usize>(1, candidates.size())));
+
+	std::vector<TitleInfo> results(candidates.size());
+	std::atomic<usize> nextCandidate = 0;
+
+	auto worker = [&]() {
+		Crypto::AESEngine engine = baseEngine;
+
+		for (usize i = nextCandidate++; i < candidates.size(); i = nextCandidate++) {
+			const Candidate& candidate = candidates[i];
+			results[i] = readTitleInfo(engine, candidate.path, candidate.size, candidate.timestamp);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < threadCount; i++) {
+		threads.emplace_back(worker);
+	}
+
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (auto& title : results) {
+		newTitles[getKey(title.path)] = std::move(title);
+	}
+
+	// Replace the whole index, which also drops files that are gone
+	std::scoped_lock lock(mutex);
+	titles = std::move(newTitles);
+	return candidates.size();
+}
+
+std::vector<TitleInfo> TitleIndex::getTitles() const {
+	std::vector<TitleInfo> result;
+
+	{
+		std::scoped_lock lock(mutex);
+		for (const auto& [key, title] : titles) {
+			if (title.valid) {
+				result.push_back(title);
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [](const TitleInfo& a, const TitleInfo& b) { return a.path < b.path; });
+	return result;
+}
+
+std::optional<TitleInfo> TitleIndex::find(const std::filesystem::path& path) const {
+	std::scoped_lock lock(mutex);
+	if (auto it = titles.find(getKey(path)); it != titles.end()) {
+		return it->second;
+	}
+
+	return std::nullopt;
+}
+
+namespace {
+	// Serialized form of the fixed-size fields of a TitleInfo. The path and SMDH follow it in the index file
+	struct IndexEntry {
+		u64 fileSize;
+		s64 timestamp;
+		u64 programID;
+		u32 region;  // noRegion if the title has no region
+		u32 pathSize;
+		u32 smdhSize;
+		u8 valid;
+		u8 encrypted;
+		u8 padding[2];
+	};
+
+	constexpr u32 noRegion = 0xFFFFFFFF;
+}  // namespace
+
+bool TitleIndex::load(const std::filesystem::path& indexPath) {
+	IOFile file;
+	if (!file.open(indexPath, "rb")) {
+		return false;
+	}
+
+	std::unordered_map<std::string, TitleInfo> loadedTitles;
+	u32 header[3];  // Magic, version, entry count
+	auto [success, count] = file.read(header, 3, sizeof(u32));
+	bool valid = success && count == 3 && header[0] == magic && header[1] == version;
+
+	// Sizes in the index come from the file, so check them against what's left of it before allocating anything
+	u64 remaining = file.size().value_or(0);
+	remaining = (remaining >= sizeof(header)) ? remaining - sizeof(header) : 0;
+
+	for (u32 i = 0; valid && i < header[2]; i++) {
+		IndexEntry entry;
+		auto [entrySuccess, entryBytes] = file.readBytes(&entry, sizeof(entry));
+		if (!entrySuccess || entryBytes != sizeof(entry) || remaining < sizeof(entry)) {
+			valid = false;
+			break;
+		}
+
+		remaining -= sizeof(entry);
+		if (u64(entry.pathSize) + entry.smdhSize > remaining) {
+			valid = false;
+			break;
+		}
+
+		remaining -= u64(entry.pathSize) + entry.smdhSize;
+
+		std::string path(entry.pathSize, '\0');
+		TitleInfo title;
+		title.smdh.resize(entry.smdhSize);
+
+		auto [pathSuccess, pathBytes] = file.readBytes(path.data(), path.size());
+		auto [smdhSuccess, smdhBytes] = file.readBytes(title.smdh.data(), title.smdh.size());
+		if (!pathSuccess || pathBytes != path.size() || !smdhSuccess || smdhBytes != title.smdh.size()) {
+			valid = false;
+			break;
+		}
+
+		title.path = std::filesystem::path(std::u8string(path.begin(), path.end()));
+		title.fileSize = entry.fileSize;
+		title.timestamp = entry.timestamp;
+		title.programID = entry.programID;
+		title.valid = entry.valid != 0;
+		title.encrypted = entry.encrypted != 0;
+		if (entry.region != noRegion) {
+			title.region = static_cast<Regions>(entry.region);
+		}
+
+		loadedTitles[std::move(path)] = std::move(title);
+	}
+
+	file.close();
+	if (!valid) {
+		Helpers::warn("Title index %s is invalid, ignoring it", indexPath.string().c_str());
+		return false;
+	}
+
+	std::scoped_lock lock(mutex);
+	titles = std::move(loadedTitles);
+	return true;
+}
+
+bool TitleIndex::save(const std::filesystem::path& indexPath) const {
+	std::error_code ec;
+	if (indexPath.has_parent_path()) {
+		std::filesystem::create_directories(indexPath.parent_path(), ec);
+	}
+
+	// Write to a temporary file and rename it over the old index, so that a crash mid-save doesn't lose the index
+	std::filesystem::path tmpPath = indexPath;
+	tmpPath += ".tmp";
+
+	IOFile file;
+	if (!file.open(tmpPath, "wb")) {
+		return false;
+	}
+
+	auto writeAll = [&file](const void* data, std::size_t size) {
+		auto [success, bytes] = file.writeBytes(data, size);
+		return success && bytes == size;
+	};
+
+	bool success;
+	{
+		std::scoped_lock lock(mutex);
+		const u32 header[3] = {magic, version, u32(titles.size())};
+		success = writeAll(header, sizeof(header));
+
+		for (const auto& [path, title] : titles) {
+			if (!success) {
+				break;
+			}
+
+			IndexEntry entry{};
+			entry.fileSize = title.fileSize;
+			entry.timestamp = title.timestamp;
+			entry.programID = title.programID;
+			entry.region = title.region.has_value() ? static_cast<u32>(*title.region) : noRegion;
+			entry.pathSize = u32(path.size());
+			entry.smdhSize = u32(title.smdh.size());
+			entry.valid = title.valid ? 1 : 0;
+			entry.encrypted = title.encrypted ? 1 : 0;
+
+			success = writeAll(&entry, sizeof(entry)) && writeAll(path.data(), path.size()) && writeAll(title.smdh.data(), title.smdh.size());
+		}
+	}
+
+	file.close();
+	if (success) {
+		std::filesystem::rename(tmpPath, indexPath, ec);
+		success = !ec;
+	}
+
+	if (!success) {
+		std::filesystem::remove(tmpPath, ec);
+	}
+
+	return success;
+}
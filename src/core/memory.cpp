@@ -3,11 +3,13 @@
 #include <cassert>
 #include <chrono>  // For time since epoch
 #include <cmrc/cmrc.hpp>
+#include <cstring>
 #include <ctime>
 
 #include "config_mem.hpp"
 #include "kernel/fcram.hpp"
 #include "resource_limits.hpp"
+#include "scheduler.hpp"
 #include "services/fonts.hpp"
 #include "services/ptm.hpp"
 
@@ -15,24 +17,28 @@ CMRC_DECLARE(ConsoleFonts);
 
 using namespace KernelMemoryTypes;
 
+const Memory::PageEntry Memory::unmappedPage = {0, 0, 0};
+
 Memory::Memory(KFcram& fcramManager, const EmulatorConfig& config) : fcramManager(fcramManager), config(config) {
 	const bool fastmemEnabled = config.fastmemEnabled;
 	arena = new Common::HostMemory(FASTMEM_BACKING_SIZE, FASTMEM_VIRTUAL_SIZE, fastmemEnabled);
 
-	readTable.resize(totalPageCount, 0);
-	writeTable.resize(totalPageCount, 0);
-	paddrTable.resize(totalPageCount, 0);
-
 	fcram = arena->BackingBasePointer() + FASTMEM_FCRAM_OFFSET;
 	dspRam = arena->BackingBasePointer() + FASTMEM_DSP_RAM_OFFSET;
+	vram = arena->BackingBasePointer() + FASTMEM_VRAM_OFFSET;
 	useFastmem = fastmemEnabled && arena->VirtualBasePointer() != nullptr;
+
+	if (!useFastmem) {
+		cpuPageTable = std::make_unique<CPUPageTable>();
+		cpuPageTable->fill(nullptr);
+	}
 }
 
 void Memory::reset() {
 	// Mark the entire process address space as free
 	constexpr static int MAX_USER_PAGES = 0x40000000 >> 12;
 	memoryInfo.clear();
-	memoryInfo.push_back(MemoryInfo(0, MAX_USER_PAGES, 0, KernelMemoryTypes::Free));
+	memoryInfo.emplace(0, MemoryInfo(0, MAX_USER_PAGES, 0, KernelMemoryTypes::Free));
 
 	// TODO: remove this, only needed to make the subsequent allocations work for now
 	fcramManager.reset(FCRAM_SIZE, FCRAM_APPLICATION_SIZE, FCRAM_SYSTEM_SIZE, FCRAM_BASE_SIZE);
@@ -42,10 +48,23 @@ void Memory::reset() {
 		arena->Unmap(0, 4_GB, false);
 	}
 
-	for (u32 i = 0; i < totalPageCount; i++) {
-		readTable[i] = 0;
-		writeTable[i] = 0;
-		paddrTable[i] = 0;
+	// Free the page table leaves that were populated. Untouched parts of the address space don't cost us anything
+	for (auto& leaf : pageDirectory) {
+		if (leaf != nullptr) {
+			leaf.reset();
+		}
+	}
+
+	if (cpuPageTable) {
+		cpuPageTable->fill(nullptr);
+	}
+
+	watchedVRAMWrites.reset();
+	watchedVRAMReads.reset();
+
+	// Everything got unmapped. Write watches stay armed, and pick up the write pointers of their pages when they get mapped again
+	for (auto& [page, watch] : watchedPages) {
+		watch.write = 0;
 	}
 
 	// Allocate 512 bytes of TLS for each thread. Since the smallest allocatable unit is 4 KB, that means allocating one page for every 8 threads
@@ -77,8 +96,13 @@ void Memory::reset() {
 	changeMemoryState(vaddr, dspRamPages, op);
 	mapPhysicalMemory(vaddr, paddr, dspRamPages, true, true, false);
 
-	// Allocate RW mapping for DSP RAM
-	// addFastmemView(VirtualAddrs::DSPMemStart, FASTMEM_DSP_RAM_OFFSET, DSP_RAM_SIZE, true, false);
+	// Map VRAM as R/W at [0x1F000000, 0x1F5FFFFF]. It shares the fastmem backing with FCRAM and DSP RAM, so CPU accesses to it
+	// don't need to go through the slow path
+	vaddr = VirtualAddrs::VramStart;
+	paddr = PhysicalAddrs::VRAM;
+
+	changeMemoryState(vaddr, VRAM_PAGE_COUNT, op);
+	mapPhysicalMemory(vaddr, paddr, VRAM_PAGE_COUNT, true, true, false);
 
 	// Later adjusted based on ROM header when possible
 	region = Regions::USA;
@@ -95,9 +119,11 @@ u8 Memory::read8(u32 vaddr) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = readTable[page];
+	uintptr_t pointer = lookupPage(page).read;
 	if (pointer != 0) [[likely]] {
 		return *(u8*)(pointer + offset);
+	} else if (u8 value; readWatchedVRAM(vaddr, value)) {
+		return value;
 	} else {
 		switch (vaddr) {
 			case ConfigMem::BatteryState: {
@@ -143,9 +169,11 @@ u16 Memory::read16(u32 vaddr) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = readTable[page];
+	uintptr_t pointer = lookupPage(page).read;
 	if (pointer != 0) [[likely]] {
 		return *(u16*)(pointer + offset);
+	} else if (u16 value; readWatchedVRAM(vaddr, value)) {
+		return value;
 	} else {
 		switch (vaddr) {
 			case ConfigMem::WifiMac + 4: return (MACAddress[5] << 8) | MACAddress[4];  // Wifi MAC: Last 2 bytes of MAC Address
@@ -158,9 +186,11 @@ u32 Memory::read32(u32 vaddr) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = readTable[page];
+	uintptr_t pointer = lookupPage(page).read;
 	if (pointer != 0) [[likely]] {
 		return *(u32*)(pointer + offset);
+	} else if (u32 value; readWatchedVRAM(vaddr, value)) {
+		return value;
 	} else {
 		switch (vaddr) {
 			case 0x1FF80000: return u32(kernelVersion) << 16;
@@ -188,17 +218,6 @@ u32 Memory::read32(u32 vaddr) {
 				return u32(read8(vaddr)) | (u32(read8(vaddr + 1)) << 8) | (u32(read8(vaddr + 2)) << 16) | (u32(read8(vaddr + 3)) << 24);
 
 			default:
-				if (vaddr >= VirtualAddrs::VramStart && vaddr < VirtualAddrs::VramStart + VirtualAddrs::VramSize) {
-					static int shutUpCounter = 0;
-					if (shutUpCounter < 5) {  // Stop spamming about VRAM reads after the first 5
-						shutUpCounter++;
-						Helpers::warn("VRAM read!\n");
-					}
-
-					// TODO: Properly handle framebuffer readbacks and the like
-					return *(u32*)&vram[vaddr - VirtualAddrs::VramStart];
-				}
-
 				Helpers::panic("Unimplemented 32-bit read, addr: %08X", vaddr);
 				break;
 		}
@@ -215,19 +234,11 @@ void Memory::write8(u32 vaddr, u8 value) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = writeTable[page];
+	uintptr_t pointer = lookupPage(page).write;
 	if (pointer != 0) [[likely]] {
 		*(u8*)(pointer + offset) = value;
-	} else {
-		// VRAM write
-		if (vaddr >= VirtualAddrs::VramStart && vaddr < VirtualAddrs::VramStart + VirtualAddrs::VramSize) {
-			// TODO: Invalidate renderer caches here
-			vram[vaddr - VirtualAddrs::VramStart] = value;
-		}
-
-		else {
-			Helpers::panic("Unimplemented 8-bit write, addr: %08X, val: %02X", vaddr, value);
-		}
+	} else if (!writeWatchedPage(vaddr, value) && !writeWatchedVRAM(vaddr, value)) {
+		Helpers::panic("Unimplemented 8-bit write, addr: %08X, val: %02X", vaddr, value);
 	}
 }
 
@@ -235,10 +246,10 @@ void Memory::write16(u32 vaddr, u16 value) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = writeTable[page];
+	uintptr_t pointer = lookupPage(page).write;
 	if (pointer != 0) [[likely]] {
 		*(u16*)(pointer + offset) = value;
-	} else {
+	} else if (!writeWatchedPage(vaddr, value) && !writeWatchedVRAM(vaddr, value)) {
 		Helpers::panic("Unimplemented 16-bit write, addr: %08X, val: %08X", vaddr, value);
 	}
 }
@@ -247,14 +258,237 @@ void Memory::write32(u32 vaddr, u32 value) {
 	const u32 page = vaddr >> pageShift;
 	const u32 offset = vaddr & pageMask;
 
-	uintptr_t pointer = writeTable[page];
+	uintptr_t pointer = lookupPage(page).write;
 	if (pointer != 0) [[likely]] {
 		*(u32*)(pointer + offset) = value;
-	} else {
+	} else if (!writeWatchedPage(vaddr, value) && !writeWatchedVRAM(vaddr, value)) {
 		Helpers::panic("Unimplemented 32-bit write, addr: %08X, val: %08X", vaddr, value);
 	}
 }
 
+template <typename T>
+bool Memory::readWatchedVRAM(u32 vaddr, T& value) {
+	const u32 offset = vaddr - VirtualAddrs::VramStart;
+	if (offset >= VRAM_SIZE || VRAM_SIZE - offset < sizeof(T)) [[unlikely]] {
+		return false;
+	}
+
+	// Let the renderer write back any data it's holding for this memory before we read it
+	if (vramAccessCallback) {
+		vramAccessCallback(PhysicalAddrs::VRAM + offset, sizeof(T), false);
+	}
+
+	std::memcpy(&value, &vram[offset], sizeof(T));
+	return true;
+}
+
+template <typename T>
+bool Memory::writeWatchedVRAM(u32 vaddr, T value) {
+	const u32 offset = vaddr - VirtualAddrs::VramStart;
+	if (offset >= VRAM_SIZE || VRAM_SIZE - offset < sizeof(T)) [[unlikely]] {
+		return false;
+	}
+
+	// Notify the renderer before the write lands, so that it can flush or drop any copy of this memory it's holding
+	if (vramAccessCallback) {
+		vramAccessCallback(PhysicalAddrs::VRAM + offset, sizeof(T), true);
+	}
+
+	std::memcpy(&vram[offset], &value, sizeof(T));
+	return true;
+}
+
+template <typename T>
+bool Memory::writeWatchedPage(u32 vaddr, T value) {
+	if (watchedPages.empty()) [[likely]] {
+		return false;
+	}
+
+	auto it = watchedPages.find(vaddr >> pageShift);
+	if (it == watchedPages.end()) {
+		return false;
+	}
+
+	// Watched VRAM pages have no write pointer, as the VRAM watch wants to see these writes too
+	const uintptr_t pointer = it->second.write;
+	if (pointer != 0) {
+		std::memcpy((void*)(pointer + (vaddr & pageMask)), &value, sizeof(T));
+	} else if (!writeWatchedVRAM(vaddr, value)) {
+		return false;
+	}
+
+	if (writeWatchCallback) {
+		writeWatchCallback(vaddr, sizeof(T), u32(value));
+	}
+
+	return true;
+}
+
+void Memory::hideWatchedPage(u32 page, WatchedPage& watch) {
+	PageEntry* entry = findPage(page);
+	watch.write = (entry != nullptr) ? entry->write : 0;
+
+	if (entry != nullptr) {
+		entry->write = 0;
+	}
+
+	if (cpuPageTable) {
+		(*cpuPageTable)[page] = nullptr;
+	}
+}
+
+void Memory::protectWatchedPages(u32 vaddr, s32 pages) {
+	if (!useFastmem || watchedPages.empty()) [[likely]] {
+		return;
+	}
+
+	const u32 firstPage = vaddr >> pageShift;
+	for (s32 i = 0; i < pages; i++) {
+		auto it = watchedPages.find(firstPage + i);
+		if (it != watchedPages.end() && it->second.write != 0) {
+			arena->Protect(usize(firstPage + i) << pageShift, pageSize, Common::MemoryPermission::Read);
+		}
+	}
+}
+
+void Memory::addWriteWatch(u32 vaddr, u32 size) {
+	if (size == 0) {
+		return;
+	}
+
+	const u32 firstPage = vaddr >> pageShift;
+	const u32 endPage = u32(std::min<u64>((u64(vaddr) + size + pageMask) >> pageShift, totalPageCount));
+
+	for (u32 page = firstPage; page < endPage; page++) {
+		WatchedPage& watch = watchedPages[page];
+		if (watch.watchCount++ != 0) {
+			continue;
+		}
+
+		hideWatchedPage(page, watch);
+		if (useFastmem && watch.write != 0) {
+			arena->Protect(usize(page) << pageShift, pageSize, Common::MemoryPermission::Read);
+		}
+	}
+}
+
+void Memory::removeWriteWatch(u32 vaddr, u32 size) {
+	if (size == 0) {
+		return;
+	}
+
+	const u32 firstPage = vaddr >> pageShift;
+	const u32 endPage = u32(std::min<u64>((u64(vaddr) + size + pageMask) >> pageShift, totalPageCount));
+
+	for (u32 page = firstPage; page < endPage; page++) {
+		auto it = watchedPages.find(page);
+		if (it == watchedPages.end() || --it->second.watchCount != 0) {
+			continue;
+		}
+
+		const uintptr_t write = it->second.write;
+		watchedPages.erase(it);
+
+		// Give the page its fast paths back if it was writable. Pages with a write pointer can't have a VRAM watch on them
+		if (write == 0) {
+			continue;
+		}
+
+		PageEntry* entry = findPage(page);
+		entry->write = write;
+
+		if (cpuPageTable && entry->read != 0) {
+			(*cpuPageTable)[page] = (u8*)write;
+		}
+
+		if (useFastmem) {
+			arena->Protect(usize(page) << pageShift, pageSize, Common::MemoryPermission::ReadWrite);
+		}
+	}
+}
+
+void Memory::watchVRAM(u32 paddr, u32 size, VRAMWatch mode) {
+	const u32 offset = paddr - PhysicalAddrs::VRAM;
+	if (size == 0 || offset >= VRAM_SIZE) {
+		return;
+	}
+
+	const u32 firstPage = offset >> pageShift;
+	const u32 endPage = std::min<u32>((u64(offset) + size + pageMask) >> pageShift, VRAM_PAGE_COUNT);
+
+	// Range of pages whose watch mode actually changed, so that we only re-protect those in the fastmem arena
+	u32 firstChanged = endPage;
+	u32 lastChanged = firstPage;
+
+	for (u32 page = firstPage; page < endPage; page++) {
+		const bool watchWrites = mode != VRAMWatch::None;
+		const bool watchReads = mode == VRAMWatch::ReadsAndWrites;
+		if (watchedVRAMWrites[page] == watchWrites && watchedVRAMReads[page] == watchReads) {
+			continue;
+		}
+
+		watchedVRAMWrites[page] = watchWrites;
+		watchedVRAMReads[page] = watchReads;
+		firstChanged = std::min(firstChanged, page);
+		lastChanged = page;
+
+		// VRAM is always mapped as R/W at VramStart, so we only need to drop the host pointers for the accesses we're watching
+		const u32 index = (VirtualAddrs::VramStart >> pageShift) + page;
+		PageEntry* entry = findPage(index);
+		if (entry == nullptr || entry->paddr == 0) {
+			continue;
+		}
+
+		const uintptr_t hostPointer = (uintptr_t)(vram + (page << pageShift));
+		entry->read = watchedVRAMReads[page] ? 0 : hostPointer;
+		entry->write = watchedVRAMWrites[page] ? 0 : hostPointer;
+
+		if (cpuPageTable) {
+			(*cpuPageTable)[index] = (mode == VRAMWatch::None) ? (u8*)hostPointer : nullptr;
+		}
+
+		if (auto it = watchedPages.find(index); it != watchedPages.end()) [[unlikely]] {
+			hideWatchedPage(index, it->second);
+		}
+	}
+
+	if (firstChanged < endPage) {
+		const u32 changedCount = lastChanged - firstChanged + 1;
+		protectFastmemVRAM(VirtualAddrs::VramStart + firstChanged * pageSize, PhysicalAddrs::VRAM + firstChanged * pageSize, changedCount);
+	}
+}
+
+// Make the fastmem view of some VRAM pages fault on the accesses that are being watched, so that dynarmic falls back to our slow paths for them
+void Memory::protectFastmemVRAM(u32 vaddr, u32 paddr, s32 pages) {
+	if (!useFastmem) {
+		return;
+	}
+
+	auto getPermissions = [&](s32 page) {
+		const u32 pagePaddr = paddr + (page << pageShift);
+		if (isWatchedVRAMPage(pagePaddr, watchedVRAMReads)) {
+			return Common::MemoryPermission{};
+		} else if (isWatchedVRAMPage(pagePaddr, watchedVRAMWrites) || watchedPages.contains((vaddr >> pageShift) + page)) {
+			return Common::MemoryPermission::Read;
+		} else {
+			return Common::MemoryPermission::ReadWrite;
+		}
+	};
+
+	// Protect runs of pages with the same permissions at once, to keep the number of syscalls down
+	s32 runStart = 0;
+	while (runStart < pages) {
+		const auto perms = getPermissions(runStart);
+		s32 runEnd = runStart + 1;
+		while (runEnd < pages && getPermissions(runEnd) == perms) {
+			runEnd++;
+		}
+
+		arena->Protect(vaddr + (runStart << pageShift), usize(runEnd - runStart) * pageSize, perms);
+		runStart = runEnd;
+	}
+}
+
 void Memory::write64(u32 vaddr, u64 value) {
 	write32(vaddr, u32(value));
 	write32(vaddr + 4, u32(value >> 32));
@@ -264,7 +498,7 @@ void* Memory::getReadPointer(u32 address) {
 	const u32 page = address >> pageShift;
 	const u32 offset = address & pageMask;
 
-	uintptr_t pointer = readTable[page];
+	uintptr_t pointer = lookupPage(page).read;
 	if (pointer == 0) return nullptr;
 	return (void*)(pointer + offset);
 }
@@ -273,7 +507,7 @@ void* Memory::getWritePointer(u32 address) {
 	const u32 page = address >> pageShift;
 	const u32 offset = address & pageMask;
 
-	uintptr_t pointer = writeTable[page];
+	uintptr_t pointer = lookupPage(page).write;
 	if (pointer == 0) return nullptr;
 	return (void*)(pointer + offset);
 }
@@ -300,85 +534,112 @@ std::string Memory::readString(u32 address, u32 maxSize) {
 // thanks to the New 3DS having more FCRAM
 u32 Memory::getLinearHeapVaddr() { return (kernelVersion < 0x22C) ? VirtualAddrs::LinearHeapStartOld : VirtualAddrs::LinearHeapStartNew; }
 
+Memory::VMAMap::iterator Memory::findVMA(u32 vaddr) {
+	// Find the last block that starts at or before vaddr
+	auto it = memoryInfo.upper_bound(vaddr);
+	if (it == memoryInfo.begin()) {
+		return memoryInfo.end();
+	}
+
+	--it;
+	return (vaddr < it->second.end()) ? it : memoryInfo.end();
+}
+
+static bool isReadOnlyCodeBlock(const MemoryInfo& block) {
+	return block.state == MemoryState::Code && (block.perms & PERMISSION_R) != 0 && (block.perms & PERMISSION_W) == 0;
+}
+
+bool Memory::isReadOnlyCode(u32 vaddr) {
+	// Only the loaders create code blocks, and CROs are mapped writable, so these contents only change if the block itself gets remapped or
+	// reprotected, which changeMemoryState reports
+	auto it = findVMA(vaddr);
+	return it != memoryInfo.end() && isReadOnlyCodeBlock(it->second);
+}
+
 void Memory::changeMemoryState(u32 vaddr, s32 pages, const Operation& op) {
 	assert(!(vaddr & 0xFFF));
 
 	if (!op.changePerms && !op.changeState) Helpers::panic("Invalid op passed to changeMemoryState!");
 
-	bool blockFound = false;
+	const u32 reqStart = vaddr;
+	const u32 reqEnd = vaddr + (pages << 12);
 
-	for (auto it = memoryInfo.begin(); it != memoryInfo.end(); it++) {
-		// Find the block that the memory region is located in
-		u32 blockStart = it->baseAddr;
-		u32 blockEnd = it->end();
+	// Find the block that the memory region is located in
+	auto it = findVMA(reqStart);
+	if (it == memoryInfo.end() || reqEnd > it->second.end()) Helpers::panic("Unable to find block in changeMemoryState!");
 
-		u32 reqStart = vaddr;
-		u32 reqEnd = vaddr + (pages << 12);
-
-		if (!(reqStart >= blockStart && reqEnd <= blockEnd)) continue;
+	// If the requested memory region is smaller than the block found, the block must be split. The parts before and after the region keep
+	// the old state and permissions
+	const MemoryInfo oldBlock = it->second;
+	if (oldBlock.baseAddr < reqStart) {
+		it->second.pages = (reqStart - oldBlock.baseAddr) >> 12;
+		it = memoryInfo.emplace_hint(std::next(it), reqStart, MemoryInfo(reqStart, pages, oldBlock.perms, oldBlock.state));
+	} else {
+		it->second.pages = pages;
+	}
 
-		// Now that the block has been found, fill it with the necessary info
-		auto oldState = it->state;
-		u32 oldPerms = it->perms;
-		it->baseAddr = reqStart;
-		it->pages = pages;
-		if (op.changePerms) it->perms = (op.r ? PERMISSION_R : 0) | (op.w ? PERMISSION_W : 0) | (op.x ? PERMISSION_X : 0);
-		if (op.changeState) it->state = op.newState;
+	if (reqEnd < oldBlock.end()) {
+		MemoryInfo endBlock(reqEnd, (oldBlock.end() - reqEnd) >> 12, oldBlock.perms, oldBlock.state);
+		memoryInfo.emplace_hint(std::next(it), reqEnd, endBlock);
+	}
 
-		// If the requested memory region is smaller than the block found, the block must be split
-		if (blockStart < reqStart) {
-			MemoryInfo startBlock(blockStart, (reqStart - blockStart) >> 12, oldPerms, oldState);
-			memoryInfo.insert(it, startBlock);
-		}
+	// Now that the block has been found, fill it with the necessary info
+	MemoryInfo& block = it->second;
+	if (op.changePerms) block.perms = (op.r ? PERMISSION_R : 0) | (op.w ? PERMISSION_W : 0) | (op.x ? PERMISSION_X : 0);
+	if (op.changeState) block.state = op.newState;
 
-		if (reqEnd < blockEnd) {
-			auto itAfter = std::next(it);
-			MemoryInfo endBlock(reqEnd, (blockEnd - reqEnd) >> 12, oldPerms, oldState);
-			memoryInfo.insert(itAfter, endBlock);
-		}
-
-		blockFound = true;
-		break;
+	// The JIT may have folded loads from this range into compiled code, which is only valid while it stays read-only code
+	if (isReadOnlyCodeBlock(oldBlock) && !isReadOnlyCodeBlock(block) && codeChangeCallback) {
+		codeChangeCallback(reqStart, reqEnd - reqStart);
 	}
 
-	if (!blockFound) Helpers::panic("Unable to find block in changeMemoryState!");
+	// Merge blocks with the same state and permissions. Every other block is already merged with its neighbours, so only the neighbours of
+	// the block we changed need to be checked
+	auto canMerge = [](const MemoryInfo& a, const MemoryInfo& b) { return a.state == b.state && a.perms == b.perms; };
 
-	// Merge all blocks with the same state and permissions
-	for (auto it = memoryInfo.begin(); it != memoryInfo.end();) {
-		auto next = std::next(it);
-		if (next == memoryInfo.end()) break;
+	if (auto next = std::next(it); next != memoryInfo.end() && canMerge(block, next->second)) {
+		block.pages += next->second.pages;
+		memoryInfo.erase(next);
+	}
 
-		if (it->state != next->state || it->perms != next->perms) {
-			it++;
-			continue;
+	if (it != memoryInfo.begin()) {
+		auto prev = std::prev(it);
+		if (canMerge(prev->second, block)) {
+			prev->second.pages += block.pages;
+			memoryInfo.erase(it);
 		}
-
-		next->baseAddr = it->baseAddr;
-		next->pages += it->pages;
-		it = memoryInfo.erase(it);
 	}
 }
 
 void Memory::queryPhysicalBlocks(FcramBlockList& outList, u32 vaddr, s32 pages) {
-	s32 srcPages = pages;
-	for (auto& alloc : memoryInfo) {
-		u32 blockStart = alloc.baseAddr;
-		u32 blockEnd = alloc.end();
+	if (pages <= 0) {
+		return;
+	}
 
-		if (!(vaddr >= blockStart && vaddr < blockEnd)) continue;
+	// Blocks cover the whole process address space, so we only need to check that both ends of the range are in it
+	const u32 endVaddr = vaddr + (u32(pages) << 12);
+	if (findVMA(vaddr) == memoryInfo.end() || findVMA(endVaddr - 1) == memoryInfo.end()) {
+		Helpers::panic("Unable to find virtual pages to map!");
+	}
+
+	// Split the range into physically contiguous blocks. A single virtual block can be backed by several physical ones,
+	// eg if a non-linear allocation had to use multiple free FCRAM blocks
+	u32 blockPaddr = lookupPage(vaddr >> 12).paddr;
+	s32 blockPages = 1;
 
-		s32 blockPaddr = paddrTable[vaddr >> 12];
-		s32 blockPages = alloc.pages - ((vaddr - blockStart) >> 12);
-		blockPages = std::min(srcPages, blockPages);
-		FcramBlock physicalBlock(blockPaddr, blockPages);
-		outList.push_back(physicalBlock);
+	for (u32 page = (vaddr >> 12) + 1; page < (endVaddr >> 12); page++) {
+		const u32 paddr = lookupPage(page).paddr;
+		if (paddr == blockPaddr + (u32(blockPages) << 12)) {
+			blockPages++;
+			continue;
+		}
 
-		vaddr += blockPages << 12;
-		srcPages -= blockPages;
-		if (srcPages == 0) break;
+		outList.push_back(FcramBlock(blockPaddr, blockPages));
+		blockPaddr = paddr;
+		blockPages = 1;
 	}
 
-	if (srcPages != 0) Helpers::panic("Unable to find virtual pages to map!");
+	outList.push_back(FcramBlock(blockPaddr, blockPages));
 }
 
 void Memory::mapPhysicalMemory(u32 vaddr, u32 paddr, s32 pages, bool r, bool w, bool x) {
@@ -387,41 +648,78 @@ void Memory::mapPhysicalMemory(u32 vaddr, u32 paddr, s32 pages, bool r, bool w,
 
 	// TODO: make this a separate function
 	u8* hostPtr = nullptr;
+	// Whether the new fastmem view needs its write-watched pages protected, once the loop below has updated the watches
+	bool protectWatches = false;
+
 	if (paddr < FCRAM_SIZE) {
 		hostPtr = fcram + paddr;  // FIXME: FCRAM doesn't actually start from physical address 0, but from 0x20000000
 
 		if (useFastmem) {
 			addFastmemView(vaddr, FASTMEM_FCRAM_OFFSET + paddr, usize(pages) * pageSize, w);
+			protectWatches = w;
 		}
 	} else if (paddr >= VirtualAddrs::DSPMemStart && paddr < VirtualAddrs::DSPMemStart + DSP_RAM_SIZE) {
 		hostPtr = dspRam + (paddr - VirtualAddrs::DSPMemStart);
 
 		if (useFastmem) {
 			addFastmemView(vaddr, FASTMEM_DSP_RAM_OFFSET + paddr - VirtualAddrs::DSPMemStart, usize(pages) * pageSize, w);
+			protectWatches = w;
+		}
+	} else if (paddr >= PhysicalAddrs::VRAM && paddr < PhysicalAddrs::VRAM + VRAM_SIZE) {
+		hostPtr = vram + (paddr - PhysicalAddrs::VRAM);
+
+		if (useFastmem) {
+			addFastmemView(vaddr, FASTMEM_VRAM_OFFSET + paddr - PhysicalAddrs::VRAM, usize(pages) * pageSize, w);
+			// Keep watched pages protected so that CPU accesses to them still fault into the slow path
+			if (w) {
+				protectFastmemVRAM(vaddr, paddr, pages);
+			}
 		}
 	}
 
 	for (int i = 0; i < pages; i++) {
 		u32 index = (vaddr >> 12) + i;
-		paddrTable[index] = paddr + (i << 12);
-		if (r)
-			readTable[index] = (uintptr_t)(hostPtr + (i << 12));
-		else
-			readTable[index] = 0;
+		// Accesses to watched VRAM pages have to take the slow path, so that the renderer gets notified about them
+		const bool readable = r && !isWatchedVRAMPage(paddr + (i << 12), watchedVRAMReads);
+		const bool writable = w && !isWatchedVRAMPage(paddr + (i << 12), watchedVRAMWrites);
+
+		PageEntry& entry = getOrCreatePage(index);
+		entry.paddr = paddr + (i << 12);
+		entry.read = readable ? (uintptr_t)(hostPtr + (i << 12)) : 0;
+		entry.write = writable ? (uintptr_t)(hostPtr + (i << 12)) : 0;
+
+		if (cpuPageTable) {
+			(*cpuPageTable)[index] = (readable && writable && hostPtr != nullptr) ? hostPtr + (i << 12) : nullptr;
+		}
+
+		if (!watchedPages.empty()) [[unlikely]] {
+			if (auto it = watchedPages.find(index); it != watchedPages.end()) {
+				hideWatchedPage(index, it->second);
+			}
+		}
+	}
 
-		if (w)
-			writeTable[index] = (uintptr_t)(hostPtr + (i << 12));
-		else
-			writeTable[index] = 0;
+	// Pages with write watches have to keep faulting on writes. This has to happen after the loop, as it only protects watches that have
+	// their write pointer set
+	if (protectWatches) {
+		protectWatchedPages(vaddr, pages);
 	}
 }
 
 void Memory::unmapPhysicalMemory(u32 vaddr, u32 paddr, s32 pages) {
 	for (int i = 0; i < pages; i++) {
 		u32 index = (vaddr >> 12) + i;
-		paddrTable[index] = 0;
-		readTable[index] = 0;
-		writeTable[index] = 0;
+		if (PageEntry* entry = findPage(index)) {
+			*entry = PageEntry{0, 0, 0};
+		}
+
+		if (auto it = watchedPages.find(index); it != watchedPages.end()) [[unlikely]] {
+			it->second.write = 0;
+		}
+
+		if (cpuPageTable) {
+			(*cpuPageTable)[index] = nullptr;
+		}
 	}
 
 	if (useFastmem) {
@@ -515,18 +813,37 @@ void Memory::changePermissions(u32 vaddr, s32 pages, bool r, bool w, bool x) {
 
 	for (auto& block : physicalList) {
 		mapPhysicalMemory(vaddr, block.paddr, block.pages, r, w, x);
-		vaddr += block.pages;
+		vaddr += block.pages << 12;
 	}
 }
 
+bool Memory::freeMemory(u32 vaddr, s32 pages) {
+	// Only memory allocated via ControlMemory can be freed, and it must not be aliased
+	const bool isHeap = testMemoryState(vaddr, pages, MemoryState::Private).isSuccess();
+	const bool isLinearHeap = testMemoryState(vaddr, pages, MemoryState::Continuous).isSuccess();
+	if (!isHeap && !isLinearHeap) return false;
+
+	FcramBlockList physicalList;
+	queryPhysicalBlocks(physicalList, vaddr, pages);
+
+	Operation op{.newState = MemoryState::Free, .r = false, .w = false, .x = false, .changeState = true, .changePerms = true};
+	changeMemoryState(vaddr, pages, op);
+
+	for (auto& block : physicalList) {
+		unmapPhysicalMemory(vaddr, block.paddr, block.pages);
+		vaddr += block.pages << 12;
+	}
+
+	// Return the physical pages to the FCRAM allocator. Pages that are still referenced elsewhere stay allocated
+	fcramManager.decRef(physicalList);
+	return true;
+}
+
 Result::HorizonResult Memory::queryMemory(MemoryInfo& out, u32 vaddr) {
-	// Check each allocation
-	for (auto& alloc : memoryInfo) {
-		// Check if the memory address belongs in this allocation and return the info if so
-		if (vaddr >= alloc.baseAddr && vaddr < alloc.end()) {
-			out = alloc;
-			return Result::Success;
-		}
+	// Find the allocation the memory address belongs to and return its info
+	if (auto it = findVMA(vaddr); it != memoryInfo.end()) {
+		out = it->second;
+		return Result::Success;
 	}
 
 	// Official kernel just returns an error here
@@ -534,14 +851,28 @@ Result::HorizonResult Memory::queryMemory(MemoryInfo& out, u32 vaddr) {
 	return Result::FailurePlaceholder;
 }
 
+std::vector<MemoryInfo> Memory::getReadableRegions() const {
+	std::vector<MemoryInfo> regions;
+
+	for (const auto& [base, block] : memoryInfo) {
+		// Alias mappings mirror memory that is also mapped at its original address, so skip them to not report that memory twice
+		if (block.state != MemoryState::Free && block.state != MemoryState::Alias && (block.perms & PERMISSION_R) != 0) {
+			regions.push_back(block);
+		}
+	}
+
+	return regions;
+}
+
 Result::HorizonResult Memory::testMemoryState(u32 vaddr, s32 pages, MemoryState desiredState) {
-	for (auto& alloc : memoryInfo) {
-		// Don't bother checking if we're to the left of the requested region
-		if (vaddr >= alloc.end()) continue;
-		if (alloc.state != desiredState) return Result::FailurePlaceholder;  // TODO: error for state mismatch
+	const u32 endVaddr = vaddr + (pages << 12);
+
+	// Start from the block the requested region starts in and walk forward until we reach its end
+	for (auto it = findVMA(vaddr); it != memoryInfo.end(); it++) {
+		if (it->second.state != desiredState) return Result::FailurePlaceholder;  // TODO: error for state mismatch
 
 		// If the end of this block comes after the end of the requested range with no errors, it's a success
-		if (alloc.end() >= vaddr + (pages << 12)) return Result::Success;
+		if (it->second.end() >= endVaddr) return Result::Success;
 	}
 
 	// TODO: error for when address is outside of userland
@@ -550,7 +881,7 @@ Result::HorizonResult Memory::testMemoryState(u32 vaddr, s32 pages, MemoryState
 
 void Memory::copyToVaddr(u32 dstVaddr, const u8* srcHost, s32 size) {
 	// TODO: check for noncontiguous allocations
-	u8* dstHost = (u8*)readTable[dstVaddr >> 12] + (dstVaddr & 0xFFF);
+	u8* dstHost = (u8*)lookupPage(dstVaddr >> 12).read + (dstVaddr & 0xFFF);
 	memcpy(dstHost, srcHost, size);
 }
 
@@ -590,6 +921,10 @@ u8* Memory::mapSharedMemory(Handle handle, u32 vaddr, u32 myPerms, u32 otherPerm
 u64 Memory::timeSince3DSEpoch() {
 	using namespace std::chrono;
 
+	if (fixedClockStart.has_value()) {
+		return fixedClockStart.value() + (*cpuTicks * 1000) / Scheduler::arm11Clock;
+	}
+
 	std::time_t rawTime = std::time(nullptr);   // Get current UTC time
 	auto localTime = std::localtime(&rawTime);  // Convert to local time
 
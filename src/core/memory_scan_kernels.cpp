@@ -0,0 +1,236 @@
+#include "memory_scan_kernels.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+#include "compiler_builtins.hpp"
+
+#ifdef PANDA3DS_X64_HOST
+#include "xbyak/xbyak_util.h"
+#elif defined(PANDA3DS_ARM64_HOST)
+#include <arm_neon.h>
+#endif
+
+namespace MemoryScanKernels {
+	namespace {
+		// Non-SIMD, portable kernels
+		template <typename T, Op op>
+		void portableKernel(const u8* current, const u8* previous, u32 lo, u32 hi, u64* bits, usize blockCount) {
+			// Values are compared as T, and floats additionally by bit pattern for the equality ops
+			using Raw = std::conditional_t<std::is_same_v<T, float>, u32, T>;
+			const T low = Helpers::bit_cast<T, Raw>(Raw(lo));
+			const T high = Helpers::bit_cast<T, Raw>(Raw(hi));
+
+			for (usize block = 0; block < blockCount; block++) {
+				if (bits[block] == 0) {
+					continue;
+				}
+
+				u64 mask = 0;
+				for (usize i = 0; i < blockValues; i++) {
+					const usize offset = (block * blockValues + i) * sizeof(T);
+					Raw xBits, pBits = 0;
+					std::memcpy(&xBits, current + offset, sizeof(T));
+					if constexpr (op != Op::InRange && op != Op::NotInRange) {
+						std::memcpy(&pBits, previous + offset, sizeof(T));
+					}
+
+					const T x = Helpers::bit_cast<T, Raw>(xBits);
+					const T p = Helpers::bit_cast<T, Raw>(pBits);
+					bool pass;
+
+					switch (op) {
+						case Op::InRange: pass = x >= low && x <= high; break;
+						case Op::NotInRange: pass = !(x >= low && x <= high); break;
+						case Op::EqualPrevious: pass = xBits == pBits; break;
+						case Op::NotEqualPrevious: pass = xBits != pBits; break;
+						case Op::GreaterPrevious: pass = x > p; break;
+						case Op::LessPrevious: pass = x < p; break;
+						default: pass = false; break;
+					}
+
+					mask |= u64(pass) << i;
+				}
+
+				bits[block] &= mask;
+			}
+		}
+
+		template <typename T>
+		constexpr std::array<Kernel, opCount> portableKernelsFor() {
+			return {
+				portableKernel<T, Op::InRange>,         portableKernel<T, Op::NotInRange>,   portableKernel<T, Op::EqualPrevious>,
+				portableKernel<T, Op::NotEqualPrevious>, portableKernel<T, Op::GreaterPrevious>, portableKernel<T, Op::LessPrevious>,
+			};
+		}
+
+#ifdef PANDA3DS_ARM64_HOST
+		// Lane-wise operations for each value type. Compares produce a vector of all-ones/all-zeroes lanes, of the same width as the values
+		struct NeonU8 {
+			using Vector = uint8x16_t;
+			static Vector load(const u8* pointer) { return vld1q_u8(pointer); }
+			static Vector set(u32 value) { return vdupq_n_u8(u8(value)); }
+			static uint8x16_t ge(Vector a, Vector b) { return vcgeq_u8(a, b); }
+			static uint8x16_t le(Vector a, Vector b) { return vcleq_u8(a, b); }
+			static uint8x16_t gt(Vector a, Vector b) { return vcgtq_u8(a, b); }
+			static uint8x16_t lt(Vector a, Vector b) { return vcltq_u8(a, b); }
+			static uint8x16_t eq(Vector a, Vector b) { return vceqq_u8(a, b); }
+			static uint8x16_t and_(uint8x16_t a, uint8x16_t b) { return vandq_u8(a, b); }
+			static uint8x16_t not_(uint8x16_t a) { return vmvnq_u8(a); }
+		};
+
+		struct NeonU16 {
+			using Vector = uint16x8_t;
+			static Vector load(const u8* pointer) { return vld1q_u16(reinterpret_cast<const u16*>(pointer)); }
+			static Vector set(u32 value) { return vdupq_n_u16(u16(value)); }
+			static uint16x8_t ge(Vector a, Vector b) { return vcgeq_u16(a, b); }
+			static uint16x8_t le(Vector a, Vector b) { return vcleq_u16(a, b); }
+			static uint16x8_t gt(Vector a, Vector b) { return vcgtq_u16(a, b); }
+			static uint16x8_t lt(Vector a, Vector b) { return vcltq_u16(a, b); }
+			static uint16x8_t eq(Vector a, Vector b) { return vceqq_u16(a, b); }
+			static uint16x8_t and_(uint16x8_t a, uint16x8_t b) { return vandq_u16(a, b); }
+			static uint16x8_t not_(uint16x8_t a) { return vmvnq_u16(a); }
+		};
+
+		struct NeonU32 {
+			using Vector = uint32x4_t;
+			static Vector load(const u8* pointer) { return vld1q_u32(reinterpret_cast<const u32*>(pointer)); }
+			static Vector set(u32 value) { return vdupq_n_u32(value); }
+			static uint32x4_t ge(Vector a, Vector b) { return vcgeq_u32(a, b); }
+			static uint32x4_t le(Vector a, Vector b) { return vcleq_u32(a, b); }
+			static uint32x4_t gt(Vector a, Vector b) { return vcgtq_u32(a, b); }
+			static uint32x4_t lt(Vector a, Vector b) { return vcltq_u32(a, b); }
+			static uint32x4_t eq(Vector a, Vector b) { return vceqq_u32(a, b); }
+			static uint32x4_t and_(uint32x4_t a, uint32x4_t b) { return vandq_u32(a, b); }
+			static uint32x4_t not_(uint32x4_t a) { return vmvnq_u32(a); }
+		};
+
+		// NEON float compares are ordered, so NaNs never pass a range or greater/less test. Equality is tested on the bit patterns
+		struct NeonFloat : NeonU32 {
+			using Vector = float32x4_t;
+			static Vector load(const u8* pointer) { return vld1q_f32(reinterpret_cast<const float*>(pointer)); }
+			static Vector set(u32 value) { return vreinterpretq_f32_u32(vdupq_n_u32(value)); }
+			static uint32x4_t ge(Vector a, Vector b) { return vcgeq_f32(a, b); }
+			static uint32x4_t le(Vector a, Vector b) { return vcleq_f32(a, b); }
+			static uint32x4_t gt(Vector a, Vector b) { return vcgtq_f32(a, b); }
+			static uint32x4_t lt(Vector a, Vector b) { return vcltq_f32(a, b); }
+			static uint32x4_t eq(Vector a, Vector b) { return vceqq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)); }
+		};
+
+		// Narrow lane masks to one byte per value
+		ALWAYS_INLINE inline uint8x16_t narrow(uint8x16_t a) { return a; }
+		ALWAYS_INLINE inline uint8x16_t narrow(uint16x8_t a, uint16x8_t b) { return vcombine_u8(vmovn_u16(a), vmovn_u16(b)); }
+		ALWAYS_INLINE inline uint8x16_t narrow(uint32x4_t a, uint32x4_t b, uint32x4_t c, uint32x4_t d) {
+			return narrow(vcombine_u16(vmovn_u32(a), vmovn_u32(b)), vcombine_u16(vmovn_u32(c), vmovn_u32(d)));
+		}
+
+		// Gather the top bit of each of the 64 bytes into a u64, like x86's movemask. Each byte is reduced to its bit, then pairwise adds
+		// combine 8 bytes into one
+		ALWAYS_INLINE inline u64 movemask(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+			static constexpr u8 weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+			const uint8x16_t weight = vld1q_u8(weights);
+
+			uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, weight), vandq_u8(b, weight));
+			uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, weight), vandq_u8(d, weight));
+			sum0 = vpaddq_u8(sum0, sum1);
+			sum0 = vpaddq_u8(sum0, sum0);
+			return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+		}
+
+		template <typename Ops, usize size, Op op>
+		void neonKernel(const u8* current, const u8* previous, u32 lo, u32 hi, u64* bits, usize blockCount) {
+			const auto low = Ops::set(lo);
+			const auto high = Ops::set(hi);
+
+			// Test the vector of values at the given byte offset
+			auto test = [&](usize offset) {
+				const auto x = Ops::load(current + offset);
+
+				if constexpr (op == Op::InRange || op == Op::NotInRange) {
+					const auto inRange = Ops::and_(Ops::ge(x, low), Ops::le(x, high));
+					return (op == Op::InRange) ? inRange : Ops::not_(inRange);
+				} else {
+					const auto p = Ops::load(previous + offset);
+
+					if constexpr (op == Op::EqualPrevious) {
+						return Ops::eq(x, p);
+					} else if constexpr (op == Op::NotEqualPrevious) {
+						return Ops::not_(Ops::eq(x, p));
+					} else if constexpr (op == Op::GreaterPrevious) {
+						return Ops::gt(x, p);
+					} else {
+						return Ops::lt(x, p);
+					}
+				}
+			};
+
+			// Byte masks for the 16 values starting at the given byte offset
+			auto test16 = [&](usize offset) {
+				if constexpr (size == 1) {
+					return narrow(test(offset));
+				} else if constexpr (size == 2) {
+					return narrow(test(offset), test(offset + 16));
+				} else {
+					return narrow(test(offset), test(offset + 16), test(offset + 32), test(offset + 48));
+				}
+			};
+
+			for (usize block = 0; block < blockCount; block++) {
+				if (bits[block] == 0) {
+					continue;
+				}
+
+				const usize base = block * blockValues * size;
+				constexpr usize stride = 16 * size;
+				bits[block] &= movemask(test16(base), test16(base + stride), test16(base + stride * 2), test16(base + stride * 3));
+			}
+		}
+
+		template <typename Ops, usize size>
+		constexpr std::array<Kernel, opCount> neonKernelsFor() {
+			return {
+				neonKernel<Ops, size, Op::InRange>,         neonKernel<Ops, size, Op::NotInRange>,
+				neonKernel<Ops, size, Op::EqualPrevious>,   neonKernel<Ops, size, Op::NotEqualPrevious>,
+				neonKernel<Ops, size, Op::GreaterPrevious>, neonKernel<Ops, size, Op::LessPrevious>,
+			};
+		}
+#endif
+	}  // namespace
+
+	const KernelTable& portableKernels() {
+		static constexpr KernelTable kernels = {
+			portableKernelsFor<u8>(),
+			portableKernelsFor<u16>(),
+			portableKernelsFor<u32>(),
+			portableKernelsFor<float>(),
+		};
+
+		return kernels;
+	}
+
+#ifdef PANDA3DS_ARM64_HOST
+	const KernelTable& neonKernels() {
+		static constexpr KernelTable kernels = {
+			neonKernelsFor<NeonU8, 1>(),
+			neonKernelsFor<NeonU16, 2>(),
+			neonKernelsFor<NeonU32, 4>(),
+			neonKernelsFor<NeonFloat, 4>(),
+		};
+
+		return kernels;
+	}
+#endif
+
+	const KernelTable& getKernels() {
+#ifdef PANDA3DS_X64_HOST
+		static const bool haveAVX2 = Xbyak::util::Cpu().has(Xbyak::util::Cpu::tAVX2);
+		if (haveAVX2) {
+			return avx2Kernels();
+		}
+#elif defined(PANDA3DS_ARM64_HOST)
+		return neonKernels();
+#endif
+
+		return portableKernels();
+	}
+}  // namespace MemoryScanKernels
@@ -0,0 +1,161 @@
+// This file is compiled with AVX2 enabled. Its kernels are only used if the host CPU supports AVX2, so nothing in here may be called otherwise
+#include <immintrin.h>
+
+#include "compiler_builtins.hpp"
+#include "memory_scan_kernels.hpp"
+
+namespace MemoryScanKernels {
+	namespace {
+		ALWAYS_INLINE inline __m256i load(const u8* pointer, usize offset) {
+			return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pointer + offset));
+		}
+
+		// Lane-wise integer operations for each value size. There's no unsigned comparison in AVX2, so x > y is tested as min(x, y) != x
+		struct Ops8 {
+			static __m256i set(u32 value) { return _mm256_set1_epi8(s8(value)); }
+			static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi8(a, b); }
+			static __m256i min(__m256i a, __m256i b) { return _mm256_min_epu8(a, b); }
+			static __m256i eq(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+		};
+
+		struct Ops16 {
+			static __m256i set(u32 value) { return _mm256_set1_epi16(s16(value)); }
+			static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi16(a, b); }
+			static __m256i min(__m256i a, __m256i b) { return _mm256_min_epu16(a, b); }
+			static __m256i eq(__m256i a, __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+		};
+
+		struct Ops32 {
+			static __m256i set(u32 value) { return _mm256_set1_epi32(s32(value)); }
+			static __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+			static __m256i min(__m256i a, __m256i b) { return _mm256_min_epu32(a, b); }
+			static __m256i eq(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+		};
+
+		// Turn the lane masks produced by compare(byteOffset) for a block of 64 values into one bit per value
+		template <usize size, typename Compare>
+		ALWAYS_INLINE inline u64 blockMask(Compare compare) {
+			u64 mask = 0;
+
+			if constexpr (size == 1) {
+				mask = u64(u32(_mm256_movemask_epi8(compare(0))));
+				mask |= u64(u32(_mm256_movemask_epi8(compare(32)))) << 32;
+			} else if constexpr (size == 2) {
+				// Narrow pairs of 16-bit lane masks to bytes. packs works within 128-bit lanes, so the permute restores the order of the values
+				for (usize i = 0; i < 2; i++) {
+					const __m256i packed = _mm256_packs_epi16(compare(i * 64), compare(i * 64 + 32));
+					const __m256i ordered = _mm256_permute4x64_epi64(packed, 0xD8);
+					mask |= u64(u32(_mm256_movemask_epi8(ordered))) << (i * 32);
+				}
+			} else {
+				for (usize i = 0; i < 8; i++) {
+					mask |= u64(u32(_mm256_movemask_ps(_mm256_castsi256_ps(compare(i * 32))))) << (i * 8);
+				}
+			}
+
+			return mask;
+		}
+
+		template <typename Ops, usize size, Op op>
+		void integerKernel(const u8* current, const u8* previous, u32 lo, u32 hi, u64* bits, usize blockCount) {
+			// lo <= x <= hi is tested as (x - lo) <= (hi - lo) with wrapping subtraction, which needs one compare instead of two
+			const __m256i low = Ops::set(lo);
+			const __m256i range = Ops::set(hi - lo);
+			// Ops that are the negation of an equality test, and get their result inverted at the end
+			constexpr bool invert = op == Op::NotInRange || op == Op::NotEqualPrevious || op == Op::GreaterPrevious || op == Op::LessPrevious;
+
+			for (usize block = 0; block < blockCount; block++) {
+				if (bits[block] == 0) {
+					continue;
+				}
+
+				const usize base = block * blockValues * size;
+				u64 mask = blockMask<size>([&](usize offset) {
+					const __m256i x = load(current, base + offset);
+
+					if constexpr (op == Op::InRange || op == Op::NotInRange) {
+						const __m256i delta = Ops::sub(x, low);
+						return Ops::eq(Ops::min(delta, range), delta);
+					} else {
+						const __m256i p = load(previous, base + offset);
+
+						if constexpr (op == Op::EqualPrevious || op == Op::NotEqualPrevious) {
+							return Ops::eq(x, p);
+						} else if constexpr (op == Op::GreaterPrevious) {
+							return Ops::eq(Ops::min(x, p), x);  // x <= p
+						} else {
+							return Ops::eq(Ops::min(x, p), p);  // x >= p
+						}
+					}
+				});
+
+				bits[block] &= invert ? ~mask : mask;
+			}
+		}
+
+		// Float compares are ordered, so NaNs never pass a range or greater/less test
+		template <Op op>
+		void floatKernel(const u8* current, const u8* previous, u32 lo, u32 hi, u64* bits, usize blockCount) {
+			const __m256 low = _mm256_castsi256_ps(_mm256_set1_epi32(s32(lo)));
+			const __m256 high = _mm256_castsi256_ps(_mm256_set1_epi32(s32(hi)));
+			constexpr bool invert = op == Op::NotInRange || op == Op::NotEqualPrevious;
+
+			for (usize block = 0; block < blockCount; block++) {
+				if (bits[block] == 0) {
+					continue;
+				}
+
+				const usize base = block * blockValues * sizeof(float);
+				u64 mask = blockMask<4>([&](usize offset) {
+					const __m256i xBits = load(current, base + offset);
+					const __m256 x = _mm256_castsi256_ps(xBits);
+
+					if constexpr (op == Op::InRange || op == Op::NotInRange) {
+						const __m256 inRange = _mm256_and_ps(_mm256_cmp_ps(x, low, _CMP_GE_OQ), _mm256_cmp_ps(x, high, _CMP_LE_OQ));
+						return _mm256_castps_si256(inRange);
+					} else {
+						const __m256i pBits = load(previous, base + offset);
+						const __m256 p = _mm256_castsi256_ps(pBits);
+
+						if constexpr (op == Op::EqualPrevious || op == Op::NotEqualPrevious) {
+							return _mm256_cmpeq_epi32(xBits, pBits);
+						} else if constexpr (op == Op::GreaterPrevious) {
+							return _mm256_castps_si256(_mm256_cmp_ps(x, p, _CMP_GT_OQ));
+						} else {
+							return _mm256_castps_si256(_mm256_cmp_ps(x, p, _CMP_LT_OQ));
+						}
+					}
+				});
+
+				bits[block] &= invert ? ~mask : mask;
+			}
+		}
+
+		template <typename Ops, usize size>
+		constexpr std::array<Kernel, opCount> integerKernels() {
+			return {
+				integerKernel<Ops, size, Op::InRange>,         integerKernel<Ops, size, Op::NotInRange>,
+				integerKernel<Ops, size, Op::EqualPrevious>,   integerKernel<Ops, size, Op::NotEqualPrevious>,
+				integerKernel<Ops, size, Op::GreaterPrevious>, integerKernel<Ops, size, Op::LessPrevious>,
+			};
+		}
+	}  // namespace
+
+	const KernelTable& avx2Kernels() {
+		static constexpr KernelTable kernels = {
+			integerKernels<Ops8, 1>(),
+			integerKernels<Ops16, 2>(),
+			integerKernels<Ops32, 4>(),
+			std::array<Kernel, opCount>{
+				floatKernel<Op::InRange>,
+				floatKernel<Op::NotInRange>,
+				floatKernel<Op::EqualPrevious>,
+				floatKernel<Op::NotEqualPrevious>,
+				floatKernel<Op::GreaterPrevious>,
+				floatKernel<Op::LessPrevious>,
+			},
+		};
+
+		return kernels;
+	}
+}  // namespace MemoryScanKernels
@@ -0,0 +1,336 @@
+#include "memory_scanner.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "memory.hpp"
+
+using namespace MemoryScanKernels;
+
+namespace {
+	// Comparisons that test against the values of the previous scan, and thus can't be used on a first scan
+	bool comparesPrevious(MemoryScanner::Comparison comparison) {
+		using Comparison = MemoryScanner::Comparison;
+		return comparison == Comparison::Changed || comparison == Comparison::Unchanged || comparison == Comparison::Increased ||
+			   comparison == Comparison::Decreased;
+	}
+
+	u32 readValue(const u8* pointer, usize size) {
+		u32 value = 0;
+		std::memcpy(&value, pointer, size);
+		return value;
+	}
+
+	// Number of values gathered from a page's candidates into a buffer for the compare kernels, which round up to whole blocks.
+	// Pages only stay sparse while their candidate list is smaller than a page snapshot, so this is always enough
+	constexpr usize gatherBufferSize = Memory::pageSize + blockValues * sizeof(u32);
+	constexpr usize maxBlocksPerPage = Memory::pageSize / blockValues;
+}  // namespace
+
+usize MemoryScanner::blocksPerPage() const { return Memory::pageSize / (valueSize() * blockValues); }
+
+MemoryScanner::Filter MemoryScanner::makeFilter(Comparison comparison, u32 value, u32 value2) const {
+	static constexpr Filter nothing = {Op::InRange, 0, 0, true};
+
+	switch (comparison) {
+		case Comparison::Changed: return {Op::NotEqualPrevious, 0, 0};
+		case Comparison::Unchanged: return {Op::EqualPrevious, 0, 0};
+		case Comparison::Increased: return {Op::GreaterPrevious, 0, 0};
+		case Comparison::Decreased: return {Op::LessPrevious, 0, 0};
+		default: break;
+	}
+
+	if (type == ValueType::Float) {
+		// Comparisons are turned into closed ranges, so x > value becomes x >= the next float after value. NaN bounds never match
+		constexpr float infinity = std::numeric_limits<float>::infinity();
+		const float x = Helpers::bit_cast<float, u32>(value);
+		const float y = Helpers::bit_cast<float, u32>(value2);
+
+		auto range = [](float lo, float hi, Op op = Op::InRange) {
+			return Filter{op, Helpers::bit_cast<u32, float>(lo), Helpers::bit_cast<u32, float>(hi)};
+		};
+
+		switch (comparison) {
+			case Comparison::Equal: return range(x, x);
+			case Comparison::NotEqual: return range(x, x, Op::NotInRange);
+			case Comparison::Greater: return (x < infinity) ? range(std::nextafter(x, infinity), infinity) : nothing;
+			case Comparison::GreaterOrEqual: return range(x, infinity);
+			case Comparison::Less: return (x > -infinity) ? range(-infinity, std::nextafter(x, -infinity)) : nothing;
+			case Comparison::LessOrEqual: return range(-infinity, x);
+			case Comparison::Between: return range(std::min(x, y), std::max(x, y));
+			default: return nothing;
+		}
+	}
+
+	// Integer comparisons, with the bounds clamped to what the value type can hold
+	const u32 max = (type == ValueType::U8) ? 0xFF : ((type == ValueType::U16) ? 0xFFFF : 0xFFFFFFFF);
+	auto range = [](u32 lo, u32 hi) { return Filter{Op::InRange, lo, hi}; };
+
+	switch (comparison) {
+		case Comparison::Equal: return (value > max) ? nothing : range(value, value);
+		case Comparison::NotEqual: return (value > max) ? range(0, max) : Filter{Op::NotInRange, value, value};
+		case Comparison::Greater: return (value >= max) ? nothing : range(value + 1, max);
+		case Comparison::GreaterOrEqual: return (value > max) ? nothing : range(value, max);
+		case Comparison::Less: return (value == 0) ? nothing : range(0, std::min(value - 1, max));
+		case Comparison::LessOrEqual: return range(0, std::min(value, max));
+		case Comparison::Between: {
+			const u32 lo = std::min(value, value2);
+			const u32 hi = std::max(value, value2);
+			return (lo > max) ? nothing : range(lo, std::min(hi, max));
+		}
+		default: return nothing;
+	}
+}
+
+void MemoryScanner::storePage(Page& page, const u8* current, const u64* bits, usize blockCount) {
+	const usize size = valueSize();
+	usize count = 0;
+	for (usize block = 0; block < blockCount; block++) {
+		count += std::popcount(bits[block]);
+	}
+
+	page.count = u32(count);
+	if (count == 0) {
+		return;
+	}
+
+	// Keep whichever of the two representations is smaller
+	const usize denseBytes = Memory::pageSize + blockCount * sizeof(u64);
+	const usize sparseBytes = count * (sizeof(u16) + size);
+
+	if (sparseBytes < denseBytes) {
+		page.offsets.resize(count);
+		page.values.resize(count * size);
+
+		usize index = 0;
+		for (usize block = 0; block < blockCount; block++) {
+			for (u64 blockBits = bits[block]; blockBits != 0; blockBits &= blockBits - 1) {
+				const usize offset = (block * blockValues + std::countr_zero(blockBits)) * size;
+				page.offsets[index] = u16(offset);
+				std::memcpy(&page.values[index * size], current + offset, size);
+				index++;
+			}
+		}
+
+		page.bits = {};
+		page.snapshot = {};
+	} else {
+		page.bits.assign(bits, bits + blockCount);
+		page.snapshot.assign(current, current + Memory::pageSize);
+	}
+}
+
+void MemoryScanner::scanPage(Page& page, const KernelTable& kernels, const Filter* filter, bool firstScan) {
+	const u8* current = static_cast<const u8*>(mem.getReadPointer(page.vaddr));
+
+	// Pages that got unmapped since the last scan lose all their candidates
+	if (current == nullptr || (filter != nullptr && filter->matchesNothing)) {
+		page.count = 0;
+		return;
+	}
+
+	const Kernel kernel = (filter != nullptr) ? kernels[usize(type)][usize(filter->op)] : nullptr;
+	const u32 lo = (filter != nullptr) ? filter->lo : 0;
+	const u32 hi = (filter != nullptr) ? filter->hi : 0;
+	std::array<u64, maxBlocksPerPage> bits;
+
+	if (firstScan || page.isDense()) {
+		const usize blockCount = blocksPerPage();
+		if (firstScan) {
+			std::fill_n(bits.begin(), blockCount, ~u64(0));
+		} else {
+			std::copy(page.bits.begin(), page.bits.end(), bits.begin());
+		}
+
+		if (kernel != nullptr) {
+			kernel(current, firstScan ? nullptr : page.snapshot.data(), lo, hi, bits.data(), blockCount);
+		}
+
+		storePage(page, current, bits.data(), blockCount);
+		return;
+	}
+
+	// Sparse page: Gather the current values of the candidates next to each other, so that the kernels can filter them like a page
+	const usize size = valueSize();
+	const usize count = page.count;
+	const usize blockCount = (count + blockValues - 1) / blockValues;
+	alignas(32) std::array<u8, gatherBufferSize> currentValues;
+	alignas(32) std::array<u8, gatherBufferSize> previousValues;
+
+	for (usize i = 0; i < count; i++) {
+		std::memcpy(&currentValues[i * size], current + page.offsets[i], size);
+	}
+	std::memcpy(previousValues.data(), page.values.data(), count * size);
+
+	// Zero the unused values of the last block. They're masked out, but the kernels still read them
+	const usize tailBytes = blockCount * blockValues * size - count * size;
+	std::memset(&currentValues[count * size], 0, tailBytes);
+	std::memset(&previousValues[count * size], 0, tailBytes);
+
+	std::fill_n(bits.begin(), blockCount, ~u64(0));
+	if (count % blockValues != 0) {
+		bits[blockCount - 1] = (u64(1) << (count % blockValues)) - 1;
+	}
+
+	if (kernel != nullptr) {
+		kernel(currentValues.data(), previousValues.data(), lo, hi, bits.data(), blockCount);
+	}
+
+	// Compact the candidates that passed, keeping their new values
+	usize kept = 0;
+	for (usize i = 0; i < count; i++) {
+		if ((bits[i / blockValues] >> (i % blockValues)) & 1) {
+			page.offsets[kept] = page.offsets[i];
+			std::memcpy(&page.values[kept * size], &currentValues[i * size], size);
+			kept++;
+		}
+	}
+
+	page.count = u32(kept);
+	page.offsets.resize(kept);
+	page.values.resize(kept * size);
+}
+
+void MemoryScanner::scanPages(const Filter* filter, bool firstScan) {
+	const KernelTable& kernels = getKernels();
+
+	// Hand out pages to threads in chunks, as scanning a single page takes less time than fetching the next index would
+	static constexpr usize pagesPerChunk = 64;
+	const usize chunkCount = (pages.size() + pagesPerChunk - 1) / pagesPerChunk;
+
+	unsigned threads = (threadCount == 0) ? std::max(1u, std::thread::hardware_concurrency()) : threadCount;
+	threads = std::min<unsigned>(threads, unsigned(std::max<usize>(1, chunkCount)));
+	std::atomic<usize> nextChunk = 0;
+
+	auto worker = [&]() {
+		for (usize chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+			const usize end = std::min(pages.size(), (chunk + 1) * pagesPerChunk);
+			for (usize i = chunk * pagesPerChunk; i < end; i++) {
+				scanPage(pages[i], kernels, filter, firstScan);
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+
+	std::erase_if(pages, [](const Page& page) { return page.count == 0; });
+
+	resultCount = 0;
+	for (const Page& page : pages) {
+		resultCount += page.count;
+	}
+}
+
+bool MemoryScanner::firstScan(ValueType newType, Comparison comparison, u32 value, u32 value2) {
+	if (comparesPrevious(comparison)) {
+		return false;
+	}
+
+	reset();
+	type = newType;
+	active = true;
+
+	const auto regions = mem.getReadableRegions();
+	usize pageCount = 0;
+	for (const auto& region : regions) {
+		pageCount += region.pages;
+	}
+
+	pages.reserve(pageCount);
+	for (const auto& region : regions) {
+		for (u32 i = 0; i < region.pages; i++) {
+			pages.emplace_back().vaddr = region.baseAddr + i * Memory::pageSize;
+		}
+	}
+
+	if (comparison == Comparison::Unknown) {
+		scanPages(nullptr, true);
+	} else {
+		const Filter filter = makeFilter(comparison, value, value2);
+		scanPages(&filter, true);
+	}
+
+	return true;
+}
+
+bool MemoryScanner::nextScan(Comparison comparison, u32 value, u32 value2) {
+	if (!active) {
+		return false;
+	}
+
+	if (comparison == Comparison::Unknown) {
+		scanPages(nullptr, false);
+	} else {
+		const Filter filter = makeFilter(comparison, value, value2);
+		scanPages(&filter, false);
+	}
+
+	return true;
+}
+
+void MemoryScanner::reset() {
+	pages.clear();
+	pages.shrink_to_fit();
+	resultCount = 0;
+	active = false;
+}
+
+std::vector<MemoryScanner::Result> MemoryScanner::getResults(usize start, usize maxResults) const {
+	std::vector<Result> results;
+	const usize size = valueSize();
+
+	for (const Page& page : pages) {
+		if (results.size() >= maxResults) {
+			break;
+		}
+
+		// Skip whole pages until we reach the first requested result
+		if (start >= page.count) {
+			start -= page.count;
+			continue;
+		}
+
+		const u8* current = static_cast<const u8*>(mem.getReadPointer(page.vaddr));
+		auto addResult = [&](usize offset, const u8* previousPointer) {
+			if (start > 0) {
+				start--;
+				return;
+			}
+
+			if (results.size() < maxResults) {
+				const u32 previous = readValue(previousPointer, size);
+				const u32 value = (current != nullptr) ? readValue(current + offset, size) : previous;
+				results.push_back({page.vaddr + u32(offset), value, previous});
+			}
+		};
+
+		if (page.isDense()) {
+			for (usize block = 0; block < page.bits.size(); block++) {
+				for (u64 bits = page.bits[block]; bits != 0; bits &= bits - 1) {
+					const usize offset = (block * blockValues + std::countr_zero(bits)) * size;
+					addResult(offset, &page.snapshot[offset]);
+				}
+			}
+		} else {
+			for (usize i = 0; i < page.count; i++) {
+				addResult(page.offsets[i], &page.values[i * size]);
+			}
+		}
+	}
+
+	return results;
+}
@@ -0,0 +1,177 @@
+#include "movie.hpp"
+
+#include "io_file.hpp"
+#include "xxhash/xxhash.h"
+
+namespace {
+	// Fixed-size header at the start of every movie file, followed by the input entries and then the FCRAM hashes
+	struct FileHeader {
+		u32 magic;
+		u32 version;
+		u32 hashInterval;
+		u32 padding;
+		Movie::Environment environment;
+
+		u64 totalFrames;
+		u64 inputCount;
+		u64 hashCount;
+	};
+}  // namespace
+
+void Movie::clear() {
+	state = State::Idle;
+	inputs.clear();
+	hashes.clear();
+	nextInput = nextHash = 0;
+	currentInput = {};
+	frameCount = totalFrames = 0;
+	desyncFrame = std::nullopt;
+}
+
+bool Movie::startRecording(const std::filesystem::path& moviePath, const Environment& env, u32 interval) {
+	stop();
+	clear();
+
+	path = moviePath;
+	environment = env;
+	hashInterval = interval;
+	state = State::Recording;
+	return true;
+}
+
+bool Movie::startPlayback(const std::filesystem::path& moviePath) {
+	stop();
+	clear();
+
+	if (!load(moviePath)) {
+		clear();
+		return false;
+	}
+
+	path = moviePath;
+	state = State::Playing;
+	return true;
+}
+
+bool Movie::stop() {
+	bool success = true;
+	if (state == State::Recording) {
+		totalFrames = frameCount;
+		success = save();
+	}
+
+	state = State::Idle;
+	return success;
+}
+
+void Movie::onInputSample(u64 tick, HID::InputState& input) {
+	if (state == State::Recording) {
+		if (inputs.empty() || input != currentInput) {
+			inputs.push_back({tick, input});
+			currentInput = input;
+		}
+	} else if (state == State::Playing) {
+		while (nextInput < inputs.size() && inputs[nextInput].tick <= tick) {
+			currentInput = inputs[nextInput++].state;
+		}
+
+		input = currentInput;
+	}
+}
+
+void Movie::onFrame(std::span<const u8> fcram) {
+	frameCount++;
+	if (hashInterval == 0 || (frameCount % hashInterval) != 0) {
+		return;
+	}
+
+	const u64 hash = XXH3_64bits(fcram.data(), fcram.size());
+	if (state == State::Recording) {
+		hashes.push_back({frameCount, hash});
+	} else if (state == State::Playing) {
+		while (nextHash < hashes.size() && hashes[nextHash].frame < frameCount) {
+			nextHash++;
+		}
+
+		const bool mismatch = nextHash < hashes.size() && hashes[nextHash].frame == frameCount && hashes[nextHash].hash != hash;
+		if (mismatch && !desyncFrame.has_value()) {
+			desyncFrame = frameCount;
+			Helpers::warn("Movie playback desynced at frame %llu, FCRAM no longer matches the recording", (unsigned long long)frameCount);
+		}
+	}
+}
+
+bool Movie::save() {
+	FileHeader header{};
+	header.magic = magic;
+	header.version = version;
+	header.hashInterval = hashInterval;
+	header.environment = environment;
+	header.totalFrames = totalFrames;
+	header.inputCount = inputs.size();
+	header.hashCount = hashes.size();
+
+	IOFile file;
+	if (!file.open(path, "wb")) {
+		Helpers::warn("Failed to open movie file %s for writing", path.string().c_str());
+		return false;
+	}
+
+	auto writeAll = [&file](const void* data, std::size_t size) {
+		auto [success, bytes] = file.writeBytes(data, size);
+		return success && bytes == size;
+	};
+
+	const bool success = writeAll(&header, sizeof(header)) && writeAll(inputs.data(), inputs.size() * sizeof(InputEntry)) &&
+						 writeAll(hashes.data(), hashes.size() * sizeof(HashEntry));
+	file.close();
+
+	if (!success) {
+		Helpers::warn("Failed to write movie file %s", path.string().c_str());
+	}
+
+	return success;
+}
+
+bool Movie::load(const std::filesystem::path& moviePath) {
+	IOFile file;
+	if (!file.open(moviePath, "rb")) {
+		Helpers::warn("Failed to open movie file %s", moviePath.string().c_str());
+		return false;
+	}
+
+	auto readAll = [&file](void* data, std::size_t size) {
+		auto [success, bytes] = file.readBytes(data, size);
+		return success && bytes == size;
+	};
+
+	FileHeader header;
+	if (!readAll(&header, sizeof(header)) || header.magic != magic || header.version != version) {
+		Helpers::warn("%s is not a valid movie file, or was made by an incompatible version", moviePath.string().c_str());
+		file.close();
+		return false;
+	}
+
+	// Make sure the entry counts can't make us allocate more than the file could possibly hold
+	const u64 fileSize = file.size().value_or(0);
+	if (header.inputCount > fileSize / sizeof(InputEntry) || header.hashCount > fileSize / sizeof(HashEntry)) {
+		Helpers::warn("Movie file %s is truncated", moviePath.string().c_str());
+		file.close();
+		return false;
+	}
+
+	inputs.resize(header.inputCount);
+	hashes.resize(header.hashCount);
+	const bool success = readAll(inputs.data(), inputs.size() * sizeof(InputEntry)) && readAll(hashes.data(), hashes.size() * sizeof(HashEntry));
+	file.close();
+
+	if (!success) {
+		Helpers::warn("Movie file %s is truncated", moviePath.string().c_str());
+		return false;
+	}
+
+	environment = header.environment;
+	hashInterval = header.hashInterval;
+	totalFrames = header.totalFrames;
+	return true;
+}
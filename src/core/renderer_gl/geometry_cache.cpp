@@ -0,0 +1,130 @@
+#include "renderer_gl/geometry_cache.hpp"
+
+GLuint GeometryCache::lookup(BufferKind kind, u32 address, const u8* data, u32 size) {
+	if (size < minCachedSize || data == nullptr) {
+		return 0;
+	}
+
+	const Key key = {address, size, kind};
+	auto it = entries.find(key);
+
+	if (it == entries.end()) {
+		stats.misses++;
+
+		// Never let a single buffer take up more than the whole budget. If the buffers of this draw already fill it, stream this one instead
+		if (size > budget || !makeRoom(size)) {
+			return 0;
+		}
+
+		lru.push_front(key);
+
+		Entry& entry = entries[key];
+		entry.lruPosition = lru.begin();
+		entry.lastDraw = drawGeneration;
+		entry.hash = PICAHash::computeHash((const char*)data, size);
+		upload(entry, data, size);
+
+		return entry.buffer;
+	}
+
+	Entry& entry = it->second;
+	// Move the entry to the front of the LRU list and pin it for the rest of the draw
+	lru.splice(lru.begin(), lru, entry.lruPosition);
+	entry.lastDraw = drawGeneration;
+
+	// Volatile entries don't hold a buffer, the caller is expected to stream their data
+	if (entry.isVolatile) {
+		stats.misses++;
+		return 0;
+	}
+
+	const PICAHash::HashType hash = PICAHash::computeHash((const char*)data, size);
+	if (hash == entry.hash) [[likely]] {
+		stats.hits++;
+		entry.consecutiveChanges = 0;
+		return entry.buffer;
+	}
+
+	// The guest data changed under us. If this keeps happening, stop caching this range and leave it to the stream buffers
+	stats.misses++;
+	stats.invalidations++;
+	entry.hash = hash;
+
+	if (++entry.consecutiveChanges >= volatileThreshold) {
+		entry.isVolatile = true;
+		glDeleteBuffers(1, &entry.buffer);
+		entry.buffer = 0;
+		stats.residentBytes -= size;
+
+		return 0;
+	}
+
+	upload(entry, data, size);
+	return entry.buffer;
+}
+
+void GeometryCache::upload(Entry& entry, const u8* data, u32 size) {
+	const bool newBuffer = entry.buffer == 0;
+	if (newBuffer) {
+		glGenBuffers(1, &entry.buffer);
+		stats.residentBytes += size;
+	}
+
+	// Upload through GL_COPY_WRITE_BUFFER, so that we don't disturb the array buffer or the element array buffer of the currently bound VAO.
+	// For buffers that are already allocated, glBufferData orphans the old storage so that we don't have to wait on draws still reading from it.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, entry.buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	stats.bytesUploaded += size;
+}
+
+void GeometryCache::evict(Key key) {
+	auto it = entries.find(key);
+	if (it == entries.end()) {
+		return;
+	}
+
+	Entry& entry = it->second;
+	if (entry.buffer != 0) {
+		glDeleteBuffers(1, &entry.buffer);
+		stats.residentBytes -= key.size;
+	}
+
+	lru.erase(entry.lruPosition);
+	entries.erase(it);
+	stats.evictions++;
+}
+
+bool GeometryCache::makeRoom(usize size) {
+	// Evict the least recently used entries until the new buffer fits in our budget and we've got a free entry slot.
+	// Lookups move entries to the front of the LRU list, so once we reach an entry of the current draw, every entry left belongs to it too
+	while (stats.residentBytes + size > budget || entries.size() >= maxEntries) {
+		if (lru.empty() || entries.find(lru.back())->second.lastDraw == drawGeneration) {
+			return false;
+		}
+
+		evict(lru.back());
+	}
+
+	return true;
+}
+
+void GeometryCache::setBudget(usize newBudget) {
+	budget = newBudget;
+	// Start a new draw first, so that nothing is pinned and we can get all the way down to the new budget
+	beginDraw();
+	makeRoom(0);
+}
+
+void GeometryCache::reset() {
+	for (auto& [key, entry] : entries) {
+		if (entry.buffer != 0) {
+			glDeleteBuffers(1, &entry.buffer);
+		}
+	}
+
+	entries.clear();
+	lru.clear();
+	stats.residentBytes = 0;
+}
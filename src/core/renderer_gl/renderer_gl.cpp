@@ -3,6 +3,7 @@
 #include <stb_image_write.h>
 
 #include <algorithm>
+#include <atomic>
 #include <bit>
 #include <cmrc/cmrc.hpp>
 
@@ -13,6 +14,7 @@
 #include "PICA/pica_simd.hpp"
 #include "PICA/regs.hpp"
 #include "PICA/shader_decompiler.hpp"
+#include "PICA/surface_tiling.hpp"
 #include "config.hpp"
 #include "math_util.hpp"
 #include "screen_layout.hpp"
@@ -23,14 +25,32 @@ using namespace Floats;
 using namespace Helpers;
 using namespace PICA;
 
-RendererGL::~RendererGL() {}
+RendererGL::~RendererGL() {
+	// Report how well the GLSL decompiler handled the vertex shaders of this session
+	const auto& stats = shaderDecompilerStats;
+	if (stats.structured + stats.dispatcher + stats.failed != 0) {
+		log(
+			"Decompiled vertex shaders: %llu structured, %llu using the dispatcher, %llu failed\n", (unsigned long long)stats.structured,
+			(unsigned long long)stats.dispatcher, (unsigned long long)stats.failed
+		);
+	}
+}
 
 void RendererGL::reset() {
+	// Any batched draws target surfaces that are about to be destroyed, so just drop them
+	drawBatch.vertices.clear();
+	drawsPending = false;
+
 	depthBufferCache.reset();
 	colourBufferCache.reset();
 	textureCache.reset();
+	geometryCache.reset();
+	// None of the colour buffers we were watching VRAM for exist anymore
+	pendingVRAMWatch = std::nullopt;
+	gpu.watchVRAM(PhysicalAddrs::VRAM, Memory::VRAM_SIZE, Memory::VRAMWatch::None);
 
 	shaderCache.clear();
+	invalidateDerivedState();
 
 	// Init the colour/depth buffer settings to some random defaults on reset
 	colourBufferLoc = 0;
@@ -58,15 +78,18 @@ void RendererGL::reset() {
 
 void RendererGL::initGraphicsContextInternal() {
 	gl.reset();
+	invalidateDerivedState();
+	// The ubershader VS is generated, so set up the shader generator for our API before anything else
+	fragShaderGen.setTarget(driverInfo.usingGLES ? PICA::ShaderGen::API::GLES : PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL);
 
 	auto gl_resources = cmrc::RendererGL::get_filesystem();
-	auto vertexShaderSource = gl_resources.open("opengl_vertex_shader.vert");
 	auto fragmentShaderSource = gl_resources.open("opengl_fragment_shader.frag");
+	const std::string vertexShaderSource = fragShaderGen.getUbershaderVertexShader();
 
-	OpenGL::Shader vert({vertexShaderSource.begin(), vertexShaderSource.size()}, OpenGL::Vertex);
-	OpenGL::Shader frag({fragmentShaderSource.begin(), fragmentShaderSource.size()}, OpenGL::Fragment);
-	triangleProgram.create({vert, frag});
-	initUbershader(triangleProgram);
+	OpenGL::Shader vert({vertexShaderSource.c_str(), vertexShaderSource.size()}, OpenGL::Vertex);
+	ubershaderFragShader.create({fragmentShaderSource.begin(), fragmentShaderSource.size()}, OpenGL::Fragment);
+	triangleProgram.create({vert, ubershaderFragShader});
+	initUbershader(triangleProgram, ubershaderData);
 
 	compileDisplayShader();
 	// Create stream buffers for vertex, index and uniform buffers
@@ -174,7 +197,6 @@ void RendererGL::initGraphicsContextInternal() {
 	}
 
 	reset();
-	fragShaderGen.setTarget(driverInfo.usingGLES ? PICA::ShaderGen::API::GLES : PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL);
 
 	// Populate our driver info structure
 	driverInfo.supportsExtFbFetch = (GLAD_GL_EXT_shader_framebuffer_fetch != 0);
@@ -225,40 +247,44 @@ void RendererGL::setupBlending() {
 		GL_NAND,  GL_OR,  GL_NOR,         GL_XOR,  GL_EQUIV, GL_AND_INVERTED,  GL_OR_REVERSE, GL_OR_INVERTED,
 	};
 
-	// Shows if blending is enabled. If it is not enabled, then logic ops are enabled instead
-	const bool blendingEnabled = (regs[PICA::InternalRegs::ColourOperation] & (1 << 8)) != 0;
-
-	if (!blendingEnabled) {  // Logic ops are enabled
-		const u32 logicOp = getBits<0, 4>(regs[PICA::InternalRegs::LogicOp]);
-		gl.setLogicOp(logicOps[logicOp]);
+	if (pendingDirtyState.blending & PICA::DirtyState::Blend) {
+		pendingDirtyState.blending = 0;
 
-		// If logic ops are enabled we don't need to disable blending because they override it
-		gl.enableLogicOp();
-	} else {
-		gl.enableBlend();
-		gl.disableLogicOp();
+		// Shows if blending is enabled. If it is not enabled, then logic ops are enabled instead
+		blendState.blendingEnabled = (regs[PICA::InternalRegs::ColourOperation] & (1 << 8)) != 0;
+		blendState.logicOp = logicOps[getBits<0, 4>(regs[PICA::InternalRegs::LogicOp])];
 
 		// Get blending equations
 		const u32 blendControl = regs[PICA::InternalRegs::BlendFunc];
-		const u32 rgbEquation = blendControl & 0x7;
-		const u32 alphaEquation = getBits<8, 3>(blendControl);
+		blendState.rgbEquation = blendingEquations[blendControl & 0x7];
+		blendState.alphaEquation = blendingEquations[getBits<8, 3>(blendControl)];
 
 		// Get blending functions
-		const u32 rgbSourceFunc = getBits<16, 4>(blendControl);
-		const u32 rgbDestFunc = getBits<20, 4>(blendControl);
-		const u32 alphaSourceFunc = getBits<24, 4>(blendControl);
-		const u32 alphaDestFunc = getBits<28, 4>(blendControl);
+		blendState.rgbSourceFunc = blendingFuncs[getBits<16, 4>(blendControl)];
+		blendState.rgbDestFunc = blendingFuncs[getBits<20, 4>(blendControl)];
+		blendState.alphaSourceFunc = blendingFuncs[getBits<24, 4>(blendControl)];
+		blendState.alphaDestFunc = blendingFuncs[getBits<28, 4>(blendControl)];
 
+		// The blend colour isn't tracked by our state manager, so only set it when it changes
 		const u32 constantColor = regs[PICA::InternalRegs::BlendColour];
 		const u32 r = constantColor & 0xff;
 		const u32 g = getBits<8, 8>(constantColor);
 		const u32 b = getBits<16, 8>(constantColor);
 		const u32 a = getBits<24, 8>(constantColor);
 		OpenGL::setBlendColor(float(r) / 255.f, float(g) / 255.f, float(b) / 255.f, float(a) / 255.f);
+	}
+
+	if (!blendState.blendingEnabled) {  // Logic ops are enabled
+		gl.setLogicOp(blendState.logicOp);
 
-		// Translate equations and funcs to their GL equivalents and set them
-		gl.setBlendEquation(blendingEquations[rgbEquation], blendingEquations[alphaEquation]);
-		gl.setBlendFunc(blendingFuncs[rgbSourceFunc], blendingFuncs[rgbDestFunc], blendingFuncs[alphaSourceFunc], blendingFuncs[alphaDestFunc]);
+		// If logic ops are enabled we don't need to disable blending because they override it
+		gl.enableLogicOp();
+	} else {
+		gl.enableBlend();
+		gl.disableLogicOp();
+
+		gl.setBlendEquation(blendState.rgbEquation, blendState.alphaEquation);
+		gl.setBlendFunc(blendState.rgbSourceFunc, blendState.rgbDestFunc, blendState.alphaSourceFunc, blendState.alphaDestFunc);
 	}
 }
 
@@ -268,37 +294,63 @@ void RendererGL::setupStencilTest(bool stencilEnable) {
 		return;
 	}
 
-	static constexpr std::array<GLenum, 8> stencilFuncs = {
-		GL_NEVER, GL_ALWAYS, GL_EQUAL, GL_NOTEQUAL, GL_LESS, GL_LEQUAL, GL_GREATER, GL_GEQUAL,
-	};
 	gl.enableStencil();
 
-	const u32 stencilConfig = regs[PICA::InternalRegs::StencilTest];
-	const u32 stencilFunc = getBits<4, 3>(stencilConfig);
-	const s32 reference = s8(getBits<16, 8>(stencilConfig));  // Signed reference value
-	const u32 stencilRefMask = getBits<24, 8>(stencilConfig);
+	if (pendingDirtyState.stencil & PICA::DirtyState::Stencil) {
+		pendingDirtyState.stencil = 0;
 
-	const bool stencilWrite = regs[PICA::InternalRegs::DepthBufferWrite];
-	const u32 stencilBufferMask = stencilWrite ? getBits<8, 8>(stencilConfig) : 0;
+		static constexpr std::array<GLenum, 8> stencilFuncs = {
+			GL_NEVER, GL_ALWAYS, GL_EQUAL, GL_NOTEQUAL, GL_LESS, GL_LEQUAL, GL_GREATER, GL_GEQUAL,
+		};
+
+		static constexpr std::array<GLenum, 8> stencilOps = {
+			GL_KEEP, GL_ZERO, GL_REPLACE, GL_INCR, GL_DECR, GL_INVERT, GL_INCR_WRAP, GL_DECR_WRAP,
+		};
 
-	// TODO: Throw stencilFunc/stencilOp to the GL state manager
-	glStencilFunc(stencilFuncs[stencilFunc], reference, stencilRefMask);
-	gl.setStencilMask(stencilBufferMask);
+		const u32 stencilConfig = regs[PICA::InternalRegs::StencilTest];
+		stencilState.func = stencilFuncs[getBits<4, 3>(stencilConfig)];
+		stencilState.reference = s8(getBits<16, 8>(stencilConfig));  // Signed reference value
+		stencilState.referenceMask = getBits<24, 8>(stencilConfig);
 
-	static constexpr std::array<GLenum, 8> stencilOps = {
-		GL_KEEP, GL_ZERO, GL_REPLACE, GL_INCR, GL_DECR, GL_INVERT, GL_INCR_WRAP, GL_DECR_WRAP,
-	};
+		const bool stencilWrite = regs[PICA::InternalRegs::DepthBufferWrite];
+		stencilState.writeMask = stencilWrite ? getBits<8, 8>(stencilConfig) : 0;
 
-	const u32 stencilOpConfig = regs[PICA::InternalRegs::StencilOp];
-	const u32 stencilFailOp = getBits<0, 3>(stencilOpConfig);
-	const u32 depthFailOp = getBits<4, 3>(stencilOpConfig);
-	const u32 passOp = getBits<8, 3>(stencilOpConfig);
+		const u32 stencilOpConfig = regs[PICA::InternalRegs::StencilOp];
+		stencilState.stencilFailOp = stencilOps[getBits<0, 3>(stencilOpConfig)];
+		stencilState.depthFailOp = stencilOps[getBits<4, 3>(stencilOpConfig)];
+		stencilState.passOp = stencilOps[getBits<8, 3>(stencilOpConfig)];
 
-	glStencilOp(stencilOps[stencilFailOp], stencilOps[depthFailOp], stencilOps[passOp]);
+		// TODO: Throw stencilFunc/stencilOp to the GL state manager. Until then, we only touch them when the PICA state changes
+		glStencilFunc(stencilState.func, stencilState.reference, stencilState.referenceMask);
+		glStencilOp(stencilState.stencilFailOp, stencilState.depthFailOp, stencilState.passOp);
+	}
+
+	gl.setStencilMask(stencilState.writeMask);
+}
+
+void RendererGL::collectDirtyState() {
+	const u32 dirty = gpu.dirtyState;
+	gpu.dirtyState = 0;
+
+	pendingDirtyState.fragmentShader |= dirty;
+	pendingDirtyState.fragmentUniforms |= dirty;
+	pendingDirtyState.blending |= dirty;
+	pendingDirtyState.stencil |= dirty;
+	pendingDirtyState.ubershader |= dirty;
+}
+
+void RendererGL::invalidateDerivedState() {
+	pendingDirtyState.fragmentShader = PICA::DirtyState::All;
+	pendingDirtyState.fragmentUniforms = PICA::DirtyState::All;
+	pendingDirtyState.blending = PICA::DirtyState::All;
+	pendingDirtyState.stencil = PICA::DirtyState::All;
+	pendingDirtyState.ubershader = PICA::DirtyState::All;
+	currentFragmentShader = nullptr;
+	lastUbershaderProgram = 0;
 }
 
-void RendererGL::setupUbershaderTexEnv() {
-	// TODO: Only update uniforms when the TEV config changed. Use an UBO potentially.
+void RendererGL::setupUbershaderTexEnv(const UbershaderUniforms& uniforms) {
+	// TODO: Use an UBO potentially.
 	static constexpr std::array<u32, 6> ioBases = {
 		PICA::InternalRegs::TexEnv0Source, PICA::InternalRegs::TexEnv1Source, PICA::InternalRegs::TexEnv2Source,
 		PICA::InternalRegs::TexEnv3Source, PICA::InternalRegs::TexEnv4Source, PICA::InternalRegs::TexEnv5Source,
@@ -320,11 +372,11 @@ void RendererGL::setupUbershaderTexEnv() {
 		textureEnvScaleRegs[i] = regs[ioBase + 4];
 	}
 
-	glUniform1uiv(ubershaderData.textureEnvSourceLoc, 6, textureEnvSourceRegs);
-	glUniform1uiv(ubershaderData.textureEnvOperandLoc, 6, textureEnvOperandRegs);
-	glUniform1uiv(ubershaderData.textureEnvCombinerLoc, 6, textureEnvCombinerRegs);
-	glUniform1uiv(ubershaderData.textureEnvColorLoc, 6, textureEnvColourRegs);
-	glUniform1uiv(ubershaderData.textureEnvScaleLoc, 6, textureEnvScaleRegs);
+	glUniform1uiv(uniforms.textureEnvSourceLoc, 6, textureEnvSourceRegs);
+	glUniform1uiv(uniforms.textureEnvOperandLoc, 6, textureEnvOperandRegs);
+	glUniform1uiv(uniforms.textureEnvCombinerLoc, 6, textureEnvCombinerRegs);
+	glUniform1uiv(uniforms.textureEnvColorLoc, 6, textureEnvColourRegs);
+	glUniform1uiv(uniforms.textureEnvScaleLoc, 6, textureEnvScaleRegs);
 }
 
 void RendererGL::bindTexturesToSlots() {
@@ -421,7 +473,95 @@ void RendererGL::updateFogLUT() {
 	glActiveTexture(GL_TEXTURE0);
 }
 
+// Number of vertices needed to represent a draw of the given primitive type as a triangle list
+static usize triangleListSize(PICA::PrimType primType, usize vertexCount) {
+	switch (primType) {
+		case PICA::PrimType::TriangleStrip:
+		case PICA::PrimType::TriangleFan: return vertexCount >= 3 ? (vertexCount - 2) * 3 : 0;
+		default: return vertexCount - (vertexCount % 3);
+	}
+}
+
+// Append the triangles of a draw to a triangle list. We don't do any face culling, so we don't need to care about preserving winding order
+static void appendAsTriangleList(std::vector<Vertex>& out, PICA::PrimType primType, std::span<const Vertex> vertices) {
+	const usize vertexCount = vertices.size();
+
+	switch (primType) {
+		case PICA::PrimType::TriangleStrip:
+			for (usize i = 0; i + 2 < vertexCount; i++) {
+				out.push_back(vertices[i]);
+				out.push_back(vertices[i + 1]);
+				out.push_back(vertices[i + 2]);
+			}
+			break;
+
+		case PICA::PrimType::TriangleFan:
+			for (usize i = 1; i + 1 < vertexCount; i++) {
+				out.push_back(vertices[0]);
+				out.push_back(vertices[i]);
+				out.push_back(vertices[i + 1]);
+			}
+			break;
+
+		default: out.insert(out.end(), vertices.begin(), vertices.begin() + triangleListSize(primType, vertexCount)); break;
+	}
+}
+
 void RendererGL::drawVertices(PICA::PrimType primType, std::span<const Vertex> vertices) {
+	// Draws using hw shaders have their vertex data in our hw VBO rather than in the vertex array, so we can't batch them
+	if (!emulatorConfig->drawBatchingEnabled || usingAcceleratedShader) {
+		flushDraws();
+		issueDraw(primType, vertices);
+		return;
+	}
+
+	// prepareForDraw has already flushed the batch if the rasterizer state changed, so anything that's still in it can be merged with this draw
+	if (drawBatch.vertices.empty()) {
+		if (vertices.size() > maxBatchedVertices) [[unlikely]] {
+			issueDraw(primType, vertices);
+			return;
+		}
+
+		// Keep the first draw of a batch in its original topology, so that we don't pay for the conversion if nothing gets merged with it
+		drawBatch.vertices.assign(vertices.begin(), vertices.end());
+		drawBatch.primType = primType;
+		drawsPending = true;
+		return;
+	}
+
+	const usize batchSize = triangleListSize(drawBatch.primType, drawBatch.vertices.size());
+	const usize drawSize = triangleListSize(primType, vertices.size());
+
+	if (batchSize + drawSize > maxBatchedVertices) {
+		flushDraws();
+		drawVertices(primType, vertices);
+		return;
+	}
+
+	if (drawBatch.primType != PICA::PrimType::TriangleList) {
+		std::vector<Vertex> batchVertices = std::move(drawBatch.vertices);
+		drawBatch.vertices.clear();
+		drawBatch.vertices.reserve(batchSize + drawSize);
+
+		appendAsTriangleList(drawBatch.vertices, drawBatch.primType, batchVertices);
+		drawBatch.primType = PICA::PrimType::TriangleList;
+	}
+
+	appendAsTriangleList(drawBatch.vertices, primType, vertices);
+}
+
+void RendererGL::flushDraws() {
+	if (!drawsPending) {
+		return;
+	}
+
+	// Clear the pending flag first, as nothing in issueDraw should be able to flush again
+	drawsPending = false;
+	issueDraw(drawBatch.primType, drawBatch.vertices);
+	drawBatch.vertices.clear();
+}
+
+void RendererGL::issueDraw(PICA::PrimType primType, std::span<const Vertex> vertices) {
 	// The fourth type is meant to be "Geometry primitive". TODO: Find out what that is
 	static constexpr std::array<OpenGL::Primitives, 4> primTypes = {
 		OpenGL::Triangle,
@@ -445,8 +585,7 @@ void RendererGL::drawVertices(PICA::PrimType primType, std::span<const Vertex> v
 	}
 
 	setupBlending();
-	auto poop = getColourBuffer(colourBufferLoc, colourBufferFormat, fbSize[0], fbSize[1]);
-	poop->fbo.bind(OpenGL::DrawAndReadFramebuffer);
+	auto poop = bindDrawColourBuffer();
 
 	const u32 depthControl = regs[PICA::InternalRegs::DepthAndColorMask];
 	const bool depthWrite = regs[PICA::InternalRegs::DepthBufferWrite];
@@ -509,7 +648,7 @@ void RendererGL::drawVertices(PICA::PrimType primType, std::span<const Vertex> v
 	} else {
 		if (performIndexedRender) {
 			// When doing indexed rendering, use glDrawRangeElementsBaseVertex to issue the indexed draw
-			hwIndexBuffer->Bind();
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hwIndexBufferHandle);
 
 			if (glDrawRangeElementsBaseVertex != nullptr) [[likely]] {
 				glDrawRangeElementsBaseVertex(
@@ -531,7 +670,43 @@ void RendererGL::drawVertices(PICA::PrimType primType, std::span<const Vertex> v
 	}
 }
 
+ColourBuffer* RendererGL::bindDrawColourBuffer() {
+	ColourBuffer* colourBuffer = getColourBuffer(colourBufferLoc, colourBufferFormat, fbSize[0], fbSize[1]);
+	loadSurface(*colourBuffer);
+	colourBuffer->fbo.bind(OpenGL::DrawAndReadFramebuffer);
+	markSurfaceRendered(*colourBuffer);
+
+	return colourBuffer;
+}
+
+void RendererGL::skipDraw() {
+	// Do the surface cache work of issueDraw without drawing anything, so that the colour and depth buffers of the draw exist, are loaded from
+	// memory and are known to have been rendered to, like they would be if this frame was drawn
+	bindDrawColourBuffer();
+
+	const u32 depthControl = regs[PICA::InternalRegs::DepthAndColorMask];
+	const bool depthEnable = depthControl & 1;
+	const bool depthWriteEnable = getBit<12>(depthControl);
+	const bool stencilEnable = getBit<0>(regs[PICA::InternalRegs::StencilTest]);
+
+	if (depthEnable || depthWriteEnable || stencilEnable) {
+		bindDepthBuffer();
+	}
+}
+
 void RendererGL::display() {
+	flushDraws();
+	commitVRAMWatches();
+
+	// Start reading back the colour buffers that the CPU has accessed after rendering before, so the data is likely to be ready by the time
+	// it does so again
+	for (usize i = 0; i < colourBufferCacheSize; i++) {
+		ColourBuffer& surface = colourBufferCache[i];
+		if (surface.valid && surface.gpuDirty && surface.prefetchReadback && surface.readbackFence == nullptr) {
+			queueSurfaceReadback(surface);
+		}
+	}
+
 	gl.disableScissor();
 	gl.disableBlend();
 	gl.disableDepth();
@@ -554,6 +729,7 @@ void RendererGL::display() {
 	auto topScreen = colourBufferCache.findFromAddress(topScreenAddr);
 
 	if (topScreen) {
+		loadSurface(topScreen->get());
 		topScreen->get().texture.bind();
 		OpenGL::setViewport(0, 240, 400, 240);   // Top screen viewport
 		OpenGL::draw(OpenGL::TriangleStrip, 4);  // Actually draw our 3DS screen
@@ -564,6 +740,7 @@ void RendererGL::display() {
 	auto bottomScreen = colourBufferCache.findFromAddress(bottomScreenAddr);
 
 	if (bottomScreen) {
+		loadSurface(bottomScreen->get());
 		bottomScreen->get().texture.bind();
 		OpenGL::setViewport(40, 0, 320, 240);
 		OpenGL::draw(OpenGL::TriangleStrip, 4);
@@ -625,9 +802,17 @@ void RendererGL::display() {
 			);
 		}
 	}
+
+	// A new frame has been displayed. When streaming, queue up its readback, otherwise the readbacks in the ring are stale
+	if (frameStreaming) {
+		queueFrameReadback();
+	} else {
+		consecutiveReadbacks = 0;
+	}
 }
 
 void RendererGL::clearBuffer(u32 startAddress, u32 endAddress, u32 value, u32 control) {
+	flushDraws();
 	log("GPU: Clear buffer\nStart: %08X End: %08X\nValue: %08X Control: %08X\n", startAddress, endAddress, value, control);
 	gl.disableScissor();
 
@@ -642,6 +827,10 @@ void RendererGL::clearBuffer(u32 startAddress, u32 endAddress, u32 value, u32 co
 		gl.setColourMask(true, true, true, true);
 		gl.setClearColour(r, g, b, a);
 		OpenGL::clearColor();
+
+		// The clear overwrites the whole buffer, so there's no need to load it from memory first
+		color->get().needsUpload = false;
+		markSurfaceRendered(color->get());
 		return;
 	}
 
@@ -724,8 +913,28 @@ OpenGL::Texture RendererGL::getTexture(Texture& tex) {
 
 		const auto textureData = std::span{startPointer, tex.sizeInBytes()};  // Get pointer to the texture data in 3DS memory
 		Texture& newTex = textureCache.add(tex);
-		newTex.decodeTexture(textureData);
 
+		// Decoding is slow, so check if this instance or another one running in the same process has already decoded the same texture
+		auto& decodedCache = gpu.getSharedCaches().textures;
+		struct {
+			u64 dataHash;
+			u32 format;
+			u32 size;
+		} key = {
+			.dataHash = (tex.hash != 0) ? tex.hash : PICAHash::computeHash((const char*)startPointer, sizeInBytes),
+			.format = u32(tex.format),
+			.size = (tex.size.u() << 16) | tex.size.v(),
+		};
+		const u64 keyHash = PICAHash::computeHash((const char*)&key, sizeof(key));
+
+		auto decoded = decodedCache.find(keyHash);
+		if (!decoded) {
+			auto newDecoded = std::make_shared<std::vector<u32>>(newTex.decodeTexture(textureData));
+			const usize cost = newDecoded->size() * sizeof(u32);
+			decoded = decodedCache.insert(keyHash, std::move(newDecoded), cost);
+		}
+
+		newTex.upload(*decoded);
 		return newTex.texture;
 	}
 }
@@ -740,6 +949,7 @@ PICA::ColorFmt ToColorFmt(u32 format) {
 }
 
 void RendererGL::displayTransfer(u32 inputAddr, u32 outputAddr, u32 inputSize, u32 outputSize, u32 flags) {
+	flushDraws();
 	const u32 inputWidth = inputSize & 0xffff;
 	const u32 inputHeight = inputSize >> 16;
 	const auto inputFormat = ToColorFmt(Helpers::getBits<8, 3>(flags));
@@ -778,6 +988,9 @@ void RendererGL::displayTransfer(u32 inputAddr, u32 outputAddr, u32 inputSize, u
 		// Helpers::warn("Strided display transfer is not handled correctly!\n");
 	}
 
+	loadSurface(*srcFramebuffer);
+	loadSurface(*destFramebuffer);
+
 	// Blit the framebuffers
 	srcFramebuffer->fbo.bind(OpenGL::ReadFramebuffer);
 	destFramebuffer->fbo.bind(OpenGL::DrawFramebuffer);
@@ -787,9 +1000,11 @@ void RendererGL::displayTransfer(u32 inputAddr, u32 outputAddr, u32 inputSize, u
 		srcRect.left, srcRect.bottom, srcRect.right, srcRect.top, destRect.left, destRect.bottom, destRect.right, destRect.top, GL_COLOR_BUFFER_BIT,
 		GL_LINEAR
 	);
+	markSurfaceRendered(*destFramebuffer);
 }
 
 void RendererGL::textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32 inputSize, u32 outputSize, u32 flags) {
+	flushDraws();
 	// Texture copy size is aligned to 16 byte units
 	const u32 copySize = totalBytes & ~0xf;
 	if (copySize == 0) {
@@ -844,13 +1059,18 @@ void RendererGL::textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32
 	// Find the source surface.
 	auto srcFramebuffer = getColourBuffer(inputAddr, PICA::ColorFmt::RGBA8, copyStride, copyHeight, false);
 	if (!srcFramebuffer) {
-		static int shutUpCounter = 0;  // Don't want to spam the console too much, so shut up after 5 times
+		// Don't want to spam the console too much, so shut up after 5 times. Shared by all instances, hence atomic
+		static std::atomic<int> shutUpCounter = 0;
 
-		if (shutUpCounter < 5) {
-			shutUpCounter++;
+		if (shutUpCounter.fetch_add(1, std::memory_order_relaxed) < 5) {
 			printf("RendererGL::TextureCopy failed to locate src framebuffer!\n");
 		}
 
+		// The copy goes through memory, so write back any colour buffers it reads from and reload any it writes to
+		const u32 lineCount = (copySize + inputWidth - 1) / inputWidth;
+		notifyVRAMAccess(inputAddr, lineCount * (inputWidth + inputGap), false);
+		notifyVRAMAccess(outputAddr, lineCount * (outputWidth + outputGap), true);
+
 		doSoftwareTextureCopy(inputAddr, outputAddr, copySize, inputWidth, inputGap, outputWidth, outputGap);
 		return;
 	}
@@ -862,6 +1082,9 @@ void RendererGL::textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32
 	auto destFramebuffer = getColourBuffer(outputAddr, srcFramebuffer->format, copyWidth, copyHeight);
 	Math::Rect<u32> destRect = destFramebuffer->getSubRect(outputAddr, copyWidth, copyHeight);
 
+	loadSurface(*srcFramebuffer);
+	loadSurface(*destFramebuffer);
+
 	// Blit the framebuffers
 	srcFramebuffer->fbo.bind(OpenGL::ReadFramebuffer);
 	destFramebuffer->fbo.bind(OpenGL::DrawFramebuffer);
@@ -871,42 +1094,49 @@ void RendererGL::textureCopy(u32 inputAddr, u32 outputAddr, u32 totalBytes, u32
 		srcRect.left, srcRect.bottom, srcRect.right, srcRect.top, destRect.left, destRect.bottom, destRect.right, destRect.top, GL_COLOR_BUFFER_BIT,
 		GL_LINEAR
 	);
+	markSurfaceRendered(*destFramebuffer);
 }
 
-std::optional<ColourBuffer> RendererGL::getColourBuffer(u32 addr, PICA::ColorFmt format, u32 width, u32 height, bool createIfnotFound) {
+ColourBuffer* RendererGL::getColourBuffer(u32 addr, PICA::ColorFmt format, u32 width, u32 height, bool createIfnotFound) {
 	// Try to find an already existing buffer that contains the provided address
 	// This is a more relaxed check compared to getColourFBO as display transfer/texcopy may refer to
 	// subrect of a surface and in case of texcopy we don't know the format of the surface.
 	auto buffer = colourBufferCache.findFromAddress(addr);
 	if (buffer.has_value()) {
-		return buffer.value().get();
+		return &buffer.value().get();
 	}
 
 	if (!createIfnotFound) {
-		return std::nullopt;
+		return nullptr;
 	}
 
 	// Otherwise create and cache a new buffer.
 	ColourBuffer sampleBuffer(addr, format, width, height);
-	return colourBufferCache.add(sampleBuffer);
+	return &colourBufferCache.add(sampleBuffer);
 }
 
 OpenGL::Program& RendererGL::getSpecializedShader() {
-	constexpr uint vsUBOBlockBinding = 1;
-	constexpr uint fsUBOBlockBinding = 2;
+	// Only rebuild the fragment config and look it up in the shader cache if any of the registers it depends on changed
+	if (currentFragmentShader == nullptr || (pendingDirtyState.fragmentShader & PICA::DirtyState::FragmentConfig)) {
+		pendingDirtyState.fragmentShader = 0;
+
+		PICA::FragmentConfig fsConfig(regs);
+		// If we're not on GLES, ignore the logic op configuration and don't generate redundant shaders for it, since we use hw logic ops
+		if (!driverInfo.usingGLES) {
+			fsConfig.outConfig.logicOpMode = PICA::LogicOpMode(0);
+		}
 
-	PICA::FragmentConfig fsConfig(regs);
-	// If we're not on GLES, ignore the logic op configuration and don't generate redundant shaders for it, since we use hw logic ops
-	if (!driverInfo.usingGLES) {
-		fsConfig.outConfig.logicOpMode = PICA::LogicOpMode(0);
-	}
+		OpenGL::Shader& shader = shaderCache.fragmentShaderCache[fsConfig];
+		if (!shader.exists()) {
+			std::string fs = fragShaderGen.generate(fsConfig);
+			shader.create({fs.c_str(), fs.size()}, OpenGL::Fragment);
+		}
 
-	OpenGL::Shader& fragShader = shaderCache.fragmentShaderCache[fsConfig];
-	if (!fragShader.exists()) {
-		std::string fs = fragShaderGen.generate(fsConfig);
-		fragShader.create({fs.c_str(), fs.size()}, OpenGL::Fragment);
+		currentFragmentShader = &shader;
 	}
 
+	OpenGL::Shader& fragShader = *currentFragmentShader;
+
 	// Get the handle of the current vertex shader
 	OpenGL::Shader& vertexShader = usingAcceleratedShader ? *generatedVertexShader : defaultShadergenVs;
 	// And form the key for looking up a shader program
@@ -936,62 +1166,65 @@ OpenGL::Program& RendererGL::getSpecializedShader() {
 		}
 	}
 
-	// Upload uniform data to our shader's UBO
-	PICA::FragmentUniforms uniforms;
-	uniforms.alphaReference = Helpers::getBits<8, 8>(regs[InternalRegs::AlphaTestConfig]);
-
-	// Set up the texenv buffer color
-	const u32 texEnvBufferColor = regs[InternalRegs::TexEnvBufferColor];
-	uniforms.tevBufferColor[0] = float(texEnvBufferColor & 0xFF) / 255.0f;
-	uniforms.tevBufferColor[1] = float((texEnvBufferColor >> 8) & 0xFF) / 255.0f;
-	uniforms.tevBufferColor[2] = float((texEnvBufferColor >> 16) & 0xFF) / 255.0f;
-	uniforms.tevBufferColor[3] = float((texEnvBufferColor >> 24) & 0xFF) / 255.0f;
-
-	uniforms.depthScale = f24::fromRaw(regs[PICA::InternalRegs::DepthScale] & 0xffffff).toFloat32();
-	uniforms.depthOffset = f24::fromRaw(regs[PICA::InternalRegs::DepthOffset] & 0xffffff).toFloat32();
-
-	if (regs[InternalRegs::ClipEnable] & 1) {
-		uniforms.clipCoords[0] = f24::fromRaw(regs[PICA::InternalRegs::ClipData0] & 0xffffff).toFloat32();
-		uniforms.clipCoords[1] = f24::fromRaw(regs[PICA::InternalRegs::ClipData1] & 0xffffff).toFloat32();
-		uniforms.clipCoords[2] = f24::fromRaw(regs[PICA::InternalRegs::ClipData2] & 0xffffff).toFloat32();
-		uniforms.clipCoords[3] = f24::fromRaw(regs[PICA::InternalRegs::ClipData3] & 0xffffff).toFloat32();
-	}
-
-	// Set up the constant color for the 6 TEV stages
-	for (int i = 0; i < 6; i++) {
-		static constexpr std::array<u32, 6> ioBases = {
-			PICA::InternalRegs::TexEnv0Source, PICA::InternalRegs::TexEnv1Source, PICA::InternalRegs::TexEnv2Source,
-			PICA::InternalRegs::TexEnv3Source, PICA::InternalRegs::TexEnv4Source, PICA::InternalRegs::TexEnv5Source,
-		};
-
-		auto& vec = uniforms.constantColors[i];
-		u32 base = ioBases[i];
-		u32 color = regs[base + 3];
-
-		vec[0] = float(color & 0xFF) / 255.0f;
-		vec[1] = float((color >> 8) & 0xFF) / 255.0f;
-		vec[2] = float((color >> 16) & 0xFF) / 255.0f;
-		vec[3] = float((color >> 24) & 0xFF) / 255.0f;
-	}
-
-	uniforms.fogColor = regs[PICA::InternalRegs::FogColor];
+	// Rebuild the uniform data and upload it to our shader's UBO if it's changed. Otherwise, the data from the last upload is still in the UBO
+	if (pendingDirtyState.fragmentUniforms & PICA::DirtyState::FragmentUniforms) {
+		pendingDirtyState.fragmentUniforms = 0;
+		fragmentUniforms = {};
+		auto& uniforms = fragmentUniforms;
+		uniforms.alphaReference = Helpers::getBits<8, 8>(regs[InternalRegs::AlphaTestConfig]);
+
+		// Set up the texenv buffer color
+		const u32 texEnvBufferColor = regs[InternalRegs::TexEnvBufferColor];
+		uniforms.tevBufferColor[0] = float(texEnvBufferColor & 0xFF) / 255.0f;
+		uniforms.tevBufferColor[1] = float((texEnvBufferColor >> 8) & 0xFF) / 255.0f;
+		uniforms.tevBufferColor[2] = float((texEnvBufferColor >> 16) & 0xFF) / 255.0f;
+		uniforms.tevBufferColor[3] = float((texEnvBufferColor >> 24) & 0xFF) / 255.0f;
+
+		uniforms.depthScale = f24::fromRaw(regs[PICA::InternalRegs::DepthScale] & 0xffffff).toFloat32();
+		uniforms.depthOffset = f24::fromRaw(regs[PICA::InternalRegs::DepthOffset] & 0xffffff).toFloat32();
+
+		if (regs[InternalRegs::ClipEnable] & 1) {
+			uniforms.clipCoords[0] = f24::fromRaw(regs[PICA::InternalRegs::ClipData0] & 0xffffff).toFloat32();
+			uniforms.clipCoords[1] = f24::fromRaw(regs[PICA::InternalRegs::ClipData1] & 0xffffff).toFloat32();
+			uniforms.clipCoords[2] = f24::fromRaw(regs[PICA::InternalRegs::ClipData2] & 0xffffff).toFloat32();
+			uniforms.clipCoords[3] = f24::fromRaw(regs[PICA::InternalRegs::ClipData3] & 0xffffff).toFloat32();
+		}
 
-	// Append lighting uniforms
-	if (fsConfig.lighting.enable) {
-		uniforms.globalAmbientLight = regs[InternalRegs::LightGlobalAmbient];
-		for (int i = 0; i < 8; i++) {
-			auto& light = uniforms.lightUniforms[i];
-			const u32 specular0 = regs[InternalRegs::Light0Specular0 + i * 0x10];
-			const u32 specular1 = regs[InternalRegs::Light0Specular1 + i * 0x10];
-			const u32 diffuse = regs[InternalRegs::Light0Diffuse + i * 0x10];
-			const u32 ambient = regs[InternalRegs::Light0Ambient + i * 0x10];
-			const u32 lightXY = regs[InternalRegs::Light0XY + i * 0x10];
-			const u32 lightZ = regs[InternalRegs::Light0Z + i * 0x10];
+		// Set up the constant color for the 6 TEV stages
+		for (int i = 0; i < 6; i++) {
+			static constexpr std::array<u32, 6> ioBases = {
+				PICA::InternalRegs::TexEnv0Source, PICA::InternalRegs::TexEnv1Source, PICA::InternalRegs::TexEnv2Source,
+				PICA::InternalRegs::TexEnv3Source, PICA::InternalRegs::TexEnv4Source, PICA::InternalRegs::TexEnv5Source,
+			};
+
+			auto& vec = uniforms.constantColors[i];
+			u32 base = ioBases[i];
+			u32 color = regs[base + 3];
+
+			vec[0] = float(color & 0xFF) / 255.0f;
+			vec[1] = float((color >> 8) & 0xFF) / 255.0f;
+			vec[2] = float((color >> 16) & 0xFF) / 255.0f;
+			vec[3] = float((color >> 24) & 0xFF) / 255.0f;
+		}
 
-			const u32 spotlightXY = regs[InternalRegs::Light0SpotlightXY + i * 0x10];
-			const u32 spotlightZ = regs[InternalRegs::Light0SpotlightZ + i * 0x10];
-			const u32 attenuationBias = regs[InternalRegs::Light0AttenuationBias + i * 0x10];
-			const u32 attenuationScale = regs[InternalRegs::Light0AttenuationScale + i * 0x10];
+		uniforms.fogColor = regs[PICA::InternalRegs::FogColor];
+
+		// Append lighting uniforms
+		if (regs[InternalRegs::LightingEnable] & 1) {
+			uniforms.globalAmbientLight = regs[InternalRegs::LightGlobalAmbient];
+			for (int i = 0; i < 8; i++) {
+				auto& light = uniforms.lightUniforms[i];
+				const u32 specular0 = regs[InternalRegs::Light0Specular0 + i * 0x10];
+				const u32 specular1 = regs[InternalRegs::Light0Specular1 + i * 0x10];
+				const u32 diffuse = regs[InternalRegs::Light0Diffuse + i * 0x10];
+				const u32 ambient = regs[InternalRegs::Light0Ambient + i * 0x10];
+				const u32 lightXY = regs[InternalRegs::Light0XY + i * 0x10];
+				const u32 lightZ = regs[InternalRegs::Light0Z + i * 0x10];
+
+				const u32 spotlightXY = regs[InternalRegs::Light0SpotlightXY + i * 0x10];
+				const u32 spotlightZ = regs[InternalRegs::Light0SpotlightZ + i * 0x10];
+				const u32 attenuationBias = regs[InternalRegs::Light0AttenuationBias + i * 0x10];
+				const u32 attenuationScale = regs[InternalRegs::Light0AttenuationScale + i * 0x10];
 
 #define lightColorToVec3(value)                         \
 	{                                                   \
@@ -999,34 +1232,36 @@ OpenGL::Program& RendererGL::getSpecializedShader() {
 		float(Helpers::getBits<10, 8>(value)) / 255.0f, \
 		float(Helpers::getBits<0, 8>(value)) / 255.0f,  \
 	}
-			light.specular0 = lightColorToVec3(specular0);
-			light.specular1 = lightColorToVec3(specular1);
-			light.diffuse = lightColorToVec3(diffuse);
-			light.ambient = lightColorToVec3(ambient);
-			light.position[0] = Floats::f16::fromRaw(u16(lightXY)).toFloat32();
-			light.position[1] = Floats::f16::fromRaw(u16(lightXY >> 16)).toFloat32();
-			light.position[2] = Floats::f16::fromRaw(u16(lightZ)).toFloat32();
-
-			// Fixed point 1.11.1 to float, without negation
-			light.spotlightDirection[0] = float(s32(spotlightXY & 0x1FFF) << 19 >> 19) / 2047.0;
-			light.spotlightDirection[1] = float(s32((spotlightXY >> 16) & 0x1FFF) << 19 >> 19) / 2047.0;
-			light.spotlightDirection[2] = float(s32(spotlightZ & 0x1FFF) << 19 >> 19) / 2047.0;
-
-			light.distanceAttenuationBias = Floats::f20::fromRaw(attenuationBias & 0xFFFFF).toFloat32();
-			light.distanceAttenuationScale = Floats::f20::fromRaw(attenuationScale & 0xFFFFF).toFloat32();
+				light.specular0 = lightColorToVec3(specular0);
+				light.specular1 = lightColorToVec3(specular1);
+				light.diffuse = lightColorToVec3(diffuse);
+				light.ambient = lightColorToVec3(ambient);
+				light.position[0] = Floats::f16::fromRaw(u16(lightXY)).toFloat32();
+				light.position[1] = Floats::f16::fromRaw(u16(lightXY >> 16)).toFloat32();
+				light.position[2] = Floats::f16::fromRaw(u16(lightZ)).toFloat32();
+
+				// Fixed point 1.11.1 to float, without negation
+				light.spotlightDirection[0] = float(s32(spotlightXY & 0x1FFF) << 19 >> 19) / 2047.0;
+				light.spotlightDirection[1] = float(s32((spotlightXY >> 16) & 0x1FFF) << 19 >> 19) / 2047.0;
+				light.spotlightDirection[2] = float(s32(spotlightZ & 0x1FFF) << 19 >> 19) / 2047.0;
+
+				light.distanceAttenuationBias = Floats::f20::fromRaw(attenuationBias & 0xFFFFF).toFloat32();
+				light.distanceAttenuationScale = Floats::f20::fromRaw(attenuationScale & 0xFFFFF).toFloat32();
 #undef lightColorToVec3
+			}
 		}
-	}
 
-	// Upload fragment uniforms to UBO
-	shadergenFragmentUBO->Bind();
-	auto uboRes = shadergenFragmentUBO->Map(driverInfo.uboAlignment, sizeof(PICA::FragmentUniforms));
-	std::memcpy(uboRes.pointer, &uniforms, sizeof(PICA::FragmentUniforms));
-	shadergenFragmentUBO->Unmap(sizeof(PICA::FragmentUniforms));
+		// Upload fragment uniforms to UBO
+		shadergenFragmentUBO->Bind();
+		auto uboRes = shadergenFragmentUBO->Map(driverInfo.uboAlignment, sizeof(PICA::FragmentUniforms));
+		std::memcpy(uboRes.pointer, &uniforms, sizeof(PICA::FragmentUniforms));
+		shadergenFragmentUBO->Unmap(sizeof(PICA::FragmentUniforms));
+		fragmentUniformsOffset = uboRes.buffer_offset;
+	}
 
 	// Bind our UBOs
 	glBindBufferRange(
-		GL_UNIFORM_BUFFER, fsUBOBlockBinding, shadergenFragmentUBO->GetGLBufferId(), uboRes.buffer_offset, sizeof(PICA::FragmentUniforms)
+		GL_UNIFORM_BUFFER, fsUBOBlockBinding, shadergenFragmentUBO->GetGLBufferId(), fragmentUniformsOffset, sizeof(PICA::FragmentUniforms)
 	);
 
 	if (usingAcceleratedShader) {
@@ -1038,7 +1273,28 @@ OpenGL::Program& RendererGL::getSpecializedShader() {
 	return program;
 }
 
+RendererGL::CachedUbershaderProgram& RendererGL::getAcceleratedUbershader() {
+	CachedUbershaderProgram& programEntry = shaderCache.ubershaderProgramCache[generatedVertexShader->handle()];
+	OpenGL::Program& program = programEntry.program;
+
+	if (!program.exists()) {
+		program.create({*generatedVertexShader, ubershaderFragShader});
+		initUbershader(program, programEntry.uniforms);
+
+		uint vertexUBOIndex = glGetUniformBlockIndex(program.handle(), "PICAShaderUniforms");
+		glUniformBlockBinding(program.handle(), vertexUBOIndex, vsUBOBlockBinding);
+	}
+
+	glBindBufferRange(
+		GL_UNIFORM_BUFFER, vsUBOBlockBinding, hwShaderUniformUBO->GetGLBufferId(), hwShaderUniformUBOOffset, PICAShader::totalUniformSize()
+	);
+
+	return programEntry;
+}
+
 bool RendererGL::prepareForDraw(ShaderUnit& shaderUnit, PICA::DrawAcceleration* accel) {
+	collectDirtyState();
+
 	// First we figure out if we will be using an ubershader
 	bool usingUbershader = emulatorConfig->useUbershaders;
 	if (usingUbershader) {
@@ -1053,8 +1309,20 @@ bool RendererGL::prepareForDraw(ShaderUnit& shaderUnit, PICA::DrawAcceleration*
 	}
 
 	// Then we figure out if we will use hw accelerated shaders, and try to fetch our shader
-	// TODO: Ubershader support for accelerated shaders
-	usingAcceleratedShader = emulatorConfig->accelerateShaders && !usingUbershader && accel != nullptr && accel->canBeAccelerated;
+	const bool wantAcceleratedShader = emulatorConfig->accelerateShaders && accel != nullptr && accel->canBeAccelerated;
+
+	// If we've got batched draws, the GPU has already flushed them if any rasterizer register changed since they were queued.
+	// So if this draw is also CPU-shaded, all the state we'd set up below is already bound and the draw can be merged into the batch.
+	if (drawsPending) {
+		if (!wantAcceleratedShader) {
+			usingAcceleratedShader = false;
+			return false;
+		}
+
+		flushDraws();
+	}
+
+	usingAcceleratedShader = wantAcceleratedShader;
 
 	if (usingAcceleratedShader) {
 		PICA::VertConfig vertexConfig(shaderUnit.vs, regs, usingUbershader);
@@ -1067,7 +1335,8 @@ bool RendererGL::prepareForDraw(ShaderUnit& shaderUnit, PICA::DrawAcceleration*
 
 			std::string picaShaderSource = PICA::ShaderGen::decompileShader(
 				shaderUnit.vs, *emulatorConfig, shaderUnit.vs.entrypoint,
-				driverInfo.usingGLES ? PICA::ShaderGen::API::GLES : PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL
+				driverInfo.usingGLES ? PICA::ShaderGen::API::GLES : PICA::ShaderGen::API::GL, PICA::ShaderGen::Language::GLSL,
+				&shaderDecompilerStats
 			);
 
 			// Empty source means compilation error, if the source is not empty then we convert the recompiled PICA code into a valid shader and
@@ -1108,70 +1377,383 @@ bool RendererGL::prepareForDraw(ShaderUnit& shaderUnit, PICA::DrawAcceleration*
 		OpenGL::Program& program = getSpecializedShader();
 		gl.useProgram(program);
 	} else {  // Bind ubershader & load ubershader uniforms
-		gl.useProgram(triangleProgram);
+		// With accelerated shaders, the ubershader FS is linked with the recompiled vertex shader instead of the default ubershader VS
+		OpenGL::Program* program = &triangleProgram;
+		const UbershaderUniforms* uniforms = &ubershaderData;
+
+		if (usingAcceleratedShader) {
+			CachedUbershaderProgram& programEntry = getAcceleratedUbershader();
+			program = &programEntry.program;
+			uniforms = &programEntry.uniforms;
+		}
+
+		gl.useProgram(*program);
+
+		// Uniforms are stored per program, so if we switched ubershader programs since the last upload, upload everything again
+		const bool programChanged = program->handle() != lastUbershaderProgram;
+		if (programChanged) {
+			lastUbershaderProgram = program->handle();
+			pendingDirtyState.ubershader = PICA::DirtyState::All;
+		}
 
 		const float depthScale = f24::fromRaw(regs[PICA::InternalRegs::DepthScale] & 0xffffff).toFloat32();
 		const float depthOffset = f24::fromRaw(regs[PICA::InternalRegs::DepthOffset] & 0xffffff).toFloat32();
 		const bool depthMapEnable = regs[PICA::InternalRegs::DepthmapEnable] & 1;
 
-		if (oldDepthScale != depthScale) {
+		if (programChanged || oldDepthScale != depthScale) {
 			oldDepthScale = depthScale;
-			glUniform1f(ubershaderData.depthScaleLoc, depthScale);
+			glUniform1f(uniforms->depthScaleLoc, depthScale);
 		}
 
-		if (oldDepthOffset != depthOffset) {
+		if (programChanged || oldDepthOffset != depthOffset) {
 			oldDepthOffset = depthOffset;
-			glUniform1f(ubershaderData.depthOffsetLoc, depthOffset);
+			glUniform1f(uniforms->depthOffsetLoc, depthOffset);
 		}
 
-		if (oldDepthmapEnable != depthMapEnable) {
+		if (programChanged || oldDepthmapEnable != depthMapEnable) {
 			oldDepthmapEnable = depthMapEnable;
-			glUniform1i(ubershaderData.depthmapEnableLoc, depthMapEnable);
+			glUniform1i(uniforms->depthmapEnableLoc, depthMapEnable);
 		}
 
 		// Upload PICA Registers as a single uniform. The shader needs access to the rasterizer registers (for depth, starting from index 0x48)
 		// The texturing and the fragment lighting registers. Therefore we upload them all in one go to avoid multiple slow uniform updates
-		glUniform1uiv(ubershaderData.picaRegLoc, 0x200 - 0x48, &regs[0x48]);
-		setupUbershaderTexEnv();
+		// The uniforms persist in the program, so we can skip this if none of them changed since the last upload
+		if (pendingDirtyState.ubershader & PICA::DirtyState::Rasterizer) {
+			glUniform1uiv(uniforms->picaRegLoc, 0x200 - 0x48, &regs[0x48]);
+
+			if (pendingDirtyState.ubershader & PICA::DirtyState::TexEnv) {
+				setupUbershaderTexEnv(*uniforms);
+			}
+
+			pendingDirtyState.ubershader = 0;
+		}
 	}
 
 	return usingAcceleratedShader;
 }
 
 void RendererGL::screenshot(const std::string& name) {
-	constexpr uint width = 400;
-	constexpr uint height = 2 * 240;
-
-	std::vector<uint8_t> pixels, flippedPixels;
-	pixels.resize(width * height * 4);
-	flippedPixels.resize(pixels.size());
-
-	OpenGL::bindScreenFramebuffer();
-	glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, pixels.data());
-
-	// Flip the image vertically
-	for (int y = 0; y < height; y++) {
-		std::memcpy(&flippedPixels[y * width * 4], &pixels[(height - y - 1) * width * 4], width * 4);
-		// Swap R and B channels
-		for (int x = 0; x < width; x++) {
-			std::swap(flippedPixels[y * width * 4 + x * 4 + 0], flippedPixels[y * width * 4 + x * 4 + 2]);
-			// Set alpha to 0xFF
-			flippedPixels[y * width * 4 + x * 4 + 3] = 0xFF;
+	FrameCapture capture;
+	if (captureFrame(capture)) {
+		stbi_write_png(name.c_str(), capture.width, capture.height, 4, capture.pixels.data(), 0);
+	}
+}
+
+void RendererGL::queueFrameReadback() {
+	constexpr u32 width = 400;
+	constexpr u32 height = 2 * 240;
+
+	// Go around the ring, so that we don't write to the buffers the previous frames are being read back into
+	FrameReadback& readback = frameReadbacks[nextReadback];
+
+	if (readback.buffer == 0) {
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ);
+	} else {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	}
+
+	if (readback.fence != nullptr) {
+		glDeleteSync(readback.fence);
+	}
+
+	// With a pack buffer bound, glReadPixels only queues up the copy instead of waiting for it
+	screenFramebuffer.bind(OpenGL::ReadFramebuffer);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	nextReadback = (nextReadback + 1) % frameReadbackCount;
+	consecutiveReadbacks = std::min(consecutiveReadbacks + 1, frameReadbackCount);
+}
+
+bool RendererGL::captureFrame(FrameCapture& capture) {
+	constexpr u32 width = 400;
+	constexpr u32 height = 2 * 240;
+	constexpr usize rowSize = width * 4;
+
+	flushDraws();
+	usize index;
+
+	if (frameStreaming && consecutiveReadbacks >= 2) {
+		// Return the previous frame. The readback of the frame we just displayed was only queued this frame, and waiting for it would stall us
+		index = (nextReadback + frameReadbackCount - 2) % frameReadbackCount;
+	} else {
+		// Screenshots (and the first streamed frame) want the last displayed frame. If display() didn't read it back, read it now and wait for it
+		if (consecutiveReadbacks == 0) {
+			queueFrameReadback();
+		}
+
+		index = (nextReadback + frameReadbackCount - 1) % frameReadbackCount;
+	}
+
+	FrameReadback& readback = frameReadbacks[index];
+	if (readback.fence != nullptr) {
+		glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);  // Wait up to 1 second
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	const u8* data = static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowSize * height, GL_MAP_READ_BIT));
+	if (data == nullptr) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return false;
+	}
+
+	capture.width = width;
+	capture.height = height;
+	capture.pixels.resize(rowSize * height);
+
+	// We read back in RGBA order so there's no channel swapping to do, but GL images are bottom-up so we need to flip the rows
+	for (u32 y = 0; y < height; y++) {
+		std::memcpy(&capture.pixels[y * rowSize], data + (height - y - 1) * rowSize, rowSize);
+	}
+
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// The alpha channel of the output is meaningless, so make the frame fully opaque
+	for (usize i = 3; i < capture.pixels.size(); i += 4) {
+		capture.pixels[i] = 0xFF;
+	}
+
+	return true;
+}
+
+void RendererGL::releaseFrameReadbacks() {
+	for (auto& readback : frameReadbacks) {
+		if (readback.fence != nullptr) {
+			glDeleteSync(readback.fence);
+			readback.fence = nullptr;
+		}
+
+		if (readback.buffer != 0) {
+			glDeleteBuffers(1, &readback.buffer);
+			readback.buffer = 0;
+		}
+	}
+
+	nextReadback = 0;
+	consecutiveReadbacks = 0;
+}
+
+// Expand a range of memory to the pages it touches
+static Interval<u32> getPageRange(u32 start, u32 end) {
+	constexpr u32 pageMask = Memory::pageMask;
+	return Interval<u32>(start & ~pageMask, (end + pageMask) & ~pageMask);
+}
+
+void RendererGL::loadSurface(ColourBuffer& surface) {
+	if (!surface.needsUpload) {
+		return;
+	}
+
+	const u32 width = surface.size.x();
+	const u32 height = surface.size.y();
+	surfaceStagingBuffer.resize(usize(width) * height * 4);
+
+	const u8* source = gpu.getPointerPhys<u8>(surface.location, u32(surface.sizeInBytes()));
+	if (source != nullptr) [[likely]] {
+		PICA::SurfaceTiling::decode(surface.format, source, surfaceStagingBuffer.data(), width, height);
+	} else {
+		// Buffers outside of memory we know about start out opaque black
+		for (usize i = 0; i < surfaceStagingBuffer.size(); i += 4) {
+			surfaceStagingBuffer[i] = surfaceStagingBuffer[i + 1] = surfaceStagingBuffer[i + 2] = 0;
+			surfaceStagingBuffer[i + 3] = 0xff;
+		}
+	}
+
+	const auto prevTexture = OpenGL::getTex2D();
+	surface.texture.bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, surfaceStagingBuffer.data());
+	glBindTexture(GL_TEXTURE_2D, prevTexture);
+
+	surface.needsUpload = false;
+	updateVRAMWatch(surface.range);
+}
+
+void RendererGL::markSurfaceRendered(ColourBuffer& surface) {
+	// A readback we queued ahead of time doesn't include this rendering, so it's of no use anymore
+	if (surface.readbackFence != nullptr) {
+		glDeleteSync(surface.readbackFence);
+		surface.readbackFence = nullptr;
+	}
+
+	if (!surface.gpuDirty) {
+		surface.gpuDirty = true;
+		surface.needsUpload = false;
+		queueVRAMWatchUpdate(surface.range);
+	}
+}
+
+void RendererGL::queueVRAMWatchUpdate(Interval<u32> range) {
+	pendingVRAMWatch = pendingVRAMWatch.has_value() ? boost::icl::hull(pendingVRAMWatch.value(), range) : range;
+}
+
+void RendererGL::commitVRAMWatches() {
+	if (pendingVRAMWatch.has_value()) {
+		const auto range = pendingVRAMWatch.value();
+		pendingVRAMWatch = std::nullopt;
+		updateVRAMWatch(range);
+	}
+}
+
+void RendererGL::queueSurfaceReadback(ColourBuffer& surface) {
+	const u32 width = surface.size.x();
+	const u32 height = surface.size.y();
+
+	if (surface.readbackBuffer == 0) {
+		glGenBuffers(1, &surface.readbackBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, surface.readbackBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, usize(width) * height * 4, nullptr, GL_STREAM_READ);
+	} else {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, surface.readbackBuffer);
+	}
+
+	if (surface.readbackFence != nullptr) {
+		glDeleteSync(surface.readbackFence);
+	}
+
+	// With a pack buffer bound, glReadPixels only queues up the copy instead of waiting for it
+	surface.fbo.bind(OpenGL::ReadFramebuffer);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	surface.readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void RendererGL::flushSurface(ColourBuffer& surface) {
+	if (!surface.gpuDirty) {
+		return;
+	}
+
+	surface.gpuDirty = false;
+	// The CPU looks at this buffer after rendering, so it'll probably do so again. Read it back ahead of time from now on
+	surface.prefetchReadback = true;
+
+	const u32 width = surface.size.x();
+	const u32 height = surface.size.y();
+	const usize size = usize(width) * height * 4;
+
+	u8* dest = gpu.getPointerPhys<u8>(surface.location, u32(surface.sizeInBytes()));
+	if (dest == nullptr) [[unlikely]] {
+		updateVRAMWatch(surface.range);
+		return;
+	}
+
+	// Use the readback queued at the end of the last frame if nothing was rendered since, otherwise read back now and wait for it
+	if (surface.readbackFence == nullptr) {
+		queueSurfaceReadback(surface);
+	}
+
+	glClientWaitSync(surface.readbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);  // Wait up to 1 second
+	glDeleteSync(surface.readbackFence);
+	surface.readbackFence = nullptr;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, surface.readbackBuffer);
+	const u8* data = static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+
+	if (data != nullptr) [[likely]] {
+		PICA::SurfaceTiling::encode(surface.format, data, dest, width, height);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		Helpers::warn("RendererGL: Failed to map colour buffer readback");
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	updateVRAMWatch(surface.range);
+}
+
+void RendererGL::updateVRAMWatch(Interval<u32> range) {
+	using VRAMWatch = Memory::VRAMWatch;
+
+	auto getWatchMode = [](const ColourBuffer& surface) {
+		if (surface.gpuDirty) {
+			return VRAMWatch::ReadsAndWrites;  // Anything the CPU does needs the data we rendered
+		} else if (!surface.needsUpload) {
+			return VRAMWatch::Writes;  // Writes make our copy of the buffer stale
+		} else {
+			return VRAMWatch::None;  // We're going to reload the buffer anyways
 		}
+	};
+
+	// Memory is watched with page granularity, so look at every buffer that shares a page with the range.
+	// Pages shared between buffers need the strictest watch any of them asks for
+	const auto pageRange = getPageRange(range.lower(), range.upper());
+	const u32 firstPage = pageRange.lower() >> Memory::pageShift;
+	const u32 pageCount = (pageRange.upper() >> Memory::pageShift) - firstPage;
+
+	std::vector<VRAMWatch> pageModes(pageCount, VRAMWatch::None);
+	colourBufferCache.forEachInRange(pageRange, [&](ColourBuffer& surface) {
+		const auto surfacePages = getPageRange(surface.range.lower(), surface.range.upper());
+		const u32 begin = std::max(surfacePages.lower() >> Memory::pageShift, firstPage) - firstPage;
+		const u32 end = std::min(surfacePages.upper() >> Memory::pageShift, firstPage + pageCount) - firstPage;
+		const VRAMWatch mode = getWatchMode(surface);
+
+		for (u32 page = begin; page < end; page++) {
+			pageModes[page] = std::max(pageModes[page], mode);
+		}
+	});
+
+	// Apply the watch modes in runs of pages
+	u32 runStart = 0;
+	while (runStart < pageCount) {
+		u32 runEnd = runStart + 1;
+		while (runEnd < pageCount && pageModes[runEnd] == pageModes[runStart]) {
+			runEnd++;
+		}
+
+		gpu.watchVRAM(pageRange.lower() + (runStart << Memory::pageShift), (runEnd - runStart) << Memory::pageShift, pageModes[runStart]);
+		runStart = runEnd;
 	}
+}
+
+void RendererGL::notifyVRAMAccess(u32 paddr, u32 size, bool write) {
+	// Batched draws may still render to the memory being accessed
+	flushDraws();
+	commitVRAMWatches();
+
+	// Handle every buffer sharing a page with the access, so that the pages stop being watched if possible
+	const auto pageRange = getPageRange(paddr, paddr + size);
+
+	colourBufferCache.forEachInRange(pageRange, [&](ColourBuffer& surface) {
+		flushSurface(surface);
 
-	stbi_write_png(name.c_str(), width, height, 4, flippedPixels.data(), 0);
+		if (write) {
+			surface.needsUpload = true;
+		}
+	});
+
+	// This also stops watching pages whose buffers have been evicted from the cache since they were watched
+	updateVRAMWatch(pageRange);
 }
 
 void RendererGL::deinitGraphicsContext() {
+	drawBatch.vertices.clear();
+	drawsPending = false;
+
+	// Write back the colour buffers that are newer than memory, so that they can be reloaded once we have a new context
+	for (usize i = 0; i < colourBufferCacheSize; i++) {
+		if (colourBufferCache[i].valid) {
+			flushSurface(colourBufferCache[i]);
+		}
+	}
+
 	// Invalidate all surface caches since they'll no longer be valid
 	textureCache.reset();
 	depthBufferCache.reset();
 	colourBufferCache.reset();
+	geometryCache.reset();
 	shaderCache.clear();
+	invalidateDerivedState();
+	releaseFrameReadbacks();
+	pendingVRAMWatch = std::nullopt;
+	gpu.watchVRAM(PhysicalAddrs::VRAM, Memory::VRAM_SIZE, Memory::VRAMWatch::None);
 
 	// All other GL objects should be invalidated automatically and be recreated by the next call to initGraphicsContext
-	// TODO: Make it so that depth and colour buffers get written back to 3DS memory
+	// TODO: Make it so that depth buffers get written back to 3DS memory
 	printf("RendererGL::DeinitGraphicsContext called\n");
 }
 
@@ -1183,33 +1765,41 @@ std::string RendererGL::getUbershader() {
 }
 
 void RendererGL::setUbershader(const std::string& shader) {
-	auto gl_resources = cmrc::RendererGL::get_filesystem();
-	auto vertexShaderSource = gl_resources.open("opengl_vertex_shader.vert");
+	// Queued draws were set up for the old ubershader
+	flushDraws();
+
+	const std::string vertexShaderSource = fragShaderGen.getUbershaderVertexShader();
+
+	// Programs linking the old FS with accelerated vertex shaders are stale now
+	shaderCache.clearUbershaderPrograms();
+	ubershaderFragShader.free();
 
-	OpenGL::Shader vert({vertexShaderSource.begin(), vertexShaderSource.size()}, OpenGL::Vertex);
-	OpenGL::Shader frag(shader, OpenGL::Fragment);
-	triangleProgram.create({vert, frag});
+	OpenGL::Shader vert({vertexShaderSource.c_str(), vertexShaderSource.size()}, OpenGL::Vertex);
+	ubershaderFragShader.create(shader, OpenGL::Fragment);
+	triangleProgram.create({vert, ubershaderFragShader});
 
-	initUbershader(triangleProgram);
+	initUbershader(triangleProgram, ubershaderData);
+	// The new program starts out with none of our uniforms
+	invalidateDerivedState();
 
 	glUniform1f(ubershaderData.depthScaleLoc, oldDepthScale);
 	glUniform1f(ubershaderData.depthOffsetLoc, oldDepthOffset);
 	glUniform1i(ubershaderData.depthmapEnableLoc, oldDepthmapEnable);
 }
 
-void RendererGL::initUbershader(OpenGL::Program& program) {
+void RendererGL::initUbershader(OpenGL::Program& program, UbershaderUniforms& uniforms) {
 	gl.useProgram(program);
 
-	ubershaderData.textureEnvSourceLoc = OpenGL::uniformLocation(program, "u_textureEnvSource");
-	ubershaderData.textureEnvOperandLoc = OpenGL::uniformLocation(program, "u_textureEnvOperand");
-	ubershaderData.textureEnvCombinerLoc = OpenGL::uniformLocation(program, "u_textureEnvCombiner");
-	ubershaderData.textureEnvColorLoc = OpenGL::uniformLocation(program, "u_textureEnvColor");
-	ubershaderData.textureEnvScaleLoc = OpenGL::uniformLocation(program, "u_textureEnvScale");
+	uniforms.textureEnvSourceLoc = OpenGL::uniformLocation(program, "u_textureEnvSource");
+	uniforms.textureEnvOperandLoc = OpenGL::uniformLocation(program, "u_textureEnvOperand");
+	uniforms.textureEnvCombinerLoc = OpenGL::uniformLocation(program, "u_textureEnvCombiner");
+	uniforms.textureEnvColorLoc = OpenGL::uniformLocation(program, "u_textureEnvColor");
+	uniforms.textureEnvScaleLoc = OpenGL::uniformLocation(program, "u_textureEnvScale");
 
-	ubershaderData.depthScaleLoc = OpenGL::uniformLocation(program, "u_depthScale");
-	ubershaderData.depthOffsetLoc = OpenGL::uniformLocation(program, "u_depthOffset");
-	ubershaderData.depthmapEnableLoc = OpenGL::uniformLocation(program, "u_depthmapEnable");
-	ubershaderData.picaRegLoc = OpenGL::uniformLocation(program, "u_picaRegs");
+	uniforms.depthScaleLoc = OpenGL::uniformLocation(program, "u_depthScale");
+	uniforms.depthOffsetLoc = OpenGL::uniformLocation(program, "u_depthOffset");
+	uniforms.depthmapEnableLoc = OpenGL::uniformLocation(program, "u_depthmapEnable");
+	uniforms.picaRegLoc = OpenGL::uniformLocation(program, "u_picaRegs");
 
 	// Init sampler objects. Texture 0 goes in texture unit 0, texture 1 in TU 1, texture 2 in TU 2 and the LUTs go in TU 3
 	glUniform1i(OpenGL::uniformLocation(program, "u_tex0"), 0);
@@ -1245,31 +1835,82 @@ void RendererGL::accelerateVertexUpload(ShaderUnit& shaderUnit, PICA::DrawAccele
 	};
 
 	const u32 vertexCount = accel->maximumIndex - accel->minimumIndex + 1;
+	const bool useGeometryCache = emulatorConfig->geometryCacheEnabled;
+	if (useGeometryCache) {
+		geometryCache.beginDraw();
+	}
 
 	// Update index buffer if necessary
 	if (accel->indexed) {
 		usingShortIndices = accel->useShortIndices;
 		const usize indexBufferSize = regs[PICA::InternalRegs::VertexCountReg] * (usingShortIndices ? sizeof(u16) : sizeof(u8));
 
-		hwIndexBuffer->Bind();
-		auto indexBufferRes = hwIndexBuffer->Map(4, indexBufferSize);
-		hwIndexBufferOffset = reinterpret_cast<void*>(usize(indexBufferRes.buffer_offset));
+		// If we don't have glDrawRangeElementsBaseVertex, we must patch the index buffer on upload, so don't bother looking it up in the cache
+		GLuint cachedIndexBuffer = 0;
+		if (useGeometryCache && glDrawRangeElementsBaseVertex != nullptr) [[likely]] {
+			const auto kind = usingShortIndices ? GeometryCache::BufferKind::Index16 : GeometryCache::BufferKind::Index8;
+			cachedIndexBuffer = geometryCache.lookup(kind, accel->indexBufferAddress, accel->indexBuffer, u32(indexBufferSize));
+		}
+
+		if (cachedIndexBuffer != 0) {
+			hwIndexBufferHandle = cachedIndexBuffer;
+			hwIndexBufferOffset = nullptr;
+		} else {
+			hwIndexBuffer->Bind();
+			auto indexBufferRes = hwIndexBuffer->Map(4, indexBufferSize);
+			hwIndexBufferOffset = reinterpret_cast<void*>(usize(indexBufferRes.buffer_offset));
+			hwIndexBufferHandle = hwIndexBuffer->GetGLBufferId();
+
+			std::memcpy(indexBufferRes.pointer, accel->indexBuffer, indexBufferSize);
+			// If we don't have glDrawRangeElementsBaseVertex, we must subtract the base index value from our index buffer manually
+			if (glDrawRangeElementsBaseVertex == nullptr) [[unlikely]] {
+				const u32 indexCount = regs[PICA::InternalRegs::VertexCountReg];
+				usingShortIndices ? PICA::IndexBuffer::subtractBaseIndex<true>((u8*)indexBufferRes.pointer, indexCount, accel->minimumIndex)
+								  : PICA::IndexBuffer::subtractBaseIndex<false>((u8*)indexBufferRes.pointer, indexCount, accel->minimumIndex);
+			}
 
-		std::memcpy(indexBufferRes.pointer, accel->indexBuffer, indexBufferSize);
-		// If we don't have glDrawRangeElementsBaseVertex, we must subtract the base index value from our index buffer manually
-		if (glDrawRangeElementsBaseVertex == nullptr) [[unlikely]] {
-			const u32 indexCount = regs[PICA::InternalRegs::VertexCountReg];
-			usingShortIndices ? PICA::IndexBuffer::subtractBaseIndex<true>((u8*)indexBufferRes.pointer, indexCount, accel->minimumIndex)
-							  : PICA::IndexBuffer::subtractBaseIndex<false>((u8*)indexBufferRes.pointer, indexCount, accel->minimumIndex);
+			hwIndexBuffer->Unmap(indexBufferSize);
 		}
+	}
+
+	// Figure out where the data for each attribute loader will come from. Loaders whose data is resident in the geometry cache get bound in place,
+	// while everything else gets streamed into our vertex stream buffer
+	std::array<GLuint, PICA::DrawAcceleration::maxLoaderCount> loaderBuffers;
+	std::array<u32, PICA::DrawAcceleration::maxLoaderCount> loaderOffsets;
+	u32 streamedDataSize = 0;
 
-		hwIndexBuffer->Unmap(indexBufferSize);
+	for (int i = 0; i < accel->totalLoaderCount; i++) {
+		auto& loader = accel->loaders[i];
+		loaderBuffers[i] =
+			useGeometryCache ? geometryCache.lookup(GeometryCache::BufferKind::Vertex, loader.address, loader.data, u32(loader.size)) : 0;
+		loaderOffsets[i] = 0;
+
+		if (loaderBuffers[i] == 0) {
+			loaderOffsets[i] = streamedDataSize;
+			// Keep each loader's data aligned to 4 bytes
+			streamedDataSize += (u32(loader.size) + 3) & ~3;
+		}
 	}
 
-	hwVertexBuffer->Bind();
-	auto vertexBufferRes = hwVertexBuffer->Map(4, accel->vertexDataSize);
-	u8* vertexData = static_cast<u8*>(vertexBufferRes.pointer);
-	const u32 vertexBufferOffset = vertexBufferRes.buffer_offset;
+	// Upload the data for each streamed attribute loader into our vertex buffer
+	if (streamedDataSize != 0) {
+		hwVertexBuffer->Bind();
+		auto vertexBufferRes = hwVertexBuffer->Map(4, streamedDataSize);
+		u8* vertexData = static_cast<u8*>(vertexBufferRes.pointer);
+		const GLuint streamBufferHandle = hwVertexBuffer->GetGLBufferId();
+
+		for (int i = 0; i < accel->totalLoaderCount; i++) {
+			if (loaderBuffers[i] == 0) {
+				auto& loader = accel->loaders[i];
+				std::memcpy(vertexData + loaderOffsets[i], loader.data, loader.size);
+
+				loaderBuffers[i] = streamBufferHandle;
+				loaderOffsets[i] += vertexBufferRes.buffer_offset;
+			}
+		}
+
+		hwVertexBuffer->Unmap(streamedDataSize);
+	}
 
 	gl.bindVAO(hwShaderVAO);
 
@@ -1294,16 +1935,8 @@ void RendererGL::accelerateVertexUpload(ShaderUnit& shaderUnit, PICA::DrawAccele
 	}
 
 	previousAttributeMask = currentAttributeMask;
-
-	// Upload the data for each (enabled) attribute loader into our vertex buffer
-	for (int i = 0; i < accel->totalLoaderCount; i++) {
-		auto& loader = accel->loaders[i];
-
-		std::memcpy(vertexData, loader.data, loader.size);
-		vertexData += loader.size;
-	}
-
-	hwVertexBuffer->Unmap(accel->vertexDataSize);
+	// glVertexAttribPointer sources data from the currently bound GL_ARRAY_BUFFER, so keep track of it to avoid redundant binds
+	GLuint boundArrayBuffer = 0;
 
 	// Iterate over the 16 PICA input registers and configure how they should be fetched.
 	for (int i = 0; i < 16; i++) {
@@ -1319,9 +1952,15 @@ void RendererGL::accelerateVertexUpload(ShaderUnit& shaderUnit, PICA::DrawAccele
 				glVertexAttrib4f(i, attrib.fixedValue[0], attrib.fixedValue[1], attrib.fixedValue[2], attrib.fixedValue[3]);
 			}
 		} else if (accel->enabledAttributeMask & attributeMask) {
+			const GLuint attribBuffer = loaderBuffers[attrib.loaderIndex];
+			if (attribBuffer != boundArrayBuffer) {
+				glBindBuffer(GL_ARRAY_BUFFER, attribBuffer);
+				boundArrayBuffer = attribBuffer;
+			}
+
 			glVertexAttribPointer(
 				i, attrib.componentCount, attributeFormats[attrib.type], GL_FALSE, attrib.stride,
-				reinterpret_cast<GLvoid*>(vertexBufferOffset + attrib.offset)
+				reinterpret_cast<GLvoid*>(usize(loaderOffsets[attrib.loaderIndex] + attrib.offset))
 			);
 		}
 	}
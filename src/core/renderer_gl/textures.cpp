@@ -247,7 +247,7 @@ u32 Texture::decodeTexel(u32 u, u32 v, PICA::TextureFmt fmt, std::span<const u8>
     }
 }
 
-void Texture::decodeTexture(std::span<const u8> data) {
+std::vector<u32> Texture::decodeTexture(std::span<const u8> data) {
     std::vector<u32> decoded;
     decoded.reserve(u64(size.u()) * u64(size.v()));
 
@@ -259,6 +259,10 @@ void Texture::decodeTexture(std::span<const u8> data) {
         }
     }
 
+    return decoded;
+}
+
+void Texture::upload(std::span<const u32> decoded) {
     texture.bind();
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.u(), size.v(), GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
 }
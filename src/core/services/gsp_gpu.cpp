@@ -226,6 +226,9 @@ void GPUService::writeHwRegs(u32 messagePointer) {
 		ioAddr += 4;
 	}
 
+	// Register writes can kick off memory fills and display transfers
+	gpu.commitVRAMWatches();
+
 	mem.write32(messagePointer, IPC::responseHeader(0x1, 1, 0));
 	mem.write32(messagePointer + 4, Result::Success);
 }
@@ -269,6 +272,8 @@ void GPUService::writeHwRegsWithMask(u32 messagePointer) {
 		ioAddr += 4;
 	}
 
+	gpu.commitVRAMWatches();
+
 	mem.write32(messagePointer, IPC::responseHeader(0x2, 1, 0));
 	mem.write32(messagePointer + 4, Result::Success);
 }
@@ -382,6 +387,8 @@ void GPUService::processCommandBuffer() {
 			commandsLeft--;
 		}
 	}
+
+	gpu.commitVRAMWatches();
 }
 
 static u32 VaddrToPaddr(u32 addr) {
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <unordered_map>
 
 #include "ipc.hpp"
@@ -26,7 +27,6 @@ void HIDService::reset() {
 	accelerometerEnabled = false;
 	eventsInitialized = false;
 	gyroEnabled = false;
-	touchScreenPressed = false;
 
 	// Deinitialize HID events
 	for (auto& e : events) {
@@ -38,11 +38,17 @@ void HIDService::reset() {
 	// Reset button states
 	newButtons = oldButtons = 0;
 	circlePadX = circlePadY = 0;
-	touchScreenX = touchScreenY = 0;
+	touchScreenState = packTouchScreen(0, 0, false);
 	roll = pitch = yaw = 0;
 	accelX = accelY = accelZ = 0;
 
 	cStickX = cStickY = IR::CirclePadPro::ButtonState::C_STICK_CENTER;
+	latchedCStickX = latchedCStickY = IR::CirclePadPro::ButtonState::C_STICK_CENTER;
+
+	// Start sampling inputs. The scheduler has been reset before us, so the sampling event just needs to be queued again
+	sampleCount = 0;
+	Scheduler& scheduler = kernel.getScheduler();
+	scheduler.rescheduleEvent(Scheduler::EventType::UpdateHID, scheduler.currentTimestamp + padUpdateTicks);
 }
 
 void HIDService::handleSyncRequest(u32 messagePointer) {
@@ -151,6 +157,54 @@ void HIDService::getIPCHandles(u32 messagePointer) {
 }
 
 void HIDService::updateInputs(u64 currentTick) {
+	const bool updateMotion = (sampleCount++ & 1) == 0;
+
+	// Latch the input state the frontend has given us so far. Everything below works on this snapshot
+	HID::InputState state = {};
+	state.buttons = newButtons;
+	state.touchScreen = touchScreenState;
+	state.circlePadX = circlePadX;
+	state.circlePadY = circlePadY;
+	state.cStickX = cStickX;
+	state.cStickY = cStickY;
+
+	if (updateMotion) {
+		// Since gyroscope euler angles are relative, we zero them out here and the frontend will update them again when we receive a new rotation
+		state.roll = roll.exchange(0, std::memory_order_relaxed);
+		state.pitch = pitch.exchange(0, std::memory_order_relaxed);
+		state.yaw = yaw.exchange(0, std::memory_order_relaxed);
+		state.accelX = accelX;
+		state.accelY = accelY;
+		state.accelZ = accelZ;
+	}
+
+	// Let movies record the state, or replace it with a recorded one
+	if (inputHook) [[unlikely]] {
+		inputHook(currentTick, state);
+	}
+
+	const s16 padX = state.circlePadX;
+	const s16 padY = state.circlePadY;
+	u32 buttons = state.buttons;
+
+	// Set the bits that indicate which way the circlepad is being steered
+	if (padX >= 41) {
+		buttons |= HID::Keys::CirclePadRight;
+	} else if (padX <= -41) {
+		buttons |= HID::Keys::CirclePadLeft;
+	}
+
+	if (padY >= 41) {
+		buttons |= HID::Keys::CirclePadUp;
+	} else if (padY <= -41) {
+		buttons |= HID::Keys::CirclePadDown;
+	}
+
+	const u32 touchState = state.touchScreen;
+	const u16 touchX = Helpers::getBits<0, 15>(touchState);
+	const u16 touchY = Helpers::getBits<15, 15>(touchState);
+	const bool touchPressed = (touchState & touchScreenPressedBit) != 0;
+
 	// Update shared memory if it has been initialized
 	if (sharedMem) {
 		// First, update the pad state
@@ -160,14 +214,13 @@ void HIDService::updateInputs(u64 currentTick) {
 		}
 
 		// Mask out the CirclePadPro buttons when writing to HID shared memory, since the actual OS doesn't store anything in those bits
-		const u32 currentButtons = newButtons & ~HID::Keys::CirclePadProButtons;
+		const u32 currentButtons = buttons & ~HID::Keys::CirclePadProButtons;
 		const u32 previousButtons = oldButtons & ~HID::Keys::CirclePadProButtons;
-		oldButtons = newButtons;
 
 		writeSharedMem<u32>(0x10, nextPadIndex);    // Index last updated by the HID module
 		writeSharedMem<u32>(0x1C, currentButtons);  // Current PAD state
-		writeSharedMem<s16>(0x20, circlePadX);      // Current circle pad state
-		writeSharedMem<s16>(0x22, circlePadY);
+		writeSharedMem<s16>(0x20, padX);            // Current circle pad state
+		writeSharedMem<s16>(0x22, padY);
 
 		const size_t padEntryOffset = 0x28 + (nextPadIndex * 0x10);  // Offset in the array of 8 pad entries
 		nextPadIndex = (nextPadIndex + 1) % 8;                       // Move to next entry
@@ -178,8 +231,8 @@ void HIDService::updateInputs(u64 currentTick) {
 		writeSharedMem<u32>(padEntryOffset, currentButtons);
 		writeSharedMem<u32>(padEntryOffset + 4, pressed);
 		writeSharedMem<u32>(padEntryOffset + 8, released);
-		writeSharedMem<s16>(padEntryOffset + 12, circlePadX);
-		writeSharedMem<s16>(padEntryOffset + 14, circlePadY);
+		writeSharedMem<s16>(padEntryOffset + 12, padX);
+		writeSharedMem<s16>(padEntryOffset + 14, padY);
 
 		// Next, update touchscreen state
 		if (nextTouchscreenIndex == 0) {
@@ -190,50 +243,52 @@ void HIDService::updateInputs(u64 currentTick) {
 		const size_t touchEntryOffset = 0xC8 + (nextTouchscreenIndex * 8);  // Offset in the array of 8 touchscreen entries
 		nextTouchscreenIndex = (nextTouchscreenIndex + 1) % 8;              // Move to next entry
 
-		writeSharedMem<u16>(touchEntryOffset, touchScreenX);
-		writeSharedMem<u16>(touchEntryOffset + 2, touchScreenY);
-		writeSharedMem<u8>(touchEntryOffset + 4, touchScreenPressed ? 1 : 0);
-
-		// Next, update accelerometer state
-		if (nextAccelerometerIndex == 0) {
-			writeSharedMem<u64>(0x110, readSharedMem<u64>(0x108));  // Copy previous tick count
-			writeSharedMem<u64>(0x108, currentTick);                // Write new tick count
+		writeSharedMem<u16>(touchEntryOffset, touchX);
+		writeSharedMem<u16>(touchEntryOffset + 2, touchY);
+		writeSharedMem<u8>(touchEntryOffset + 4, touchPressed ? 1 : 0);
+
+		if (updateMotion) {
+			// Next, update accelerometer state
+			if (nextAccelerometerIndex == 0) {
+				writeSharedMem<u64>(0x110, readSharedMem<u64>(0x108));  // Copy previous tick count
+				writeSharedMem<u64>(0x108, currentTick);                // Write new tick count
+			}
+			writeSharedMem<u32>(0x118, nextAccelerometerIndex);                    // Index last updated by the HID module
+			const size_t accelEntryOffset = 0x128 + (nextAccelerometerIndex * 6);  // Offset in the array of 8 accelerometer entries
+
+			const s16 accel[3] = {state.accelX, state.accelY, state.accelZ};
+
+			// Raw data of current accelerometer entry
+			// TODO: How is the "raw" data actually calculated?
+			s16* accelerometerDataRaw = getSharedMemPointer<s16>(0x120);
+			std::memcpy(accelerometerDataRaw, accel, sizeof(accel));
+
+			// Accelerometer entry in entry table
+			s16* accelerometerData = getSharedMemPointer<s16>(accelEntryOffset);
+			std::memcpy(accelerometerData, accel, sizeof(accel));
+			nextAccelerometerIndex = (nextAccelerometerIndex + 1) % 8;  // Move to next entry
+
+			// Next, update gyro state
+			if (nextGyroIndex == 0) {
+				writeSharedMem<u64>(0x160, readSharedMem<u64>(0x158));  // Copy previous tick count
+				writeSharedMem<u64>(0x158, currentTick);                // Write new tick count
+			}
+			const size_t gyroEntryOffset = 0x178 + (nextGyroIndex * 6);  // Offset in the array of 8 touchscreen entries
+			s16* gyroData = getSharedMemPointer<s16>(gyroEntryOffset);
+
+			gyroData[0] = state.pitch;
+			gyroData[1] = state.yaw;
+			gyroData[2] = state.roll;
+
+			writeSharedMem<u32>(0x168, nextGyroIndex);  // Index last updated by the HID module
+			nextGyroIndex = (nextGyroIndex + 1) % 32;   // Move to next entry
 		}
-		writeSharedMem<u32>(0x118, nextAccelerometerIndex);                    // Index last updated by the HID module
-		const size_t accelEntryOffset = 0x128 + (nextAccelerometerIndex * 6);  // Offset in the array of 8 accelerometer entries
-
-		// Raw data of current accelerometer entry
-		// TODO: How is the "raw" data actually calculated?
-		s16* accelerometerDataRaw = getSharedMemPointer<s16>(0x120);
-		accelerometerDataRaw[0] = accelX;
-		accelerometerDataRaw[1] = accelY;
-		accelerometerDataRaw[2] = accelZ;
-
-		// Accelerometer entry in entry table
-		s16* accelerometerData = getSharedMemPointer<s16>(accelEntryOffset);
-		accelerometerData[0] = accelX;
-		accelerometerData[1] = accelY;
-		accelerometerData[2] = accelZ;
-		nextAccelerometerIndex = (nextAccelerometerIndex + 1) % 8;  // Move to next entry
-
-		// Next, update gyro state
-		if (nextGyroIndex == 0) {
-			writeSharedMem<u64>(0x160, readSharedMem<u64>(0x158));  // Copy previous tick count
-			writeSharedMem<u64>(0x158, currentTick);                // Write new tick count
-		}
-		const size_t gyroEntryOffset = 0x178 + (nextGyroIndex * 6);  // Offset in the array of 8 touchscreen entries
-		s16* gyroData = getSharedMemPointer<s16>(gyroEntryOffset);
-		gyroData[0] = pitch;
-		gyroData[1] = yaw;
-		gyroData[2] = roll;
-
-		// Since gyroscope euler angles are relative, we zero them out here and the frontend will update them again when we receive a new rotation
-		roll = pitch = yaw = 0;
-
-		writeSharedMem<u32>(0x168, nextGyroIndex);  // Index last updated by the HID module
-		nextGyroIndex = (nextGyroIndex + 1) % 32;   // Move to next entry
 	}
 
+	oldButtons = buttons;
+	latchedCStickX = state.cStickX;
+	latchedCStickY = state.cStickY;
+
 	// For some reason, the original developers decided to signal the HID events each time the OS rescanned inputs
 	// Rather than once every time the state of a key, or the accelerometer state, etc is updated
 	// This means that the OS will signal the events even if nothing happened
@@ -243,6 +298,9 @@ void HIDService::updateInputs(u64 currentTick) {
 			kernel.signalEvent(e.value());
 		}
 	}
+
+	// Queue the next sample relative to this one rather than to the current tick, to keep the sampling rate steady
+	kernel.getScheduler().addEvent(Scheduler::EventType::UpdateHID, currentTick + padUpdateTicks);
 }
 
 // Key serialization helpers
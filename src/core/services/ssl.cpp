@@ -35,7 +35,8 @@ void SSLService::initialize(u32 messagePointer) {
 	}
 
 	initialized = true;
-	rng.seed(std::random_device()());  // Seed rng via std::random_device
+	// Seed rng via std::random_device, unless we were given a fixed seed
+	rng.seed(fixedSeed.has_value() ? fixedSeed.value() : std::random_device()());
 
 	mem.write32(messagePointer + 4, Result::Success);
 }
@@ -0,0 +1,50 @@
+#include "speed_control.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void SpeedControl::setSpeed(float multiplier) {
+	speed = (multiplier > 0.0f) ? multiplier : unlimited;
+	// Start pacing from scratch, so that we don't try to catch up to the old speed
+	pacing = false;
+}
+
+void SpeedControl::setRenderSkip(u32 skipped, u32 period) {
+	skipPeriod = std::max<u32>(period, 1);
+	// Always render at least one frame per period, otherwise the screen would never update
+	skippedFrames = std::min(skipped, skipPeriod - 1);
+	frameIndex = 0;
+	renderingFrame = true;
+}
+
+bool SpeedControl::beginFrame() {
+	// Skip the first frames of each period, so that the last one is rendered. Frontends that run a whole period per host frame then always
+	// present a frame that was just rendered
+	renderingFrame = frameIndex >= skippedFrames;
+	frameIndex = (frameIndex + 1 == skipPeriod) ? 0 : frameIndex + 1;
+
+	return renderingFrame;
+}
+
+void SpeedControl::endFrame() {
+	if (isRealTime() || isUnlimited()) {
+		pacing = false;
+		return;
+	}
+
+	const auto frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / (framesPerSecond * speed)));
+	const auto now = Clock::now();
+
+	if (!pacing) {
+		pacing = true;
+		nextFrameTime = now;
+	}
+
+	nextFrameTime += frameDuration;
+	if (nextFrameTime > now) {
+		std::this_thread::sleep_until(nextFrameTime);
+	} else if (now - nextFrameTime > std::chrono::milliseconds(100)) {
+		// We fell far behind, eg because the emulator was paused or a frame took very long. Don't run ahead to make up for it
+		nextFrameTime = now;
+	}
+}
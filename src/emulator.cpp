@@ -5,6 +5,7 @@
 #endif
 
 #include <fstream>
+#include <random>
 
 #include "renderdoc.hpp"
 
@@ -18,9 +19,12 @@ __declspec(dllexport) DWORD AmdPowerXpressRequestHighPerformance = 1;
 }
 #endif
 
-Emulator::Emulator()
-	: config(getConfigPath()), kernel(cpu, memory, gpu, config, lua), cpu(memory, kernel, *this), gpu(memory, config),
-	  memory(kernel.fcramManager, config), cheats(memory, kernel.getServiceManager().getHID()), audioDevice(config.audioDeviceConfig), lua(*this),
+Emulator::Emulator() : Emulator(EmulatorConfig(getConfigPath())) {}
+
+Emulator::Emulator(const EmulatorConfig& emulatorConfig, std::shared_ptr<SharedCaches> caches)
+	: config(emulatorConfig), sharedCaches(caches ? std::move(caches) : std::make_shared<SharedCaches>()), kernel(cpu, memory, gpu, config, lua),
+	  cpu(memory, kernel, *this), gpu(memory, config, *sharedCaches), memory(kernel.fcramManager, config),
+	  cheats(memory, kernel.getServiceManager().getHID()), memoryScanner(memory), audioDevice(config.audioDeviceConfig), lua(*this),
 	  running(false)
 #ifdef PANDA3DS_ENABLE_HTTP_SERVER
 	  ,
@@ -45,7 +49,14 @@ Emulator::Emulator()
 }
 
 Emulator::~Emulator() {
-	config.save();
+	// Write out any movie being recorded, and put back the config settings a movie being played back overrode
+	stopMovie();
+
+	// Configs injected by the host may not be backed by a file
+	if (!config.filePath.empty()) {
+		config.save();
+	}
+
 	lua.close();
 	audioDevice.close();
 
@@ -55,10 +66,15 @@ Emulator::~Emulator() {
 }
 
 void Emulator::reset(ReloadOption reload) {
+	// Movies start from boot, so resetting ends them
+	stopMovie();
+
 	cpu.reset();
 	gpu.reset();
 	memory.reset();
 	dsp->reset();
+	// Scan results point into the address space of the old process
+	memoryScanner.reset();
 
 	// Reset scheduler and add a VBlank event
 	scheduler.reset();
@@ -119,7 +135,8 @@ void Emulator::step() {}
 void Emulator::resume() {
 	running = (romType != ROMType::None);
 
-	if (running && config.audioEnabled) {
+	// Audio stays off while running at a speed other than 1x
+	if (running && config.audioEnabled && speedControl.isRealTime()) {
 		audioDevice.start();
 	}
 }
@@ -133,20 +150,48 @@ void Emulator::togglePause() { running ? pause() : resume(); }
 
 void Emulator::runFrame() {
 	if (running) {
+		// Frames skipped by render-skip still run every GPU command, they just don't draw or display anything on the host
+		frameRendered = speedControl.beginFrame();
+		gpu.setDrawSkipping(!frameRendered);
+
 		cpu.runFrame();  // Run 1 frame of instructions
-		gpu.display();   // Display graphics
+		if (frameRendered) {
+			gpu.display();  // Display graphics
+		}
 
 		// Run cheats if any are loaded
 		if (cheats.haveCheats()) [[unlikely]] {
 			cheats.run();
 		}
+
+		speedControl.endFrame();
 	} else if (romType != ROMType::None) {
 		// If the emulator is not running and a game is loaded, we still want to display the framebuffer otherwise we will get weird
 		// double-buffering issues
+		frameRendered = true;
+		gpu.setDrawSkipping(false);
 		gpu.display();
 	}
 }
 
+void Emulator::setSpeed(float multiplier) {
+	speedControl.setSpeed(multiplier);
+	// Audio can't keep up with (or would stall) anything but 1x speed, so mute it there. Time-stretching it would be nicer
+	setAudioEnabled(config.audioEnabled);
+}
+
+void Emulator::setTurbo(bool enable) {
+	turboEnabled = enable;
+
+	if (enable) {
+		setSpeed(config.turboSpeed);
+		setRenderSkip(u32(config.turboSkippedFrames), u32(config.turboSkipPeriod));
+	} else {
+		setSpeed(1.0f);
+		setRenderSkip(0, 1);
+	}
+}
+
 void Emulator::pollScheduler() {
 	auto& events = scheduler.events;
 
@@ -163,6 +208,14 @@ void Emulator::pollScheduler() {
 				[[likely]] {
 					// Signal that we've reached the end of a frame
 					frameDone = true;
+					if (movie.isActive()) [[unlikely]] {
+						movie.onFrame(std::span<const u8>(memory.getFCRAM(), Memory::FCRAM_SIZE));
+						if (movie.isPlaybackDone()) {
+							printf("Movie playback finished after %llu frames\n", (unsigned long long)movie.getFrameCount());
+							stopMovie();
+						}
+					}
+
 					lua.signalEvent(LuaEvent::Frame);
 
 					// Send VBlank interrupts
@@ -184,6 +237,8 @@ void Emulator::pollScheduler() {
 
 			case Scheduler::EventType::SignalY2R: kernel.getServiceManager().getY2R().signalConversionDone(); break;
 			case Scheduler::EventType::UpdateIR: kernel.getServiceManager().getIRUser().updateCirclePadPro(); break;
+			case Scheduler::EventType::UpdateHID: kernel.getServiceManager().getHID().updateInputs(time); break;
+			case Scheduler::EventType::SignalAAC: dsp->finishAACRequest(); break;
 
 			default: {
 				Helpers::panic("Scheduler: Unimplemented event type received: %d\n", static_cast<int>(eventType));
@@ -235,6 +290,7 @@ bool Emulator::loadROM(const std::filesystem::path& path) {
 	const std::filesystem::path seedDBPath = appDataPath / "sysdata" / "seeddb.bin";
 
 	IOFile::setAppDataDir(dataPath);
+	bootCache.setDirectory(appDataPath / "cache" / "boot");
 
 	// Open the text file containing our AES keys if it exists. We use the std::filesystem::exists overload that takes an error code param to
 	// avoid the call throwing exceptions
@@ -253,9 +309,9 @@ bool Emulator::loadROM(const std::filesystem::path& path) {
 
 	if (extension == ".elf" || extension == ".axf")
 		success = loadELF(path);
-	else if (extension == ".3ds" || extension == ".cci")
+	else if (extension == ".3ds" || extension == ".cci" || extension == ".zcci")
 		success = loadNCSD(path, ROMType::NCSD);
-	else if (extension == ".cxi" || extension == ".app" || extension == ".ncch")
+	else if (extension == ".cxi" || extension == ".app" || extension == ".ncch" || extension == ".zcxi")
 		success = loadNCSD(path, ROMType::CXI);
 	else if (extension == ".3dsx")
 		success = load3DSX(path);
@@ -283,6 +339,80 @@ bool Emulator::loadROM(const std::filesystem::path& path) {
 	return success;
 }
 
+bool Emulator::startMovieRecording(const std::filesystem::path& path) {
+	if (romType == ROMType::None) {
+		return false;
+	}
+
+	reset(ReloadOption::Reload);
+
+	Movie::Environment environment = {};
+	environment.programID = memory.getProgramID().value_or(0);
+	environment.startTime = memory.timeSince3DSEpoch();
+	environment.sslSeed = std::random_device()();
+	environment.chargerPlugged = config.chargerPlugged ? 1 : 0;
+	environment.batteryPercentage = u8(config.batteryPercentage);
+
+	if (!movie.startRecording(path, environment)) {
+		return false;
+	}
+
+	applyMovieEnvironment(environment);
+	return true;
+}
+
+bool Emulator::startMoviePlayback(const std::filesystem::path& path) {
+	if (romType == ROMType::None) {
+		return false;
+	}
+
+	reset(ReloadOption::Reload);
+	if (!movie.startPlayback(path)) {
+		return false;
+	}
+
+	const Movie::Environment& environment = movie.getEnvironment();
+	if (environment.programID != memory.getProgramID().value_or(0)) {
+		Helpers::warn("Movie was recorded on title %016llX, it will likely desync", (unsigned long long)environment.programID);
+	}
+
+	// The battery state comes from the config, so override it for as long as the movie plays
+	savedChargerPlugged = config.chargerPlugged;
+	savedBatteryPercentage = config.batteryPercentage;
+	config.chargerPlugged = environment.chargerPlugged != 0;
+	config.batteryPercentage = environment.batteryPercentage;
+
+	applyMovieEnvironment(environment);
+	return true;
+}
+
+bool Emulator::stopMovie() {
+	if (!movie.isActive()) {
+		return true;
+	}
+
+	if (movie.isPlaying()) {
+		config.chargerPlugged = savedChargerPlugged;
+		config.batteryPercentage = savedBatteryPercentage;
+	}
+
+	memory.setFixedClock(std::nullopt);
+	kernel.getServiceManager().getSSL().setFixedSeed(std::nullopt);
+	kernel.getServiceManager().getHID().setInputHook(nullptr);
+
+	return movie.stop();
+}
+
+void Emulator::applyMovieEnvironment(const Movie::Environment& environment) {
+	if (config.dspType == Audio::DSPCore::Type::Teakra && config.lleDSPThreadEnabled) {
+		Helpers::warn("The LLE DSP thread makes emulation nondeterministic, movies will likely desync");
+	}
+
+	memory.setFixedClock(environment.startTime);
+	kernel.getServiceManager().getSSL().setFixedSeed(environment.sslSeed);
+	kernel.getServiceManager().getHID().setInputHook([this](u64 tick, HID::InputState& state) { movie.onInputSample(tick, state); });
+}
+
 bool Emulator::loadAmiibo(const std::filesystem::path& path) {
 	NFCService& nfc = kernel.getServiceManager().getNFC();
 	return nfc.loadAmiibo(path);
@@ -292,7 +422,8 @@ bool Emulator::loadAmiibo(const std::filesystem::path& path) {
 // (We promote CXI files to NCSD internally for ease)
 bool Emulator::loadNCSD(const std::filesystem::path& path, ROMType type) {
 	romType = type;
-	std::optional<NCSD> opt = (type == ROMType::NCSD) ? memory.loadNCSD(aesEngine, path) : memory.loadCXI(aesEngine, path);
+	BootCache* cache = config.bootCacheEnabled ? &bootCache : nullptr;
+	std::optional<NCSD> opt = (type == ROMType::NCSD) ? memory.loadNCSD(aesEngine, path, cache) : memory.loadCXI(aesEngine, path, cache);
 
 	if (!opt.has_value()) {
 		return false;
@@ -301,6 +432,11 @@ bool Emulator::loadNCSD(const std::filesystem::path& path, ROMType type) {
 	loadedNCSD = opt.value();
 	cpu.setReg(15, loadedNCSD.entrypoint);
 
+	// Let RomFS reads share decrypted data with other instances running the same title
+	if (NCCH* cxi = memory.getCXI(); cxi != nullptr) {
+		cxi->decryptedBlockCache = &sharedCaches->decryptedBlocks;
+	}
+
 	if (loadedNCSD.entrypoint & 1) {
 		Helpers::panic("Misaligned NCSD entrypoint; should this start the CPU in Thumb mode?");
 	}
@@ -439,7 +575,8 @@ RomFS::DumpingResult Emulator::dumpRomFS(const std::filesystem::path& path) {
 void Emulator::setAudioEnabled(bool enable) {
 	// Don't enable audio if we didn't manage to find an audio device and initialize it properly, otherwise audio sync will break,
 	// because the emulator will expect the audio device to drain the sample buffer, but there's no audio device running...
-	enable = enable && audioDevice.isInitialized();
+	// Audio is also muted when not running at 1x speed, as the DSP would otherwise wait for the audio device to drain its samples
+	enable = enable && audioDevice.isInitialized() && speedControl.isRealTime();
 
 	if (!enable) {
 		audioDevice.stop();
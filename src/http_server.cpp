@@ -1,6 +1,8 @@
 #ifdef PANDA3DS_ENABLE_HTTP_SERVER
 #include "http_server.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -11,13 +13,18 @@
 #include "emulator.hpp"
 #include "helpers.hpp"
 #include "httplib.h"
+#include <stb_image_write.h>
 
 class HttpActionScreenshot : public HttpAction {
 	DeferredResponseWrapper& response;
+	FrameCapture& frame;
 
   public:
-	HttpActionScreenshot(DeferredResponseWrapper& response) : HttpAction(HttpActionType::Screenshot), response(response) {}
+	HttpActionScreenshot(DeferredResponseWrapper& response, FrameCapture& frame)
+		: HttpAction(HttpActionType::Screenshot), response(response), frame(frame) {}
+
 	DeferredResponseWrapper& getResponse() { return response; }
+	FrameCapture& getFrame() { return frame; }
 };
 
 class HttpActionTogglePause : public HttpAction {
@@ -67,8 +74,55 @@ class HttpActionStep : public HttpAction {
 	int getFrames() const { return frames; }
 };
 
-std::unique_ptr<HttpAction> HttpAction::createScreenshotAction(DeferredResponseWrapper& response) {
-	return std::make_unique<HttpActionScreenshot>(response);
+class HttpActionSetSpeed : public HttpAction {
+	float speed;
+	u32 skippedFrames;
+	u32 skipPeriod;
+
+  public:
+	HttpActionSetSpeed(float speed, u32 skippedFrames, u32 skipPeriod)
+		: HttpAction(HttpActionType::SetSpeed), speed(speed), skippedFrames(skippedFrames), skipPeriod(skipPeriod) {}
+
+	float getSpeed() const { return speed; }
+	u32 getSkippedFrames() const { return skippedFrames; }
+	u32 getSkipPeriod() const { return skipPeriod; }
+};
+
+class HttpActionMovie : public HttpAction {
+	DeferredResponseWrapper& response;
+	HttpMovieCommand command;
+	std::filesystem::path path;
+
+  public:
+	HttpActionMovie(DeferredResponseWrapper& response, HttpMovieCommand command, const std::filesystem::path& path)
+		: HttpAction(HttpActionType::Movie), response(response), command(command), path(path) {}
+
+	DeferredResponseWrapper& getResponse() { return response; }
+	HttpMovieCommand getCommand() const { return command; }
+	const std::filesystem::path& getPath() const { return path; }
+};
+
+std::unique_ptr<HttpAction> HttpAction::createScreenshotAction(DeferredResponseWrapper& response, FrameCapture& frame) {
+	return std::make_unique<HttpActionScreenshot>(response, frame);
+}
+
+// Encode a captured frame to PNG or JPEG in memory
+static std::vector<u8> encodeFrame(const FrameCapture& frame, bool jpeg, int quality = 90) {
+	std::vector<u8> output;
+	auto append = [](void* context, void* data, int size) {
+		auto& out = *static_cast<std::vector<u8>*>(context);
+		out.insert(out.end(), static_cast<u8*>(data), static_cast<u8*>(data) + size);
+	};
+
+	const int width = int(frame.width);
+	const int height = int(frame.height);
+	if (jpeg) {
+		stbi_write_jpg_to_func(append, &output, width, height, 4, frame.pixels.data(), quality);
+	} else {
+		stbi_write_png_to_func(append, &output, width, height, 4, frame.pixels.data(), width * 4);
+	}
+
+	return output;
 }
 
 std::unique_ptr<HttpAction> HttpAction::createKeyAction(u32 key, bool state) { return std::make_unique<HttpActionKey>(key, state); }
@@ -83,6 +137,16 @@ std::unique_ptr<HttpAction> HttpAction::createStepAction(DeferredResponseWrapper
 	return std::make_unique<HttpActionStep>(response, frames);
 }
 
+std::unique_ptr<HttpAction> HttpAction::createSetSpeedAction(float speed, u32 skippedFrames, u32 skipPeriod) {
+	return std::make_unique<HttpActionSetSpeed>(speed, skippedFrames, skipPeriod);
+}
+
+std::unique_ptr<HttpAction> HttpAction::createMovieAction(
+	DeferredResponseWrapper& response, HttpMovieCommand command, const std::filesystem::path& path
+) {
+	return std::make_unique<HttpActionMovie>(response, command, path);
+}
+
 HttpServer::HttpServer(Emulator* emulator)
 	: emulator(emulator), server(std::make_unique<httplib::Server>()), keyMap({
 																		   {"A", {HID::Keys::A}},
@@ -105,6 +169,13 @@ HttpServer::HttpServer(Emulator* emulator)
 
 HttpServer::~HttpServer() {
 	printf("Stopping http server...\n");
+	// Wake up any /stream handlers waiting for a frame, so that the server can shut down
+	{
+		std::scoped_lock lock(streamMutex);
+		stopping = true;
+	}
+	streamCv.notify_all();
+
 	server->stop();
 	if (httpServerThread.joinable()) {
 		httpServerThread.join();
@@ -120,13 +191,67 @@ void HttpServer::startHttpServer() {
 	server->set_tcp_nodelay(true);
 	server->Get("/ping", [](const httplib::Request&, httplib::Response& response) { response.set_content("pong", "text/plain"); });
 
-	server->Get("/screen", [this](const httplib::Request&, httplib::Response& response) {
+	server->Get("/screen", [this](const httplib::Request& request, httplib::Response& response) {
 		// TODO: make the below a DeferredResponseWrapper function
 		DeferredResponseWrapper wrapper(response);
+		FrameCapture frame;
 		// Lock the mutex before pushing the action to ensure that the condition variable is not notified before we wait on it
 		std::unique_lock lock(wrapper.mutex);
-		pushAction(HttpAction::createScreenshotAction(wrapper));
+		pushAction(HttpAction::createScreenshotAction(wrapper, frame));
 		wrapper.cv.wait(lock, [&wrapper] { return wrapper.ready; });
+
+		// Encode the frame here instead of on the emulator thread. If the renderer couldn't capture the frame, the response already
+		// holds a screenshot taken the slow way
+		if (!frame.pixels.empty()) {
+			const bool jpeg = request.get_param_value("format") == "jpg";
+			const std::vector<u8> image = encodeFrame(frame, jpeg);
+			response.set_content(reinterpret_cast<const char*>(image.data()), image.size(), jpeg ? "image/jpeg" : "image/png");
+		}
+	});
+
+	// Continuously stream frames to the client as MJPEG
+	server->Get("/stream", [this](const httplib::Request& request, httplib::Response& response) {
+		int quality = 80;
+		if (request.has_param("quality")) {
+			try {
+				quality = std::clamp(std::stoi(request.get_param_value("quality")), 1, 100);
+			} catch (...) {
+				response.set_content("error", "text/plain");
+				return;
+			}
+		}
+
+		streamClients++;
+		auto lastFrameCount = std::make_shared<u64>(0);
+
+		response.set_chunked_content_provider(
+			"multipart/x-mixed-replace; boundary=frame",
+			[this, quality, lastFrameCount](size_t, httplib::DataSink& sink) {
+				FrameCapture frame;
+				{
+					std::unique_lock lock(streamMutex);
+					// Wake up every now and then even if there are no new frames (eg when paused), to check if the client is still there
+					const bool newFrame =
+						streamCv.wait_for(lock, std::chrono::seconds(1), [&] { return stopping || streamFrameCount != *lastFrameCount; });
+
+					if (stopping) {
+						return false;
+					} else if (!newFrame) {
+						return sink.is_writable();
+					}
+
+					*lastFrameCount = streamFrameCount;
+					frame = streamFrame;
+				}
+
+				const std::vector<u8> image = encodeFrame(frame, true, quality);
+				const std::string header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(image.size()) + "\r\n\r\n";
+
+				return sink.write(header.data(), header.size()) && sink.write(reinterpret_cast<const char*>(image.data()), image.size()) &&
+					   sink.write("\r\n", 2);
+			},
+			[this](bool) { streamClients--; }
+		);
 	});
 
 	server->Get("/input", [this](const httplib::Request& request, httplib::Response& response) {
@@ -180,6 +305,70 @@ void HttpServer::startHttpServer() {
 		wrapper.cv.wait(lock, [&wrapper] { return wrapper.ready; });
 	});
 
+	// Set the emulation speed and render-skip, eg /speed?speed=unlimited&skip=7&period=8 to run as fast as possible while only rendering
+	// 1 out of every 8 frames. The speed is a multiplier of the 3DS' speed, or "unlimited". Leaving out skip and period renders every frame
+	server->Get("/speed", [this](const httplib::Request& request, httplib::Response& response) {
+		auto getParam = [&](const char* name, const std::string& def) {
+			auto it = request.params.find(name);
+			return (it == request.params.end()) ? def : it->second;
+		};
+
+		float speed;
+		u32 skippedFrames;
+		u32 skipPeriod;
+		try {
+			const std::string speedString = getParam("speed", "1");
+			speed = (speedString == "unlimited") ? SpeedControl::unlimited : std::stof(speedString);
+			skippedFrames = u32(std::stoul(getParam("skip", "0")));
+			skipPeriod = u32(std::stoul(getParam("period", "1")));
+		} catch (...) {
+			response.set_content("error", "text/plain");
+			return;
+		}
+
+		if (speed < 0.0f || (speed == 0.0f && getParam("speed", "1") != "unlimited") || skipPeriod == 0 || skippedFrames >= skipPeriod) {
+			response.set_content("error", "text/plain");
+			return;
+		}
+
+		pushAction(HttpAction::createSetSpeedAction(speed, skippedFrames, skipPeriod));
+		response.set_content("ok", "text/plain");
+	});
+
+	// Record or play back a movie, eg /movie?action=record&path=run.pmov, then /movie?action=stop to write it out. Both restart the
+	// current ROM first. Playing the recording back later reruns the exact same inputs, for comparing the performance of builds
+	server->Get("/movie", [this](const httplib::Request& request, httplib::Response& response) {
+		auto action = request.params.find("action");
+		auto path = request.params.find("path");
+		if (action == request.params.end()) {
+			response.set_content("error", "text/plain");
+			return;
+		}
+
+		HttpMovieCommand command;
+		if (action->second == "record") {
+			command = HttpMovieCommand::Record;
+		} else if (action->second == "play") {
+			command = HttpMovieCommand::Play;
+		} else if (action->second == "stop") {
+			command = HttpMovieCommand::Stop;
+		} else {
+			response.set_content("error", "text/plain");
+			return;
+		}
+
+		if (command != HttpMovieCommand::Stop && (path == request.params.end() || path->second.empty())) {
+			response.set_content("error", "text/plain");
+			return;
+		}
+
+		const std::filesystem::path moviePath = (path == request.params.end()) ? std::filesystem::path() : std::filesystem::path(path->second);
+		DeferredResponseWrapper wrapper(response);
+		std::unique_lock lock(wrapper.mutex);
+		pushAction(HttpAction::createMovieAction(wrapper, command, moviePath));
+		wrapper.cv.wait(lock, [&wrapper] { return wrapper.ready; });
+	});
+
 	server->Get("/status", [this](const httplib::Request&, httplib::Response& response) { response.set_content(status(), "text/plain"); });
 
 	server->Get("/load_rom", [this](const httplib::Request& request, httplib::Response& response) {
@@ -235,6 +424,22 @@ std::string HttpServer::status() {
 
 	stringStream << "Panda3DS\n";
 	stringStream << "Status: " << (paused ? "Paused" : "Running") << "\n";
+	if (const float speed = emulator->getSpeedControl().getSpeed(); speed == SpeedControl::unlimited) {
+		stringStream << "Speed: Unlimited\n";
+	} else {
+		stringStream << "Speed: " << speed << "x\n";
+	}
+
+	const Movie& movie = emulator->getMovie();
+	if (movie.isRecording()) {
+		stringStream << "Movie: Recording, frame " << movie.getFrameCount() << "\n";
+	} else if (movie.isPlaying()) {
+		stringStream << "Movie: Playing, frame " << movie.getFrameCount() << "/" << movie.getTotalFrames() << "\n";
+	}
+
+	if (auto desyncFrame = movie.getDesyncFrame(); desyncFrame.has_value()) {
+		stringStream << "Movie desynced at frame " << desyncFrame.value() << "\n";
+	}
 
 	// TODO: This currently doesn't work for N3DS buttons
 	auto keyPressed = [](const HIDService& hid, u32 mask) { return (hid.getOldButtons() & mask) != 0; };
@@ -245,9 +450,33 @@ std::string HttpServer::status() {
 	return stringStream.str();
 }
 
+void HttpServer::publishStreamFrame() {
+	if (!emulator->gpu.captureFrame(streamScratchFrame)) {
+		return;
+	}
+
+	{
+		std::scoped_lock lock(streamMutex);
+		std::swap(streamFrame, streamScratchFrame);
+		streamFrameCount++;
+	}
+	streamCv.notify_all();
+}
+
 void HttpServer::processActions() {
 	std::scoped_lock lock(actionQueueMutex);
 
+	// Let the renderer know whether it should read back every frame asynchronously, then hand the last frame to the /stream clients
+	const bool streaming = streamClients > 0;
+	if (streaming != frameStreaming) {
+		frameStreaming = streaming;
+		emulator->gpu.setFrameStreaming(streaming);
+	}
+
+	if (streaming) {
+		publishStreamFrame();
+	}
+
 	if (framesToRun > 0) {
 		if (!currentStepAction) {
 			// Should never happen
@@ -282,12 +511,16 @@ void HttpServer::processActions() {
 		switch (action->getType()) {
 			case HttpActionType::Screenshot: {
 				HttpActionScreenshot* screenshotAction = static_cast<HttpActionScreenshot*>(action.get());
-				emulator->gpu.screenshot(httpServerScreenshotPath);
-				std::ifstream file(httpServerScreenshotPath, std::ios::binary);
-				std::vector<char> buffer(std::istreambuf_iterator<char>(file), {});
-
 				DeferredResponseWrapper& response = screenshotAction->getResponse();
-				response.inner_response.set_content(buffer.data(), buffer.size(), "image/png");
+
+				// The server thread encodes the captured frame. Renderers that can't capture frames to memory go through a screenshot file instead
+				if (!emulator->gpu.captureFrame(screenshotAction->getFrame())) {
+					emulator->gpu.screenshot(httpServerScreenshotPath);
+					std::ifstream file(httpServerScreenshotPath, std::ios::binary);
+					std::vector<char> buffer(std::istreambuf_iterator<char>(file), {});
+					response.inner_response.set_content(buffer.data(), buffer.size(), "image/png");
+				}
+
 				std::unique_lock<std::mutex> lock(response.mutex);
 				response.ready = true;
 				response.cv.notify_one();
@@ -335,6 +568,32 @@ void HttpServer::processActions() {
 
 			case HttpActionType::Reset: emulator->reset(Emulator::ReloadOption::Reload); break;
 
+			case HttpActionType::SetSpeed: {
+				HttpActionSetSpeed* speedAction = static_cast<HttpActionSetSpeed*>(action.get());
+				emulator->setSpeed(speedAction->getSpeed());
+				emulator->setRenderSkip(speedAction->getSkippedFrames(), speedAction->getSkipPeriod());
+				break;
+			}
+
+			case HttpActionType::Movie: {
+				HttpActionMovie* movieAction = static_cast<HttpActionMovie*>(action.get());
+				DeferredResponseWrapper& response = movieAction->getResponse();
+				bool success;
+
+				switch (movieAction->getCommand()) {
+					case HttpMovieCommand::Record: success = emulator->startMovieRecording(movieAction->getPath()); break;
+					case HttpMovieCommand::Play: success = emulator->startMoviePlayback(movieAction->getPath()); break;
+					default: success = emulator->stopMovie(); break;
+				}
+
+				response.inner_response.set_content(success ? "ok" : "error", "text/plain");
+
+				std::unique_lock<std::mutex> lock(response.mutex);
+				response.ready = true;
+				response.cv.notify_one();
+				break;
+			}
+
 			case HttpActionType::Step: {
 				HttpActionStep* stepAction = static_cast<HttpActionStep*>(action.get());
 				framesToRun = stepAction->getFrames();
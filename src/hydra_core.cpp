@@ -102,7 +102,6 @@ void HydraCore::runFrame() {
 		hid.releaseTouchScreen();
 	}
 
-	hid.updateInputs(emulator->getTicks());
 	emulator->runFrame();
 }
 
@@ -156,7 +155,7 @@ HC_API const char* getInfo(hydra::InfoType type) {
 		case hydra::InfoType::Version: return PANDA3DS_VERSION;
 		case hydra::InfoType::License: return "GPLv3";
 		case hydra::InfoType::Website: return "https://panda3ds.com/";
-		case hydra::InfoType::Extensions: return "3ds,cci,cxi,app,3dsx,elf,axf";
+		case hydra::InfoType::Extensions: return "3ds,cci,cxi,app,zcci,zcxi,3dsx,elf,axf";
 		case hydra::InfoType::Firmware: return "";
 		case hydra::InfoType::IconWidth: return HYDRA_ICON_WIDTH;
 		case hydra::InfoType::IconHeight: return HYDRA_ICON_HEIGHT;
@@ -87,8 +87,6 @@ AlberFunction(void, RunFrame)(JNIEnv* env, jobject obj, jint fbo) {
 	// TODO: don't reset entire state manager
 	renderer->resetStateManager();
 	emulator->runFrame();
-
-	hidService->updateInputs(emulator->getTicks());
 }
 
 AlberFunction(void, Finalize)(JNIEnv* env, jobject obj) {
@@ -17,6 +17,8 @@ static retro_hw_render_callback hwRender;
 static std::filesystem::path savePath;
 
 static bool screenTouched = false;
+// Number of 3DS frames emulated per retro_run. Only the last one is rendered, so this speeds up the game without costing any host rendering
+static int framesPerRun = 1;
 static bool usingGLES = false;
 
 static std::unique_ptr<Emulator> emulator;
@@ -161,6 +163,7 @@ static void configInit() {
 		{"panda3ds_use_ubershader", EmulatorConfig::ubershaderDefault ? "Use ubershaders (No stutter, maybe slower); enabled|disabled"
 																	  : "Use ubershaders (No stutter, maybe slower); disabled|enabled"},
 		{"panda3ds_use_vsync", "Enable VSync; enabled|disabled"},
+		{"panda3ds_speed", "Emulation speed (skips rendering of extra frames); 1|2|3|4|6|8"},
 		{"panda3ds_hash_textures", EmulatorConfig::hashTexturesDefault ? "Hash textures (Better graphics, maybe slower); enabled|disabled"
 																	   : "Hash textures (Better graphics, maybe slower); disabled|enabled"},
 
@@ -211,6 +214,11 @@ static void configUpdate() {
 	config.lightShadergenThreshold = fetchVariableRange("panda3ds_ubershader_lighting_override_threshold", 1, 8);
 	config.discordRpcEnabled = false;
 
+	// The frontend paces retro_run, so faster speeds just run more frames per call, with render-skip dropping all but the last one
+	framesPerRun = fetchVariableRange("panda3ds_speed", 1, 8);
+	emulator->setSpeed(framesPerRun == 1 ? 1.0f : SpeedControl::unlimited);
+	emulator->setRenderSkip(u32(framesPerRun - 1), u32(framesPerRun));
+
 	// Handle any settings that might need the emulator core to be notified when they're changed, and save the config.
 	emulator->setAudioEnabled(config.audioEnabled);
 	config.save();
@@ -227,7 +235,7 @@ static void configCheckVariables() {
 
 void retro_get_system_info(retro_system_info* info) {
 	info->need_fullpath = true;
-	info->valid_extensions = "3ds|3dsx|elf|axf|cci|cxi|app";
+	info->valid_extensions = "3ds|3dsx|elf|axf|cci|cxi|app|zcci|zcxi";
 	info->library_version = PANDA3DS_VERSION;
 	info->library_name = "Panda3DS";
 	info->block_extract = false;
@@ -362,8 +370,9 @@ void retro_run() {
 		screenTouched = false;
 	}
 
-	hid.updateInputs(emulator->getTicks());
-	emulator->runFrame();
+	for (int i = 0; i < framesPerRun; i++) {
+		emulator->runFrame();
+	}
 
 	videoCallback(RETRO_HW_FRAME_BUFFER_VALID, emulator->width, emulator->height, 0);
 	// Call audio batch callback
@@ -1,6 +1,7 @@
 #ifdef PANDA3DS_ENABLE_LUA
 #include <teakra/disassembler.h>
 
+#include <algorithm>
 #include <array>
 
 #include "capstone.hpp"
@@ -32,10 +33,13 @@ void LuaManager::initialize() {
 	initializeThunks();
 	initialized = true;
 	haveScript = false;
+
+	emulator.getMemory().setWriteWatchCallback([this](u32 vaddr, u32 size, u32 value) { signalWrite(vaddr, size, value); });
 }
 
 void LuaManager::close() {
 	if (initialized) {
+		clearWriteWatches();
 		lua_close(L);
 		initialized = false;
 		haveScript = false;
@@ -135,27 +139,83 @@ void LuaManager::removeInterceptedService(const std::string& service, u32 functi
 	luaL_unref(L, LUA_REGISTRYINDEX, callbackRef);
 }
 
+u32 LuaManager::addWriteWatch(u32 vaddr, u32 size, int callbackRef) {
+	const u32 id = nextWriteWatchID++;
+	writeWatches.push_back({id, vaddr, vaddr + size, callbackRef});
+	emulator.getMemory().addWriteWatch(vaddr, size);
+
+	return id;
+}
+
+bool LuaManager::removeWriteWatch(u32 id) {
+	auto it = std::find_if(writeWatches.begin(), writeWatches.end(), [id](const WriteWatch& watch) { return watch.id == id; });
+	if (it == writeWatches.end()) {
+		return false;
+	}
+
+	emulator.getMemory().removeWriteWatch(it->start, it->end - it->start);
+	luaL_unref(L, LUA_REGISTRYINDEX, it->callbackRef);
+	writeWatches.erase(it);
+	return true;
+}
+
+void LuaManager::clearWriteWatches() {
+	for (const auto& watch : writeWatches) {
+		emulator.getMemory().removeWriteWatch(watch.start, watch.end - watch.start);
+		luaL_unref(L, LUA_REGISTRYINDEX, watch.callbackRef);
+	}
+
+	writeWatches.clear();
+}
+
+// Called by Memory after a write to a watched page. Calls the callback of every watch whose range overlaps the write, with the address,
+// size and value of the write as parameters. Callbacks run in the middle of emulation, so they may read and write memory or remove watches,
+// but shouldn't reset the emulator or load ROMs
+void LuaManager::signalWrite(u32 vaddr, u32 size, u32 value) {
+	// Index-based loop, as callbacks can remove watches
+	for (usize i = 0; i < writeWatches.size(); i++) {
+		const WriteWatch watch = writeWatches[i];
+		if (vaddr >= watch.end || vaddr + size <= watch.start) {
+			continue;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, watch.callbackRef);
+		lua_pushinteger(L, vaddr);
+		lua_pushinteger(L, size);
+		lua_pushinteger(L, value);
+
+		if (lua_pcall(L, 3, 0, 0) != LUA_OK) {
+			fprintf(stderr, "Lua: Error in write watch: %s\n", lua_tostring(L, -1));
+			lua_pop(L, 1);
+		}
+
+		// Don't skip the watch that took this one's place if the callback removed it
+		if (i < writeWatches.size() && writeWatches[i].id != watch.id) {
+			i--;
+		}
+	}
+}
+
 void LuaManager::reset() {
 	// Reset scripts
 	haveScript = false;
 }
 
 // Initialize C++ thunks for Lua code to call here
-// All code beyond this point is terrible and full of global state, don't judge
-
-Emulator* LuaManager::g_emulator = nullptr;
-
-#define MAKE_MEMORY_FUNCTIONS(size)                                                \
-	static int read##size##Thunk(lua_State* L) {                                   \
-		const u32 vaddr = (u32)lua_tointeger(L, 1);                                \
-		lua_pushinteger(L, LuaManager::g_emulator->getMemory().read##size(vaddr)); \
-		return 1;                                                                  \
-	}                                                                              \
-	static int write##size##Thunk(lua_State* L) {                                  \
-		const u32 vaddr = (u32)lua_tointeger(L, 1);                                \
-		const u##size value = (u##size)lua_tointeger(L, 2);                        \
-		LuaManager::g_emulator->getMemory().write##size(vaddr, value);             \
-		return 0;                                                                  \
+// Every thunk gets a pointer to the emulator that owns the Lua state as its first upvalue, so that instances don't share any global state
+static Emulator& getEmulator(lua_State* L) { return *static_cast<Emulator*>(lua_touserdata(L, lua_upvalueindex(1))); }
+
+#define MAKE_MEMORY_FUNCTIONS(size)                                       \
+	static int read##size##Thunk(lua_State* L) {                          \
+		const u32 vaddr = (u32)lua_tointeger(L, 1);                       \
+		lua_pushinteger(L, getEmulator(L).getMemory().read##size(vaddr)); \
+		return 1;                                                         \
+	}                                                                     \
+	static int write##size##Thunk(lua_State* L) {                         \
+		const u32 vaddr = (u32)lua_tointeger(L, 1);                       \
+		const u##size value = (u##size)lua_tointeger(L, 2);               \
+		getEmulator(L).getMemory().write##size(vaddr, value);             \
+		return 0;                                                         \
 	}
 
 MAKE_MEMORY_FUNCTIONS(8)
@@ -166,32 +226,193 @@ MAKE_MEMORY_FUNCTIONS(64)
 
 static int readFloatThunk(lua_State* L) {
 	const u32 vaddr = (u32)lua_tointeger(L, 1);
-	lua_pushnumber(L, (lua_Number)Helpers::bit_cast<float, u32>(LuaManager::g_emulator->getMemory().read32(vaddr)));
+	lua_pushnumber(L, (lua_Number)Helpers::bit_cast<float, u32>(getEmulator(L).getMemory().read32(vaddr)));
 	return 1;
 }
 
 static int writeFloatThunk(lua_State* L) {
 	const u32 vaddr = (u32)lua_tointeger(L, 1);
 	const float value = (float)lua_tonumber(L, 2);
-	LuaManager::g_emulator->getMemory().write32(vaddr, Helpers::bit_cast<u32, float>(value));
+	getEmulator(L).getMemory().write32(vaddr, Helpers::bit_cast<u32, float>(value));
 	return 0;
 }
 
 static int readDoubleThunk(lua_State* L) {
 	const u32 vaddr = (u32)lua_tointeger(L, 1);
-	lua_pushnumber(L, (lua_Number)Helpers::bit_cast<double, u64>(LuaManager::g_emulator->getMemory().read64(vaddr)));
+	lua_pushnumber(L, (lua_Number)Helpers::bit_cast<double, u64>(getEmulator(L).getMemory().read64(vaddr)));
 	return 1;
 }
 
 static int writeDoubleThunk(lua_State* L) {
 	const u32 vaddr = (u32)lua_tointeger(L, 1);
 	const double value = (double)lua_tonumber(L, 2);
-	LuaManager::g_emulator->getMemory().write64(vaddr, Helpers::bit_cast<u64, double>(value));
+	getEmulator(L).getMemory().write64(vaddr, Helpers::bit_cast<u64, double>(value));
+	return 0;
+}
+
+// Calls func(hostPointer, size) for each page-sized chunk of a range of guest memory, so that bulk reads can copy whole chunks instead of
+// crossing into C++ once per value. Returns false without touching anything if any part of the range isn't readable
+// Largest range a single bulk read may cover. This is more than the FCRAM of any model, so it only catches nonsensical sizes
+static constexpr lua_Integer maxBulkReadSize = 256_MB;
+
+// Validates the address and size arguments of a bulk read, which are at stack indices index and index + 1
+static std::pair<u32, usize> checkReadRange(lua_State* L, int index) {
+	const lua_Integer vaddr = luaL_checkinteger(L, index);
+	const lua_Integer size = luaL_checkinteger(L, index + 1);
+
+	if (vaddr < 0 || vaddr > lua_Integer(0xFFFFFFFF)) {
+		luaL_error(L, "Argument %d (address) is not a valid address", index);
+	}
+
+	if (size < 0 || size > maxBulkReadSize || u64(vaddr) + u64(size) > 0x100000000ull) {
+		luaL_error(L, "Argument %d (size) is not a valid size for this address", index + 1);
+	}
+
+	return {u32(vaddr), usize(size)};
+}
+
+static bool isRangeReadable(Memory& mem, u32 vaddr, usize size) {
+	for (u64 address = vaddr; address < u64(vaddr) + size; address = (address + Memory::pageSize) & ~u64(Memory::pageMask)) {
+		if (mem.getReadPointer(u32(address)) == nullptr) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Calls func for each page-sized piece of a range that was checked with checkReadRange and isRangeReadable
+template <typename Func>
+static void forEachReadChunk(Memory& mem, u32 vaddr, usize size, Func func) {
+	while (size > 0) {
+		const usize chunkSize = std::min<usize>(size, Memory::pageSize - (vaddr & Memory::pageMask));
+		func(static_cast<const u8*>(mem.getReadPointer(vaddr)), chunkSize);
+
+		vaddr += u32(chunkSize);
+		size -= chunkSize;
+	}
+}
+
+// Returns a range of memory as a string, or nil if it isn't all readable
+static int readBytesThunk(lua_State* L) {
+	const auto [vaddr, size] = checkReadRange(L, 1);
+	Memory& mem = getEmulator(L).getMemory();
+
+	// Check the whole range before allocating anything, so that we don't copy half of it
+	if (!isRangeReadable(mem, vaddr, size)) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	std::string bytes;
+	bytes.reserve(size);
+	forEachReadChunk(mem, vaddr, size, [&](const u8* data, usize chunkSize) { bytes.append(reinterpret_cast<const char*>(data), chunkSize); });
+
+	lua_pushlstring(L, bytes.data(), bytes.size());
+	return 1;
+}
+
+// Copies a range of memory into a buffer, passed as a host address. This lets scripts read into FFI buffers without creating Lua strings
+static int readIntoThunk(lua_State* L) {
+	u8* buffer = reinterpret_cast<u8*>(uintptr_t(luaL_checknumber(L, 1)));
+	const auto [vaddr, size] = checkReadRange(L, 2);
+
+	if (buffer == nullptr) {
+		return luaL_error(L, "Argument 1 (buffer) is null");
+	}
+
+	Memory& mem = getEmulator(L).getMemory();
+	if (!isRangeReadable(mem, vaddr, size)) {
+		lua_pushboolean(L, 0);
+		return 1;
+	}
+
+	forEachReadChunk(mem, vaddr, size, [&](const u8* data, usize chunkSize) {
+		std::memcpy(buffer, data, chunkSize);
+		buffer += chunkSize;
+	});
+
+	lua_pushboolean(L, 1);
+	return 1;
+}
+
+// Reads a value of the given size (1, 2 or 4 bytes) from every address in an array. Returns an array with the values at the same indices.
+// Unreadable addresses are left as nil
+static int readListThunk(lua_State* L) {
+	if (lua_type(L, 1) != LUA_TTABLE) {
+		return luaL_error(L, "Argument 1 (addresses) is not a table");
+	}
+
+	const int size = (int)luaL_checkinteger(L, 2);
+	if (size != 1 && size != 2 && size != 4) {
+		return luaL_error(L, "Argument 2 (size) must be 1, 2 or 4");
+	}
+
+	Memory& mem = getEmulator(L).getMemory();
+	const int count = int(lua_objlen(L, 1));
+	lua_createtable(L, count, 0);
+
+	for (int i = 1; i <= count; i++) {
+		lua_rawgeti(L, 1, i);
+		const u32 vaddr = (u32)lua_tointeger(L, -1);
+		lua_pop(L, 1);
+
+		// Values that straddle a page boundary take the regular read path, as the next page may not follow this one in host memory
+		const u8* pointer = static_cast<const u8*>(mem.getReadPointer(vaddr));
+		if (pointer == nullptr) {
+			continue;
+		}
+
+		u32 value = 0;
+		if ((vaddr & Memory::pageMask) + size <= Memory::pageSize) [[likely]] {
+			std::memcpy(&value, pointer, size);
+		} else {
+			value = (size == 2) ? mem.read16(vaddr) : mem.read32(vaddr);
+		}
+
+		lua_pushinteger(L, value);
+		lua_rawseti(L, -2, i);
+	}
+
+	return 1;
+}
+
+static int addWriteWatchThunk(lua_State* L) {
+	const lua_Integer vaddr = luaL_checkinteger(L, 1);
+	const lua_Integer size = luaL_checkinteger(L, 2);
+
+	if (vaddr < 0 || vaddr > lua_Integer(0xFFFFFFFF)) {
+		return luaL_error(L, "Argument 1 (address) is not a valid address");
+	}
+
+	if (size <= 0 || u64(vaddr) + u64(size) > 0x100000000ull) {
+		return luaL_error(L, "Argument 2 (size) is not a valid size for this address");
+	}
+
+	// Like service intercepts, the callback must be a function object
+	if (lua_type(L, 3) != LUA_TFUNCTION) {
+		return luaL_error(L, "Argument 3 (callback) is not a function");
+	}
+
+	lua_pushvalue(L, 3);
+	const int callbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	lua_pushinteger(L, getEmulator(L).getLua().addWriteWatch(u32(vaddr), u32(size), callbackRef));
+	return 1;
+}
+
+static int removeWriteWatchThunk(lua_State* L) {
+	const u32 id = (u32)lua_tointeger(L, 1);
+	lua_pushboolean(L, getEmulator(L).getLua().removeWriteWatch(id) ? 1 : 0);
+	return 1;
+}
+
+static int clearWriteWatchesThunk(lua_State* L) {
+	getEmulator(L).getLua().clearWriteWatches();
 	return 0;
 }
 
 static int getAppIDThunk(lua_State* L) {
-	std::optional<u64> id = LuaManager::g_emulator->getMemory().getProgramID();
+	std::optional<u64> id = getEmulator(L).getMemory().getProgramID();
 
 	// If the app has an ID, return true + its ID
 	// Otherwise return false and 0 as the ID
@@ -210,17 +431,17 @@ static int getAppIDThunk(lua_State* L) {
 }
 
 static int pauseThunk(lua_State* L) {
-	LuaManager::g_emulator->pause();
+	getEmulator(L).pause();
 	return 0;
 }
 
 static int resumeThunk(lua_State* L) {
-	LuaManager::g_emulator->resume();
+	getEmulator(L).resume();
 	return 0;
 }
 
 static int resetThunk(lua_State* L) {
-	LuaManager::g_emulator->reset(Emulator::ReloadOption::Reload);
+	getEmulator(L).reset(Emulator::ReloadOption::Reload);
 	return 0;
 }
 
@@ -237,7 +458,7 @@ static int loadROMThunk(lua_State* L) {
 
 	const auto path = std::filesystem::path(std::string(str, pathLength));
 	// Load ROM and reply if it succeeded or not
-	lua_pushboolean(L, LuaManager::g_emulator->loadROM(path) ? 1 : 0);
+	lua_pushboolean(L, getEmulator(L).loadROM(path) ? 1 : 0);
 	return 1;
 }
 
@@ -270,24 +491,24 @@ static int addServiceInterceptThunk(lua_State* L) {
 	// Must be freed with lua_unref later, in order to avoid memory leaks
 	lua_pushvalue(L, 3);
 	const int callbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
-	LuaManager::g_emulator->getServiceManager().addServiceIntercept(serviceName, function, callbackRef);
+	getEmulator(L).getServiceManager().addServiceIntercept(serviceName, function, callbackRef);
 	return 0;
 }
 
 static int clearServiceInterceptsThunk(lua_State* L) {
-	LuaManager::g_emulator->getServiceManager().clearServiceIntercepts();
+	getEmulator(L).getServiceManager().clearServiceIntercepts();
 	return 0;
 }
 
 static int getButtonsThunk(lua_State* L) {
-	auto buttons = LuaManager::g_emulator->getServiceManager().getHID().getOldButtons();
+	auto buttons = getEmulator(L).getServiceManager().getHID().getOldButtons();
 	lua_pushinteger(L, static_cast<lua_Integer>(buttons));
 
 	return 1;
 }
 
 static int getCirclepadThunk(lua_State* L) {
-	auto& hid = LuaManager::g_emulator->getServiceManager().getHID();
+	auto& hid = getEmulator(L).getServiceManager().getHID();
 	s16 x = hid.getCirclepadX();
 	s16 y = hid.getCirclepadY();
 
@@ -297,7 +518,7 @@ static int getCirclepadThunk(lua_State* L) {
 }
 
 static int getButtonThunk(lua_State* L) {
-	auto& hid = LuaManager::g_emulator->getServiceManager().getHID();
+	auto& hid = getEmulator(L).getServiceManager().getHID();
 	// This function accepts a mask. You can use it to check if one or more buttons are pressed at a time
 	const u32 mask = (u32)lua_tonumber(L, 1);
 	const bool result = (hid.getOldButtons() & mask) == mask;
@@ -308,7 +529,8 @@ static int getButtonThunk(lua_State* L) {
 }
 
 static int disassembleARMThunk(lua_State* L) {
-	static Common::CapstoneDisassembler disassembler;
+	// One disassembler per thread, since instances running on other threads may be disassembling at the same time
+	static thread_local Common::CapstoneDisassembler disassembler;
 	// We want the disassembler to only be fully initialized when this function is first used
 	if (!disassembler.isInitialized()) {
 		disassembler.init(CS_ARCH_ARM, CS_MODE_ARM);
@@ -341,6 +563,97 @@ static int disassembleTeakThunk(lua_State* L) {
 	return 1;
 }
 
+// Memory scanner values are passed around as raw bits, so floats need to be converted from and to Lua numbers
+static u32 toScanValue(lua_State* L, int index, MemoryScanner::ValueType type) {
+	if (type == MemoryScanner::ValueType::Float) {
+		return Helpers::bit_cast<u32, float>(float(lua_tonumber(L, index)));
+	}
+
+	return u32(lua_tointeger(L, index));
+}
+
+static void pushScanValue(lua_State* L, u32 value, MemoryScanner::ValueType type) {
+	if (type == MemoryScanner::ValueType::Float) {
+		lua_pushnumber(L, (lua_Number)Helpers::bit_cast<float, u32>(value));
+	} else {
+		lua_pushinteger(L, lua_Integer(value));
+	}
+}
+
+static bool isValidScanComparison(int comparison) {
+	return comparison >= int(MemoryScanner::Comparison::Unknown) && comparison <= int(MemoryScanner::Comparison::Decreased);
+}
+
+static int scanFirstThunk(lua_State* L) {
+	const int type = (int)lua_tointeger(L, 1);
+	const int comparison = (int)lua_tointeger(L, 2);
+
+	if (type < 0 || type >= int(MemoryScanner::ValueType::Count)) {
+		return luaL_error(L, "Argument 1 (value type) is not a valid scan type");
+	}
+
+	if (!isValidScanComparison(comparison)) {
+		return luaL_error(L, "Argument 2 (comparison) is not a valid scan comparison");
+	}
+
+	auto valueType = static_cast<MemoryScanner::ValueType>(type);
+	auto& scanner = getEmulator(L).getMemoryScanner();
+	const bool success = scanner.firstScan(
+		valueType, static_cast<MemoryScanner::Comparison>(comparison), toScanValue(L, 3, valueType), toScanValue(L, 4, valueType)
+	);
+
+	lua_pushboolean(L, success ? 1 : 0);
+	return 1;
+}
+
+static int scanNextThunk(lua_State* L) {
+	const int comparison = (int)lua_tointeger(L, 1);
+	if (!isValidScanComparison(comparison)) {
+		return luaL_error(L, "Argument 1 (comparison) is not a valid scan comparison");
+	}
+
+	auto& scanner = getEmulator(L).getMemoryScanner();
+	const bool success = scanner.nextScan(
+		static_cast<MemoryScanner::Comparison>(comparison), toScanValue(L, 2, scanner.getType()), toScanValue(L, 3, scanner.getType())
+	);
+
+	lua_pushboolean(L, success ? 1 : 0);
+	return 1;
+}
+
+static int scanCountThunk(lua_State* L) {
+	lua_pushinteger(L, lua_Integer(getEmulator(L).getMemoryScanner().getResultCount()));
+	return 1;
+}
+
+// Returns an array of {address, value, previous} tables
+static int scanResultsThunk(lua_State* L) {
+	auto& scanner = getEmulator(L).getMemoryScanner();
+	const usize start = usize(lua_tointeger(L, 1));
+	const usize count = usize(lua_tointeger(L, 2));
+	const auto results = scanner.getResults(start, count);
+
+	lua_createtable(L, int(results.size()), 0);
+	for (usize i = 0; i < results.size(); i++) {
+		lua_createtable(L, 0, 3);
+		lua_pushinteger(L, lua_Integer(results[i].address));
+		lua_setfield(L, -2, "address");
+		pushScanValue(L, results[i].value, scanner.getType());
+		lua_setfield(L, -2, "value");
+		pushScanValue(L, results[i].previous, scanner.getType());
+		lua_setfield(L, -2, "previous");
+
+		lua_rawseti(L, -2, int(i + 1));
+	}
+
+	return 1;
+}
+
+static int scanResetThunk(lua_State* L) {
+	getEmulator(L).getMemoryScanner().reset();
+	return 0;
+}
+
 // clang-format off
 static constexpr luaL_Reg functions[] = {
 	{ "__read8", read8Thunk },
@@ -355,6 +668,12 @@ static constexpr luaL_Reg functions[] = {
 	{ "__write64", write64Thunk },
 	{ "__writeFloat", writeFloatThunk },
 	{ "__writeDouble", writeDoubleThunk },
+	{ "__readBytes", readBytesThunk },
+	{ "__readInto", readIntoThunk },
+	{ "__readList", readListThunk },
+	{ "__addWriteWatch", addWriteWatchThunk },
+	{ "__removeWriteWatch", removeWriteWatchThunk },
+	{ "__clearWriteWatches", clearWriteWatchesThunk },
 	{ "__getAppID", getAppIDThunk },
 	{ "__pause", pauseThunk }, 
 	{ "__resume", resumeThunk },
@@ -367,6 +686,11 @@ static constexpr luaL_Reg functions[] = {
 	{ "__disassembleTeak", disassembleTeakThunk },
 	{"__addServiceIntercept", addServiceInterceptThunk },
 	{"__clearServiceIntercepts", clearServiceInterceptsThunk },
+	{ "__scanFirst", scanFirstThunk },
+	{ "__scanNext", scanNextThunk },
+	{ "__scanCount", scanCountThunk },
+	{ "__scanResults", scanResultsThunk },
+	{ "__scanReset", scanResetThunk },
 	{ nullptr, nullptr },
 };
 // clang-format on
@@ -388,6 +712,17 @@ void LuaManager::initializeThunks() {
 		writeFloat = function(addr, value) GLOBALS.__writeFloat(addr, value) end,
 		writeDouble = function(addr, value) GLOBALS.__writeDouble(addr, value) end,
 
+		readBytes = function(addr, size) return GLOBALS.__readBytes(addr, size) end,
+		readInto = function(buffer, addr, size)
+			local ffi = require("ffi")
+			return GLOBALS.__readInto(tonumber(ffi.cast("uintptr_t", buffer)), addr, size)
+		end,
+		readList = function(addresses, size) return GLOBALS.__readList(addresses, size or 4) end,
+
+		addWriteWatch = function(addr, size, cb) return GLOBALS.__addWriteWatch(addr, size, cb) end,
+		removeWriteWatch = function(id) return GLOBALS.__removeWriteWatch(id) end,
+		clearWriteWatches = function() GLOBALS.__clearWriteWatches() end,
+
 		getAppID = function()
 			local ffi = require("ffi")
 
@@ -410,6 +745,12 @@ void LuaManager::initializeThunks() {
 		addServiceIntercept = function(service, func, cb) return GLOBALS.__addServiceIntercept(service, func, cb) end,
 		clearServiceIntercepts = function() return GLOBALS.__clearServiceIntercepts() end,
 
+		scanFirst = function(type, comparison, value, value2) return GLOBALS.__scanFirst(type, comparison, value or 0, value2 or 0) end,
+		scanNext = function(comparison, value, value2) return GLOBALS.__scanNext(comparison, value or 0, value2 or 0) end,
+		scanCount = function() return GLOBALS.__scanCount() end,
+		scanResults = function(start, count) return GLOBALS.__scanResults(start or 0, count or 100) end,
+		scanReset = function() GLOBALS.__scanReset() end,
+
 		Frame = __Frame,
 		ButtonA = __ButtonA,
 		ButtonB = __ButtonB,
@@ -423,6 +764,24 @@ void LuaManager::initializeThunks() {
 		ButtonDown = __ButtonDown,
 		ButtonLeft = __ButtonLeft,
 		ButtonRight= __ButtonRight,
+
+		ScanU8 = __ScanU8,
+		ScanU16 = __ScanU16,
+		ScanU32 = __ScanU32,
+		ScanFloat = __ScanFloat,
+
+		ScanUnknown = __ScanUnknown,
+		ScanEqual = __ScanEqual,
+		ScanNotEqual = __ScanNotEqual,
+		ScanGreater = __ScanGreater,
+		ScanGreaterOrEqual = __ScanGreaterOrEqual,
+		ScanLess = __ScanLess,
+		ScanLessOrEqual = __ScanLessOrEqual,
+		ScanBetween = __ScanBetween,
+		ScanChanged = __ScanChanged,
+		ScanUnchanged = __ScanUnchanged,
+		ScanIncreased = __ScanIncreased,
+		ScanDecreased = __ScanDecreased,
 	}
 )";
 
@@ -431,7 +790,9 @@ void LuaManager::initializeThunks() {
 		lua_setglobal(L, name);
 	};
 
-	luaL_register(L, "GLOBALS", functions);
+	// Register the thunks with the emulator pointer as their upvalue
+	lua_pushlightuserdata(L, &emulator);
+	luaL_openlib(L, "GLOBALS", functions, 1);
 	// Add values for event enum
 	addIntConstant(LuaEvent::Frame, "__Frame");
 
@@ -449,6 +810,27 @@ void LuaManager::initializeThunks() {
 	addIntConstant(HID::Keys::ZL, "__ButtonZL");
 	addIntConstant(HID::Keys::ZR, "__ButtonZR");
 
+	// Add enums for the memory scanner
+	using ScanType = MemoryScanner::ValueType;
+	using ScanComparison = MemoryScanner::Comparison;
+	addIntConstant(ScanType::U8, "__ScanU8");
+	addIntConstant(ScanType::U16, "__ScanU16");
+	addIntConstant(ScanType::U32, "__ScanU32");
+	addIntConstant(ScanType::Float, "__ScanFloat");
+
+	addIntConstant(ScanComparison::Unknown, "__ScanUnknown");
+	addIntConstant(ScanComparison::Equal, "__ScanEqual");
+	addIntConstant(ScanComparison::NotEqual, "__ScanNotEqual");
+	addIntConstant(ScanComparison::Greater, "__ScanGreater");
+	addIntConstant(ScanComparison::GreaterOrEqual, "__ScanGreaterOrEqual");
+	addIntConstant(ScanComparison::Less, "__ScanLess");
+	addIntConstant(ScanComparison::LessOrEqual, "__ScanLessOrEqual");
+	addIntConstant(ScanComparison::Between, "__ScanBetween");
+	addIntConstant(ScanComparison::Changed, "__ScanChanged");
+	addIntConstant(ScanComparison::Unchanged, "__ScanUnchanged");
+	addIntConstant(ScanComparison::Increased, "__ScanIncreased");
+	addIntConstant(ScanComparison::Decreased, "__ScanDecreased");
+
 	// Call our Lua runtime initialization before any Lua script runs
 	luaL_loadstring(L, runtimeInit);
 	int ret = lua_pcall(L, 0, 0, 0);  // tell Lua to run the script
@@ -0,0 +1,244 @@
+#include "panda_qt/game_list_window.hpp"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPixmap>
+#include <QVBoxLayout>
+#include <cstring>
+
+#include "crypto/aes_engine.hpp"
+#include "panda_qt/main_window.hpp"
+
+namespace {
+	// SMDH layout. Titles come in 16 languages, each with a short description, a long description and a publisher
+	constexpr usize smdhSize = 0x36C0;
+	constexpr usize smdhTitlesOffset = 0x8;
+	constexpr usize smdhTitleSize = 0x200;
+	constexpr usize smdhShortTitleLength = 0x40;  // In UTF-16 code units
+	constexpr usize smdhEnglishTitle = 1;
+	constexpr usize smdhLargeIconOffset = 0x24C0;
+	constexpr int smdhLargeIconSize = 48;
+
+	enum Column { TitleColumn = 0, TitleIDColumn, RegionColumn, PathColumn };
+}  // namespace
+
+GameListWindow::GameListWindow(Emulator* emu, MainWindow* mainWindow, QWidget* parent)
+	: QWidget(parent, Qt::Window), emu(emu), mainWindow(mainWindow) {
+	setWindowTitle(tr("Game List"));
+	resize(800, 500);
+
+	appDataPath = emu->getAppDataRoot();
+	romDirectory = emu->getConfig().defaultRomPath;
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->setContentsMargins(6, 6, 6, 6);
+
+	gameTree = new QTreeWidget;
+	gameTree->setColumnCount(4);
+	gameTree->setHeaderLabels({tr("Title"), tr("Title ID"), tr("Region"), tr("File")});
+	gameTree->setRootIsDecorated(false);
+	gameTree->setIconSize(QSize(smdhLargeIconSize, smdhLargeIconSize));
+	gameTree->setSortingEnabled(true);
+	gameTree->sortByColumn(TitleColumn, Qt::AscendingOrder);
+	gameTree->header()->setSectionResizeMode(TitleColumn, QHeaderView::Stretch);
+	gameTree->header()->setStretchLastSection(false);
+	layout->addWidget(gameTree);
+
+	QHBoxLayout* buttonLayout = new QHBoxLayout;
+	statusLabel = new QLabel;
+	folderButton = new QPushButton(tr("Choose folder"));
+	refreshButton = new QPushButton(tr("Refresh"));
+	buttonLayout->addWidget(statusLabel, 1);
+	buttonLayout->addWidget(folderButton);
+	buttonLayout->addWidget(refreshButton);
+	layout->addLayout(buttonLayout);
+
+	connect(folderButton, &QPushButton::clicked, this, &GameListWindow::chooseFolder);
+	connect(refreshButton, &QPushButton::clicked, this, &GameListWindow::startScan);
+	connect(gameTree, &QTreeWidget::itemActivated, this, [this](QTreeWidgetItem* item, int) { loadTitle(item); });
+
+	// Show what we knew from last time right away, the scan only has to look at what changed since
+	index.load(getIndexPath());
+	populate();
+}
+
+GameListWindow::~GameListWindow() {
+	if (scanThread.joinable()) {
+		scanThread.join();
+	}
+}
+
+void GameListWindow::showEvent(QShowEvent* event) {
+	QWidget::showEvent(event);
+	startScan();
+}
+
+void GameListWindow::chooseFolder() {
+	const QString folder = QFileDialog::getExistingDirectory(
+		this, tr("Select the folder containing your games"), QString::fromStdU16String(romDirectory.u16string()), QFileDialog::ShowDirsOnly
+	);
+
+	if (folder.isEmpty()) {
+		return;
+	}
+
+	romDirectory = std::filesystem::path(folder.toStdU16String());
+	// The config belongs to the emulator thread, so update it from there
+	mainWindow->runOnEmuThread([emu = emu, directory = romDirectory]() {
+		emu->getConfig().defaultRomPath = directory;
+		emu->getConfig().save();
+	});
+
+	startScan();
+}
+
+void GameListWindow::startScan() {
+	if (romDirectory.empty()) {
+		statusLabel->setText(tr("Choose the folder containing your games to fill the list"));
+		return;
+	}
+
+	if (scanning.exchange(true)) {
+		return;
+	}
+
+	if (scanThread.joinable()) {
+		scanThread.join();
+	}
+
+	statusLabel->setText(tr("Looking for games..."));
+	folderButton->setEnabled(false);
+	refreshButton->setEnabled(false);
+
+	scanThread = std::thread([this, directory = romDirectory]() {
+		// Encrypted titles need the same keys the emulator uses to read their SMDH
+		Crypto::AESEngine aesEngine;
+		const std::filesystem::path aesKeysPath = appDataPath / "sysdata" / "aes_keys.txt";
+		const std::filesystem::path seedDBPath = appDataPath / "sysdata" / "seeddb.bin";
+
+		std::error_code ec;
+		if (std::filesystem::exists(aesKeysPath, ec) && !ec) {
+			aesEngine.loadKeys(aesKeysPath);
+		}
+
+		if (std::filesystem::exists(seedDBPath, ec) && !ec) {
+			aesEngine.setSeedPath(seedDBPath);
+		}
+
+		const usize parsedCount = index.scan({directory}, aesEngine);
+		if (parsedCount != 0) {
+			index.save(getIndexPath());
+		}
+
+		QMetaObject::invokeMethod(this, [this, parsedCount]() { finishScan(parsedCount); }, Qt::QueuedConnection);
+	});
+}
+
+void GameListWindow::finishScan(usize parsedCount) {
+	scanning = false;
+	folderButton->setEnabled(true);
+	refreshButton->setEnabled(true);
+
+	// Don't rebuild the list if nothing changed, so that the selection and scroll position stay put
+	if (parsedCount != 0 || gameTree->topLevelItemCount() != int(index.getTitles().size())) {
+		populate();
+	}
+}
+
+void GameListWindow::populate() {
+	const std::vector<TitleInfo> titles = index.getTitles();
+
+	gameTree->setSortingEnabled(false);
+	gameTree->clear();
+
+	for (const TitleInfo& title : titles) {
+		const QString path = QString::fromStdU16String(title.path.u16string());
+		QString name = getTitleName(title.smdh);
+		if (name.isEmpty()) {
+			name = QString::fromStdU16String(title.path.stem().u16string());
+		}
+
+		QTreeWidgetItem* item = new QTreeWidgetItem(gameTree);
+		item->setText(TitleColumn, name);
+		item->setText(TitleIDColumn, QString("%1").arg(title.programID, 16, 16, QChar('0')).toUpper());
+		item->setText(RegionColumn, getRegionName(title.region));
+		item->setText(PathColumn, path);
+		item->setData(TitleColumn, Qt::UserRole, path);
+
+		if (const QImage icon = getIcon(title.smdh); !icon.isNull()) {
+			item->setIcon(TitleColumn, QIcon(QPixmap::fromImage(icon)));
+		}
+
+		if (title.encrypted && title.smdh.empty()) {
+			item->setToolTip(TitleColumn, tr("This game is encrypted, and its name and icon can't be read without the AES keys"));
+		}
+	}
+
+	gameTree->setSortingEnabled(true);
+	statusLabel->setText(tr("%n game(s)", "", int(titles.size())));
+}
+
+void GameListWindow::loadTitle(QTreeWidgetItem* item) {
+	const std::filesystem::path path = item->data(TitleColumn, Qt::UserRole).toString().toStdU16String();
+	mainWindow->runOnEmuThread([emu = emu, path]() {
+		if (!emu->loadROM(path)) {
+			Helpers::warn("Failed to load ROM file: %s", path.string().c_str());
+		}
+	});
+}
+
+QString GameListWindow::getTitleName(const std::vector<u8>& smdh) {
+	if (smdh.size() < smdhSize) {
+		return {};
+	}
+
+	char16_t name[smdhShortTitleLength];
+	std::memcpy(name, &smdh[smdhTitlesOffset + smdhEnglishTitle * smdhTitleSize], sizeof(name));
+
+	usize length = 0;
+	while (length < smdhShortTitleLength && name[length] != 0) {
+		length++;
+	}
+
+	return QString::fromUtf16(name, qsizetype(length)).trimmed();
+}
+
+QImage GameListWindow::getIcon(const std::vector<u8>& smdh) {
+	if (smdh.size() < smdhSize) {
+		return {};
+	}
+
+	// The icon is RGB565, split in 8x8 tiles with their pixels in Morton order
+	QImage icon(smdhLargeIconSize, smdhLargeIconSize, QImage::Format_RGB16);
+	const u8* pixel = &smdh[smdhLargeIconOffset];
+
+	for (int tileY = 0; tileY < smdhLargeIconSize; tileY += 8) {
+		for (int tileX = 0; tileX < smdhLargeIconSize; tileX += 8) {
+			for (int i = 0; i < 64; i++, pixel += sizeof(u16)) {
+				const int x = tileX + ((i & 1) | ((i >> 1) & 2) | ((i >> 2) & 4));
+				const int y = tileY + (((i >> 1) & 1) | ((i >> 2) & 2) | ((i >> 3) & 4));
+				std::memcpy(icon.scanLine(y) + x * sizeof(u16), pixel, sizeof(u16));
+			}
+		}
+	}
+
+	return icon;
+}
+
+QString GameListWindow::getRegionName(std::optional<Regions> region) {
+	if (!region.has_value()) {
+		return tr("Unknown");
+	}
+
+	switch (*region) {
+		case Regions::Japan: return tr("Japan");
+		case Regions::USA: return tr("USA");
+		case Regions::Europe: return tr("Europe");
+		case Regions::Australia: return tr("Australia");
+		case Regions::China: return tr("China");
+		case Regions::Korea: return tr("Korea");
+		case Regions::Taiwan: return tr("Taiwan");
+		default: return tr("Unknown");
+	}
+}
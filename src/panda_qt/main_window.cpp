@@ -53,10 +53,12 @@ MainWindow::MainWindow(QApplication* app, QWidget* parent) : QMainWindow(parent)
 
 	// Create and bind actions for them
 	auto loadGameAction = fileMenu->addAction(tr("Load game"));
+	auto gameListAction = fileMenu->addAction(tr("Game list"));
 	auto loadLuaAction = fileMenu->addAction(tr("Load Lua script"));
 	auto openAppFolderAction = fileMenu->addAction(tr("Open Panda3DS folder"));
 
 	connect(loadGameAction, &QAction::triggered, this, &MainWindow::selectROM);
+	connect(gameListAction, &QAction::triggered, this, [this]() { gameList->show(); });
 	connect(loadLuaAction, &QAction::triggered, this, &MainWindow::selectLuaFile);
 	connect(openAppFolderAction, &QAction::triggered, this, [this]() {
 		QString path = QString::fromStdU16String(emu->getAppDataRoot().u16string());
@@ -66,17 +68,27 @@ MainWindow::MainWindow(QApplication* app, QWidget* parent) : QMainWindow(parent)
 	auto pauseAction = emulationMenu->addAction(tr("Pause"));
 	auto resumeAction = emulationMenu->addAction(tr("Resume"));
 	auto resetAction = emulationMenu->addAction(tr("Reset"));
+	turboAction = emulationMenu->addAction(tr("Turbo"));
+	turboAction->setCheckable(true);
+	auto recordMovieAction = emulationMenu->addAction(tr("Record movie"));
+	auto playMovieAction = emulationMenu->addAction(tr("Play movie"));
+	auto stopMovieAction = emulationMenu->addAction(tr("Stop movie"));
 	auto configureAction = emulationMenu->addAction(tr("Configure"));
 	configureAction->setMenuRole(QAction::PreferencesRole);
 
 	connect(pauseAction, &QAction::triggered, this, [this]() { sendMessage(EmulatorMessage{.type = MessageType::Pause}); });
 	connect(resumeAction, &QAction::triggered, this, [this]() { sendMessage(EmulatorMessage{.type = MessageType::Resume}); });
 	connect(resetAction, &QAction::triggered, this, [this]() { sendMessage(EmulatorMessage{.type = MessageType::Reset}); });
+	connect(turboAction, &QAction::toggled, this, [this](bool enabled) { runOnEmuThread([this, enabled]() { emu->setTurbo(enabled); }); });
+	connect(recordMovieAction, &QAction::triggered, this, &MainWindow::recordMovie);
+	connect(playMovieAction, &QAction::triggered, this, &MainWindow::playMovie);
+	connect(stopMovieAction, &QAction::triggered, this, [this]() { runOnEmuThread([this]() { emu->stopMovie(); }); });
 	connect(configureAction, &QAction::triggered, this, [this]() { configWindow->show(); });
 
 	auto dumpRomFSAction = toolsMenu->addAction(tr("Dump RomFS"));
 	auto luaEditorAction = toolsMenu->addAction(tr("Open Lua Editor"));
 	auto cheatsEditorAction = toolsMenu->addAction(tr("Open Cheats Editor"));
+	auto memorySearchAction = toolsMenu->addAction(tr("Open Memory Search"));
 	auto patchWindowAction = toolsMenu->addAction(tr("Open Patch Window"));
 	auto shaderEditorAction = toolsMenu->addAction(tr("Open Shader Editor"));
 	auto cpuDebuggerAction = toolsMenu->addAction(tr("Open CPU Debugger"));
@@ -88,6 +100,7 @@ MainWindow::MainWindow(QApplication* app, QWidget* parent) : QMainWindow(parent)
 	connect(luaEditorAction, &QAction::triggered, this, [this]() { luaEditor->show(); });
 	connect(shaderEditorAction, &QAction::triggered, this, [this]() { shaderEditor->show(); });
 	connect(cheatsEditorAction, &QAction::triggered, this, [this]() { cheatsEditor->show(); });
+	connect(memorySearchAction, &QAction::triggered, this, [this]() { memorySearch->show(); });
 	connect(patchWindowAction, &QAction::triggered, this, [this]() { patchWindow->show(); });
 	connect(cpuDebuggerAction, &QAction::triggered, this, [this]() { cpuDebugger->show(); });
 	connect(dspDebuggerAction, &QAction::triggered, this, [this]() { dspDebugger->show(); });
@@ -107,6 +120,8 @@ MainWindow::MainWindow(QApplication* app, QWidget* parent) : QMainWindow(parent)
 	// Set up misc objects
 	aboutWindow = new AboutWindow(nullptr);
 	cheatsEditor = new CheatsWindow(emu, {}, this);
+	memorySearch = new MemorySearchWindow(emu, this, this);
+	gameList = new GameListWindow(emu, this, this);
 	patchWindow = new PatchWindow(this);
 	luaEditor = new TextEditorWindow(this, "script.lua", "");
 	shaderEditor = new ShaderEditorWindow(this, "shader.glsl", "");
@@ -167,6 +182,7 @@ MainWindow::MainWindow(QApplication* app, QWidget* parent) : QMainWindow(parent)
 				GL::Context* glContext = screen->getGLContext();
 				glContext->MakeCurrent();
 				glContext->SetSwapInterval(emu->getConfig().vsyncEnabled ? 1 : 0);
+				vsyncActive = emu->getConfig().vsyncEnabled;
 
 				if (glContext->IsGLES()) {
 					emu->getRenderer()->setupGLES();
@@ -210,11 +226,10 @@ void MainWindow::emuThreadMainLoop() {
 		emu->runFrame();
 		pollControllers();
 
-		if (emu->romType != ROMType::None) {
-			emu->getServiceManager().getHID().updateInputs(emu->getTicks());
+		// Frames skipped by render-skip didn't draw anything, so keep showing the last one that did
+		if (emu->isFrameRendered()) {
+			swapEmuBuffer();
 		}
-
-		swapEmuBuffer();
 	}
 
 	// Unbind GL context if we're using GL, otherwise some setups seem to be unable to join this thread
@@ -225,6 +240,12 @@ void MainWindow::emuThreadMainLoop() {
 
 void MainWindow::swapEmuBuffer() {
 	if (usingGL) {
+		// Vsync is turned off while running at a speed other than 1x, as the emulator paces itself then
+		if (const bool vsync = emu->shouldUseVsync(); vsync != vsyncActive) {
+			vsyncActive = vsync;
+			screen->getGLContext()->SetSwapInterval(vsync ? 1 : 0);
+		}
+
 		screen->getGLContext()->SwapBuffers();
 	} else if (usingMtl) {
 		// The renderer itself calls presentDrawable to swap buffers on Metal
@@ -236,7 +257,7 @@ void MainWindow::swapEmuBuffer() {
 void MainWindow::selectROM() {
 	auto path = QFileDialog::getOpenFileName(
 		this, tr("Select 3DS ROM to load"), QString::fromStdU16String(emu->getConfig().defaultRomPath.u16string()),
-		tr("Nintendo 3DS ROMs (*.3ds *.cci *.cxi *.app *.ncch *.3dsx *.elf *.axf)")
+		tr("Nintendo 3DS ROMs (*.3ds *.cci *.cxi *.app *.ncch *.zcci *.zcxi *.3dsx *.elf *.axf)")
 	);
 
 	if (!path.isEmpty()) {
@@ -248,6 +269,33 @@ void MainWindow::selectROM() {
 	}
 }
 
+// Movies restart the running game and record or replay every input from boot
+void MainWindow::recordMovie() {
+	auto path = QFileDialog::getSaveFileName(this, tr("Select file to record movie to"), "", tr("Panda3DS movies (*.pmov)"));
+
+	if (!path.isEmpty()) {
+		const std::filesystem::path moviePath = path.toStdU16String();
+		runOnEmuThread([this, moviePath]() {
+			if (!emu->startMovieRecording(moviePath)) {
+				printf("Failed to start recording movie, is a game running?\n");
+			}
+		});
+	}
+}
+
+void MainWindow::playMovie() {
+	auto path = QFileDialog::getOpenFileName(this, tr("Select movie to play"), "", tr("Panda3DS movies (*.pmov)"));
+
+	if (!path.isEmpty()) {
+		const std::filesystem::path moviePath = path.toStdU16String();
+		runOnEmuThread([this, moviePath]() {
+			if (!emu->startMoviePlayback(moviePath)) {
+				printf("Failed to play movie\n");
+			}
+		});
+	}
+}
+
 void MainWindow::selectLuaFile() {
 	auto path = QFileDialog::getOpenFileName(this, tr("Select Lua script to load"), "", tr("Lua scripts (*.lua *.txt)"));
 
@@ -305,6 +353,8 @@ MainWindow::~MainWindow() {
 	delete aboutWindow;
 	delete configWindow;
 	delete cheatsEditor;
+	delete memorySearch;
+	delete gameList;
 	delete screen;
 	delete luaEditor;
 }
@@ -436,8 +486,6 @@ void MainWindow::dispatchMessage(const EmulatorMessage& message) {
 			break;
 
 		case MessageType::Reset: emu->reset(Emulator::ReloadOption::Reload); break;
-		case MessageType::PressKey: emu->getServiceManager().getHID().pressKey(message.key.key); break;
-		case MessageType::ReleaseKey: emu->getServiceManager().getHID().releaseKey(message.key.key); break;
 
 		// Track whether we're controlling the analog stick with our controller and update the CirclePad X/Y values in HID
 		// Controllers are polled on the emulator thread, so this message type is only used when the circlepad is changed via keyboard input
@@ -453,10 +501,6 @@ void MainWindow::dispatchMessage(const EmulatorMessage& message) {
 			break;
 		}
 
-		case MessageType::PressTouchscreen:
-			emu->getServiceManager().getHID().setTouchScreenPress(message.touchscreen.x, message.touchscreen.y);
-			break;
-		case MessageType::ReleaseTouchscreen: emu->getServiceManager().getHID().releaseTouchScreen(); break;
 
 		case MessageType::ReloadUbershader:
 			emu->getRenderer()->setUbershader(*message.string.str);
@@ -471,6 +515,11 @@ void MainWindow::dispatchMessage(const EmulatorMessage& message) {
 			break;
 		}
 
+		case MessageType::RunOnEmuThread:
+			(*message.function.f)();
+			delete message.function.f;
+			break;
+
 		case MessageType::UpdateConfig: {
 			auto& emuConfig = emu->getConfig();
 			auto& newConfig = configWindow->getConfig();
@@ -493,11 +542,8 @@ void MainWindow::dispatchMessage(const EmulatorMessage& message) {
 }
 
 void MainWindow::keyPressEvent(QKeyEvent* event) {
-	auto pressKey = [this](u32 key) {
-		EmulatorMessage message{.type = MessageType::PressKey};
-		message.key.key = key;
-		sendMessage(message);
-	};
+	// HID input state is lock-free, so we can write to it directly instead of going through the message queue
+	auto pressKey = [this](u32 key) { emu->getServiceManager().getHID().pressKey(key); };
 
 	auto setCirclePad = [this](MessageType type, s16 value) {
 		EmulatorMessage message{.type = type};
@@ -519,16 +565,13 @@ void MainWindow::keyPressEvent(QKeyEvent* event) {
 		switch (event->key()) {
 			case Qt::Key_F4: sendMessage(EmulatorMessage{.type = MessageType::TogglePause}); break;
 			case Qt::Key_F5: sendMessage(EmulatorMessage{.type = MessageType::Reset}); break;
+			case Qt::Key_F6: turboAction->toggle(); break;
 		}
 	}
 }
 
 void MainWindow::keyReleaseEvent(QKeyEvent* event) {
-	auto releaseKey = [this](u32 key) {
-		EmulatorMessage message{.type = MessageType::ReleaseKey};
-		message.key.key = key;
-		sendMessage(message);
-	};
+	auto releaseKey = [this](u32 key) { emu->getServiceManager().getHID().releaseKey(key); };
 
 	auto releaseCirclePad = [this](MessageType type) {
 		EmulatorMessage message{.type = type};
@@ -564,7 +607,7 @@ void MainWindow::mouseMoveEvent(QMouseEvent* event) {
 
 void MainWindow::mouseReleaseEvent(QMouseEvent* event) {
 	if (event->button() == Qt::MouseButton::LeftButton) {
-		sendMessage(EmulatorMessage{.type = MessageType::ReleaseTouchscreen});
+		emu->getServiceManager().getHID().releaseTouchScreen();
 	}
 }
 
@@ -588,12 +631,9 @@ void MainWindow::handleTouchscreenPress(QMouseEvent* event) {
 		u16 x_converted = u16(std::clamp(relX * ScreenLayout::BOTTOM_SCREEN_WIDTH, 0.f, float(ScreenLayout::BOTTOM_SCREEN_WIDTH - 1)));
 		u16 y_converted = u16(std::clamp(relY * ScreenLayout::BOTTOM_SCREEN_HEIGHT, 0.f, float(ScreenLayout::BOTTOM_SCREEN_HEIGHT - 1)));
 
-		EmulatorMessage message{.type = MessageType::PressTouchscreen};
-		message.touchscreen.x = x_converted;
-		message.touchscreen.y = y_converted;
-		sendMessage(message);
+		emu->getServiceManager().getHID().setTouchScreenPress(x_converted, y_converted);
 	} else {
-		sendMessage(EmulatorMessage{.type = MessageType::ReleaseTouchscreen});
+		emu->getServiceManager().getHID().releaseTouchScreen();
 	}
 }
 
@@ -625,6 +665,12 @@ void MainWindow::editCheat(u32 handle, const std::vector<uint8_t>& cheat, const
 	sendMessage(message);
 }
 
+void MainWindow::runOnEmuThread(const std::function<void()>& callback) {
+	EmulatorMessage message{.type = MessageType::RunOnEmuThread};
+	message.function.f = new std::function<void()>(callback);
+	sendMessage(message);
+}
+
 void MainWindow::handleScreenResize(u32 width, u32 height) {
 	EmulatorMessage message{.type = MessageType::SetScreenSize};
 	message.screenSize.width = width;
@@ -0,0 +1,239 @@
+#include "panda_qt/memory_search_window.hpp"
+
+#include <fmt/format.h>
+
+#include <QApplication>
+#include <QClipboard>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+#include "panda_qt/main_window.hpp"
+
+using ValueType = MemoryScanner::ValueType;
+using Comparison = MemoryScanner::Comparison;
+
+MemorySearchWindow::MemorySearchWindow(Emulator* emu, MainWindow* mainWindow, QWidget* parent)
+	: QWidget(parent, Qt::Window), emu(emu), mainWindow(mainWindow) {
+	setWindowTitle(tr("Memory Search"));
+	resize(500, 600);
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->setContentsMargins(6, 6, 6, 6);
+
+	QGridLayout* optionsLayout = new QGridLayout;
+	typeSelect = new QComboBox;
+	typeSelect->addItem(tr("8-bit"), int(ValueType::U8));
+	typeSelect->addItem(tr("16-bit"), int(ValueType::U16));
+	typeSelect->addItem(tr("32-bit"), int(ValueType::U32));
+	typeSelect->addItem(tr("Float"), int(ValueType::Float));
+	typeSelect->setCurrentIndex(2);
+
+	comparisonSelect = new QComboBox;
+	comparisonSelect->addItem(tr("Unknown value"), int(Comparison::Unknown));
+	comparisonSelect->addItem(tr("Equal to"), int(Comparison::Equal));
+	comparisonSelect->addItem(tr("Not equal to"), int(Comparison::NotEqual));
+	comparisonSelect->addItem(tr("Greater than"), int(Comparison::Greater));
+	comparisonSelect->addItem(tr("Greater than or equal to"), int(Comparison::GreaterOrEqual));
+	comparisonSelect->addItem(tr("Less than"), int(Comparison::Less));
+	comparisonSelect->addItem(tr("Less than or equal to"), int(Comparison::LessOrEqual));
+	comparisonSelect->addItem(tr("Between"), int(Comparison::Between));
+	comparisonSelect->addItem(tr("Changed"), int(Comparison::Changed));
+	comparisonSelect->addItem(tr("Unchanged"), int(Comparison::Unchanged));
+	comparisonSelect->addItem(tr("Increased"), int(Comparison::Increased));
+	comparisonSelect->addItem(tr("Decreased"), int(Comparison::Decreased));
+	comparisonSelect->setCurrentIndex(1);
+
+	valueEdit = new QLineEdit;
+	valueEdit->setPlaceholderText(tr("Value (prefix hex values with 0x)"));
+	value2Edit = new QLineEdit;
+	value2Edit->setPlaceholderText(tr("Upper bound"));
+	value2Edit->setEnabled(false);
+
+	optionsLayout->addWidget(new QLabel(tr("Value type")), 0, 0);
+	optionsLayout->addWidget(typeSelect, 0, 1);
+	optionsLayout->addWidget(new QLabel(tr("Comparison")), 1, 0);
+	optionsLayout->addWidget(comparisonSelect, 1, 1);
+	optionsLayout->addWidget(new QLabel(tr("Value")), 2, 0);
+	optionsLayout->addWidget(valueEdit, 2, 1);
+	optionsLayout->addWidget(value2Edit, 3, 1);
+	layout->addLayout(optionsLayout);
+
+	QHBoxLayout* buttonLayout = new QHBoxLayout;
+	firstScanButton = new QPushButton(tr("First Scan"));
+	nextScanButton = new QPushButton(tr("Next Scan"));
+	resetButton = new QPushButton(tr("Reset"));
+	buttonLayout->addWidget(firstScanButton);
+	buttonLayout->addWidget(nextScanButton);
+	buttonLayout->addWidget(resetButton);
+	layout->addLayout(buttonLayout);
+
+	resultCountLabel = new QLabel;
+	layout->addWidget(resultCountLabel);
+
+	resultTable = new QTableWidget(this);
+	resultTable->setColumnCount(3);
+	resultTable->setHorizontalHeaderLabels(QStringList({tr("Address"), tr("Value"), tr("Previous")}));
+	resultTable->verticalHeader()->setVisible(false);
+	resultTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+	resultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+	resultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	layout->addWidget(resultTable);
+
+	copyCheatButton = new QPushButton(tr("Copy selected results as cheat code"));
+	layout->addWidget(copyCheatButton);
+
+	connect(firstScanButton, &QPushButton::clicked, this, [this]() { startScan(true); });
+	connect(nextScanButton, &QPushButton::clicked, this, [this]() { startScan(false); });
+	connect(resetButton, &QPushButton::clicked, this, &MemorySearchWindow::resetScan);
+	connect(copyCheatButton, &QPushButton::clicked, this, &MemorySearchWindow::copyCheatCode);
+	connect(comparisonSelect, &QComboBox::currentIndexChanged, this, [this](int) {
+		const auto comparison = Comparison(comparisonSelect->currentData().toInt());
+		const bool needsValue = comparison >= Comparison::Equal && comparison <= Comparison::Between;
+
+		valueEdit->setEnabled(needsValue);
+		value2Edit->setEnabled(comparison == Comparison::Between);
+	});
+
+	setButtonsEnabled(true, false);
+}
+
+void MemorySearchWindow::setButtonsEnabled(bool enabled, bool searchActive) {
+	firstScanButton->setEnabled(enabled);
+	nextScanButton->setEnabled(enabled && searchActive);
+	resetButton->setEnabled(enabled && searchActive);
+	typeSelect->setEnabled(enabled);
+}
+
+std::optional<u32> MemorySearchWindow::parseValue(const QString& text, ValueType type) const {
+	bool ok = false;
+
+	if (type == ValueType::Float) {
+		const float value = text.trimmed().toFloat(&ok);
+		return ok ? std::optional<u32>(Helpers::bit_cast<u32, float>(value)) : std::nullopt;
+	}
+
+	// Base 0 accepts both decimal and 0x-prefixed hex values
+	const u32 value = text.trimmed().toUInt(&ok, 0);
+	return ok ? std::optional<u32>(value) : std::nullopt;
+}
+
+QString MemorySearchWindow::formatValue(u32 value, ValueType type) {
+	switch (type) {
+		case ValueType::U8: return QString::fromStdString(fmt::format("{} (0x{:02X})", value, value));
+		case ValueType::U16: return QString::fromStdString(fmt::format("{} (0x{:04X})", value, value));
+		case ValueType::Float: return QString::number(Helpers::bit_cast<float, u32>(value));
+		default: return QString::fromStdString(fmt::format("{} (0x{:08X})", value, value));
+	}
+}
+
+void MemorySearchWindow::startScan(bool firstScan) {
+	const auto type = firstScan ? ValueType(typeSelect->currentData().toInt()) : shownType;
+	const auto comparison = Comparison(comparisonSelect->currentData().toInt());
+	u32 value = 0;
+	u32 value2 = 0;
+
+	if (valueEdit->isEnabled()) {
+		auto parsed = parseValue(valueEdit->text(), type);
+		if (!parsed.has_value()) {
+			resultCountLabel->setText(tr("Invalid value"));
+			return;
+		}
+
+		value = *parsed;
+	}
+
+	if (value2Edit->isEnabled()) {
+		auto parsed = parseValue(value2Edit->text(), type);
+		if (!parsed.has_value()) {
+			resultCountLabel->setText(tr("Invalid upper bound"));
+			return;
+		}
+
+		value2 = *parsed;
+	}
+
+	setButtonsEnabled(false, false);
+	resultCountLabel->setText(tr("Scanning..."));
+
+	// Scans read guest memory, so they have to run on the emulator thread
+	mainWindow->runOnEmuThread([this, firstScan, type, comparison, value, value2]() {
+		MemoryScanner& scanner = emu->getMemoryScanner();
+		const bool success = firstScan ? scanner.firstScan(type, comparison, value, value2) : scanner.nextScan(comparison, value, value2);
+
+		const usize count = success ? scanner.getResultCount() : 0;
+		auto results = success ? scanner.getResults(0, maxShownResults) : std::vector<MemoryScanner::Result>{};
+		const bool active = scanner.isActive();
+
+		QMetaObject::invokeMethod(
+			this,
+			[this, success, active, type, count, results = std::move(results)]() {
+				setButtonsEnabled(true, active);
+				if (!success) {
+					resultCountLabel->setText(tr("This comparison needs the values of a previous scan"));
+					return;
+				}
+
+				showResults(type, count, results);
+			},
+			Qt::QueuedConnection
+		);
+	});
+}
+
+void MemorySearchWindow::resetScan() {
+	mainWindow->runOnEmuThread([this]() { emu->getMemoryScanner().reset(); });
+
+	shownResults.clear();
+	resultTable->setRowCount(0);
+	resultCountLabel->clear();
+	setButtonsEnabled(true, false);
+}
+
+void MemorySearchWindow::showResults(ValueType type, usize resultCount, std::vector<MemoryScanner::Result> results) {
+	shownType = type;
+	shownResults = std::move(results);
+
+	if (resultCount > shownResults.size()) {
+		resultCountLabel->setText(tr("%1 results (showing the first %2)").arg(resultCount).arg(shownResults.size()));
+	} else {
+		resultCountLabel->setText(tr("%1 results").arg(resultCount));
+	}
+
+	resultTable->setRowCount(int(shownResults.size()));
+	for (int i = 0; i < int(shownResults.size()); i++) {
+		const auto& result = shownResults[i];
+		resultTable->setItem(i, 0, new QTableWidgetItem(QString::fromStdString(fmt::format("{:08X}", result.address))));
+		resultTable->setItem(i, 1, new QTableWidgetItem(formatValue(result.value, type)));
+		resultTable->setItem(i, 2, new QTableWidgetItem(formatValue(result.previous, type)));
+	}
+}
+
+// Turn the selected results into an Action Replay code that writes their current values, and copy it to the clipboard
+void MemorySearchWindow::copyCheatCode() {
+	// Action Replay writes take the type in the top nibble and a 28-bit address, so addresses above that need the offset register
+	const u32 writeType = (shownType == ValueType::U8) ? 2 : ((shownType == ValueType::U16) ? 1 : 0);
+	std::string code;
+
+	for (const auto& range : resultTable->selectedRanges()) {
+		for (int row = range.topRow(); row <= range.bottomRow(); row++) {
+			const auto& result = shownResults[row];
+			const u32 offset = result.address & 0xF0000000;
+
+			if (offset != 0) {
+				code += fmt::format("D3000000 {:08X}\n", offset);
+			}
+
+			code += fmt::format("{:08X} {:08X}\n", (writeType << 28) | (result.address & 0x0FFFFFFF), result.value);
+
+			if (offset != 0) {
+				code += "D2000000 00000000\n";
+			}
+		}
+	}
+
+	if (!code.empty()) {
+		QApplication::clipboard()->setText(QString::fromStdString(code));
+	}
+}
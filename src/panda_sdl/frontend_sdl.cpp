@@ -100,6 +100,7 @@ FrontendSDL::FrontendSDL() : keyboardMappings(InputMappings::defaultKeyboardMapp
 		}
 
 		SDL_GL_SetSwapInterval(config.vsyncEnabled ? 1 : 0);
+		vsyncActive = config.vsyncEnabled;
 	}
 
 #ifdef PANDA3DS_ENABLE_VULKAN
@@ -196,6 +197,12 @@ void FrontendSDL::run() {
 								break;
 							}
 
+							// F6 toggles turbo mode
+							case SDLK_F6: {
+								emu.toggleTurbo();
+								break;
+							}
+
 							case SDLK_F11: {
 								if constexpr (Renderdoc::isSupported()) {
 									Renderdoc::triggerCapture();
@@ -432,13 +439,20 @@ void FrontendSDL::run() {
 					hid.setCStickY(-(cStickY / 8));
 				}
 			}
-
-			hid.updateInputs(emu.getTicks());
 		}
 		// TODO: Should this be uncommented?
 		// kernel.evalReschedule();
 
-		SDL_GL_SwapWindow(window);
+		// Vsync is turned off while running at a speed other than 1x, as the emulator paces itself then
+		if (const bool vsync = emu.shouldUseVsync(); vsync != vsyncActive) {
+			vsyncActive = vsync;
+			SDL_GL_SetSwapInterval(vsync ? 1 : 0);
+		}
+
+		// Frames skipped by render-skip didn't draw anything, so keep showing the last one that did
+		if (emu.isFrameRendered()) {
+			SDL_GL_SwapWindow(window);
+		}
 	}
 }
 
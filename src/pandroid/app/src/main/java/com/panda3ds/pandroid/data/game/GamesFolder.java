@@ -53,7 +53,7 @@ public class GamesFolder {
             }
 
             String ext = FileUtils.extension(path);
-            if (ext.equals("3ds") || ext.equals("3dsx") || ext.equals("cci") || ext.equals("cxi") || ext.equals("app") || ext.equals("ncch")) {
+            if (ext.equals("3ds") || ext.equals("3dsx") || ext.equals("cci") || ext.equals("cxi") || ext.equals("app") || ext.equals("ncch") || ext.equals("zcci") || ext.equals("zcxi")) {
                 String name = FileUtils.getName(path).trim().split("\\.")[0];
                 games.put(file, new GameMetadata(new Uri.Builder().path(file).authority(id).scheme("folder").build().toString(), name, unknown));
             }
@@ -0,0 +1,50 @@
+// Command line tool for converting CCI/CXI images to compressed ROM containers (see loader/compressed_rom.hpp)
+// Usage: AlberROMCompressor <aes_keys.txt> <input.3ds/.cci/.cxi> <output> [seeddb.bin]
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "crypto/aes_engine.hpp"
+#include "loader/compressed_rom.hpp"
+
+int main(int argc, char** argv) {
+	if (argc < 4 || argc > 5) {
+		printf("Usage: %s <aes_keys.txt> <input ROM> <output> [seeddb.bin]\n", argv[0]);
+		printf("Inputs with a .cxi, .app or .ncch extension are treated as CXIs, everything else as CCIs\n");
+		return 1;
+	}
+
+	const std::filesystem::path keysPath = argv[1];
+	const std::filesystem::path inputPath = argv[2];
+	const std::filesystem::path outputPath = argv[3];
+
+	Crypto::AESEngine aesEngine;
+	std::error_code ec;
+	if (std::filesystem::exists(keysPath, ec) && !ec) {
+		aesEngine.loadKeys(keysPath);
+	} else {
+		printf("Couldn't find %s, only unencrypted ROMs can be converted\n", keysPath.string().c_str());
+	}
+
+	if (argc == 5) {
+		aesEngine.setSeedPath(argv[4]);
+	}
+
+	const auto extension = inputPath.extension();
+	const bool isCXI = extension == ".cxi" || extension == ".app" || extension == ".ncch";
+
+	if (!CompressedROM::convert(aesEngine, inputPath, outputPath, isCXI)) {
+		printf("Conversion failed\n");
+		return 1;
+	}
+
+	const auto inputSize = std::filesystem::file_size(inputPath, ec);
+	const auto outputSize = std::filesystem::file_size(outputPath, ec);
+	if (!ec && inputSize != 0) {
+		printf("Compressed %s to %s (%.1f%% of the original size)\n", inputPath.string().c_str(), outputPath.string().c_str(),
+			   double(outputSize) * 100.0 / double(inputSize));
+	}
+
+	return 0;
+}
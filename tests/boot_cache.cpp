@@ -0,0 +1,115 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "loader/boot_cache.hpp"
+#include "loader/ncch.hpp"
+
+namespace {
+	// Scratch directory holding a fake ROM and the cache, removed when the test is done
+	struct ScratchDirectory {
+		std::filesystem::path path;
+
+		ScratchDirectory() {
+			path = std::filesystem::temp_directory_path() / ("panda3ds-boot-cache-test-" + std::to_string(std::random_device{}()));
+			std::filesystem::create_directories(path);
+		}
+
+		~ScratchDirectory() {
+			std::error_code ec;
+			std::filesystem::remove_all(path, ec);
+		}
+	};
+
+	void writeFile(const std::filesystem::path& path, const std::string& contents) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << contents;
+	}
+
+	NCCH makeNCCH() {
+		NCCH ncch;
+		ncch.programID = 0x0004000000123400;
+		ncch.saveDataSize = 0x80000;
+		ncch.stackSize = 0x4000;
+		ncch.bssSize = 0x1234;
+		ncch.text = {0x100000, 2, 0x1800};
+		ncch.rodata = {0x102000, 1, 0x200};
+		ncch.data = {0x103000, 1, 0x300};
+		ncch.region = Regions::Europe;
+
+		for (u32 i = 0; i < 0x2000; i++) {
+			ncch.codeFile.push_back(u8(i * 7));
+		}
+		ncch.smdh.assign(0x36C0, 0xAB);
+		return ncch;
+	}
+}  // namespace
+
+TEST_CASE("Boot cache entries round-trip", "[boot_cache]") {
+	ScratchDirectory scratch;
+	const auto romPath = scratch.path / "game.3ds";
+	const auto cachePath = scratch.path / "cache";
+	writeFile(romPath, "not really a ROM");
+
+	BootCache cache;
+	cache.setDirectory(cachePath);
+	cache.setROM(romPath);
+
+	const NCCH original = makeNCCH();
+	constexpr u64 headerHash = 0x0123456789ABCDEF;
+	cache.store(original, headerHash);
+
+	NCCH loaded;
+	loaded.programID = original.programID;
+	REQUIRE(cache.load(loaded, headerHash));
+	REQUIRE(loaded.codeFile == original.codeFile);
+	REQUIRE(loaded.smdh == original.smdh);
+	REQUIRE(loaded.saveDataSize == original.saveDataSize);
+	REQUIRE(loaded.stackSize == original.stackSize);
+	REQUIRE(loaded.bssSize == original.bssSize);
+	REQUIRE(loaded.text.address == original.text.address);
+	REQUIRE(loaded.rodata.size == original.rodata.size);
+	REQUIRE(loaded.data.pageCount == original.data.pageCount);
+	REQUIRE(loaded.region == original.region);
+}
+
+TEST_CASE("Boot cache entries are invalidated", "[boot_cache]") {
+	ScratchDirectory scratch;
+	const auto romPath = scratch.path / "game.3ds";
+	const auto cachePath = scratch.path / "cache";
+	writeFile(romPath, "not really a ROM");
+
+	BootCache cache;
+	cache.setDirectory(cachePath);
+	cache.setROM(romPath);
+
+	const NCCH original = makeNCCH();
+	constexpr u64 headerHash = 0x0123456789ABCDEF;
+	cache.store(original, headerHash);
+
+	NCCH loaded;
+	loaded.programID = original.programID;
+
+	SECTION("Header hash mismatch") {
+		REQUIRE_FALSE(cache.load(loaded, headerHash ^ 1));
+		REQUIRE(loaded.codeFile.empty());
+		REQUIRE(loaded.smdh.empty());
+	}
+
+	SECTION("ROM changed size") {
+		writeFile(romPath, "not really a ROM, but longer");
+		cache.setROM(romPath);
+		REQUIRE_FALSE(cache.load(loaded, headerHash));
+		REQUIRE(loaded.codeFile.empty());
+	}
+
+	SECTION("Truncated entry") {
+		const auto entry = std::filesystem::directory_iterator(cachePath)->path();
+		std::filesystem::resize_file(entry, std::filesystem::file_size(entry) - 1);
+		REQUIRE_FALSE(cache.load(loaded, headerHash));
+		REQUIRE(loaded.codeFile.empty());
+	}
+}
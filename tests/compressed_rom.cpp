@@ -0,0 +1,159 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "loader/compressed_rom.hpp"
+#include "xxhash/xxhash.h"
+
+namespace {
+	// Temporary container file, removed when the test is done
+	struct ScratchFile {
+		std::filesystem::path path;
+
+		ScratchFile() {
+			path = std::filesystem::temp_directory_path() / ("panda3ds-compressed-rom-test-" + std::to_string(std::random_device{}()) + ".zcci");
+		}
+
+		~ScratchFile() {
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+		}
+	};
+
+	constexpr u32 blockSize = 16_KB;
+
+	// An image with a compressible block, an incompressible block and a partial block at the end
+	std::vector<u8> makeImage() {
+		std::vector<u8> image(blockSize * 2 + 1234);
+		std::mt19937 rng(1234);
+
+		for (u32 i = 0; i < blockSize; i++) {
+			image[i] = u8(i / 64);
+		}
+
+		for (u32 i = blockSize; i < image.size(); i++) {
+			image[i] = u8(rng());
+		}
+
+		return image;
+	}
+
+	bool writeContainer(const std::filesystem::path& path, const std::vector<u8>& image) {
+		return CompressedROM::write(path, image.size(), blockSize, [&](u64 offset, u8* dst, usize size) {
+			std::memcpy(dst, &image[offset], size);
+			return true;
+		});
+	}
+
+	// Overwrite size bytes of a file at the given offset
+	void patchFile(const std::filesystem::path& path, u64 offset, const void* data, usize size) {
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offset);
+		file.write(static_cast<const char*>(data), size);
+	}
+}  // namespace
+
+TEST_CASE("Compressed ROMs round-trip", "[compressed_rom]") {
+	ScratchFile scratch;
+	const std::vector<u8> image = makeImage();
+	REQUIRE(writeContainer(scratch.path, image));
+
+	CompressedROM rom;
+	REQUIRE(rom.open(scratch.path));
+	REQUIRE(rom.size() == image.size());
+
+	// Read the blocks out of order, so that each one is decompressed on its own
+	std::vector<u8> readBack(image.size());
+	for (u64 start : {blockSize * 2, 0u, blockSize}) {
+		const usize size = std::min<usize>(blockSize, image.size() - start);
+		auto [success, bytes] = rom.read(start, &readBack[start], size);
+
+		REQUIRE(success);
+		REQUIRE(bytes == size);
+		REQUIRE(std::memcmp(&readBack[start], &image[start], size) == 0);
+	}
+	REQUIRE(XXH3_64bits(readBack.data(), readBack.size()) == XXH3_64bits(image.data(), image.size()));
+
+	// Reads that straddle blocks or go past the end of the image
+	std::vector<u8> buffer(blockSize);
+	auto [success, bytes] = rom.read(blockSize - 100, buffer.data(), 200);
+	REQUIRE(success);
+	REQUIRE(bytes == 200);
+	REQUIRE(std::memcmp(buffer.data(), &image[blockSize - 100], 200) == 0);
+
+	std::tie(success, bytes) = rom.read(image.size() - 10, buffer.data(), 100);
+	REQUIRE(bytes == 10);
+	REQUIRE(std::memcmp(buffer.data(), &image[image.size() - 10], 10) == 0);
+}
+
+TEST_CASE("Corrupted compressed ROMs are rejected", "[compressed_rom]") {
+	ScratchFile scratch;
+	const std::vector<u8> image = makeImage();
+	REQUIRE(writeContainer(scratch.path, image));
+
+	CompressedROM::Header header;
+	std::vector<CompressedROM::BlockEntry> index(3);
+	{
+		std::ifstream file(scratch.path, std::ios::binary);
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(CompressedROM::BlockEntry));
+	}
+	REQUIRE(header.blockCount == 3);
+	REQUIRE((index[0].flags & CompressedROM::BlockEntry::StoredRaw) == 0);
+	REQUIRE((index[1].flags & CompressedROM::BlockEntry::StoredRaw) != 0);
+
+	const u64 fileSize = std::filesystem::file_size(scratch.path);
+	auto patchEntry = [&](u32 i, const CompressedROM::BlockEntry& entry) {
+		patchFile(scratch.path, sizeof(header) + i * sizeof(entry), &entry, sizeof(entry));
+	};
+
+	SECTION("Corrupted block data") {
+		const u8 byte = 0x55;
+		patchFile(scratch.path, index[1].offset + 10, &byte, 1);
+
+		CompressedROM rom;
+		REQUIRE(rom.open(scratch.path));
+
+		u8 buffer[16];
+		REQUIRE(rom.read(0, buffer, sizeof(buffer)).first);
+		REQUIRE_FALSE(rom.read(blockSize, buffer, sizeof(buffer)).first);
+	}
+
+	SECTION("Block past the end of the file") {
+		auto entry = index[2];
+		entry.offset = fileSize - entry.storedSize + 1;
+		patchEntry(2, entry);
+
+		CompressedROM rom;
+		REQUIRE_FALSE(rom.open(scratch.path));
+	}
+
+	SECTION("Block bigger than the block size") {
+		auto entry = index[0];
+		entry.storedSize = blockSize + 1;
+		patchEntry(0, entry);
+
+		CompressedROM rom;
+		REQUIRE_FALSE(rom.open(scratch.path));
+	}
+
+	SECTION("Block overlapping the index") {
+		auto entry = index[0];
+		entry.offset = sizeof(header);
+		patchEntry(0, entry);
+
+		CompressedROM rom;
+		REQUIRE_FALSE(rom.open(scratch.path));
+	}
+
+	SECTION("Truncated file") {
+		std::filesystem::resize_file(scratch.path, fileSize - 1);
+
+		CompressedROM rom;
+		REQUIRE_FALSE(rom.open(scratch.path));
+	}
+}
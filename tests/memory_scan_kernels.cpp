@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "memory_scan_kernels.hpp"
+
+using namespace MemoryScanKernels;
+
+namespace {
+	constexpr usize blockCount = 32;
+
+	// Random values, with some repeated from the previous scan and some floats made special (NaN, infinities, zeroes), so that every
+	// op gets both outcomes and the SIMD compares have to get the IEEE edge cases right
+	void fillValues(std::mt19937& rng, ValueType type, std::vector<u8>& current, std::vector<u8>& previous) {
+		const usize size = valueSize(type);
+		const usize count = blockCount * blockValues;
+		current.resize(count * size);
+		previous.resize(count * size);
+
+		static constexpr u32 specialFloats[] = {0x7FC00000, 0xFFC00001, 0x7F800000, 0xFF800000, 0x00000000, 0x80000000, 0x00000001, 0x3F800000};
+		for (usize i = 0; i < count; i++) {
+			u32 x = rng(), p = rng();
+			if (type == ValueType::Float && (rng() % 4) == 0) {
+				x = specialFloats[rng() % std::size(specialFloats)];
+			}
+
+			// Small values so that range scans match some of them
+			if (rng() % 2) {
+				x %= 8;
+			}
+
+			if (rng() % 3 == 0) {
+				p = x;
+			} else if (rng() % 2) {
+				p = x + 1;
+			}
+
+			std::memcpy(&current[i * size], &x, size);
+			std::memcpy(&previous[i * size], &p, size);
+		}
+	}
+
+	std::vector<u64> makeMask(std::mt19937& rng) {
+		std::vector<u64> bits(blockCount);
+		for (usize i = 0; i < blockCount; i++) {
+			// Leave some blocks empty, as kernels skip those
+			bits[i] = (i % 5 == 0) ? 0 : (u64(rng()) << 32 | rng());
+		}
+
+		return bits;
+	}
+}  // namespace
+
+TEST_CASE("Memory scan kernels match the portable ones", "[memory_scan]") {
+	const KernelTable& portable = portableKernels();
+	const KernelTable& kernels = getKernels();
+	std::mt19937 rng(0x3D5);
+
+	// Range bounds as raw bits, including float bounds
+	const std::pair<u32, u32> ranges[] = {{0, 0}, {1, 5}, {0, 0xFFFFFFFF}, {0x80, 0x7FFF}, {0xBF800000, 0x3F800000}, {0x00000000, 0x7F800000}};
+
+	for (usize type = 0; type < valueTypeCount; type++) {
+		for (usize op = 0; op < opCount; op++) {
+			for (int iteration = 0; iteration < 16; iteration++) {
+				std::vector<u8> current, previous;
+				fillValues(rng, ValueType(type), current, previous);
+
+				// Range kernels need lo <= hi once the bounds are truncated to the value type
+				const auto [lo, hi] = ranges[iteration % std::size(ranges)];
+				const u32 valueMask = u32(u64(1) << (valueSize(ValueType(type)) * 8)) - 1;
+				if (ValueType(type) != ValueType::Float && (lo & valueMask) > (hi & valueMask)) {
+					continue;
+				}
+
+				std::vector<u64> expected = makeMask(rng);
+				std::vector<u64> actual = expected;
+				portable[type][op](current.data(), previous.data(), lo, hi, expected.data(), blockCount);
+				kernels[type][op](current.data(), previous.data(), lo, hi, actual.data(), blockCount);
+
+				INFO("Type " << type << ", op " << op << ", range [" << lo << ", " << hi << "]");
+				REQUIRE(actual == expected);
+			}
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "movie.hpp"
+
+namespace {
+	// Temporary movie file, removed when the test is done
+	struct ScratchFile {
+		std::filesystem::path path;
+
+		ScratchFile() { path = std::filesystem::temp_directory_path() / ("panda3ds-movie-test-" + std::to_string(std::random_device{}()) + ".pmov"); }
+
+		~ScratchFile() {
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+		}
+	};
+
+	constexpr u32 hashInterval = 4;
+	constexpr u64 frameCount = 20;
+	constexpr u64 ticksPerFrame = 100;
+
+	HID::InputState inputForTick(u64 tick) {
+		HID::InputState state{};
+		// Change the buttons every few samples, so that some samples repeat the previous state and aren't stored
+		state.buttons = u32(tick / 300);
+		state.circlePadX = s16(tick / 500);
+		return state;
+	}
+
+	// Fake FCRAM contents for a frame. Frames from desyncAt onwards get different contents than the recording had
+	std::vector<u8> fcramForFrame(u64 frame, u64 desyncAt = ~0ull) {
+		std::vector<u8> fcram(0x1000, u8(frame));
+		if (frame >= desyncAt) {
+			fcram[0x123] ^= 0xFF;
+		}
+
+		return fcram;
+	}
+
+	Movie::Environment makeEnvironment() {
+		Movie::Environment env{};
+		env.programID = 0x0004000000123400;
+		env.startTime = 3'900'000'000'000ull;
+		env.sslSeed = 0x12345678;
+		env.chargerPlugged = 1;
+		env.batteryPercentage = 42;
+		return env;
+	}
+
+	void recordMovie(const std::filesystem::path& path) {
+		Movie movie;
+		REQUIRE(movie.startRecording(path, makeEnvironment(), hashInterval));
+
+		for (u64 frame = 0; frame < frameCount; frame++) {
+			for (u64 tick = frame * ticksPerFrame; tick < (frame + 1) * ticksPerFrame; tick += 50) {
+				HID::InputState input = inputForTick(tick);
+				movie.onInputSample(tick, input);
+			}
+
+			const auto fcram = fcramForFrame(frame);
+			movie.onFrame(fcram);
+		}
+
+		REQUIRE(movie.stop());
+	}
+
+	// Play back a movie, checking that every sample gets the recorded input
+	void playMovie(Movie& movie, u64 desyncAt = ~0ull) {
+		for (u64 frame = 0; frame < frameCount; frame++) {
+			for (u64 tick = frame * ticksPerFrame; tick < (frame + 1) * ticksPerFrame; tick += 50) {
+				HID::InputState input{};
+				movie.onInputSample(tick, input);
+				REQUIRE(input == inputForTick(tick));
+			}
+
+			const auto fcram = fcramForFrame(frame, desyncAt);
+			movie.onFrame(fcram);
+		}
+	}
+}  // namespace
+
+TEST_CASE("Movies round-trip", "[movie]") {
+	ScratchFile scratch;
+	recordMovie(scratch.path);
+
+	Movie movie;
+	REQUIRE(movie.startPlayback(scratch.path));
+	REQUIRE(movie.isPlaying());
+	REQUIRE(movie.getTotalFrames() == frameCount);
+
+	const Movie::Environment env = movie.getEnvironment();
+	const Movie::Environment expected = makeEnvironment();
+	REQUIRE(env.programID == expected.programID);
+	REQUIRE(env.startTime == expected.startTime);
+	REQUIRE(env.sslSeed == expected.sslSeed);
+	REQUIRE(env.chargerPlugged == expected.chargerPlugged);
+	REQUIRE(env.batteryPercentage == expected.batteryPercentage);
+
+	SECTION("Matching playback") {
+		playMovie(movie);
+		REQUIRE(movie.isPlaybackDone());
+		REQUIRE_FALSE(movie.getDesyncFrame().has_value());
+	}
+
+	SECTION("Desynced playback") {
+		// The movie counts frames from 1, so the change lands in frame 10 and the first hash to see it is the one of frame 12
+		playMovie(movie, 9);
+		REQUIRE(movie.getDesyncFrame() == 12);
+	}
+}
+
+TEST_CASE("Broken movies are rejected", "[movie]") {
+	ScratchFile scratch;
+	recordMovie(scratch.path);
+
+	// The entry counts come right after the environment and the total frame count in the header
+	constexpr std::streamoff inputCountOffset = 4 * sizeof(u32) + sizeof(Movie::Environment) + sizeof(u64);
+	Movie movie;
+
+	SECTION("Input count bigger than the file") {
+		const u64 inputCount = 0x10000000000ull;
+		std::fstream file(scratch.path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(inputCountOffset);
+		file.write(reinterpret_cast<const char*>(&inputCount), sizeof(inputCount));
+		file.close();
+
+		REQUIRE_FALSE(movie.startPlayback(scratch.path));
+		REQUIRE_FALSE(movie.isActive());
+	}
+
+	SECTION("Truncated file") {
+		std::filesystem::resize_file(scratch.path, std::filesystem::file_size(scratch.path) - 1);
+		REQUIRE_FALSE(movie.startPlayback(scratch.path));
+		REQUIRE_FALSE(movie.isActive());
+	}
+
+	SECTION("Wrong magic") {
+		const u32 magic = 0;
+		std::fstream file(scratch.path, std::ios::binary | std::ios::in | std::ios::out);
+		file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		file.close();
+
+		REQUIRE_FALSE(movie.startPlayback(scratch.path));
+	}
+}
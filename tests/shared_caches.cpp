@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+
+#include "shared_caches.hpp"
+
+TEST_CASE("Concurrent caches evict to stay within capacity", "[shared_caches]") {
+	ConcurrentCache<u64, u64> cache(4);
+
+	for (u64 i = 0; i < 4; i++) {
+		cache.insert(i, std::make_shared<u64>(i * 10), 1);
+	}
+
+	const std::shared_ptr<u64> held = cache.find(0);
+	REQUIRE(held != nullptr);
+
+	// Entries 1-3 were only inserted, while 0 was used afterwards, so it gets a second chance and one of the others goes first
+	cache.insert(4, std::make_shared<u64>(40), 1);
+	REQUIRE(cache.find(0) != nullptr);
+	REQUIRE(cache.find(4) != nullptr);
+
+	usize present = 0;
+	for (u64 i = 0; i < 5; i++) {
+		present += cache.find(i) != nullptr ? 1 : 0;
+	}
+	REQUIRE(present == 4);
+
+	// Entries that are bigger than what's left push out as many entries as needed
+	cache.insert(5, std::make_shared<u64>(50), 3);
+	REQUIRE(cache.find(5) != nullptr);
+	present = 0;
+	for (u64 i = 0; i < 5; i++) {
+		present += cache.find(i) != nullptr ? 1 : 0;
+	}
+	REQUIRE(present == 1);
+
+	// Evicted values stay alive for whoever still holds them
+	cache.clear();
+	REQUIRE(cache.find(0) == nullptr);
+	REQUIRE(*held == 0);
+}
+
+TEST_CASE("Concurrent caches keep the first copy of an entry", "[shared_caches]") {
+	ConcurrentCache<u64, u64> cache(16);
+
+	const auto first = cache.insert(1, std::make_shared<u64>(1), 1);
+	const auto second = cache.insert(1, std::make_shared<u64>(2), 1);
+	REQUIRE(first == second);
+	REQUIRE(*cache.find(1) == 1);
+}
+
+TEST_CASE("Concurrent caches survive heavy churn", "[shared_caches]") {
+	ConcurrentCache<u64, u64> cache(64);
+
+	// Keep a hot set of entries in use while streaming lots of cold entries through the cache. The hot set should survive
+	for (u64 i = 0; i < 8; i++) {
+		cache.insert(i, std::make_shared<u64>(i), 1);
+	}
+
+	for (u64 i = 100; i < 10000; i++) {
+		for (u64 hot = 0; hot < 8; hot++) {
+			REQUIRE(cache.find(hot) != nullptr);
+		}
+
+		cache.insert(i, std::make_shared<u64>(i), 1);
+	}
+
+	REQUIRE(cache.find(9999) != nullptr);
+}
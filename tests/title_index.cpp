@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "crypto/aes_engine.hpp"
+#include "loader/title_index.hpp"
+
+namespace {
+	// Scratch directory holding a fake ROM library, removed when the test is done
+	struct ScratchDirectory {
+		std::filesystem::path path;
+
+		ScratchDirectory() {
+			path = std::filesystem::temp_directory_path() / ("panda3ds-title-index-test-" + std::to_string(std::random_device{}()));
+			std::filesystem::create_directories(path / "roms" / "subfolder");
+		}
+
+		~ScratchDirectory() {
+			std::error_code ec;
+			std::filesystem::remove_all(path, ec);
+		}
+	};
+
+	void writeFile(const std::filesystem::path& path, const std::vector<u8>& contents) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+	}
+
+	template <typename T>
+	void put(std::vector<u8>& data, usize offset, T value) {
+		std::memcpy(&data[offset], &value, sizeof(T));
+	}
+
+	constexpr u64 programID = 0x0004000000ABCD00;
+
+	// Smallest decrypted CXI with an icon: NCCH header, then an ExeFS holding just the SMDH
+	std::vector<u8> makeCXI() {
+		constexpr usize smdhSize = 0x36C0;
+		// Sizes in the NCCH header are in 0x200 byte media units
+		std::vector<u8> cxi((0x400 + smdhSize + 0x1FF) & ~usize(0x1FF));
+
+		std::memcpy(&cxi[0x100], "NCCH", 4);
+		put<u32>(cxi, 0x104, u32(cxi.size() / 0x200));
+		put<u64>(cxi, 0x118, programID);
+		cxi[0x188 + 7] = 0x4;                                     // NoCrypto
+		put<u32>(cxi, 0x1A0, 1);                                  // ExeFS offset
+		put<u32>(cxi, 0x1A4, u32((cxi.size() - 0x200) / 0x200));  // ExeFS size
+
+		std::memcpy(&cxi[0x200], "icon", 4);
+		put<u32>(cxi, 0x200 + 0xC, u32(smdhSize));
+
+		std::memcpy(&cxi[0x400], "SMDH", 4);
+		put<u32>(cxi, 0x400 + 0x2018, 0x4);  // Europe only
+		return cxi;
+	}
+}  // namespace
+
+TEST_CASE("Title index scans", "[title_index]") {
+	ScratchDirectory scratch;
+	const auto roms = scratch.path / "roms";
+	const auto gamePath = roms / "subfolder" / "Game.CXI";
+	const auto junkPath = roms / "junk.3ds";
+
+	writeFile(gamePath, makeCXI());
+	writeFile(junkPath, {1, 2, 3, 4});
+	writeFile(roms / "readme.txt", {1, 2, 3, 4});
+
+	Crypto::AESEngine aesEngine;
+	TitleIndex index;
+
+	// Extensions are matched regardless of case, and files that aren't ROMs are skipped
+	REQUIRE(index.scan({roms}, aesEngine, 2) == 2);
+	REQUIRE_FALSE(index.find(roms / "readme.txt").has_value());
+
+	const auto titles = index.getTitles();
+	REQUIRE(titles.size() == 1);
+	REQUIRE(titles[0].path == gamePath);
+	REQUIRE(titles[0].programID == programID);
+	REQUIRE(titles[0].region == Regions::Europe);
+	REQUIRE_FALSE(titles[0].encrypted);
+	REQUIRE(titles[0].smdh.size() == 0x36C0);
+
+	// Files that can't be parsed are remembered, so they aren't parsed again on every scan
+	const auto junk = index.find(junkPath);
+	REQUIRE(junk.has_value());
+	REQUIRE_FALSE(junk->valid);
+
+	SECTION("Unchanged files aren't parsed again") { REQUIRE(index.scan({roms}, aesEngine) == 0); }
+
+	SECTION("Changed and removed files") {
+		writeFile(junkPath, {1, 2, 3, 4, 5});
+		std::filesystem::remove(gamePath);
+
+		REQUIRE(index.scan({roms}, aesEngine) == 1);
+		REQUIRE(index.getTitles().empty());
+		REQUIRE_FALSE(index.find(gamePath).has_value());
+	}
+
+	SECTION("Saved indices round-trip") {
+		const auto indexPath = scratch.path / "index.bin";
+		REQUIRE(index.save(indexPath));
+
+		TitleIndex loaded;
+		REQUIRE(loaded.load(indexPath));
+
+		const auto loadedTitles = loaded.getTitles();
+		REQUIRE(loadedTitles.size() == 1);
+		REQUIRE(loadedTitles[0].path == gamePath);
+		REQUIRE(loadedTitles[0].programID == programID);
+		REQUIRE(loadedTitles[0].region == Regions::Europe);
+		REQUIRE(loadedTitles[0].smdh == titles[0].smdh);
+		REQUIRE(loaded.find(junkPath).has_value());
+
+		// The loaded index knows about every file already
+		REQUIRE(loaded.scan({roms}, aesEngine) == 0);
+	}
+}
+
+TEST_CASE("Broken title indices are rejected", "[title_index]") {
+	ScratchDirectory scratch;
+	const auto roms = scratch.path / "roms";
+	const auto indexPath = scratch.path / "index.bin";
+	writeFile(roms / "game.cxi", makeCXI());
+
+	Crypto::AESEngine aesEngine;
+	TitleIndex index;
+	index.scan({roms}, aesEngine);
+	REQUIRE(index.save(indexPath));
+
+	SECTION("Entry sizes past the end of the file") {
+		// The first entry follows the 12-byte file header. Its SMDH size is at offset 0x20 in the entry
+		const u32 smdhSize = 0x7FFFFFFF;
+		std::fstream file(indexPath, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(12 + 0x20);
+		file.write(reinterpret_cast<const char*>(&smdhSize), sizeof(smdhSize));
+	}
+
+	SECTION("Truncated file") { std::filesystem::resize_file(indexPath, std::filesystem::file_size(indexPath) - 1); }
+
+	SECTION("More entries than the file holds") {
+		const u32 entryCount = 1000;
+		std::fstream file(indexPath, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(8);
+		file.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+	}
+
+	TitleIndex loaded;
+	REQUIRE_FALSE(loaded.load(indexPath));
+	REQUIRE(loaded.getTitles().empty());
+}
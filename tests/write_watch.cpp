@@ -0,0 +1,105 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <vector>
+
+#include "config.hpp"
+#include "kernel/fcram.hpp"
+#include "memory.hpp"
+
+namespace {
+	struct WriteRecord {
+		u32 vaddr;
+		u32 size;
+		u32 value;
+	};
+
+	// A memory instance with a couple of pages of heap, like the one the kernel sets up for the application
+	struct MemoryFixture {
+		static constexpr u32 heapStart = 0x08000000;
+		static constexpr s32 heapPages = 2;
+
+		EmulatorConfig config;
+		KFcram fcram;
+		Memory mem;
+		std::vector<WriteRecord> writes;
+
+		MemoryFixture(bool fastmem) : config(makeConfig(fastmem)), fcram(mem), mem(fcram, config) {
+			mem.reset();
+			REQUIRE(mem.allocMemory(heapStart, heapPages, FcramRegion::App, true, true, false, KernelMemoryTypes::MemoryState::Private));
+			mem.setWriteWatchCallback([this](u32 vaddr, u32 size, u32 value) { writes.push_back({vaddr, size, value}); });
+		}
+
+		static EmulatorConfig makeConfig(bool fastmem) {
+			EmulatorConfig config;
+			config.fastmemEnabled = fastmem;
+			return config;
+		}
+	};
+}  // namespace
+
+TEST_CASE("Write watches report writes to their pages", "[memory]") {
+	MemoryFixture fixture(GENERATE(false, true));
+	Memory& mem = fixture.mem;
+	constexpr u32 address = MemoryFixture::heapStart + 0x10;
+
+	mem.write32(address, 0x11111111);
+	REQUIRE(fixture.writes.empty());
+
+	mem.addWriteWatch(address, 4);
+	REQUIRE(mem.getWritePointer(address) == nullptr);
+	REQUIRE(mem.getReadPointer(address) != nullptr);
+
+	mem.write32(address, 0xDEADBEEF);
+	mem.write8(address + 0x100, 0x42);
+	REQUIRE(fixture.writes.size() == 2);
+	REQUIRE(fixture.writes[0].vaddr == address);
+	REQUIRE(fixture.writes[0].size == 4);
+	REQUIRE(fixture.writes[0].value == 0xDEADBEEF);
+	REQUIRE(fixture.writes[1].size == 1);
+
+	// Watched writes still have to land in memory
+	REQUIRE(mem.read32(address) == 0xDEADBEEF);
+	REQUIRE(mem.read8(address + 0x100) == 0x42);
+
+	// Other pages keep their fast paths
+	mem.write32(address + Memory::pageSize, 0x1234);
+	REQUIRE(fixture.writes.size() == 2);
+	REQUIRE(mem.getWritePointer(address + Memory::pageSize) != nullptr);
+
+	mem.removeWriteWatch(address, 4);
+	REQUIRE(mem.getWritePointer(address) != nullptr);
+	mem.write32(address, 0);
+	REQUIRE(fixture.writes.size() == 2);
+}
+
+TEST_CASE("Overlapping write watches are counted", "[memory]") {
+	MemoryFixture fixture(GENERATE(false, true));
+	Memory& mem = fixture.mem;
+	constexpr u32 address = MemoryFixture::heapStart;
+
+	mem.addWriteWatch(address, 8);
+	mem.addWriteWatch(address + 4, 4);
+	mem.removeWriteWatch(address, 8);
+
+	mem.write16(address + 4, 0xBEEF);
+	REQUIRE(fixture.writes.size() == 1);
+	REQUIRE(mem.read16(address + 4) == 0xBEEF);
+
+	mem.removeWriteWatch(address + 4, 4);
+	mem.write16(address + 4, 0);
+	REQUIRE(fixture.writes.size() == 1);
+}
+
+TEST_CASE("Write watches survive the memory being remapped", "[memory]") {
+	MemoryFixture fixture(GENERATE(false, true));
+	Memory& mem = fixture.mem;
+	constexpr u32 address = MemoryFixture::heapStart;
+
+	mem.addWriteWatch(address, 4);
+	REQUIRE(mem.freeMemory(address, MemoryFixture::heapPages));
+	REQUIRE(mem.allocMemory(address, MemoryFixture::heapPages, FcramRegion::App, true, true, false, KernelMemoryTypes::MemoryState::Private));
+
+	mem.write32(address, 0xCAFEBABE);
+	REQUIRE(fixture.writes.size() == 1);
+	REQUIRE(mem.read32(address) == 0xCAFEBABE);
+}
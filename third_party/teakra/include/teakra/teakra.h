@@ -82,6 +82,17 @@ public:
     // core
     void Run(unsigned cycle);
 
+    // Execute code through a cache of pre-decoded blocks instead of decoding every instruction.
+    // Disabled by default. Timing and results are the same as with the plain interpreter
+    void SetBlockCacheEnabled(bool enabled);
+    // Translate the blocks of the block cache to native code, which only has an effect while the
+    // block cache is enabled. Disabled by default. Only x64 builds with xbyak have a recompiler,
+    // elsewhere this does nothing
+    void SetRecompilerEnabled(bool enabled);
+    // Must be called after writing program memory through the pointer from GetDspMemory, as such
+    // writes bypass the cache. ProgramWrite takes care of this by itself
+    void InvalidateCodeCache();
+
     void SetAHBMCallback(const AHBMCallback& callback);
 
     void SetAudioCallback(std::function<void(std::array<std::int16_t, 2>)> callback);
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+#include <teakra/teakra.h>
+#include "../common_types.h"
+#include "../parser.h"
+#include "register.h"
+
+// Compares the cycle throughput of the plain interpreter, the block cache and, in builds that have
+// it, the recompiler on a synthetic workload resembling audio firmware: a multiply-accumulate loop
+// over a buffer, some ALU work, a subroutine call and an MMIO read per outer iteration. All engines
+// must end in the same state.
+
+struct Line {
+    const char* text;
+    u16 expansion = 0;
+};
+
+// clang-format off
+static const Line program[] = {
+    {"mov 0x0000 r0", 0x0100},              // 0x00: input buffer
+    {"mov 0x0000 r1", 0x0200},              // 0x02: coefficients
+    {"mov 0x0000 r4", 0x0300},              // 0x04: output buffer
+    {"clr a0 always"},                      // 0x06
+    {"clr b0 always"},                      // 0x07
+    {"bkrep 0x003fu8 0x00000000", 0x000D},  // 0x08: 64 taps, loop ends at 0x0D
+    {"mov [r0++] y0"},                      // 0x0A
+    {"mov [r1++] b1l"},                     // 0x0B
+    {"mov b1l x1"},                         // 0x0C
+    {"mac y0 x1->x0 a0"},                   // 0x0D
+    {"mov a0h [r4++]"},                     // 0x0E
+    {"add a0 b0"},                          // 0x0F
+    {"inc a1 always"},                      // 0x10
+    {"call 0x00000000 always", 0x0018},     // 0x11
+    {"mov 0x0000 r2", 0x80CC},              // 0x13: APBP semaphore register
+    {"mov [r2] b1h"},                       // 0x15
+    {"br 0x00000000 always", 0x0000},       // 0x16
+    {"add a0 b1"},                          // 0x18: subroutine
+    {"ret always"},                         // 0x19
+};
+// clang-format on
+
+static std::vector<std::string> StringToTokens(const std::string& in) {
+    std::vector<std::string> out;
+    bool need_new = true;
+    for (char c : in) {
+        if (c == ' ' || c == '\t') {
+            need_new = true;
+        } else {
+            if (need_new) {
+                need_new = false;
+                out.push_back("");
+            }
+            out.back() += c;
+        }
+    }
+    return out;
+}
+
+static std::vector<u16> Assemble() {
+    auto parser = Teakra::GenerateParser();
+    std::vector<u16> code;
+    for (const auto& line : program) {
+        auto opcode = parser->Parse(StringToTokens(line.text));
+        if (opcode.status == Teakra::Parser::Opcode::Invalid) {
+            std::fprintf(stderr, "Could not assemble \"%s\"\n", line.text);
+            std::exit(-1);
+        }
+
+        code.push_back(opcode.opcode);
+        if (opcode.status == Teakra::Parser::Opcode::ValidWithExpansion) {
+            code.push_back(line.expansion);
+        }
+    }
+    return code;
+}
+
+enum class Engine {
+    Interpreter,
+    BlockCache,
+    Recompiler,
+};
+
+struct Result {
+    double seconds;
+    Teakra::RegisterState regs;
+    std::vector<u16> output;
+};
+
+static Result Run(const std::vector<u16>& code, Engine engine, u64 cycles) {
+    Teakra::Teakra teakra{Teakra::UserConfig{}};
+    for (u32 i = 0; i < code.size(); ++i) {
+        teakra.ProgramWrite(i, code[i]);
+    }
+    for (u16 i = 0; i < 0x40; ++i) {
+        teakra.DataWrite(0x100 + i, (u16)(i * 0x0123 + 7));
+        teakra.DataWrite(0x200 + i, (u16)(0x4000 - i * 0x0101));
+    }
+    teakra.SetBlockCacheEnabled(engine != Engine::Interpreter);
+    teakra.SetRecompilerEnabled(engine == Engine::Recompiler);
+
+    // Run in slices like an emulator would, so that the cost of entering the core is included
+    constexpr u64 slice = 16384;
+    auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < cycles; i += slice) {
+        teakra.Run((unsigned)std::min(slice, cycles - i));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.regs = teakra.GetRegisterState();
+    for (u16 i = 0; i < 0x40; ++i) {
+        result.output.push_back(teakra.DataRead(0x300 + i));
+    }
+    return result;
+}
+
+// Timings of a single run vary a lot on a busy machine, so keep the fastest of a few
+static Result RunBest(const std::vector<u16>& code, Engine engine, u64 cycles) {
+    Result best = Run(code, engine, cycles);
+    for (int i = 1; i < 3; ++i) {
+        Result result = Run(code, engine, cycles);
+        if (result.seconds < best.seconds) {
+            best = std::move(result);
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    u64 cycles = 50'000'000;
+    if (argc >= 2) {
+        cycles = std::strtoull(argv[1], nullptr, 0);
+    }
+
+    const std::vector<u16> code = Assemble();
+    const Result interpreter = RunBest(code, Engine::Interpreter, cycles);
+    std::printf("interpreter: %.2f Mcycles/s\n", cycles / interpreter.seconds / 1e6);
+
+    auto check = [&](const char* name, Engine engine) {
+        const Result result = RunBest(code, engine, cycles);
+        std::printf("%s: %.2f Mcycles/s (%.2fx)\n", name, cycles / result.seconds / 1e6,
+                    interpreter.seconds / result.seconds);
+
+        const auto& a = interpreter.regs;
+        const auto& b = result.regs;
+        const bool match = a.pc == b.pc && a.a == b.a && a.b == b.b && a.r == b.r && a.x == b.x &&
+                           a.y == b.y && a.p == b.p && a.sp == b.sp && a.bcn == b.bcn &&
+                           a.lp == b.lp && interpreter.output == result.output;
+        if (!match) {
+            std::printf("State mismatch between the interpreter and the %s!\n", name);
+        }
+        return match;
+    };
+
+    bool match = check("block cache", Engine::BlockCache);
+#ifdef TEAKRA_JIT_X64
+    match = check("recompiler", Engine::Recompiler) && match;
+#endif
+    return match ? 0 : -1;
+}
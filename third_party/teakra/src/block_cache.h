@@ -0,0 +1,124 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "common_types.h"
+#include "matcher.h"
+#include "memory_interface.h"
+
+namespace Teakra {
+
+// Straight-line runs of pre-decoded instructions, used by Interpreter::RunBlocks so that it doesn't
+// have to fetch and decode every instruction it executes. A block ends before undefined opcodes or
+// after MaxBlockSize instructions. Branches don't end blocks: the block engine leaves a block as
+// soon as the PC doesn't point to the next instruction in it.
+// Cached instructions run through the interpreter's handlers, unless the recompiler has translated
+// the block to native code.
+template <typename Visitor>
+class BlockCache {
+public:
+    struct Instruction {
+        const Matcher<Visitor>* decoder;
+        u16 opcode;
+        u16 expansion;
+        u32 next_pc; // Address of the instruction after this one
+    };
+
+    struct Block {
+        u32 start;
+        u32 end; // Address after the last instruction of the block
+        std::vector<Instruction> instructions;
+        const void* host_code = nullptr; // Set by the recompiler, if any
+    };
+
+    // Only program memory below this is cached. Anything else, including other program pages, is
+    // left to the interpreter
+    static constexpr u32 CachedProgramSize = 0x20000;
+    static constexpr std::size_t MaxBlockSize = 64;
+
+    Block* Get(u32 address) {
+        if (address >= CachedProgramSize || blocks.empty()) {
+            return nullptr;
+        }
+        return blocks[address].get();
+    }
+
+    // Returns nullptr if no block can be built at this address, eg if the first instruction there
+    // is undefined
+    Block* Compile(u32 address, const std::vector<Matcher<Visitor>>& decoders,
+                   const MemoryInterface& mem) {
+        if (address >= CachedProgramSize) {
+            return nullptr;
+        }
+        if (blocks.empty()) {
+            blocks.resize(CachedProgramSize);
+        }
+
+        auto block = std::make_unique<Block>();
+        block->start = address;
+
+        u32 pc = address;
+        while (block->instructions.size() < MaxBlockSize && pc < CachedProgramSize) {
+            const u16 opcode = mem.ProgramRead(pc);
+            const auto& decoder = decoders[opcode];
+            if (std::string_view(decoder.GetName()) == "*") {
+                break;
+            }
+
+            u16 expansion = 0;
+            u32 next_pc = pc + 1;
+            if (decoder.NeedExpansion()) {
+                if (next_pc >= CachedProgramSize) {
+                    break;
+                }
+                expansion = mem.ProgramRead(next_pc++);
+            }
+
+            block->instructions.push_back(Instruction{&decoder, opcode, expansion, next_pc});
+            pc = next_pc;
+        }
+
+        if (block->instructions.empty()) {
+            return nullptr;
+        }
+
+        block->end = pc;
+        blocks[address] = std::move(block);
+        return blocks[address].get();
+    }
+
+    // Drop every block that contains the program word at this address
+    void Invalidate(u32 address) {
+        if (address >= CachedProgramSize || blocks.empty()) {
+            return;
+        }
+
+        // Instructions are at most 2 words, so a block can't start further back than this
+        const u32 first = address >= MaxBlockSize * 2 ? address - MaxBlockSize * 2 + 1 : 0;
+        for (u32 start = first; start <= address; ++start) {
+            if (blocks[start] && blocks[start]->end > address) {
+                blocks[start] = nullptr;
+            }
+        }
+    }
+
+    void Clear() {
+        blocks.clear();
+    }
+
+    // Forget the native code of every block, eg when the recompiler has thrown it away
+    void ClearHostCode() {
+        for (auto& block : blocks) {
+            if (block) {
+                block->host_code = nullptr;
+            }
+        }
+    }
+
+private:
+    // Indexed by the start address of the block. Allocated on first use
+    std::vector<std::unique_ptr<Block>> blocks;
+};
+
+} // namespace Teakra
@@ -25,6 +25,15 @@ public:
         }
     }
 
+    // Number of ticks that can be skipped before any component needs to fire an event
+    u64 GetMaxSkip() const {
+        u64 ticks = Callbacks::Infinity;
+        for (const auto& callbacks : registered_callbacks) {
+            ticks = std::min(ticks, callbacks->GetMaxSkip());
+        }
+        return ticks;
+    }
+
     u64 Skip(u64 maximum) {
         u64 ticks = maximum;
         for (const auto& callbacks : registered_callbacks) {
@@ -1,18 +1,25 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <memory>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 #include "bit.h"
+#include "block_cache.h"
 #include "core_timing.h"
 #include "crash.h"
 #include "decoder.h"
 #include "memory_interface.h"
 #include "operand.h"
 #include "register.h"
+#ifdef TEAKRA_JIT_X64
+#include "jit_x64.h"
+#endif
 
 namespace Teakra {
 
@@ -21,10 +28,12 @@ public:
     UnimplementedException() : std::runtime_error("unimplemented") {}
 };
 
-class Interpreter {
+class Interpreter : public MemoryInterface::Callbacks {
 public:
     Interpreter(CoreTiming& core_timing, RegisterState& regs, MemoryInterface& mem)
-        : core_timing(core_timing), regs(regs), mem(mem) {}
+        : core_timing(core_timing), regs(regs), mem(mem) {
+        mem.SetCallbacks(this);
+    }
 
     void PushPC() {
         u16 l = (u16)(regs.pc & 0xFFFF);
@@ -63,86 +72,111 @@ public:
         idle = false;
         for (u64 i = 0; i < cycles; ++i) {
             if (idle) {
-                u64 skipped = core_timing.Skip(cycles - i - 1);
-                i += skipped;
+                SkipIdle(i, cycles);
+            }
 
-                // Skip additional tick so to let components fire interrupts
-                if (i < cycles - 1) {
-                    ++i;
-                    core_timing.Tick();
-                }
+            TransferPendingInterrupts();
+            Step();
+            core_timing.Tick();
+        }
+    }
+
+    // Same as Run, but executes straight-line code from the block cache instead of fetching and
+    // decoding every instruction. Falls back to Step for anything the cache doesn't cover
+    void RunBlocks(u64 cycles) {
+        idle = false;
+        for (u64 i = 0; i < cycles;) {
+            if (idle) {
+                SkipIdle(i, cycles);
             }
 
-            for (std::size_t i = 0; i < 3; ++i) {
-                if (interrupt_pending[i].exchange(false)) {
-                    regs.ip[i] = 1;
+            TransferPendingInterrupts();
+
+            BlockCache<Interpreter>::Block* block = nullptr;
+            if (!regs.rep && regs.prpage == 0) {
+                block = block_cache.Get(regs.pc);
+                if (block == nullptr) {
+                    block = block_cache.Compile(regs.pc, decoders, mem);
                 }
             }
 
-            if (vinterrupt_pending.exchange(false)) {
-                regs.ipv = 1;
+            if (block == nullptr) {
+                Step();
+                core_timing.Tick();
+                ++i;
+                continue;
             }
 
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+            // Components may fire an event on the tick after GetMaxSkip() ticks. Stop the block
+            // there, so that any interrupt it raises is taken at the same instruction as in Run
+            u64 budget = cycles - i;
+            const u64 max_skip = core_timing.GetMaxSkip();
+            if (max_skip < budget) {
+                budget = max_skip + 1;
             }
 
-            if (regs.rep) {
-                if (regs.repc == 0) {
-                    regs.rep = false;
-                } else {
-                    --regs.repc;
-                    --regs.pc;
-                }
+            // Nothing can raise an interrupt in the middle of a block, so the per-instruction
+            // interrupt check is only needed if one is already pending
+            const bool interrupt_pending =
+                regs.ipv || std::any_of(regs.ip.begin(), regs.ip.end(), [](u16 ip) { return ip; });
+#ifdef TEAKRA_JIT_X64
+            // The native code never checks for interrupts, and only notices idle when an instruction
+            // sets it
+            if (jit && !interrupt_pending && !idle) {
+                i += RunHostCode(*block, budget);
+                continue;
             }
+#endif
+            i += interrupt_pending ? RunBlock<true>(*block, budget)
+                                   : RunBlock<false>(*block, budget);
+        }
+    }
 
-            if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
-                if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
-                    --regs.bcn;
-                    regs.lp = regs.bcn != 0;
-                } else {
-                    --regs.bkrep_stack[regs.bcn - 1].lc;
-                    regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
-                }
-            }
+    void ClearBlockCache() {
+        block_cache.Clear();
+#ifdef TEAKRA_JIT_X64
+        if (jit) {
+            jit->Clear();
+        }
+#endif
+    }
 
-            decoder.call(*this, opcode, expand_value);
-
-            // I am not sure if a single-instruction loop is interruptable and how it is handled,
-            // so just disable interrupt for it for now.
-            if (regs.ie && !regs.rep) {
-                bool interrupt_handled = false;
-                for (u32 i = 0; i < regs.im.size(); ++i) {
-                    if (regs.im[i] && regs.ip[i]) {
-                        regs.ip[i] = 0;
-                        regs.ie = 0;
-                        PushPC();
-                        regs.pc = 0x0006 + i * 8;
-                        idle = false;
-                        interrupt_handled = true;
-                        if (regs.ic[i]) {
-                            ContextStore();
-                        }
-                        break;
-                    }
-                }
-                if (!interrupt_handled && regs.imv && regs.ipv) {
-                    regs.ipv = 0;
-                    regs.ie = 0;
-                    PushPC();
-                    regs.pc = vinterrupt_address;
-                    idle = false;
-                    if (vinterrupt_context_switch) {
-                        ContextStore();
-                    }
-                }
-            }
+    // Lets RunBlocks translate blocks to native code. Does nothing in builds without a recompiler
+    // for the host
+    void SetRecompilerEnabled(bool enabled) {
+#ifdef TEAKRA_JIT_X64
+        block_cache.ClearHostCode();
+        if (!enabled) {
+            jit.reset();
+        } else if (!jit) {
+            jit = std::make_unique<JitX64<Interpreter>>(*this, regs, block_pending_ticks,
+                                                        block_exit_requested, idle);
+        }
+#endif
+    }
 
-            core_timing.Tick();
+    // MemoryInterface::Callbacks
+    void BeforeMMIOAccess() override {
+        if (!in_block) {
+            return;
         }
+
+        // Bring the components up to date before the access, and stop the block after it, as it
+        // may change when they next fire an event
+        AdvanceTiming(block_pending_ticks);
+        block_pending_ticks = 0;
+        block_exit_requested = true;
+    }
+
+    void OnProgramWrite(u32 address) override {
+        if (!in_block) {
+            block_cache.Invalidate(address);
+            return;
+        }
+
+        // The running block may be the one being invalidated, so wait until it has finished
+        pending_invalidations.push_back(address);
+        block_exit_requested = true;
     }
 
     void SignalInterrupt(u32 i) {
@@ -2942,6 +2976,182 @@ private:
 
     bool idle = false;
 
+    BlockCache<Interpreter> block_cache;
+    bool in_block = false;
+    bool block_exit_requested = false;
+    u64 block_pending_ticks = 0;
+    std::vector<u32> pending_invalidations;
+
+#ifdef TEAKRA_JIT_X64
+    std::unique_ptr<JitX64<Interpreter>> jit; // Only allocated while the recompiler is enabled
+#endif
+
+    void SkipIdle(u64& i, u64 cycles) {
+        u64 skipped = core_timing.Skip(cycles - i - 1);
+        i += skipped;
+
+        // Skip additional tick so to let components fire interrupts
+        if (i < cycles - 1) {
+            ++i;
+            core_timing.Tick();
+        }
+    }
+
+    void TransferPendingInterrupts() {
+        for (std::size_t i = 0; i < 3; ++i) {
+            if (interrupt_pending[i].exchange(false)) {
+                regs.ip[i] = 1;
+            }
+        }
+
+        if (vinterrupt_pending.exchange(false)) {
+            regs.ipv = 1;
+        }
+    }
+
+    // Executes one instruction, without ticking the components
+    void Step() {
+        u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        auto& decoder = decoders[opcode];
+        u16 expand_value = 0;
+        if (decoder.NeedExpansion()) {
+            expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        }
+
+        if (regs.rep) {
+            if (regs.repc == 0) {
+                regs.rep = false;
+            } else {
+                --regs.repc;
+                --regs.pc;
+            }
+        }
+
+        CheckBlockRepeatEnd();
+        decoder.call(*this, opcode, expand_value);
+        CheckInterrupts();
+    }
+
+    void CheckBlockRepeatEnd() {
+        if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
+            if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
+                --regs.bcn;
+                regs.lp = regs.bcn != 0;
+            } else {
+                --regs.bkrep_stack[regs.bcn - 1].lc;
+                regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
+            }
+        }
+    }
+
+    void CheckInterrupts() {
+        // I am not sure if a single-instruction loop is interruptable and how it is handled,
+        // so just disable interrupt for it for now.
+        if (regs.ie && !regs.rep) {
+            bool interrupt_handled = false;
+            for (u32 i = 0; i < regs.im.size(); ++i) {
+                if (regs.im[i] && regs.ip[i]) {
+                    regs.ip[i] = 0;
+                    regs.ie = 0;
+                    PushPC();
+                    regs.pc = 0x0006 + i * 8;
+                    idle = false;
+                    interrupt_handled = true;
+                    if (regs.ic[i]) {
+                        ContextStore();
+                    }
+                    break;
+                }
+            }
+            if (!interrupt_handled && regs.imv && regs.ipv) {
+                regs.ipv = 0;
+                regs.ie = 0;
+                PushPC();
+                regs.pc = vinterrupt_address;
+                idle = false;
+                if (vinterrupt_context_switch) {
+                    ContextStore();
+                }
+            }
+        }
+    }
+
+    // Runs instructions of the block until control leaves it, or until budget instructions have
+    // run. Returns the number of instructions executed, which have all been ticked for
+    template <bool check_interrupts>
+    u64 RunBlock(const BlockCache<Interpreter>::Block& block, u64 budget) {
+        in_block = true;
+        block_exit_requested = false;
+        block_pending_ticks = 0;
+
+        u64 executed = 0;
+        for (const auto& instruction : block.instructions) {
+            regs.pc = instruction.next_pc;
+            CheckBlockRepeatEnd();
+            instruction.decoder->call_unchecked(*this, instruction.opcode, instruction.expansion);
+            if constexpr (check_interrupts) {
+                CheckInterrupts();
+            }
+
+            ++executed;
+            ++block_pending_ticks;
+
+            if (executed == budget || block_exit_requested || idle || regs.rep ||
+                regs.prpage != 0 || regs.pc != instruction.next_pc) {
+                break;
+            }
+        }
+
+        FinishBlock();
+        return executed;
+    }
+
+#ifdef TEAKRA_JIT_X64
+    // Same as RunBlock<false>, through the native code of the block
+    u64 RunHostCode(BlockCache<Interpreter>::Block& block, u64 budget) {
+        if (block.host_code == nullptr && !jit->Compile(block)) {
+            // Out of space for native code. Drop all of it, there's then room for this block
+            block_cache.ClearHostCode();
+            jit->Clear();
+            const bool compiled = jit->Compile(block);
+            ASSERT(compiled);
+        }
+
+        in_block = true;
+        block_exit_requested = false;
+        block_pending_ticks = 0;
+
+        const u64 executed = jit->Run(block, budget);
+        FinishBlock();
+        return executed;
+    }
+#endif
+
+    // Settles the ticks and program writes held back while a block ran
+    void FinishBlock() {
+        in_block = false;
+        AdvanceTiming(block_pending_ticks);
+        block_pending_ticks = 0;
+
+        for (u32 address : pending_invalidations) {
+            block_cache.Invalidate(address);
+        }
+        pending_invalidations.clear();
+    }
+
+    // Equivalent to calling core_timing.Tick() this many times
+    void AdvanceTiming(u64 ticks) {
+        while (ticks != 0) {
+            const u64 max_skip = core_timing.GetMaxSkip();
+            if (max_skip == 0) {
+                core_timing.Tick();
+                --ticks;
+            } else {
+                ticks -= core_timing.Skip(std::min(ticks, max_skip));
+            }
+        }
+    }
+
     u64 GetAcc(RegName name) const {
         switch (name) {
         case RegName::a0:
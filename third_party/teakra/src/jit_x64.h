@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <xbyak/xbyak.h>
+#include "block_cache.h"
+#include "decoder.h"
+#include "matcher.h"
+#include "operand.h"
+#include "register.h"
+
+namespace Teakra {
+
+// Translates blocks of the block cache into x64 code. The instructions below that have a native
+// translation run inline; every other one is a call to its handler in Visitor, so any block the
+// cache can build can be translated. The generated code follows the block engine step for step:
+// same tick counting, same exits on MMIO accesses, program writes, idle loops, repeats and branches
+// out of the block. The one difference is that a block repeat loop going back to the start of the
+// block keeps running in native code instead of returning to the dispatcher every iteration.
+template <typename Visitor>
+class JitX64 : private Xbyak::CodeGenerator {
+public:
+    using instruction_return_type = bool; // Whether the instruction was translated to native code
+    using Block = typename BlockCache<Visitor>::Block;
+    using Instruction = typename BlockCache<Visitor>::Instruction;
+
+    // When the generated code doesn't fit anymore, all of it is dropped and blocks are translated
+    // again as they run
+    static constexpr std::size_t CodeSize = 4 * 1024 * 1024;
+
+    // The generated code updates the tick counter and flags of the block engine in place
+    JitX64(Visitor& visitor, RegisterState& regs, u64& pending_ticks, bool& exit_requested,
+           bool& idle)
+        : Xbyak::CodeGenerator(CodeSize), visitor(visitor), regs(regs),
+          pending_ticks(pending_ticks), exit_requested(exit_requested), idle(idle) {}
+
+    // Returns false if there's no space left for the code of this block
+    bool Compile(Block& block) {
+        const std::size_t max_size =
+            MaxBlockOverhead + block.instructions.size() * MaxInstructionSize;
+        if (getSize() + max_size > CodeSize) {
+            return false;
+        }
+
+        block.host_code = getCurr();
+        const std::size_t code_start = getSize();
+
+        Xbyak::Label start, exit;
+        for (const auto& reg : saved_regs) {
+            push(reg);
+        }
+        sub(rsp, StackReserve);
+        mov(rbp, reinterpret_cast<std::uintptr_t>(&regs));
+        mov(rbx, reinterpret_cast<std::uintptr_t>(&pending_ticks));
+        mov(r14, reinterpret_cast<std::uintptr_t>(&exit_requested));
+        mov(r15, reinterpret_cast<std::uintptr_t>(&idle));
+        xor_(r12d, r12d); // Instructions executed
+        mov(r13, param1); // Budget
+
+        L(start);
+        for (const auto& instruction : block.instructions) {
+            CompileInstruction(block, instruction, start, exit);
+        }
+
+        L(exit);
+        mov(rax, r12);
+        add(rsp, StackReserve);
+        for (auto reg = saved_regs.rbegin(); reg != saved_regs.rend(); ++reg) {
+            pop(*reg);
+        }
+        ret();
+
+        ASSERT(getSize() - code_start <= max_size);
+        return true;
+    }
+
+    // Same contract as Interpreter::RunBlock<false>, except for the block engine state that the
+    // caller sets up and finishes
+    u64 Run(const Block& block, u64 budget) {
+        const auto code = reinterpret_cast<u64 (*)(u64)>(block.host_code);
+        const u64 executed = code(budget);
+        if (exception) {
+            std::rethrow_exception(std::exchange(exception, nullptr));
+        }
+        return executed;
+    }
+
+    // Drops all generated code. Blocks that have some must forget about it first
+    void Clear() {
+        reset();
+    }
+
+    // Native translations. These emit nothing and return false if they can't handle the operands
+    bool nop() {
+        return true;
+    }
+
+    bool load_ps(Imm2 a) {
+        return Store(regs.ps[0], a.Unsigned16());
+    }
+    bool load_stepi(Imm7s a) {
+        return Store(regs.stepi, a.Signed16() & 0x7F);
+    }
+    bool load_stepj(Imm7s a) {
+        return Store(regs.stepj, a.Signed16() & 0x7F);
+    }
+    bool load_page(Imm8 a) {
+        return Store(regs.page, a.Unsigned16());
+    }
+    bool load_modi(Imm9 a) {
+        return Store(regs.modi, a.Unsigned16());
+    }
+    bool load_modj(Imm9 a) {
+        return Store(regs.modj, a.Unsigned16());
+    }
+    bool load_movpd(Imm2 a) {
+        return Store(regs.pcmhi, a.Unsigned16());
+    }
+    bool load_ps01(Imm4 a) {
+        Store(regs.ps[0], a.Unsigned16() & 3);
+        return Store(regs.ps[1], a.Unsigned16() >> 2);
+    }
+
+    bool mov_sv(Imm8s a) {
+        return Store(regs.sv, a.Signed16());
+    }
+    bool mov_ext0(Imm8s a) {
+        return Store(regs.ext[0], a.Signed16());
+    }
+    bool mov_ext1(Imm8s a) {
+        return Store(regs.ext[1], a.Signed16());
+    }
+    bool mov_ext2(Imm8s a) {
+        return Store(regs.ext[2], a.Signed16());
+    }
+    bool mov_ext3(Imm8s a) {
+        return Store(regs.ext[3], a.Signed16());
+    }
+    bool mov(Imm16 a, Register b) {
+        u16* reg = PlainRegister(b.GetName());
+        return reg != nullptr && Store(*reg, a.Unsigned16());
+    }
+    bool mov(Imm8s a, RnOld b) {
+        u16* reg = PlainRegister(b.GetName());
+        return reg != nullptr && Store(*reg, a.Signed16());
+    }
+    bool mov(Register a, Register b) {
+        u16* src = PlainRegister(a.GetName());
+        u16* dst = PlainRegister(b.GetName());
+        if (src == nullptr || dst == nullptr) {
+            return false;
+        }
+        movzx(eax, word[rbp + Offset(*src)]);
+        mov(word[rbp + Offset(*dst)], ax);
+        return true;
+    }
+
+    bool br(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
+        if (cond.GetName() != CondValue::True) {
+            return false;
+        }
+        mov(dword[rbp + Offset(regs.pc)], Address32(addr_low, addr_high));
+        return true;
+    }
+
+private:
+    // The native translation of mov hides the x64 one otherwise
+    using Xbyak::CodeGenerator::mov;
+
+    Visitor& visitor;
+    RegisterState& regs;
+    u64& pending_ticks;
+    bool& exit_requested;
+    bool& idle;
+
+    // Thrown by a handler, held until the generated code has returned, as it can't unwind
+    std::exception_ptr exception;
+
+    // Register allocation in the generated code:
+    // rbp: &regs, rbx: &pending_ticks, r14: &exit_requested, r15: &idle,
+    // r12: instructions executed, r13: budget. rax, rcx and the parameter registers are scratch
+#ifdef _WIN32
+    static constexpr std::size_t StackReserve = 8 + 32; // Alignment, plus shadow space for calls
+    const Xbyak::Reg64 param1 = rcx, param2 = rdx, param3 = r8;
+#else
+    static constexpr std::size_t StackReserve = 8; // Alignment
+    const Xbyak::Reg64 param1 = rdi, param2 = rsi, param3 = rdx;
+#endif
+    const std::vector<Xbyak::Reg64> saved_regs{rbx, rbp, r12, r13, r14, r15};
+
+    // Upper bounds of the code size for each instruction, and for the rest of a block
+    static constexpr std::size_t MaxInstructionSize = 512;
+    static constexpr std::size_t MaxBlockOverhead = 128;
+
+    static const std::vector<Matcher<JitX64>>& NativeForms() {
+        // Same encodings as in decoder.h, for the instructions translated above
+        static const std::vector<Matcher<JitX64>> forms{
+            MatcherCreator<JitX64, 0x0000>::Create("nop", &JitX64::nop),
+            MatcherCreator<JitX64, 0x4180, At<Address18_16, 16>, At<Address18_2, 4>,
+                           At<Cond, 0>>::Create("br", &JitX64::br),
+            MatcherCreator<JitX64, 0x4D80, At<Imm2, 0>>::Create("load_ps", &JitX64::load_ps),
+            MatcherCreator<JitX64, 0xDB80, At<Imm7s, 0>>::Create("load_stepi",
+                                                                  &JitX64::load_stepi),
+            MatcherCreator<JitX64, 0xDF80, At<Imm7s, 0>>::Create("load_stepj",
+                                                                  &JitX64::load_stepj),
+            MatcherCreator<JitX64, 0x0400, At<Imm8, 0>>::Create("load_page", &JitX64::load_page),
+            MatcherCreator<JitX64, 0x0200, At<Imm9, 0>>::Create("load_modi", &JitX64::load_modi),
+            MatcherCreator<JitX64, 0x0A00, At<Imm9, 0>>::Create("load_modj", &JitX64::load_modj),
+            MatcherCreator<JitX64, 0xD7D8, At<Imm2, 1>, Unused<0>>::Create("load_movpd",
+                                                                            &JitX64::load_movpd),
+            MatcherCreator<JitX64, 0x0010, At<Imm4, 0>>::Create("load_ps01", &JitX64::load_ps01),
+            MatcherCreator<JitX64, 0x0500, At<Imm8s, 0>>::Create("mov_sv", &JitX64::mov_sv),
+            MatcherCreator<JitX64, 0x2900, At<Imm8s, 0>>::Create("mov_ext0", &JitX64::mov_ext0),
+            MatcherCreator<JitX64, 0x2D00, At<Imm8s, 0>>::Create("mov_ext1", &JitX64::mov_ext1),
+            MatcherCreator<JitX64, 0x3900, At<Imm8s, 0>>::Create("mov_ext2", &JitX64::mov_ext2),
+            MatcherCreator<JitX64, 0x3D00, At<Imm8s, 0>>::Create("mov_ext3", &JitX64::mov_ext3),
+            MatcherCreator<JitX64, 0x5E00, At<Imm16, 16>, At<Register, 0>>::Create("mov",
+                                                                                    &JitX64::mov),
+            MatcherCreator<JitX64, 0x2300, At<Imm8s, 0>, At<RnOld, 10>>::Create("mov",
+                                                                                 &JitX64::mov),
+            MatcherCreator<JitX64, 0x5800, At<Register, 0>, At<Register, 5>>::Create("mov",
+                                                                                      &JitX64::mov),
+        };
+        return forms;
+    }
+
+    static void CallHandler(JitX64* jit, const Matcher<Visitor>* decoder, u32 instruction) {
+        try {
+            decoder->call_unchecked(jit->visitor, (u16)instruction, (u16)(instruction >> 16));
+        } catch (...) {
+            jit->exception = std::current_exception();
+            jit->exit_requested = true;
+        }
+    }
+
+    void CompileInstruction(const Block& block, const Instruction& instruction,
+                            const Xbyak::Label& start, const Xbyak::Label& exit) {
+        mov(dword[rbp + Offset(regs.pc)], instruction.next_pc);
+        CompileBlockRepeatEnd(instruction.next_pc);
+
+        const bool native = CompileNative(instruction);
+        if (!native) {
+            mov(param1, reinterpret_cast<std::uintptr_t>(this));
+            mov(param2, reinterpret_cast<std::uintptr_t>(instruction.decoder));
+            mov(param3.cvt32(), instruction.opcode | (u32)instruction.expansion << 16);
+            mov(rax, reinterpret_cast<std::uintptr_t>(&CallHandler));
+            call(rax);
+        }
+
+        inc(r12);
+        inc(qword[rbx]);
+        cmp(r12, r13);
+        je(exit, Xbyak::T_NEAR);
+
+        // The native translations never touch these, so they are only checked after handlers
+        if (!native) {
+            cmp(byte[r14], 0);
+            jne(exit, Xbyak::T_NEAR);
+            cmp(byte[r15], 0);
+            jne(exit, Xbyak::T_NEAR);
+            cmp(byte[rbp + Offset(regs.rep)], 0);
+            jne(exit, Xbyak::T_NEAR);
+            cmp(word[rbp + Offset(regs.prpage)], 0);
+            jne(exit, Xbyak::T_NEAR);
+        }
+
+        // When control leaves the straight line, keep going if it's back to the start of the block
+        Xbyak::Label next;
+        cmp(dword[rbp + Offset(regs.pc)], instruction.next_pc);
+        je(next, Xbyak::T_NEAR);
+        cmp(dword[rbp + Offset(regs.pc)], block.start);
+        je(start, Xbyak::T_NEAR);
+        jmp(exit, Xbyak::T_NEAR);
+        L(next);
+    }
+
+    // Interpreter::CheckBlockRepeatEnd, for regs.pc == pc
+    void CompileBlockRepeatEnd(u32 pc) {
+        using Frame = RegisterState::BlockRepeatFrame;
+        // Offset of bkrep_stack[bcn - 1] from &regs + bcn * sizeof(Frame)
+        const int frame = Offset(regs.bkrep_stack[0]) - (int)sizeof(Frame);
+
+        Xbyak::Label done, repeat;
+        cmp(word[rbp + Offset(regs.lp)], 0);
+        je(done, Xbyak::T_NEAR);
+        movzx(eax, word[rbp + Offset(regs.bcn)]);
+        imul(eax, eax, (int)sizeof(Frame));
+        add(rax, rbp);
+        cmp(dword[rax + (frame + (int)offsetof(Frame, end))], pc - 1);
+        jne(done, Xbyak::T_NEAR);
+        cmp(word[rax + (frame + (int)offsetof(Frame, lc))], 0);
+        jne(repeat, Xbyak::T_NEAR);
+
+        dec(word[rbp + Offset(regs.bcn)]);
+        setne(cl);
+        movzx(ecx, cl);
+        mov(word[rbp + Offset(regs.lp)], cx);
+        jmp(done, Xbyak::T_NEAR);
+
+        L(repeat);
+        dec(word[rax + (frame + (int)offsetof(Frame, lc))]);
+        mov(ecx, dword[rax + (frame + (int)offsetof(Frame, start))]);
+        mov(dword[rbp + Offset(regs.pc)], ecx);
+        L(done);
+    }
+
+    bool CompileNative(const Instruction& instruction) {
+        const auto& decoder = *instruction.decoder;
+        for (const auto& form : NativeForms()) {
+            if (form.GetMask() == decoder.GetMask() && form.GetExpected() == decoder.GetExpected() &&
+                std::string_view(form.GetName()) == decoder.GetName()) {
+                return form.call_unchecked(*this, instruction.opcode, instruction.expansion);
+            }
+        }
+        return false;
+    }
+
+    // Registers that RegToBus16 and RegFromBus16 read and write as they are
+    u16* PlainRegister(RegName name) {
+        switch (name) {
+        case RegName::r0:
+        case RegName::r1:
+        case RegName::r2:
+        case RegName::r3:
+        case RegName::r4:
+        case RegName::r5:
+        case RegName::r6:
+        case RegName::r7:
+            return &regs.r[(int)name - (int)RegName::r0];
+        case RegName::y0:
+            return &regs.y[0];
+        case RegName::sp:
+            return &regs.sp;
+        case RegName::sv:
+            return &regs.sv;
+        case RegName::ext0:
+        case RegName::ext1:
+        case RegName::ext2:
+        case RegName::ext3:
+            return &regs.ext[(int)name - (int)RegName::ext0];
+        default:
+            return nullptr;
+        }
+    }
+
+    bool Store(u16& field, u16 value) {
+        mov(word[rbp + Offset(field)], value);
+        return true;
+    }
+
+    template <typename T>
+    int Offset(const T& field) const {
+        return (int)(reinterpret_cast<const u8*>(&field) - reinterpret_cast<const u8*>(&regs));
+    }
+};
+
+} // namespace Teakra
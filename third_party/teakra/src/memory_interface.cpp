@@ -11,15 +11,25 @@ void MemoryInterface::SetMMIO(MMIORegion& mmio) {
     this->mmio = &mmio;
 }
 
+void MemoryInterface::SetCallbacks(Callbacks* callbacks) {
+    this->callbacks = callbacks;
+}
+
 u16 MemoryInterface::ProgramRead(u32 address) const {
     return shared_memory.ReadWord(address);
 }
 void MemoryInterface::ProgramWrite(u32 address, u16 value) {
     shared_memory.WriteWord(address, value);
+    if (callbacks) {
+        callbacks->OnProgramWrite(address);
+    }
 }
 u16 MemoryInterface::DataRead(u16 address, bool bypass_mmio) {
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
         ASSERT(mmio != nullptr);
+        if (callbacks) {
+            callbacks->BeforeMMIOAccess();
+        }
         return mmio->Read(memory_interface_unit.ToMMIO(address));
     }
     u32 converted = memory_interface_unit.ConvertDataAddress(address);
@@ -29,6 +39,9 @@ u16 MemoryInterface::DataRead(u16 address, bool bypass_mmio) {
 void MemoryInterface::DataWrite(u16 address, u16 value, bool bypass_mmio) {
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
         ASSERT(mmio != nullptr);
+        if (callbacks) {
+            callbacks->BeforeMMIOAccess();
+        }
         return mmio->Write(memory_interface_unit.ToMMIO(address), value);
     }
     u32 converted = memory_interface_unit.ConvertDataAddress(address);
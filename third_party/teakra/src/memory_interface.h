@@ -53,8 +53,18 @@ class MMIORegion;
 
 class MemoryInterface {
 public:
+    // Notified of accesses that code caching the state of the DSP needs to know about
+    class Callbacks {
+    public:
+        virtual ~Callbacks() = default;
+        // Called before a data access hits MMIO, so that timing can be brought up to date first
+        virtual void BeforeMMIOAccess() = 0;
+        virtual void OnProgramWrite(u32 address) = 0;
+    };
+
     MemoryInterface(SharedMemory& shared_memory, MemoryInterfaceUnit& memory_interface_unit);
     void SetMMIO(MMIORegion& mmio);
+    void SetCallbacks(Callbacks* callbacks);
     u16 ProgramRead(u32 address) const;
     void ProgramWrite(u32 address, u16 value);
     u16 DataRead(u16 address, bool bypass_mmio = false); // not const because it can be a FIFO register
@@ -68,6 +78,7 @@ private:
     SharedMemory& shared_memory;
     MemoryInterfaceUnit& memory_interface_unit;
     MMIORegion* mmio;
+    Callbacks* callbacks = nullptr;
 };
 
 } // namespace Teakra
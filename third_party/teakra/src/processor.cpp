@@ -10,6 +10,7 @@ struct Processor::Impl {
     CoreTiming& core_timing;
     RegisterState regs;
     Interpreter interpreter;
+    bool block_cache_enabled = false;
 };
 
 Processor::Processor(CoreTiming& core_timing, MemoryInterface& memory_interface)
@@ -18,10 +19,28 @@ Processor::~Processor() = default;
 
 void Processor::Reset() {
     impl->regs = RegisterState();
+    impl->interpreter.ClearBlockCache();
 }
 
 void Processor::Run(unsigned cycles) {
-    impl->interpreter.Run(cycles);
+    if (impl->block_cache_enabled) {
+        impl->interpreter.RunBlocks(cycles);
+    } else {
+        impl->interpreter.Run(cycles);
+    }
+}
+
+void Processor::SetBlockCacheEnabled(bool enabled) {
+    impl->block_cache_enabled = enabled;
+    impl->interpreter.ClearBlockCache();
+}
+
+void Processor::SetRecompilerEnabled(bool enabled) {
+    impl->interpreter.SetRecompilerEnabled(enabled);
+}
+
+void Processor::InvalidateCodeCache() {
+    impl->interpreter.ClearBlockCache();
 }
 
 void Processor::SignalInterrupt(u32 i) {
@@ -15,6 +15,9 @@ public:
     ~Processor();
     void Reset();
     void Run(unsigned cycles);
+    void SetBlockCacheEnabled(bool enabled);
+    void SetRecompilerEnabled(bool enabled);
+    void InvalidateCodeCache();
     void SignalInterrupt(u32 i);
     void SignalVectoredInterrupt(u32 address, bool context_switch);
 
@@ -92,6 +92,18 @@ void Teakra::Run(unsigned cycle) {
     impl->processor.Run(cycle);
 }
 
+void Teakra::SetBlockCacheEnabled(bool enabled) {
+    impl->processor.SetBlockCacheEnabled(enabled);
+}
+
+void Teakra::SetRecompilerEnabled(bool enabled) {
+    impl->processor.SetRecompilerEnabled(enabled);
+}
+
+void Teakra::InvalidateCodeCache() {
+    impl->processor.InvalidateCodeCache();
+}
+
 bool Teakra::SendDataIsEmpty(std::uint8_t index) const {
     return !impl->apbp_from_cpu.IsDataReady(index);
 }
@@ -126,6 +126,18 @@ void Teakra_Run(TeakraContext* context, unsigned cycle) {
     context->teakra.Run(cycle);
 }
 
+void Teakra_SetBlockCacheEnabled(TeakraContext* context, bool enabled) {
+    context->teakra.SetBlockCacheEnabled(enabled);
+}
+
+void Teakra_SetRecompilerEnabled(TeakraContext* context, bool enabled) {
+    context->teakra.SetRecompilerEnabled(enabled);
+}
+
+void Teakra_InvalidateCodeCache(TeakraContext* context) {
+    context->teakra.InvalidateCodeCache();
+}
+
 void Teakra_SetAHBMCallback(TeakraContext* context, Teakra_AHBMReadCallback8 read8,
                             Teakra_AHBMWriteCallback8 write8, Teakra_AHBMReadCallback16 read16,
                             Teakra_AHBMWriteCallback16 write16, Teakra_AHBMReadCallback32 read32,
@@ -1,3 +1,4 @@
+#include <iterator>
 #include <memory>
 #include <catch.hpp>
 #include "../src/core_timing.h"
@@ -5,6 +6,12 @@
 #include "../src/memory_interface.h"
 #include "../src/shared_memory.h"
 
+enum class Engine {
+    Interpreter,
+    BlockCache,
+    Recompiler,
+};
+
 TEST_CASE("Cycle accuracy", "[interpreter]") {
     Teakra::CoreTiming core_timing;
     Teakra::SharedMemory shared_memory;
@@ -13,6 +20,18 @@ TEST_CASE("Cycle accuracy", "[interpreter]") {
     Teakra::RegisterState regs;
     Teakra::Interpreter interpreter(core_timing, regs, memory_interface);
 
+    // All execution engines must behave the same cycle for cycle. The recompiler is the block cache
+    // again in builds without one
+    const Engine engine = GENERATE(Engine::Interpreter, Engine::BlockCache, Engine::Recompiler);
+    interpreter.SetRecompilerEnabled(engine == Engine::Recompiler);
+    auto run = [&](u64 cycles) {
+        if (engine == Engine::Interpreter) {
+            interpreter.Run(cycles);
+        } else {
+            interpreter.RunBlocks(cycles);
+        }
+    };
+
     regs.pc = 0;
     regs.a[0] = 0;
     regs.a[1] = 0;
@@ -72,85 +91,132 @@ TEST_CASE("Cycle accuracy", "[interpreter]") {
 
     SECTION("Simple counting") {
         memory_interface.ProgramWrite(0x0001, 0x1000);
-        interpreter.Run(1 + 5);
+        run(1 + 5);
         REQUIRE(regs.a[0] == 5);
         REQUIRE(regs.a[1] == 0);
     }
 
     SECTION("Counting with interrupt") {
         memory_interface.ProgramWrite(0x0001, 0x1000);
-        interpreter.Run(1 + 7 + 1 + 3);
+        run(1 + 7 + 1 + 3);
         REQUIRE(regs.a[0] == 7);
         REQUIRE(regs.a[1] == 3);
     }
 
     SECTION("Counting with idle and interrupt") {
         memory_interface.ProgramWrite(0x0001, 0x100D);
-        interpreter.Run(1 + 6);
+        run(1 + 6);
         REQUIRE(regs.a[0] == 3);
         REQUIRE(regs.a[1] == 0);
 
-        interpreter.Run(3);
+        run(3);
         REQUIRE(regs.a[0] == 3);
         REQUIRE(regs.a[1] == 1);
     }
 
     SECTION("Counting with idle and interrupt 2") {
         memory_interface.ProgramWrite(0x0001, 0x100D);
-        interpreter.Run(1 + 7);
+        run(1 + 7);
         REQUIRE(regs.a[0] == 3);
         REQUIRE(regs.a[1] == 0);
 
-        interpreter.Run(3);
+        run(3);
         REQUIRE(regs.a[0] == 3);
         REQUIRE(regs.a[1] == 2);
     }
 
     SECTION("Counting with idle and interrupt 3") {
         memory_interface.ProgramWrite(0x0001, 0x100D);
-        interpreter.Run(1 + 7 + 1 + 2);
+        run(1 + 7 + 1 + 2);
         REQUIRE(regs.a[0] == 3);
         REQUIRE(regs.a[1] == 2);
     }
 
     SECTION("Idle with interrupt 1") {
         memory_interface.ProgramWrite(0x0001, 0x1010);
-        interpreter.Run(1 + 7 + 1 + 2);
+        run(1 + 7 + 1 + 2);
         REQUIRE(regs.a[0] == 0);
         REQUIRE(regs.a[1] == 2);
     }
 
     SECTION("Idle with interrupt 2") {
         memory_interface.ProgramWrite(0x0001, 0x1010);
-        interpreter.Run(1 + 7);
+        run(1 + 7);
         REQUIRE(regs.a[0] == 0);
         REQUIRE(regs.a[1] == 0);
 
-        interpreter.Run(1 + 2);
+        run(1 + 2);
         REQUIRE(regs.a[0] == 0);
         REQUIRE(regs.a[1] == 2);
     }
 
     SECTION("Idle with interrupt 3") {
         memory_interface.ProgramWrite(0x0001, 0x1010);
-        interpreter.Run(1 + 6);
+        run(1 + 6);
         REQUIRE(regs.a[0] == 0);
         REQUIRE(regs.a[1] == 0);
 
         SECTION("Single step on the interrupt") {
-            interpreter.Run(1);
+            run(1);
             REQUIRE(regs.a[0] == 0);
             REQUIRE(regs.a[1] == 0);
 
-            interpreter.Run(1 + 2);
+            run(1 + 2);
             REQUIRE(regs.a[0] == 0);
             REQUIRE(regs.a[1] == 2);
         }
 
         SECTION("Run over the interrupt") {
-            interpreter.Run(1 + 1 + 2);
+            run(1 + 1 + 2);
             REQUIRE(regs.a[0] == 0);
             REQUIRE(regs.a[1] == 2);
         }
     }
 }
+
+TEST_CASE("Block repeat loops", "[interpreter]") {
+    struct Core {
+        Teakra::CoreTiming core_timing;
+        Teakra::SharedMemory shared_memory;
+        Teakra::MemoryInterfaceUnit miu;
+        Teakra::MemoryInterface memory_interface{shared_memory, miu};
+        Teakra::RegisterState regs;
+        Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
+
+        Core() {
+            const u16 program[] = {
+                0x5E00, 0x0100, // mov 0x0100 r0
+                0x5C0F, 0x0007, // bkrep 0x0f, loop ends at 0x0007
+                0x67D0,         // inc a0
+                0x0088,         // modr [r0++]
+                0x5820,         // mov r0 r1
+                0x58E1,         // mov r1 y0
+                0x77D0,         // inc a1
+                0x4180, 0x0000, // br 0x0000
+            };
+            for (u32 i = 0; i < std::size(program); ++i) {
+                memory_interface.ProgramWrite(i, program[i]);
+            }
+        }
+    };
+
+    // Loops keep running in native code with the recompiler, so stop them at every possible point
+    // and compare with the interpreter
+    const Engine engine = GENERATE(Engine::BlockCache, Engine::Recompiler);
+    const u64 slice = GENERATE(1, 2, 3, 7, 16, 100);
+
+    Core reference, core;
+    core.interpreter.SetRecompilerEnabled(engine == Engine::Recompiler);
+    for (u32 i = 0; i < 20; ++i) {
+        reference.interpreter.Run(slice);
+        core.interpreter.RunBlocks(slice);
+
+        REQUIRE(core.regs.pc == reference.regs.pc);
+        REQUIRE(core.regs.a == reference.regs.a);
+        REQUIRE(core.regs.r == reference.regs.r);
+        REQUIRE(core.regs.y == reference.regs.y);
+        REQUIRE(core.regs.lp == reference.regs.lp);
+        REQUIRE(core.regs.bcn == reference.regs.bcn);
+        REQUIRE(core.regs.bkrep_stack[0].lc == reference.regs.bkrep_stack[0].lc);
+    }
+}